@@ -9,6 +9,7 @@
 typedef bool (*items_equal_func)(void *pointer_a, void *pointer_b);
 typedef void (*describe_item_func)(void *pointer, str *s);
 typedef unsigned long *(*hash_item_func)(void *pointer);
+typedef void (*visit_item_func)(void *pointer, void *data);
 
 typedef struct contained_item_info {
     unsigned int item_info_magic;
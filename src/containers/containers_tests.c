@@ -6,11 +6,17 @@
 #include "queue.h"
 #include "stack.h"
 #include "../utils/testing.h"
+#include "../utils/hash.h"
+#include "../utils/intern.h"
 
 #include "../runtime/variants/_variants.h"
 
 
 
+static void append_item(char *item, str *s) {
+    str_adds(s, item);
+}
+
 static void test_list() {
     str *s = new_str();
 
@@ -43,10 +49,67 @@ static void test_list() {
     str_clear(s);
     list_describe(l, "|", s);
     assert(strcmp(str_cstr(s), "a|v|c") == 0);
+    assert(list_length(l) == 3);
+
+    list_remove(l, 2);
+    list_add(l, new_str_variant("z"));
+    list_insert(l, 3, new_str_variant("w"));
+    str_clear(s);
+    list_describe(l, "|", s);
+    assert(strcmp(str_cstr(s), "a|v|z|w") == 0);
+
+    list *plain = list_of(NULL, 3, "x", "y", "z");
+    str_clear(s);
+    list_visit_items(plain, (visit_item_func)append_item, s);
+    assert(strcmp(str_cstr(s), "xyz") == 0);
+    list_free(plain);
 }
 
 static void test_dict() {
+    char buffer[16];
+    const char *symbol = intern("name");
+    assert(intern("name") == symbol);
+    assert(is_interned(symbol));
+    assert(!is_interned("name"));
+    assert(!is_interned(symbol + 1));
+    assert(!is_interned(symbol + 4));
+
+    // symbols longer than a chunk get a chunk of their own
+    char *long_name = malloc(20000 + 1);
+    memset(long_name, 'x', 20000);
+    long_name[20000] = '\0';
+    const char *long_symbol = intern(long_name);
+    assert(long_symbol != long_name && is_interned(long_symbol));
+    assert(intern(long_name) == long_symbol);
+    free(long_name);
+    assert(interned_hash(symbol) == simple_hash("name", 4));
+
+    // symbols and plain strings of the same characters are the same key
+    dict *d = new_dict(NULL);
+    dict_set(d, symbol, "a");
+    strcpy(buffer, "name");
+    assert(dict_has(d, buffer));
+    assert(strcmp(dict_get(d, buffer), "a") == 0);
+    dict_set(d, buffer, "b");
+    assert(dict_count(d) == 1);
+    assert(strcmp(dict_get(d, symbol), "b") == 0);
+
+    dict_set(d, "other", "c");
+    dict_set(d, intern("third"), "d");
+    assert(dict_count(d) == 3);
+    assert(strcmp(dict_get(d, intern("other")), "c") == 0);
+    assert(strcmp(dict_get(d, "third"), "d") == 0);
+    assert(dict_get(d, intern("missing")) == NULL);
 
+    str *s = new_str();
+    dict_visit_items(d, (visit_item_func)append_item, s);
+    assert(str_length(s) == 3 && strchr(str_cstr(s), 'b') && strchr(str_cstr(s), 'c') && strchr(str_cstr(s), 'd'));
+
+    assert(dict_del(d, symbol));
+    assert(!dict_has(d, "name"));
+    assert(!dict_del(d, "name"));
+    assert(dict_count(d) == 2);
+    dict_free(d);
 }
 
 static void test_stack() {
@@ -3,11 +3,15 @@
 #include <stddef.h>
 #include "../utils/cstr.h"
 #include "../utils/str.h"
+#include "../utils/hash.h"
+#include "../utils/intern.h"
 #include "dict.h"
 #include "list.h"
 
 typedef struct dict_entry {
-    const char *key;
+    const char *key;  // a symbol, or a copy owned by the entry
+    unsigned hash;
+    bool interned;
     void *item;
     struct dict_entry *next;
 } dict_entry;
@@ -43,89 +47,95 @@ dict *dict_of(contained_item_info *item_info, int pairs_count, ...) {
     return d;
 }
 
-static unsigned hash(const char *s) {
-    unsigned result = 5381;
-    while (*s) {
-        // result = (result * 33) + char
-        result = ((result << 5) + result) + *s++;
-    }
-    return result;
+// symbols carry their hash, and equal symbols are the same pointer
+typedef struct lookup_key {
+    const char *key;
+    unsigned hash;
+    bool interned;
+} lookup_key;
+
+static inline lookup_key make_lookup_key(const char *key) {
+    lookup_key k = { key, 0, is_interned(key) };
+    k.hash = k.interned ? interned_hash(key) : simple_hash((void *)key, strlen(key));
+    return k;
+}
+
+static inline bool entry_matches(dict_entry *e, lookup_key *k) {
+    if (e->key == k->key)
+        return true;
+    if (e->hash != k->hash)
+        return false;
+    if (k->interned && e->interned)
+        return false;
+    return strcmp(e->key, k->key) == 0;
+}
+
+static dict_entry *find_entry(dict *d, lookup_key *k) {
+    dict_entry *e = d->entries_array[k->hash % (unsigned)d->capacity];
+    while (e != NULL && !entry_matches(e, k))
+        e = e->next;
+    return e;
+}
+
+static void free_entry(dict_entry *e) {
+    if (!e->interned)
+        free((void *)e->key);
+    free(e);
 }
 
 void dict_set(dict *d, const char *key, void *item) {
+    lookup_key k = make_lookup_key(key);
+    dict_entry *existing = find_entry(d, &k);
+    if (existing != NULL) {
+        existing->item = item;
+        return;
+    }
+
     dict_entry *entry = malloc(sizeof(dict_entry));
-    char *p = malloc(strlen(key) + 1);
-    strcpy(p, key);
-    entry->key = p;
+    if (k.interned) {
+        entry->key = key;
+    } else {
+        char *p = malloc(strlen(key) + 1);
+        strcpy(p, key);
+        entry->key = p;
+    }
+    entry->hash = k.hash;
+    entry->interned = k.interned;
     entry->item = item;
+
     entry->next = NULL;
 
-    unsigned slot = hash(key) % (unsigned)d->capacity;
-    if (d->entries_array[slot] == NULL) {
-        d->entries_array[slot] = entry;
-        d->count += 1;
-    } else {
-        dict_entry *e = d->entries_array[slot];
-        while (e != NULL) {
-            if (strcmp(e->key, key) == 0) {
-                e->item = item;
-                return;
-            }
-            if (e->next == NULL) {
-                e->next = entry;
-                d->count += 1;
-                return;
-            }
-            e = e->next;
-        }
-    }
+    dict_entry **link = &d->entries_array[k.hash % (unsigned)d->capacity];
+    while (*link != NULL)
+        link = &(*link)->next;
+    *link = entry;
+    d->count += 1;
 }
 
 bool dict_has(dict *d, const char *key) {
-    int slot = hash(key) % d->capacity;
-    dict_entry *e = d->entries_array[slot];
-    while (e != NULL) {
-        if (strcmp(e->key, key) == 0)
-            return true;
-        e = e->next;
-    }
-    return false;
+    lookup_key k = make_lookup_key(key);
+    return find_entry(d, &k) != NULL;
 }
 
 void *dict_get(dict *d, const char *key) {
-    int slot = hash(key) % d->capacity;
-    dict_entry *e = d->entries_array[slot];
-    while (e != NULL) {
-        if (strcmp(e->key, key) == 0)
-            return e->item;
-        e = e->next;
-    }
-    return NULL;
+    lookup_key k = make_lookup_key(key);
+    dict_entry *e = find_entry(d, &k);
+    return e == NULL ? NULL : e->item;
 }
 
 bool dict_del(dict *d, const char *key) {
-    if (!dict_has(d, key))
-        return false;
-    int slot = hash(key) % d->capacity;
-
-    // if it's the only one in chain..
-    if (strcmp(d->entries_array[slot]->key, key) == 0 && d->entries_array[slot]->next == NULL) {
-        d->entries_array[slot] = NULL;
-        d->count -= 1;
-        return true;
-    }
-
-    // else find trailing node to reset theh "next" pointer
-    dict_entry *trailing = d->entries_array[slot];
-    while (trailing->next != NULL) {
-        if (strcmp(trailing->next->key, key) == 0) {
-            trailing->next = trailing->next->next;
+    lookup_key k = make_lookup_key(key);
+    dict_entry **link = &d->entries_array[k.hash % (unsigned)d->capacity];
+    while (*link != NULL) {
+        dict_entry *e = *link;
+        if (entry_matches(e, &k)) {
+            *link = e->next;
+            free_entry(e);
             d->count -= 1;
             return true;
         }
-        trailing = trailing->next;
+        link = &e->next;
     }
-    
     return false;
 }
 
@@ -202,6 +212,13 @@ iterator *dict_keys_iterator(dict *d) {
     return it;
 }
 
+void dict_visit_items(dict *d, visit_item_func visit, void *data) {
+    for (int i = 0; i < d->capacity; i++) {
+        for (dict_entry *e = d->entries_array[i]; e != NULL; e = e->next)
+            visit(e->item, data);
+    }
+}
+
 list *dict_get_keys(dict *d) {
     list *keys = new_list(cstr_item_info);
     iterator *it = dict_keys_iterator(d);
@@ -282,8 +299,7 @@ void dict_clear(dict *d) {
         dict_entry *next;
         while (e != NULL) {
             next = e->next;
-            free((void *)e->key);
-            free(e);
+            free_entry(e);
             e = next;
         }
         d->entries_array[i] = 0;
@@ -297,8 +313,7 @@ void dict_free(dict *d) {
         dict_entry *next;
         while (e != NULL) {
             next = e->next;
-            free((void *)e->key);
-            free(e);
+            free_entry(e);
             e = next;
         }
     }
@@ -20,6 +20,7 @@ bool  dict_del(dict *d, const char *key);
 int dict_count(dict *d);
 bool dict_is_empty(dict *d);
 iterator *dict_keys_iterator(dict *d);
+void dict_visit_items(dict *d, visit_item_func visit, void *data); // allocates no iterator
 list *dict_get_keys(dict *d);
 list *dict_get_values(dict *d);
 
@@ -88,11 +88,16 @@ void list_set(list *l, int index, void *item) {
 }
 
 void list_insert(list *l, int index, void *item) {
+    if (index >= l->length) {
+        list_add(l, item);
+        return;
+    }
+
     list_entry *entry = malloc(sizeof(list_entry));
     entry->item = item;
     entry->next = NULL;
 
-    if (index == 0) {
+    if (index <= 0) {
         entry->next = l->head;
         l->head = entry;
     } else {
@@ -106,20 +111,22 @@ void list_insert(list *l, int index, void *item) {
 }
 
 void list_remove(list *l, int index) {
+    if (index < 0 || index >= l->length)
+        return;
+
     if (index == 0) {
-        if (l->head != NULL) {
-            l->head = l->head->next;
-            l->length++;
-        }
+        l->head = l->head->next;
+        if (l->head == NULL)
+            l->tail = NULL;
     } else {
         list_entry *prev = l->head;
-        while (index-- > 1 && prev->next != NULL)
+        while (index-- > 1)
             prev = prev->next;
-        if (prev != NULL && prev->next != NULL) {
-            prev->next = prev->next->next;
-            l->length--;
-        }
+        if (prev->next == l->tail)
+            l->tail = prev;
+        prev->next = prev->next->next;
     }
+    l->length--;
 }
 
 
@@ -170,6 +177,11 @@ iterator *list_iterator(list *l) {
     return it;
 }
 
+void list_visit_items(list *l, visit_item_func visit, void *data) {
+    for (list_entry *e = l->head; e != NULL; e = e->next)
+        visit(e->item, data);
+}
+
 
 bool lists_are_equal(list *a, list *b) {
     if (a == NULL && b == NULL)
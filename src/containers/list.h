@@ -22,6 +22,7 @@ void list_insert(list *l, int index, void *item);
 void list_remove(list *l, int index);
 
 iterator *list_iterator(list *l);
+void list_visit_items(list *l, visit_item_func visit, void *data); // allocates no iterator
 
 bool lists_are_equal(list *a, list *b);
 const void list_describe(list *l, const char *separator, str *str);
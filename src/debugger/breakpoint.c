@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "breakpoint.h"
+#include "../utils/hash.h"
 
 
 contained_item_info *breakpoint_item_info = &(contained_item_info){
@@ -16,10 +17,56 @@ breakpoint *new_breakpoint(const char *filename, int line_no) {
     b->item_info = breakpoint_item_info;
     b->filename = filename;
     b->line_no = line_no;
+    b->next = NULL;
+    return b;
 }
 
 bool breakpoint_is_at(breakpoint *b, const char *filename, int line_no) {
     return b->line_no == line_no && strcmp(b->filename, filename) == 0;
 }
 
+breakpoint_table *new_breakpoint_table() {
+    breakpoint_table *t = malloc(sizeof(breakpoint_table));
+    memset(t, 0, sizeof(breakpoint_table));
+    return t;
+}
+
+static breakpoint **bucket_of(breakpoint_table *t, const char *filename, int line_no) {
+    unsigned hash = simple_hash((void *)filename, strlen(filename)) + line_no * 31;
+    return &t->buckets[hash % BREAKPOINT_BUCKETS];
+}
+
+bool breakpoint_table_has(breakpoint_table *t, const char *filename, int line_no) {
+    if (t->count == 0)
+        return false;
+
+    for (breakpoint *b = *bucket_of(t, filename, line_no); b != NULL; b = b->next) {
+        if (breakpoint_is_at(b, filename, line_no))
+            return true;
+    }
+    return false;
+}
+
+void breakpoint_table_add(breakpoint_table *t, const char *filename, int line_no) {
+    if (breakpoint_table_has(t, filename, line_no))
+        return;
 
+    breakpoint **bucket = bucket_of(t, filename, line_no);
+    breakpoint *b = new_breakpoint(filename, line_no);
+    b->next = *bucket;
+    *bucket = b;
+    t->count++;
+}
+
+bool breakpoint_table_remove(breakpoint_table *t, const char *filename, int line_no) {
+    for (breakpoint **link = bucket_of(t, filename, line_no); *link != NULL; link = &(*link)->next) {
+        breakpoint *b = *link;
+        if (breakpoint_is_at(b, filename, line_no)) {
+            *link = b->next;
+            free(b);
+            t->count--;
+            return true;
+        }
+    }
+    return false;
+}
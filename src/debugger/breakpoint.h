@@ -1,6 +1,7 @@
 #ifndef _BREAKPOINT_H
 #define _BREAKPOINT_H
 
+#include <stdbool.h>
 #include "../containers/contained_item_info.h"
 
 
@@ -11,9 +12,28 @@ struct breakpoint {
     contained_item_info *item_info;
     const char *filename;
     int line_no;
+    breakpoint *next; // in the same bucket
 };
 
 breakpoint *new_breakpoint(const char *filename, int line_no);
 bool breakpoint_is_at(breakpoint *b, const char *filename, int line_no);
 
+
+// the armed breakpoints, hashed on file and line, looked up before statements run
+#define BREAKPOINT_BUCKETS  64
+
+typedef struct breakpoint_table {
+    breakpoint *buckets[BREAKPOINT_BUCKETS];
+    int count;
+} breakpoint_table;
+
+breakpoint_table *new_breakpoint_table();
+bool breakpoint_table_has(breakpoint_table *t, const char *filename, int line_no);
+void breakpoint_table_add(breakpoint_table *t, const char *filename, int line_no);
+bool breakpoint_table_remove(breakpoint_table *t, const char *filename, int line_no);
+
+#define for_breakpoints(table, bucket_var, item_var) \
+    for (int bucket_var = 0; bucket_var < BREAKPOINT_BUCKETS; bucket_var++) \
+        for (breakpoint *item_var = (table)->buckets[bucket_var]; item_var != NULL; item_var = item_var->next)
+
 #endif
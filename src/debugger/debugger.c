@@ -17,117 +17,86 @@
                                        (expr) != NULL ? (expr)->token->origin->line_no : 0))
 
 
-enum ast_task { AST_ADD_BREAKPOINT, AST_DEL_BREAKPOINT };
-static bool walk_ast_statements(list *statements, enum ast_task task, const char *filename, int line_no);
-static bool walk_ast_statement(statement *statement, enum ast_task task, const char *filename, int line_no);
-
-
-static bool walk_ast_statements(list *statements, enum ast_task task, const char *filename, int line_no) {
+// breakpoints can only be armed on lines where statements start
+static bool has_statement_at(list *statements, const char *filename, int line_no) {
     if (statements == NULL)
         return false;
-    
-    if (task == AST_ADD_BREAKPOINT) {
-        int index = 0;
-        for_list(statements, it, statement, stmt) {
-            if (statement_is_at(stmt, filename, line_no)) {
-                list_insert(statements, index, new_breakpoint_statement(stmt->token));
-                return true;
-            }
-            index++;
-        }
-    } else if (task == AST_DEL_BREAKPOINT) {
-        int index = 0;
-        for_list(statements, it, statement, stmt) {
-            if (stmt->type == ST_BREAKPOINT && statement_is_at(stmt, filename, line_no)) {
-                list_remove(statements, index);
-                return true;
-            }
-        }
-        index++;
-    } else {
-        return false;
-    }
 
-    // if we got here, it means we did not find target, go deeper
     for_list(statements, it, statement, stmt) {
-        if (walk_ast_statement(stmt, task, filename, line_no))
+        if (statement_is_at(stmt, filename, line_no))
             return true;
-    }
-
-    return false;
-}
 
-static bool walk_ast_statement(statement *stmt, enum ast_task task, const char *filename, int line_no) {
-    bool done;
-    if (stmt->type == ST_IF) {
-        done = walk_ast_statements(stmt->per_type.if_.body_statements, task, filename, line_no);
-        if (done) return true;
-        if (stmt->per_type.if_.has_else) {
-            done = walk_ast_statements(stmt->per_type.if_.else_body_statements, task, filename, line_no);
-            if (done) return true;
+        bool found = false;
+        switch (stmt->type) {
+            case ST_IF:
+                found = has_statement_at(stmt->per_type.if_.body_statements, filename, line_no)
+                    || (stmt->per_type.if_.has_else && has_statement_at(stmt->per_type.if_.else_body_statements, filename, line_no));
+                break;
+            case ST_WHILE:
+                found = has_statement_at(stmt->per_type.while_.body_statements, filename, line_no);
+                break;
+            case ST_FOR_LOOP:
+                found = has_statement_at(stmt->per_type.for_.body_statements, filename, line_no);
+                break;
+            case ST_FUNCTION:
+                found = has_statement_at(stmt->per_type.function.statements, filename, line_no);
+                break;
+            case ST_TRY_CATCH:
+                found = has_statement_at(stmt->per_type.try_catch.try_statements, filename, line_no)
+                    || has_statement_at(stmt->per_type.try_catch.catch_statements, filename, line_no)
+                    || has_statement_at(stmt->per_type.try_catch.finally_statements, filename, line_no);
+                break;
+            case ST_CLASS:
+                for_list(stmt->per_type.class.methods, mit, class_method, method) {
+                    if (has_statement_at(method->function->per_type.function.statements, filename, line_no))
+                        found = true;
+                }
+                break;
+            default:
+                break;
         }
-    } else if (stmt->type == ST_WHILE) {
-        done = walk_ast_statements(stmt->per_type.while_.body_statements, task, filename, line_no);
-        if (done) return true;
-    } else if (stmt->type == ST_FOR_LOOP) {
-        done = walk_ast_statements(stmt->per_type.for_.body_statements, task, filename, line_no);
-        if (done) return true;
-    } else if (stmt->type == ST_FUNCTION) {
-        done = walk_ast_statements(stmt->per_type.function.statements, task, filename, line_no);
-        if (done) return true;
-    } else if (stmt->type == ST_TRY_CATCH) {
-        done = walk_ast_statements(stmt->per_type.try_catch.try_statements, task, filename, line_no);
-        if (done) return true;
-        done = walk_ast_statements(stmt->per_type.try_catch.catch_statements, task, filename, line_no);
-        if (done) return true;
-        done = walk_ast_statements(stmt->per_type.try_catch.finally_statements, task, filename, line_no);
-        if (done) return true;
-    } else if (stmt->type == ST_THROW) {
-        // nothing
+        if (found)
+            return true;
     }
     return false;
 }
 
 static void list_breakpoints(exec_context *ctx) {
-    if (list_empty(ctx->debugger.breakpoints)) {
+    if (ctx->debugger.breakpoints->count == 0) {
         printf("  no breakpoints\n");
         return;
     }
-    for_list(ctx->debugger.breakpoints, it, breakpoint, b) {
+    for_breakpoints(ctx->debugger.breakpoints, bucket, b) {
         printf("  %s : %d\n", b->filename, b->line_no);
     }
 }
 
 static bool is_breakpoint_at_line(const char *filename, int line_no, exec_context *ctx) {
-    for_list(ctx->debugger.breakpoints, it, breakpoint, bp) {
-        if (breakpoint_is_at(bp, filename, line_no))
-            return true;
-    }
-    return false;
+    return breakpoint_table_has(ctx->debugger.breakpoints, filename, line_no);
 }
 
-static void insert_breakpoint_at_line(const char *filename, int line_no, exec_context *ctx) {
-    if (!walk_ast_statements(ctx->ast_root_statements, AST_ADD_BREAKPOINT, filename, line_no))
-        return;
-    list_add(ctx->debugger.breakpoints, new_breakpoint(filename, line_no));
-    printf("Added breakpoint at %s:%d\n", filename, line_no);
+// the code is not changed, statements look up the table when instrumented
+static void update_instrumentation(exec_context *ctx) {
+    ctx->debugger.instrumented = ctx->debugger.enabled && (
+        ctx->debugger.enter_at_next_instruction ||
+        ctx->debugger.enter_when_at_different_line ||
+        ctx->debugger.enter_at_next_return ||
+        ctx->debugger.breakpoints->count > 0);
 }
 
-static void remove_breakpoint_at_line(const char *filename, int line_no, exec_context *ctx) {
-    int index = 0;
-    bool found = false;
-    for_list(ctx->debugger.breakpoints, it, breakpoint, bp) {
-        if (breakpoint_is_at(bp, filename, line_no)) {
-            found = true;
-            list_remove(ctx->debugger.breakpoints, index);
-        }
-        index++;
-    }
-    if (!found)
-        return;
-    
-    walk_ast_statements(ctx->ast_root_statements, AST_DEL_BREAKPOINT, filename, line_no);
-    printf("Removed breakpoint from %s:%d\n", filename, line_no);
+bool debugger_add_breakpoint(exec_context *ctx, const char *filename, int line_no) {
+    if (!has_statement_at(ctx->ast_root_statements, filename, line_no))
+        return false;
+    breakpoint_table_add(ctx->debugger.breakpoints, filename, line_no);
+    update_instrumentation(ctx);
+    return true;
+}
+
+bool debugger_remove_breakpoint(exec_context *ctx, const char *filename, int line_no) {
+    if (!breakpoint_table_remove(ctx->debugger.breakpoints, filename, line_no))
+        return false;
+    update_instrumentation(ctx);
+    return true;
 }
 
 static void show_help() {
@@ -192,9 +161,13 @@ static void manipulate_breakpoint(statement *curr_stmt, expression *curr_expr, e
         int line_no = between(atoi(cmd_arg), 1, listing_lines_count(ctx->code_listing));
 
         if (is_breakpoint_at_line(filename, line_no, ctx)) {
-            remove_breakpoint_at_line(filename, line_no, ctx);
+            if (debugger_remove_breakpoint(ctx, filename, line_no))
+                printf("Removed breakpoint from %s:%d\n", filename, line_no);
         } else {
-            insert_breakpoint_at_line(filename, line_no, ctx);
+            if (debugger_add_breakpoint(ctx, filename, line_no))
+                printf("Added breakpoint at %s:%d\n", filename, line_no);
+            else
+                printf("No statement at %s:%d\n", filename, line_no);
         }
     }
 }
@@ -203,8 +176,8 @@ static void print_expression(statement *curr_stmt, expression *curr_expr, exec_c
     // launch and evaluate an expression within the same local/global context...
     // i think we did not make our code re-entrant, so this may fail...
 
-    dict *vars = (stack_empty(ctx->stack_frames) ? ctx->built_in_symbols : 
-        ((stack_frame *)stack_peek(ctx->stack_frames))->symbols);
+    stack_frame *f = exec_context_get_curr_stack_frame(ctx);
+    dict *vars = (f == NULL ? ctx->built_in_symbols : stack_frame_collect_symbols(f));
     
     execution_outcome ex = interpret_and_execute(cmd_arg, "(debugger)", 
         vars, false, false, false);
@@ -225,14 +198,13 @@ static void print_expression(statement *curr_stmt, expression *curr_expr, exec_c
 }
 
 static void show_stack_trace(statement *curr_stmt, expression *curr_expr, exec_context *ctx) {
-    int level = stack_length(ctx->stack_frames);
-
-    for_stack(ctx->stack_frames, sfit, stack_frame, f) {
+    for (int level = exec_context_get_call_depth(ctx); level > 0; level--) {
+        stack_frame *f = exec_context_get_stack_frame(ctx, level - 1);
         token *t = f->func_stmt == NULL ? (f->func_expr == NULL ? NULL : f->func_expr->token) : f->func_stmt->token;
         if (f->func_stmt != NULL) t = f->func_stmt->token;
         if (f->func_expr != NULL) t = f->func_expr->token;
         printf("   %2d   %s(), at %s:%d:%d\n", 
-            level--,
+            level,
             f->func_name,
             t == NULL ? "(unknown)" : t->origin->filename,
             t == NULL ? 0 : t->origin->line_no,
@@ -262,13 +234,13 @@ static void show_values_of_symbols_of(dict *symbols) {
 }
 
 static void show_args_and_values(statement *curr_stmt, expression *curr_expr, exec_context *ctx) {
-    stack_frame *f = stack_peek(ctx->stack_frames);
+    stack_frame *f = exec_context_get_curr_stack_frame(ctx);
     if (f == NULL) {
         printf("Not in a function\n");
         return;
     }
     
-    show_values_of_symbols_of(f->symbols);
+    show_values_of_symbols_of(stack_frame_collect_symbols(f));
 }
 
 static void show_globals(exec_context *ctx) {
@@ -299,13 +271,14 @@ static void setup_stepping(enum step_type type, statement *curr_stmt, expression
         ctx->debugger.original_line_no = get_curr_line_no(curr_stmt, curr_expr);
     } else if (type == STEP_TILL_RETURN) {
         ctx->debugger.enter_at_next_return = true;
-        ctx->debugger.return_stack_size = stack_length(ctx->stack_frames);
+        ctx->debugger.return_stack_size = exec_context_get_call_depth(ctx);
     } else if (type == STEP_CONTINUE) {
         // nothing to change.
     }
+    update_instrumentation(ctx);
 }
 
-static failable handle_command(char *cmd, statement *curr_stmt, expression *curr_expr, exec_context *ctx, bool *should_resume, bool *should_quit) {
+failable debugger_handle_command(char *cmd, statement *curr_stmt, expression *curr_expr, exec_context *ctx, bool *should_resume, bool *should_quit) {
     *should_resume = false;
     *should_quit = false;
 
@@ -340,6 +313,10 @@ static bool get_command(char *buffer, int buffer_size) {
 bool should_start_debugger(statement *curr_stmt, expression *curr_expr, exec_context *ctx) {
     if (!ctx->debugger.enabled)
         return false;
+
+    // stepping stops at the expressions of these, they stop only at breakpoints
+    if (curr_stmt != NULL && (curr_stmt->type == ST_EXPRESSION || curr_stmt->type == ST_FUNCTION))
+        return is_breakpoint_at_line(curr_stmt->token->origin->filename, curr_stmt->token->origin->line_no, ctx);
     
     if (ctx->debugger.enter_at_next_instruction)
         return true;
@@ -355,10 +332,11 @@ bool should_start_debugger(statement *curr_stmt, expression *curr_expr, exec_con
     // maybe we should also support implicit returns, i.e. after the last statement of a function.
     if (ctx->debugger.enter_at_next_return 
         && curr_stmt != NULL && curr_stmt->type == ST_RETURN
-        && stack_length(ctx->stack_frames) <= ctx->debugger.return_stack_size)
+        && exec_context_get_call_depth(ctx) <= ctx->debugger.return_stack_size)
         return true;
 
-    if (curr_stmt != NULL && curr_stmt->type == ST_BREAKPOINT)
+    if (curr_stmt != NULL && (curr_stmt->type == ST_BREAKPOINT
+        || is_breakpoint_at_line(curr_stmt->token->origin->filename, curr_stmt->token->origin->line_no, ctx)))
         return true;
     
     return false;
@@ -378,7 +356,7 @@ failable run_debugger(statement *curr_stmt, expression *curr_expr, exec_context
         if (!get_command(buffer, sizeof(buffer)))
             break;
         
-        failable handling = handle_command(buffer, curr_stmt, curr_expr, ctx, &should_resume, &should_quit);
+        failable handling = debugger_handle_command(buffer, curr_stmt, curr_expr, ctx, &should_resume, &should_quit);
         if (handling.failed) return failed(&handling, NULL);
 
         if (should_resume)
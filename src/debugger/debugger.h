@@ -27,5 +27,12 @@ enum debugger_exit_mode {
 bool should_start_debugger(statement *curr_stmt, expression *curr_expr, exec_context *ctx);
 failable run_debugger(statement *curr_stmt, expression *curr_expr, exec_context *ctx);
 
+// one command of the debugger prompt, e.g. "b 12", "s" or "c"
+failable debugger_handle_command(char *cmd, statement *curr_stmt, expression *curr_expr, exec_context *ctx, bool *should_resume, bool *should_quit);
+
+// false if no statement starts at the line, or no breakpoint is there, respectively
+bool debugger_add_breakpoint(exec_context *ctx, const char *filename, int line_no);
+bool debugger_remove_breakpoint(exec_context *ctx, const char *filename, int line_no);
+
 
 #endif
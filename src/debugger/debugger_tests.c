@@ -0,0 +1,85 @@
+#include <stdlib.h>
+#include <string.h>
+#include "debugger_tests.h"
+#include "debugger.h"
+#include "breakpoint.h"
+#include "../utils/testing.h"
+#include "../utils/listing.h"
+#include "../lexer/_lexer.h"
+#include "../parser/_parser.h"
+
+
+static void test_breakpoint_table() {
+    breakpoint_table *t = new_breakpoint_table();
+    assert(!breakpoint_table_has(t, "a.scr", 3));
+
+    breakpoint_table_add(t, "a.scr", 3);
+    breakpoint_table_add(t, "a.scr", 3);
+    assert(t->count == 1);
+    assert(breakpoint_table_has(t, "a.scr", 3));
+    assert(!breakpoint_table_has(t, "a.scr", 4));
+
+    // the same line in another file is another breakpoint
+    assert(!breakpoint_table_has(t, "b.scr", 3));
+    breakpoint_table_add(t, "b.scr", 3);
+    assert(t->count == 2);
+
+    assert(breakpoint_table_remove(t, "a.scr", 3));
+    assert(!breakpoint_table_has(t, "a.scr", 3));
+    assert(breakpoint_table_has(t, "b.scr", 3));
+    assert(!breakpoint_table_remove(t, "a.scr", 3));
+    assert(!breakpoint_table_remove(t, "c.scr", 7));
+    assert(t->count == 1);
+
+    // many breakpoints share the buckets
+    for (int line_no = 1; line_no <= 200; line_no++)
+        breakpoint_table_add(t, "a.scr", line_no);
+    assert(t->count == 201);
+    for (int line_no = 1; line_no <= 200; line_no++)
+        assert(breakpoint_table_remove(t, "a.scr", line_no));
+    assert(t->count == 1);
+    assert(breakpoint_table_has(t, "b.scr", 3));
+}
+
+static exec_context *parse_into_context(const char *code, const char *filename) {
+    failable_list tokenization = parse_code_into_tokens(code, filename);
+    iterator *tokens_it = list_iterator(tokenization.result);
+    tokens_it->reset(tokens_it);
+    failable_list parsing = parse_statements(tokens_it, SP_SEQUENTIAL_STATEMENTS);
+    return new_exec_context(filename, new_listing(code), parsing.result, NULL, false, true, false);
+}
+
+static void test_instrumentation() {
+    exec_context *ctx = parse_into_context(
+        "a = 1;\n"
+        "\n"
+        "function f() {\n"
+        "    return 2;\n"
+        "}\n", "test");
+    statement *curr_stmt = list_get(ctx->ast_root_statements, 0);
+    bool should_resume, should_quit;
+    assert(!ctx->debugger.instrumented);
+
+    // only lines where statements start take breakpoints, nested ones included
+    assert(!debugger_add_breakpoint(ctx, "test", 2));
+    assert(!ctx->debugger.instrumented);
+    assert(debugger_add_breakpoint(ctx, "test", 4));
+    assert(ctx->debugger.instrumented);
+    assert(!debugger_add_breakpoint(ctx, "other", 4));
+
+    debugger_handle_command("s", curr_stmt, NULL, ctx, &should_resume, &should_quit);
+    assert(should_resume);
+    assert(debugger_remove_breakpoint(ctx, "test", 4));
+    assert(!debugger_remove_breakpoint(ctx, "test", 4));
+    assert(ctx->debugger.instrumented);
+
+    // without breakpoints, the code runs uninstrumented once stepping ends
+    debugger_handle_command("c", curr_stmt, NULL, ctx, &should_resume, &should_quit);
+    assert(should_resume);
+    assert(!ctx->debugger.instrumented);
+}
+
+void debugger_self_diagnostics(bool verbose) {
+    test_breakpoint_table();
+    test_instrumentation();
+}
@@ -0,0 +1,11 @@
+#ifndef _DEBUGGER_TESTS_H
+#define _DEBUGGER_TESTS_H
+
+#include <stdbool.h>
+
+
+void debugger_self_diagnostics(bool verbose);
+
+
+
+#endif
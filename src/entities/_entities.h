@@ -6,6 +6,7 @@
 #include "operator_type.h"
 #include "expression.h"
 #include "statement.h"
+#include "frame_layout.h"
 
 
 #endif
@@ -21,6 +21,7 @@ static expression *new_expression(expression_type type, token *token, operator_t
     e->type = type;
     e->token = token;
     e->op = op;
+    e->slot = -1;
     return e;
 }
 
@@ -6,10 +6,21 @@
 #include "token.h"
 #include "operator_type.h"
 #include "expression_type.h"
+#include "frame_layout.h"
 
 typedef struct expression expression;
 extern contained_item_info *expression_item_info;
 
+// identifiers in functions, that are neither locals nor shared with enclosing functions
+#define GLOBAL_SLOT  -2
+
+// the body of a small function, expanded at a call site of it by the ast optimizer.
+// it runs in place of the call, as long as the call target is still that function
+typedef struct inlined_call {
+    struct statement *function;  // the function statement, or the method's one
+    struct expression *body;     // the returned expression, arguments in place of the parameters
+} inlined_call;
+
 struct expression {
     contained_item_info *item_info;
     expression_type type;
@@ -27,8 +38,25 @@ struct expression {
             const char *name;
             list *arg_names;
             list *statements;
+            frame_layout *layout;
+            list *captures; // for closures, the names shared with the enclosing functions, NULL if none
         } func;
     } per_type;
+    int slot; // for identifiers, slot in the function's frame, or -1 to resolve by name, or GLOBAL_SLOT
+    struct symbol_cache {
+        void *cell;        // for identifiers, the global symbol cell last resolved
+        unsigned int version;
+    } cache;
+    void *constant;        // for literals, the immortal value (or template) from the constant pool, for closures capturing nothing, the one closure,
+                           // for identifiers, the built_in_func they are bound to
+    void *member_cache;    // for member identifiers, the inline cache of the access site
+    inlined_call *inlined; // for calls, the callee expanded in place, NULL if not inlined
+    struct type_feedback {
+        void *handler;       // for operations, the handler specialized to the operand types seen
+        short operand_types; // the operand types seen lately,
+        short hits;          // and how many times in a row
+        short deopts;        // specialized handlers that failed their guard
+    } feedback;
 };
 
 
@@ -0,0 +1,56 @@
+#include <stdlib.h>
+#include <string.h>
+#include "frame_layout.h"
+#include "../utils/intern.h"
+
+
+frame_layout *new_frame_layout() {
+    frame_layout *l = malloc(sizeof(frame_layout));
+    l->slots_count = 0;
+    l->capacity = 8;
+    l->names = malloc(sizeof(char *) * l->capacity);
+    l->captured = NULL;
+    return l;
+}
+
+int frame_layout_add(frame_layout *l, const char *name) {
+    int slot = frame_layout_find(l, name);
+    if (slot >= 0)
+        return slot;
+
+    if (l->slots_count == l->capacity) {
+        l->capacity *= 2;
+        l->names = realloc(l->names, sizeof(char *) * l->capacity);
+        if (l->captured != NULL) {
+            l->captured = realloc(l->captured, sizeof(bool) * l->capacity);
+            memset(l->captured + l->slots_count, 0, sizeof(bool) * (l->capacity - l->slots_count));
+        }
+    }
+    l->names[l->slots_count] = intern(name);
+    return l->slots_count++;
+}
+
+int frame_layout_find(frame_layout *l, const char *name) {
+    if (l == NULL)
+        return -1;
+
+    // the names are symbols, names from the code are found by pointer
+    for (int i = 0; i < l->slots_count; i++) {
+        if (l->names[i] == name)
+            return i;
+    }
+    if (is_interned(name))
+        return -1;
+
+    for (int i = 0; i < l->slots_count; i++) {
+        if (strcmp(l->names[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void frame_layout_capture(frame_layout *l, int slot) {
+    if (l->captured == NULL)
+        l->captured = calloc(l->capacity, sizeof(bool));
+    l->captured[slot] = true;
+}
@@ -0,0 +1,26 @@
+#ifndef _FRAME_LAYOUT_H
+#define _FRAME_LAYOUT_H
+
+#include <stdbool.h>
+
+/*
+    The local symbols of a function (arguments first, then locals),
+    each one assigned a fixed slot index in the function's stack frame.
+    Filled by the symbol resolver after parsing.
+*/
+
+typedef struct frame_layout frame_layout;
+
+struct frame_layout {
+    int slots_count;
+    int capacity;
+    const char **names;
+    bool *captured; // slots shared with closures, holding cells, NULL if none
+};
+
+frame_layout *new_frame_layout();
+int frame_layout_add(frame_layout *l, const char *name); // returns the existing or new slot
+int frame_layout_find(frame_layout *l, const char *name); // returns -1 if not found
+void frame_layout_capture(frame_layout *l, int slot);
+
+#endif
@@ -39,6 +39,7 @@ statement *new_for_statement(expression *init, expression *condition, expression
     s->per_type.for_.condition = condition;
     s->per_type.for_.next = next;
     s->per_type.for_.body_statements = body_statements;
+    s->per_type.for_.counted = NULL;
     return s;
 }
 statement *new_break_statement(token *token) {
@@ -50,6 +51,7 @@ statement *new_continue_statement(token *token) {
 statement *new_return_statement(expression *value, token *token) {
     statement *s = new_statement(ST_RETURN, token);
     s->per_type.return_.value = value;
+    s->per_type.return_.tail_call = false;
     return s;
 }
 statement *new_function_statement(const char *name, list *arg_names, list *statements, token *token) {
@@ -9,6 +9,16 @@
 
 
 typedef struct statement statement;
+
+// a "for" loop stepping an int local towards a bound, neither changed in its body
+typedef struct counted_loop {
+    expression *counter;       // identifier of a local
+    expression *bound;         // numeric literal, or identifier of another local
+    operator_type comparison;  // of the counter to the bound, e.g. OP_LESS_THAN
+    int step;
+    bool counter_read;         // if not read in the body, the counter is stored after the loop only
+} counted_loop;
+
 struct statement {
     contained_item_info *item_info;
     statement_type type;
@@ -31,14 +41,17 @@ struct statement {
             expression *condition;
             expression *next;
             list *body_statements;
+            counted_loop *counted; // NULL if not a counted loop, see symbol_resolver
         } for_;
         struct return_ {
             expression *value;
+            bool tail_call; // value is a call, made after leaving the function
         } return_;
         struct function {
             const char *name;
             list *arg_names;
             list *statements;
+            frame_layout *layout;
         } function;
         struct try_catch {
             list *try_statements;
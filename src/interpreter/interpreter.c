@@ -1,6 +1,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "../utils/cstr.h"
 #include "../utils/testing.h"
 #include "../utils/failable.h"
@@ -12,8 +13,25 @@
 #include "../runtime/built_ins/built_in_funcs.h"
 #include "../runtime/execution/expression_execution.h"
 #include "../runtime/execution/statement_execution.h"
+#include "../runtime/execution/constant_pool.h"
+#include "../runtime/execution/ast_optimizer.h"
 #include "interpreter.h"
 
+// script calls nest on the native stack, we size it for the allowed depth.
+// the margin leaves room for raising the exception when the limit is reached.
+#define NATIVE_STACK_PER_CALL    (4 * 1024)
+#define NATIVE_STACK_MIN_SIZE    (8 * 1024 * 1024)
+#define NATIVE_STACK_MARGIN      (256 * 1024)
+
+typedef struct execution_run {
+    list *statements;
+    exec_context *ctx;
+    size_t stack_size;
+    execution_outcome outcome;
+} execution_run;
+
+static execution_outcome execute_on_sized_stack(list *statements, exec_context *ctx);
+
 
 void initialize_interpreter() {
     initialize_lexer();
@@ -55,18 +73,62 @@ execution_outcome interpret_and_execute(const char *code, const char *filename,
         list_describe(parsing.result, "\n", str);
         printf("------------- parsed statements -------------\n%s\n", str_cstr(str));
     }
+    resolve_symbol_slots(parsing.result);
+    if (ast_optimizer_get_level() > 0) {
+        if (verbose)
+            printf("------------- optimization passes (-O%d) -------------\n", ast_optimizer_get_level());
+        optimize_statements(parsing.result, external_values, verbose);
+        if (verbose) {
+            str_clear(str);
+            list_describe(parsing.result, "\n", str);
+            printf("------------- optimized statements -------------\n%s\n", str_cstr(str));
+        }
+    }
+    build_constant_pool(parsing.result, external_values);
 
     exec_context *ctx = new_exec_context(filename, code_listing, parsing.result, external_values, verbose, enable_debugger, start_with_debugger);
     dict *built_ins = get_built_in_funcs_table();
     for_dict(built_ins, bi_it, cstr, bltin_name)
-        exec_context_register_built_in(ctx, bltin_name, new_callable_variant(dict_get(built_ins, bltin_name)));
+        exec_context_register_built_in(ctx, bltin_name, ((built_in_func *)dict_get(built_ins, bltin_name))->value);
     exec_context_log_reset();
 
 
     if (verbose)
         printf("------------- executing -------------\n");
-    execution_outcome execution = execute_statements(parsing.result, ctx);
+    execution_outcome execution = execute_on_sized_stack(parsing.result, ctx);
+    exec_context_export_globals(ctx);
 
     // no matter exception, failure, or sucess.
     return execution;
 }
+
+static void *execution_thread(void *data) {
+    execution_run *run = (execution_run *)data;
+    char base;
+    run->ctx->native_stack_limit = &base - (run->stack_size - NATIVE_STACK_MARGIN);
+    run->outcome = execute_statements(run->statements, run->ctx);
+    return NULL;
+}
+
+static execution_outcome execute_on_sized_stack(list *statements, exec_context *ctx) {
+    execution_run run = { .statements = statements, .ctx = ctx };
+    run.stack_size = (size_t)ctx->max_call_depth * NATIVE_STACK_PER_CALL + NATIVE_STACK_MARGIN;
+    if (run.stack_size < NATIVE_STACK_MIN_SIZE)
+        run.stack_size = NATIVE_STACK_MIN_SIZE;
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    bool started = pthread_attr_setstacksize(&attr, run.stack_size) == 0
+        && pthread_create(&thread, &attr, execution_thread, &run) == 0;
+    pthread_attr_destroy(&attr);
+
+    if (!started) {
+        // the depth limit still applies, the native stack of the caller may run out first
+        return execute_statements(statements, ctx);
+    }
+
+    pthread_join(thread, NULL);
+    ctx->native_stack_limit = NULL;
+    return run.outcome;
+}
@@ -8,6 +8,8 @@
 #include "../lexer/_lexer.h"
 #include "../parser/_parser.h"
 #include "../runtime/_runtime.h"
+#include "../runtime/execution/ast_optimizer.h"
+#include "../utils/mem.h"
 #include "interpreter.h"
 
 typedef enum expected_outcome {
@@ -19,6 +21,7 @@ typedef enum expected_outcome {
     EXP_STRING,
     EXP_LIST,
     EXP_LOG_CONTENTS,
+    EXP_STACK_TRACE,
 } expected_outcome;
 
 #define verify_execution(code, a_var, expected_outcome, out_var)  __verify_execution(__FILE__, __LINE__, code, a_var, expected_outcome, out_var)
@@ -53,6 +56,14 @@ static void verify_basic_expressions() {
     verify_execution("true  || false", NULL, EXP_BOOLEAN, true);
     verify_execution("false || true ", NULL, EXP_BOOLEAN, true);
     verify_execution("false || false", NULL, EXP_BOOLEAN, false);
+
+    // the second operand is evaluated only if needed
+    verify_execution("n = 0; function f() { n++; return true; } r = false && f(); r = true || f(); return n;", NULL, EXP_INTEGER, 0);
+    verify_execution("n = 0; function f() { n++; return true; } r = true && f(); r = false || f(); return n;",  NULL, EXP_INTEGER, 2);
+    verify_execution("false && 1", NULL, EXP_BOOLEAN, false);
+    verify_execution("true || 1",  NULL, EXP_BOOLEAN, true);
+    verify_execution("true && 1",  NULL, EXP_EXCEPTION, NULL);
+    verify_execution("1 || true",  NULL, EXP_EXCEPTION, NULL);
 }
 
 static void verify_branching_logic() {
@@ -61,6 +72,8 @@ static void verify_branching_logic() {
     verify_execution("a > 4 ? 5 : 6",         new_int_variant(8), EXP_INTEGER, 5);
     verify_execution("a > 4 ? 5 : 6",         new_int_variant(2), EXP_INTEGER, 6);
     verify_execution("a > 4 ? a + 1 : a + 2", new_int_variant(8), EXP_INTEGER, 9);
+    verify_execution("n = 0; function f() { n++; return n; } r = true ? 1 : f(); r = false ? f() : 2; return n;", NULL, EXP_INTEGER, 0);
+    verify_execution("a ? 1 : 2", new_int_variant(1), EXP_EXCEPTION, NULL);
 
     verify_execution("log('abc', true, 123, -456);",
                      NULL, EXP_LOG_CONTENTS,
@@ -156,6 +169,7 @@ static void verify_string_expressions() {
     // the substr() method
     verify_execution("''",                            NULL, EXP_STRING, "");
     verify_execution("'hello'",                       NULL, EXP_STRING, "hello");
+    verify_execution("'100%d'",                       NULL, EXP_STRING, "100%d");
     verify_execution("substr('hello there', 2, 3)",   NULL, EXP_STRING, "llo");
     verify_execution("substr('hello there', 20, 3)",  NULL, EXP_STRING, "");
     verify_execution("substr('hello there', 5, 0)",   NULL, EXP_STRING, "");
@@ -200,12 +214,22 @@ static void verify_list_expressions() {
                      "f = function(acc, item, idx, arr){return acc + item;};"
                      "return arr.reduce(0, f);",
                      NULL, EXP_INTEGER, 6);
+    verify_execution("arr = [5, 6, 7];"
+                     "f = function(acc, item, idx, arr){return acc + idx * arr.length();};"
+                     "return arr.reduce(1, f);",
+                     NULL, EXP_INTEGER, 10);
+
+    // every evaluation of a literal gets a list of its own
+    verify_execution("function f() { l = [1, 2]; l.add(3); return l.length(); } f(); return f();", NULL, EXP_INTEGER, 3);
+    verify_execution("for (i = 0; i < 3; i++) { l = []; l[0] = i; } return l.length();",         NULL, EXP_INTEGER, 1);
+    verify_execution("a = [1, 2]; b = [1, 2]; b[0] = 5; return a[0] + b[0];",                     NULL, EXP_INTEGER, 6);
 }
 
 static void verify_dict_expressions() {
 
     verify_execution("man = {name:'Joe',age:40}; return man['age'];", NULL, EXP_INTEGER, 40);
     verify_execution("man = {}; man['age'] = 20; return man['age'];", NULL, EXP_INTEGER, 20);
+    verify_execution("function f(n) { d = {age:40}; if (n > 0) d['age'] = n; return d['age']; } f(20); return f(0);", NULL, EXP_INTEGER, 40);
     
 }
 
@@ -254,6 +278,47 @@ static void verify_exception_handling() {
                      "in finally block\n"
                      "exception caught here\n");
 
+    // messages are formatted when stringified, thrown values are not formats
+    verify_execution("try { throw 'at 100%s'; } catch (e) { return substr(str(e), 0, 8); }",       NULL, EXP_STRING, "at 100%s");
+    verify_execution("try { throw 40 + 2; } catch (e) { return substr(str(e), 0, 2); }",          NULL, EXP_STRING, "42");
+    verify_execution("try { x = undefined_one; } catch (e) { return substr(str(e), 0, 36); }",   NULL, EXP_STRING, "identifier 'undefined_one' not found");
+    verify_execution("try { [1, 2][5]; } catch (e) { return substr(str(e), 0, 38); }",             NULL, EXP_STRING, "index 5 outside of list bounds (0..1)");
+
+    // the functions an exception propagated out of, innermost first
+    verify_execution("function g() { throw 'x'; } function f() { g(); } f();", NULL, EXP_STACK_TRACE,
+                     "    in g(), called at test_code:1:44\n"
+                     "    in f(), called at test_code:1:51\n");
+    verify_execution("f = function() { throw 'x'; }; g = function named() { f(); }; g();", NULL, EXP_STACK_TRACE,
+                     "    in <anonymous>(), called at test_code:1:55\n"
+                     "    in named(), called at test_code:1:63\n");
+
+    // recursion is counted, not repeated, long traces keep their innermost and outermost frames
+    verify_execution("function r(n) { if (n == 0) throw 'x'; r(n - 1); } r(100);", NULL, EXP_STACK_TRACE,
+                     "    in r(), called at test_code:1:40\n"
+                     "    ... 99 more in r()\n"
+                     "    in r(), called at test_code:1:52\n");
+    verify_execution("function a(n) { if (n == 0) throw 'x'; b(n - 1); } function b(n) { a(n - 1); } a(22);", NULL, EXP_STACK_TRACE,
+                     "    in a(), called at test_code:1:68\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    in a(), called at test_code:1:68\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    in a(), called at test_code:1:68\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    in a(), called at test_code:1:68\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    in a(), called at test_code:1:68\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    ... 3 more frames\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    in a(), called at test_code:1:68\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    in a(), called at test_code:1:68\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    in a(), called at test_code:1:68\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    in a(), called at test_code:1:68\n"
+                     "    in b(), called at test_code:1:40\n"
+                     "    in a(), called at test_code:1:80\n");
 }
 
 static void verify_classes_handling() {
@@ -306,6 +371,44 @@ static void verify_classes_handling() {
                      "c = new(T, 626);"
                      "return c.giveme();",
                      NULL, EXP_INTEGER, 626);
+
+    // the same call site, seeing different types
+    verify_execution("class A { public function id() { return 1; } }"
+                     "class B { public function id() { return 2; } }"
+                     "l = [new(A), new(B), new(A), new(B)];"
+                     "s = 0; for (i = 0; i < 4; i++) s += l[i].id();"
+                     "return s;",
+                     NULL, EXP_INTEGER, 6);
+    verify_execution("class A { public v = 1; } class B { public v = 2; } class C { public v = 3; }"
+                     "class D { public v = 4; } class E { public v = 5; }"
+                     "l = [new(A), new(B), new(C), new(D), new(E), new(A)];"
+                     "s = 0; for (i = 0; i < 6; i++) { l[i].v *= 10; s += l[i].v; }"
+                     "return s;",
+                     NULL, EXP_INTEGER, 160);
+
+    // the same site, with and without access to private members
+    verify_execution("class T { a1 = 3; public function get(o) { return o.a1; } }"
+                     "t = new(T);"
+                     "return t.get(t);",
+                     NULL, EXP_INTEGER, 3);
+
+    // enough members to grow the type's member index past its initial size
+    verify_execution("class T {"
+                     "    public a = 1; public b = 2; public c = 3; public d = 4; public e = 5;"
+                     "    public f = 6; public g = 7; public h = 8; i = 9; j = 10;"
+                     "}"
+                     "t = new(T);"
+                     "return t.a + t.j;",
+                     NULL, EXP_EXCEPTION, NULL);
+    verify_execution("class T {"
+                     "    public a = 1; public b = 2; public c = 3; public d = 4; public e = 5;"
+                     "    public f = 6; public g = 7; public h = 8; i = 9; j = 10;"
+                     "    public function sum() { return this.a_() + this.i + this.j; }"
+                     "    function a_() { return this.a + this.b + this.c + this.d + this.e + this.f + this.g + this.h; }"
+                     "}"
+                     "t = new(T);"
+                     "return t.sum() * 100 + t.h;",
+                     NULL, EXP_INTEGER, 5508);
 }
 
 static void verify_function_creation_and_calling() {
@@ -319,22 +422,46 @@ static void verify_function_creation_and_calling() {
                      "return increaser(1);",
                      NULL, EXP_INTEGER, 2);
                     
-    // TODO: implement support for capturing external variables for closures.
-    // // closure captures env values
-    // verify_execution("function make_reminder(number) {"
-    //                  "    return function() { return number; };"
-    //                  "}"
-    //                  "r = make_reminder(2);"
-    //                  "return r();",
-    //                  NULL, EXP_INTEGER, 2);
-
-    // // closure modifies captured values
-    // verify_execution("function make_sequencer(base) {"
-    //                  "    return function() { return ++base; };"
-    //                  "}"
-    //                  "s = make_sequencer(1);"
-    //                  "return s();",
-    //                  NULL, EXP_INTEGER, 2);
+    // closure captures env values
+    verify_execution("function make_reminder(number) {"
+                     "    return function() { return number; };"
+                     "}"
+                     "r = make_reminder(2);"
+                     "return r();",
+                     NULL, EXP_INTEGER, 2);
+
+    // closure modifies captured values, keeping them between calls
+    verify_execution("function make_sequencer(base) {"
+                     "    return function() { return ++base; };"
+                     "}"
+                     "s = make_sequencer(1);"
+                     "s();"
+                     "return s();",
+                     NULL, EXP_INTEGER, 3);
+
+    // captured values are shared with the enclosing function, and other closures
+    verify_execution("function counter() { n = 0; inc = function() { n++; }; inc(); inc(); return n; }"
+                     "return counter();",
+                     NULL, EXP_INTEGER, 2);
+    verify_execution("function f() { n = 1; get = function() { return n; }; n = 5; return get(); }"
+                     "return f();",
+                     NULL, EXP_INTEGER, 5);
+    verify_execution("function f() { n = 1; inc = function() { n++; }; get = function() { return n; }; inc(); return get(); }"
+                     "return f();",
+                     NULL, EXP_INTEGER, 2);
+    verify_execution("function f() { n = 1; return function() { return function() { return ++n; }; }; }"
+                     "g = f()(); g(); return g();",
+                     NULL, EXP_INTEGER, 3);
+
+    // each call has its own captured values
+    verify_execution("function make_sequencer(base) { return function() { return ++base; }; }"
+                     "a = make_sequencer(10); b = make_sequencer(20); a(); return a() + b();",
+                     NULL, EXP_INTEGER, 33);
+
+    // closures capturing nothing are created once, and can be called again
+    verify_execution("function f() { l = [1, 2, 3]; return l.map(function(x) { return x * 2; }); }"
+                     "return f()[2] + f()[0];",
+                     NULL, EXP_INTEGER, 8);
 
     // // call method on object
     // verify_execution("class sequencer { base = 1; function next() { return ++(this.base); }; }"
@@ -350,10 +477,248 @@ static void verify_function_creation_and_calling() {
     //                  "return f();",
     //                  NULL, EXP_INTEGER,
     //                  2);
+
+    // calls in tail position do not nest, even deep recursion runs
+    verify_execution("function count(n, acc) { if (n == 0) return acc; return count(n - 1, acc + 1); }"
+                     "return count(200000, 0);",
+                     NULL, EXP_INTEGER, 200000);
+    verify_execution("function even(n) { if (n == 0) return true; return odd(n - 1); }"
+                     "function odd(n) { if (n == 0) return false; return even(n - 1); }"
+                     "return odd(100001);",
+                     NULL, EXP_BOOLEAN, true);
+    verify_execution("add = function (x, y) { return x + y; };"
+                     "function f(x) { return add(x, 1); }"
+                     "return f(1) * 10 + strlen('abc');",
+                     NULL, EXP_INTEGER, 23);
+    verify_execution("function f(x) { return strlen(x); } return f('abcd');", NULL, EXP_INTEGER, 4);
+    verify_execution("function f(x, y) { return x + y; } function g() { return f(1); } return g();", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("function f() { throw 'x'; } function g() { try { return f(); } catch (e) { return 2; } } return g();", NULL, EXP_INTEGER, 2);
+
+    // arguments of calls in progress stay in place, while other calls evaluate theirs
+    verify_execution("function f(a, b, c) { return a * 100 + b * 10 + c; } return f(1, f(0, 0, 2), 3);", NULL, EXP_INTEGER, 123);
+    verify_execution("function r(n, a, b) { if (n == 0) return a + b; x = r(n - 1, a + 1, b); return x; } return r(300, 0, 5);", NULL, EXP_INTEGER, 305);
+    verify_execution("function f(a, b) { return a + b; } function g() { throw 'x'; }"
+                     "try { f(1, g()); } catch (e) { } return f(2, 3);",
+                     NULL, EXP_INTEGER, 5);
+
+    // too deep recursion raises a catchable exception
+    int max_depth = exec_context_get_max_call_depth();
+    exec_context_set_max_call_depth(50);
+    verify_execution("function r(n) { if (n == 0) return 0; x = r(n - 1); return x + 1; } return r(40);", NULL, EXP_INTEGER, 40);
+    verify_execution("function r(n) { if (n == 0) return 0; x = r(n - 1); return x + 1; } return r(60);", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("function r(n) { if (n == 0) return 0; x = r(n - 1); return x + 1; } try { r(60); } catch (e) { return r(3); }", NULL, EXP_INTEGER, 3);
+    exec_context_set_max_call_depth(max_depth);
 }
 
-void interpreter_self_diagnostics() {
+static void verify_loop_flow_control() {
+    // return from inside a loop yields the returned value
+    verify_execution("function f() { while (true) { return 5; } }"
+                     "return f();",
+                     NULL, EXP_INTEGER, 5);
+    verify_execution("function f() { for (i = 0; i < 10; i++) { if (i == 3) return i; } }"
+                     "return f();",
+                     NULL, EXP_INTEGER, 3);
+
+    // break and continue from inside a try block
+    verify_execution("n = 0;"
+                     "for (i = 0; i < 10; i++) { try { if (i == 4) break; n += 1; } catch (e) { } }"
+                     "return n * 100 + i;",
+                     NULL, EXP_INTEGER, 404);
+    verify_execution("n = 0;"
+                     "for (i = 0; i < 10; i++) { try { if (i % 2 == 0) continue; n += 1; } catch (e) { } }"
+                     "return n;",
+                     NULL, EXP_INTEGER, 5);
+
+    // post increment yields the original value
+    verify_execution("i = 1; x = i++; return x * 10 + i;", NULL, EXP_INTEGER, 12);
+    verify_execution("l = [1, 2]; x = l[1]++; return x * 10 + l[1];", NULL, EXP_INTEGER, 23);
+
+    // counted loops leave their counter as the generic ones
+    verify_execution("function f() { n = 0; for (i = 0; i < 10; i++) n += i; return n * 100 + i; } return f();", NULL, EXP_INTEGER, 4510);
+    verify_execution("function f() { n = 0; for (i = 10; i > 0; i -= 3) n++; return n * 100 + i; } return f();", NULL, EXP_INTEGER, 398);
+    verify_execution("function f() { m = 5; for (i = 0; i <= m; i++) { if (i == 3) break; } return i; } return f();", NULL, EXP_INTEGER, 3);
+    verify_execution("function f() { n = 0; for (i = 0; i < 6; i++) { if (i % 2 == 1) continue; n++; } return n * 100 + i; } return f();", NULL, EXP_INTEGER, 306);
+    verify_execution("function f() { try { for (i = 0; i < 9; i++) if (i == 4) throw 'x'; } catch (e) { return i; } } return f();", NULL, EXP_INTEGER, 4);
+    verify_execution("function f() { l = []; for (i = 0; i < 3; i++) l.add(function() { return i; }); return l[1]() * 10 + l[2](); } return f();", NULL, EXP_INTEGER, 33);
+    verify_execution("function k(v) { return function() { return v; }; } function f() { l = []; for (i = 0; i < 3; i++) l.add(k(i)); return l[1]() * 10 + l[2](); } return f();", NULL, EXP_INTEGER, 12);
+
+    // changing the counter or the bound in the body, or non-int counters, take the generic path
+    verify_execution("function f() { n = 0; for (i = 0; i < 10; i++) { i++; n++; } return n; } return f();", NULL, EXP_INTEGER, 5);
+    verify_execution("function f() { n = 0; m = 10; for (i = 0; i < m; i++) { m--; n++; } return n; } return f();", NULL, EXP_INTEGER, 5);
+    verify_execution("function f(x) { for (i = x; i < 3; i++) { } return i; } return f(a);", new_float_variant(1.5), EXP_EXCEPTION, NULL);
+
+    // counters and bounds that callees can change, as globals or captured ones, take the generic path
+    verify_execution("i = 0; function bump() { i = 100; } function f() { c = 0; for (i = 0; i < 5; i++) { c++; bump(); } return c; } log(f());",
+                     NULL, EXP_LOG_CONTENTS, "1\n");
+    verify_execution("m = 5; function shrink() { m = 0; } function f() { c = 0; for (i = 0; i < m; i++) { c++; shrink(); } return c; } return f();", NULL, EXP_INTEGER, 1);
+    verify_execution("function f() { c = 0; bump = function() { i = 100; }; for (i = 0; i < 5; i++) { c++; bump(); } return c; } return f();", NULL, EXP_INTEGER, 1);
+}
+
+static void verify_local_symbols() {
+    // recursion, each call with its own frame
+    verify_execution("function fib(i) { if (i <= 2) return i; return fib(i - 1) + fib(i - 2); }"
+                     "return fib(10);",
+                     NULL, EXP_INTEGER, 89);
+
+    // assigning an existing global updates it, new symbols stay local
+    verify_execution("g = 1; function f() { g = 5; } f(); return g;", NULL, EXP_INTEGER, 5);
+    verify_execution("function f() { x = 5; return x; } f(); return x;", NULL, EXP_EXCEPTION, NULL);
+
+    // reading a local before its first assignment in a loop
+    verify_execution("function f() { n = 0; for (i = 0; i < 3; i++) { if (i > 0) n += p; p = i; } return n; }"
+                     "return f();",
+                     NULL, EXP_INTEGER, 1);
+
+    // nested functions and exception identifiers are locals too
+    verify_execution("function outer() { function inner(a) { return a * 2; } return inner(3); }"
+                     "return outer();",
+                     NULL, EXP_INTEGER, 6);
+    verify_execution("function f() { try { throw 'x'; } catch (e) { } try { return e; } catch (e2) { return 2; } }"
+                     "return f();",
+                     NULL, EXP_INTEGER, 2);
+
+    // frames are reused, values of previous calls are gone
+    verify_execution("function f(n) { if (n > 0) { x = n; } return x; } f(5); return f(0);", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("class T { public function m(v) { return this.k + v; } k = 3; }"
+                     "function f(n) { if (n == 0) { t = new(T); return t.m(1); } y = n; return f(n - 1) + y; }"
+                     "a = f(3); return f(2) * 100 + a;",
+                     NULL, EXP_INTEGER, 710);
+}
+
+static void verify_global_symbols() {
+    // cached global cells follow updates and new registrations
+    verify_execution("function f() { return g; } g = 1; r = f(); g = 2; return r * 10 + f();", NULL, EXP_INTEGER, 12);
+    verify_execution("function f() { return a + 1; } return f() + f();", new_int_variant(2), EXP_INTEGER, 6);
+
+    // unregistered globals are not found any more
+    verify_execution("r = 0;"
+                     "for (i = 0; i < 2; i++) { try { throw 'x'; } catch (e) { r += 1; } }"
+                     "try { e; } catch (x) { r += 10; }"
+                     "return r;",
+                     NULL, EXP_INTEGER, 12);
+
+    // built-ins and classes resolve through the same cells
+    verify_execution("class point { public x = 1; } p = new(point); return p.x;", NULL, EXP_INTEGER, 1);
+
+    // built-ins are bound at parse time, unless the script uses their name otherwise
+    verify_execution("f = strlen; return f('abc') * 10 + strpos('abc', 'c');", NULL, EXP_INTEGER, 32);
+    verify_execution("function f(s) { return strlen(s); } return f('abcd');", NULL, EXP_INTEGER, 4);
+    verify_execution("function f() { return strlen('a'); } function strlen(s) { return 7; } return f();", NULL, EXP_INTEGER, 7);
+    verify_execution("function f(strlen) { return strlen; } return f(3);", NULL, EXP_INTEGER, 3);
+    verify_execution("function f(strlen) { return function() { return strlen(2); }; } return f(function(x) { return x * 10; })();", NULL, EXP_INTEGER, 20);
+
+    // typed built-ins get zero values for missing arguments
+    verify_execution("substr('hello')", NULL, EXP_STRING, "");
+    verify_execution("substr('hello', 1, 2) + substr('there', 2, 1)", NULL, EXP_STRING, "ele");
+}
+
+static void verify_cycle_collection() {
+    // reachable cycles survive a collection
+    verify_execution("l = [1, 2]; l.add(l); gc(); x = 0; return l.length();", NULL, EXP_INTEGER, 3);
+    verify_execution("class node { public next = 0; public v = 7; } n = new(node); n.next = n; gc(); x = 0; return n.next.next.v;", NULL, EXP_INTEGER, 7);
+
+    // unreachable ones are freed
+    long collected = mem_stats_collected();
+    verify_execution("function f() { l = [1]; l.add(l); } for (i = 0; i < 10; i++) f(); gc(); return 1;", NULL, EXP_INTEGER, 1);
+    assert(mem_stats_collected() >= collected + 10);
+
+    // functions collect between their statements too
+    collected = mem_stats_collected();
+    verify_execution("function f() { for (i = 0; i < 20; i++) { l = [1]; l.add(l); } gc(); x = 0; return 1; } return f();", NULL, EXP_INTEGER, 1);
+    assert(mem_stats_collected() >= collected + 10);
+
+    // while the values their callers hold, or pending in finally blocks, are kept
+    verify_execution("function f() { gc(); x = 0; return 1; } l = [[1, 2], f()]; return l[0].length();", NULL, EXP_INTEGER, 2);
+    verify_execution("function f() { gc(); x = 0; return [3]; } return [1, 2] == f();", NULL, EXP_BOOLEAN, false);
+    verify_execution("function f() { try { return [1, 2]; } finally { gc(); x = 0; } } return f().length();", NULL, EXP_INTEGER, 2);
+    verify_execution("function f() { try { throw [1, 2]; } catch (e) { gc(); x = 0; return str(e); } } return f();", NULL, EXP_STRING, "1, 2, at test_code:1:22");
+
+    // strings are collected too, unless they are in use
+    collected = mem_stats_collected();
+    verify_execution("function f() { for (i = 0; i < 100; i++) s = str(i) + 'x'; gc(); x = 0; return s; } return f();", NULL, EXP_STRING, "99x");
+    assert(mem_stats_collected() >= collected + 100);
+    verify_execution("function f() { s = str(7) + 'z'; for (i = 0; i < 2000; i++) { l = [s, str(i)]; l.add(l); } return s; } return f();", NULL, EXP_STRING, "7z");
+
+    // older containers that are changed keep the younger ones they get
+    verify_execution("k = []; d = {}; for (i = 0; i < 3000; i++) { if (i % 100 == 0) { k.add([i]); d[str(i)] = [i]; } a = [i]; a.add(a); } "
+                     "t = 0; for (i = 0; i < 30; i++) t += k[i][0] + d[str(i * 100)][0]; return t;", NULL, EXP_INTEGER, 87000);
+    verify_execution("class box { public v = 0; } b = new(box); c = [0]; for (i = 0; i < 3000; i++) { if (i % 100 == 0) { b.v = [i]; c[0] = [i]; } a = [i]; a.add(a); } "
+                     "return b.v[0] + c[0][0];", NULL, EXP_INTEGER, 5800);
+}
+
+static void verify_quickened_operations() {
+    // operations warmed up with some types still work with others
+    verify_execution("function add(x, y) { return x + y; } s = 0; for (i = 0; i < 5; i++) s = add(s, i); return add('a', 'b') + s;", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("function add(x, y) { return x + y; } s = 0; for (i = 0; i < 5; i++) s = add(s, i); return add('a', 'b');", NULL, EXP_STRING, "ab");
+    verify_execution("function add(x, y) { return x + y; } for (i = 0; i < 5; i++) add(i, i); return add(a, a) > a;", new_float_variant(1.5), EXP_BOOLEAN, true);
+    verify_execution("function lt(x, y) { return x < y; } for (i = 0; i < 5; i++) lt(i, 3); return lt('a', 'b');", NULL, EXP_BOOLEAN, true);
+    verify_execution("function eq(x, y) { return x == y; } for (i = 0; i < 5; i++) eq('a', 'b'); return eq(true, true);", NULL, EXP_BOOLEAN, true);
+
+    // operations that keep changing types stay generic
+    verify_execution("function add(x, y) { return x + y; } for (i = 0; i < 20; i++) { add(i, i); add('x', 'y'); } return add(3, 4);", NULL, EXP_INTEGER, 7);
+
+    // exceptions are raised by specialized operations too
+    verify_execution("function div(x, y) { return x / y; } for (i = 1; i < 5; i++) div(10, i); return div(1, 0);", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("for (i = 0; i < 5; i++) s = 'ab' + 'cd'; return s;", NULL, EXP_STRING, "abcd");
+}
 
+static void verify_optimizations() {
+    int level = ast_optimizer_get_level();
+
+    // literals are folded and branches pruned, values and exceptions stay the same
+    ast_optimizer_set_level(1);
+    verify_execution("x = 60 * 60 * 24; return x;", NULL, EXP_INTEGER, 86400);
+    verify_execution("return 'ab' + 'cd' == 'abcd' && !false;", NULL, EXP_BOOLEAN, true);
+    verify_execution("return -2147483647 - 1 < 0 ? 1 << 3 : 0;", NULL, EXP_INTEGER, 8);
+    verify_execution("x = 1 / 0;", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("return false && 1 / 0;", NULL, EXP_BOOLEAN, false);
+    verify_execution("return 1 + 'a';", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("function f() { if (false) { return 1; } } return f();", NULL, EXP_BOOLEAN, false);
+    verify_execution("function f() { x = 1; if (true) { x = 2; } else { x = 3; } while (false) { x = 4; } return x; x = 5; } return f();", NULL, EXP_INTEGER, 2);
+    verify_execution("s = 0; for (i = 0; i < 3; i++) { if (true) { continue; } s += 10; } return s;", NULL, EXP_INTEGER, 0);
+
+    // int locals are reduced, their dead stores dropped, their invariants computed before loops
+    ast_optimizer_set_level(2);
+    verify_execution("function f(n) { k = 7; m = k * 3; t = 0;"
+                     "  for (i = 0; i < n; i++) { t = t + i * (k * 2) + (m - 1) * 8; j = 0; while (j < 3) { t += k * m; j = j + 1; } }"
+                     "  unused = t * 2; return t; }"
+                     "return f(10);",
+                     NULL, EXP_INTEGER, 6640);
+    verify_execution("function f(n) { t = 0; for (i = 0; i < n; i++) t += k * 2; k = 1; return t; } return f(0);", NULL, EXP_INTEGER, 0);
+    verify_execution("function f(n) { t = 0; for (i = 0; i < n; i++) t += k * 2; k = 1; return t; } return f(1);", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("function f(s) { x = s * 2; y = s; return x + 1; } return f('ab');", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("function f(s) { x = s * 2; return x; } return f('ab');", NULL, EXP_STRING, "abab");
+    verify_execution("function g() { throw 'x'; } function f() { x = g(); return 1; } return f();", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("g = 1; function f() { g = 5; } f(); return g;", NULL, EXP_INTEGER, 5);
+    verify_execution("function f() { x = 5; y = x; } return f();", NULL, EXP_INTEGER, 5);
+
+    // small functions are inlined, while their name is bound to them
+    verify_execution("function add(a, b) { return a + b; } function sq(x) { return x * x; }"
+                     "function f(n) { t = 0; for (i = 0; i < n; i++) t = add(t, sq(i)); return t; }"
+                     "return f(10);",
+                     NULL, EXP_INTEGER, 285);
+    verify_execution("function sq(x) { return x * x; } function f() { return sq(3); }"
+                     "a = f(); sq = function(x) { return x + 1; }; return a * 100 + f();",
+                     NULL, EXP_INTEGER, 904);
+    verify_execution("function f() { return g(1); } x = f(); function g(a) { return a; }", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("class P { x = 2; function getX() { return this.x; } public function twice() { return this.getX() * 2; } }"
+                     "return new(P).twice();",
+                     NULL, EXP_INTEGER, 4);
+    // arguments are evaluated once, in order, missing ones and globals are resolved as in the call
+    verify_execution("function tick(v) { c = c * 10 + v; return v; } function sub(a, b) { return a - b; } function bus(a, b) { return b - a; }"
+                     "c = 0; r = sub(tick(1), tick(2)); s = bus(tick(3), tick(4)); return c * 100 + r * 10 + s;",
+                     NULL, EXP_INTEGER, 123391);
+    verify_execution("function sq(x) { return x * x; } function clamp(v, hi) { return v > hi ? hi : v; }"
+                     "function f(n) { c = 0; t = sq(c += 3) + c; for (i = 0; i < n; i++) t = t + clamp(i * 3, 10); return t; }"
+                     "return f(6);",
+                     NULL, EXP_INTEGER, 50);
+    verify_execution("function first(a, b) { return a; } function f(a, b) { return first(a, b); } return f(1);", NULL, EXP_EXCEPTION, NULL);
+    verify_execution("function addk(a) { return a + k; } function f() { k = 1; return addk(5); } return f();", NULL, EXP_EXCEPTION, NULL);
+
+    ast_optimizer_set_level(level);
+}
+
+static void verify_all() {
     verify_basic_expressions();
     verify_branching_logic();
     verify_int_expressions();
@@ -363,6 +728,26 @@ void interpreter_self_diagnostics() {
     verify_exception_handling();
     verify_classes_handling();
     verify_function_creation_and_calling();
+    verify_loop_flow_control();
+    verify_local_symbols();
+    verify_global_symbols();
+    verify_cycle_collection();
+    verify_quickened_operations();
+    verify_optimizations();
+}
+
+void interpreter_self_diagnostics() {
+    execution_engine original_engine = exec_context_get_default_engine();
+
+    // all engines must yield the same results
+    exec_context_set_default_engine(EE_AST_WALKER);
+    verify_all();
+    exec_context_set_default_engine(EE_BYTECODE_VM);
+    verify_all();
+    exec_context_set_default_engine(EE_COMPILED_TREE);
+    verify_all();
+
+    exec_context_set_default_engine(original_engine);
 }
 
 static void __verify_execution(const char *file, int line, char *code, variant *var_a_value, expected_outcome expect_outcome, ...) {
@@ -385,6 +770,20 @@ static void __verify_execution(const char *file, int line, char *code, variant *
         return;
     }
 
+    if (expect_outcome == EXP_STACK_TRACE) {
+        if (!ex.excepted) {
+            __testing_failed("Evaluation did not throw exception as expected", code, file, line);
+            return;
+        }
+        va_list args;
+        va_start(args, expect_outcome);
+        char *expected_trace = va_arg(args, char *);
+        va_end(args);
+        exception_variant_describe_trace(ex.exception_thrown, s);
+        assert_strs_are_equal_fl(str_cstr(s), expected_trace, code, file, line);
+        return;
+    }
+
     // we expect some good result from now on       
 
     if (ex.failed) {
@@ -420,7 +819,7 @@ static void __verify_execution(const char *file, int line, char *code, variant *
 
     } else if (expect_outcome == EXP_LIST) {
         if (!variant_instance_of(actual_result, list_type)) {
-            str_addf(s, "Was expecting a list result, got '%s'", actual_result->_type->name);
+            str_addf(s, "Was expecting a list result, got '%s'", variant_type_of(actual_result)->name);
             __testing_failed(str_cstr(s), code, file, line);
         } else {
             list *expected_contents = va_arg(args, list *);
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "../utils/failable.h"
+#include "../utils/intern.h"
 #include "tokenization.h"
 
 
@@ -216,7 +217,10 @@ static failable_token get_token_at_code_position() {
         return ok_token(new_data_token(T_NUMBER_LITERAL, data, code_filename, start_line, start_column));
 
     } else if (is_identifier_char(c)) {
-        char *data = collect(is_identifier_char);
+        // names are symbols, compared by pointer at runtime
+        char *collected = collect(is_identifier_char);
+        const char *data = intern(collected);
+        free(collected);
         token_type reserved_word_token = get_reserved_word_token(data);
         if (reserved_word_token != T_UNKNOWN)
             return ok_token(new_token(reserved_word_token, code_filename, start_line, start_column));
@@ -1,6 +1,9 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 #include "utils/testing.h"
 #include "utils/file.h"
 #include "containers/_containers.h"
@@ -10,7 +13,9 @@
 #include "interpreter/interpreter_tests.h"
 #include "interpreter/interpreter.h"
 #include "interpreter/acceptance_tests.h"
+#include "debugger/debugger_tests.h"
 #include "runtime/_runtime.h"
+#include "runtime/execution/ast_optimizer.h"
 #include "runtime/variants/_variants.h"
 #include "shell/shell.h"
 
@@ -25,6 +30,7 @@ bool run_self_diagnostics(bool verbose) {
     statement_parser_self_diagnostics(verbose);
     interpreter_self_diagnostics(verbose);
     built_in_self_diagnostics(verbose);
+    debugger_self_diagnostics(verbose);
     
     return testing_outcome();
 }
@@ -43,8 +49,23 @@ struct options {
     char *log_filename;
     bool enable_debugger;
     bool start_interactive_shell;
+    bool engine_given;
+    execution_engine engine;
+    int max_call_depth;
+    bool optimization_level_given;
+    int optimization_level;
 } options;
 
+execution_engine parse_engine_name(const char *name) {
+    if (name != NULL && strcmp(name, "vm") == 0)
+        return EE_BYTECODE_VM;
+    if (name != NULL && strcmp(name, "tree") == 0)
+        return EE_COMPILED_TREE;
+    if (name == NULL || strcmp(name, "ast") != 0)
+        printf("Unknown execution engine '%s', using 'ast'\n", name == NULL ? "" : name);
+    return EE_AST_WALKER;
+}
+
 void parse_options(int argc, char *argv[]) {
     memset(&options, 0, sizeof(options));
 
@@ -70,6 +91,17 @@ void parse_options(int argc, char *argv[]) {
                 case 'q': options.suppress_log_echo = true; break;
                 case 'd': options.enable_debugger = true; break;
                 case 'i': options.start_interactive_shell = true; break;
+                case 'X':
+                    options.engine_given = true;
+                    options.engine = parse_engine_name(argv[++i]);
+                    break;
+                case 'R':
+                    options.max_call_depth = atoi(argv[++i]);
+                    break;
+                case 'O':
+                    options.optimization_level_given = true;
+                    options.optimization_level = atoi(argv[i] + 2);
+                    break;
             }
         }
     }
@@ -83,7 +115,10 @@ void show_help() {
     printf("  -e <expression>     Interpret and execute the expression\n");
     printf("  -i                  Start interactive shell\n");
     printf("  -d                  Enable inline debugger\n");
-    printf("  -v                  Be verbose\n");
+    printf("  -X <engine>         Execution engine: 'ast' (default), 'vm' or 'tree'\n");
+    printf("  -R <depth>          Maximum depth of nested calls (default %d)\n", exec_context_get_max_call_depth());
+    printf("  -O<level>           Optimization level: 0, 1 (default) or 2, -O0 when debugging\n");
+    printf("  -v                  Be verbose, e.g. dump the parsed and optimized code\n");
     printf("  -q                  Suppress log() output to stderr\n");
     printf("  -l <log-file>       Save log() output to file\n");
     printf("  -u                  Run self diagnostics (unit tests)\n");
@@ -103,6 +138,10 @@ void execute_code(const char *code, const char *filename) {
         variant *s = variant_to_string(ex.exception_thrown);
         printf("Unhandled exception: %s\n", str_variant_as_str(s));
         variant_drop_ref(s);
+        str *trace = new_str();
+        exception_variant_describe_trace(ex.exception_thrown, trace);
+        printf("%s", str_cstr(trace));
+        str_free(trace);
         
     } else {
         variant *s = variant_to_string(ex.result);
@@ -130,6 +169,14 @@ FILE *log_file = NULL;
 void setup() {
 
     initialize_interpreter();
+    if (options.engine_given)
+        exec_context_set_default_engine(options.engine);
+    if (options.max_call_depth > 0)
+        exec_context_set_max_call_depth(options.max_call_depth);
+    if (options.optimization_level_given)
+        ast_optimizer_set_level(options.optimization_level);
+    else if (options.enable_debugger)
+        ast_optimizer_set_level(0); // the code stays as written, for stepping and breakpoints
     if (options.log_to_file)
         exec_context_set_log_echo(NULL, options.log_filename);
     else if (!options.suppress_log_echo)
@@ -137,7 +184,13 @@ void setup() {
 }
 
 int main(int argc, char *argv[]) {
-    
+
+#ifdef __GLIBC__
+    // scripts execute on a thread of their own, one at a time,
+    // a separate malloc arena for that thread only costs memory
+    mallopt(M_ARENA_MAX, 1);
+#endif
+
     parse_options(argc, argv);
     setup();
 
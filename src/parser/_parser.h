@@ -6,6 +6,7 @@
 
 #include "statement_parser.h"
 #include "expression_parser.h"
+#include "symbol_resolver.h"
 
 #include "statement_parser_tests.h"
 #include "expression_parser_tests.h"
@@ -256,7 +256,8 @@ static failable_expression parse_dict_initializer(bool verbose, token *initial_t
 
 static failable_expression parse_func_declaration_expression(bool verbose, token *initial_token) {
     // past 'function', expected: "[name] ( [args] ) { [statements] }"
-    const char *name = "anonymous";
+    // anonymous ones show up in stack traces as "in <anonymous>()"
+    const char *name = "<anonymous>";
     if (accept(T_IDENTIFIER))
         name = accepted()->data;
 
@@ -274,7 +275,7 @@ static failable_expression parse_func_declaration_expression(bool verbose, token
     failable_list statements_parsing = parse_statements(tokens_iterator, SP_BLOCK_MANDATORY);
     if (statements_parsing.failed) return failed_expression(&statements_parsing, "Failed parsing function body");
 
-    return ok_expression(new_func_decl_expression("name", arg_names, statements_parsing.result, initial_token));
+    return ok_expression(new_func_decl_expression(name, arg_names, statements_parsing.result, initial_token));
 }
 
 static failable parse_expression_on_want_operand(run_state *state, bool verbose) {
@@ -353,13 +354,14 @@ static failable_list parse_function_call_arguments_expressions(bool verbose) {
     return ok_list(args);
 }
 
-static failable_expression parse_shorthand_if_pair(bool verbose) {
+static failable_expression parse_shorthand_if_pair(completion_mode completion, bool verbose) {
     failable_expression parsing = parse_expression(tokens_iterator, CM_COLON, verbose);
     if (parsing.failed) return failed_expression(&parsing, NULL);
     expression *e1 = parsing.result;
     token *colon_token = accepted();
 
-    parsing = parse_expression(tokens_iterator, CM_END_OF_TEXT, verbose);
+    // the second value extends to the end of the enclosing expression
+    parsing = parse_expression(tokens_iterator, completion, verbose);
     if (parsing.failed) return failed_expression(&parsing, NULL);
     expression *e2 = parsing.result;
 
@@ -391,12 +393,15 @@ static failable parse_expression_on_have_operand(run_state *state, completion_mo
 
     if (accept(T_QUESTION_MARK)) {
         token *initial_token = accepted();
-        failable_expression if_parts = parse_shorthand_if_pair(verbose);
+        failable_expression if_parts = parse_shorthand_if_pair(completion, verbose);
         if (if_parts.failed) return failed(&if_parts, NULL);
         create_expressions_for_higher_operators_than(OP_SHORT_IF);
         push_operator_pair(OP_SHORT_IF, initial_token);
         push_expression(if_parts.result);
-        *state = HAVE_OPERAND;
+
+        // the completion token was consumed by the second value
+        create_expressions_for_higher_operators_than(OP_SENTINEL);
+        *state = FINISHED;
         return ok();
     }
 
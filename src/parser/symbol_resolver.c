@@ -0,0 +1,475 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/cstr.h"
+#include "symbol_resolver.h"
+
+
+static void resolve_function(list *arg_names, list *statements, frame_layout **layout_ptr, list **captures_ptr);
+static void collect_statements(list *statements, frame_layout *layout);
+static void collect_expression(expression *e, frame_layout *layout);
+static void bind_statements(list *statements, frame_layout *layout);
+static void bind_expression(expression *e, frame_layout *layout);
+static bool is_tail_call(expression *value);
+static counted_loop *find_counted_loop(statement *s);
+
+// returns within try blocks must run the catch and finally blocks after the call
+static int try_depth = 0;
+
+// the function being resolved. closures see the locals of the functions they are nested in
+typedef struct scope {
+    frame_layout *layout;
+    list **captures;        // for closures, the names shared with the enclosing functions
+    struct scope *enclosing; // NULL for functions that capture nothing
+} scope;
+static scope *curr_scope = NULL;
+
+// the counted loops of the function, valid only if their symbols are not shared with closures
+static list *counted_loops = NULL;
+
+
+void resolve_symbol_slots(list *statements) {
+    // top level code has no frame, symbols there are globals.
+    bind_statements(statements, NULL);
+}
+
+static void resolve_function(list *arg_names, list *statements, frame_layout **layout_ptr, list **captures_ptr) {
+    frame_layout *layout = new_frame_layout();
+    int outer_try_depth = try_depth;
+    try_depth = 0;
+    scope function_scope = { layout, captures_ptr, captures_ptr == NULL ? NULL : curr_scope };
+    scope *outer_scope = curr_scope;
+    curr_scope = &function_scope;
+    list *outer_counted_loops = counted_loops;
+    counted_loops = new_list(statement_item_info);
+
+    // arguments take the first slots, in order
+    for_list(arg_names, it, cstr, name)
+        frame_layout_add(layout, name);
+
+    // all locals must be known, before binding reads that precede assignments
+    collect_statements(statements, layout);
+    bind_statements(statements, layout);
+
+    // closures can change the symbols they share, at any call
+    for_list(counted_loops, lit, statement, s) {
+        counted_loop *loop = s->per_type.for_.counted;
+        if (layout->captured != NULL && (layout->captured[loop->counter->slot]
+            || (loop->bound->type == ET_IDENTIFIER && layout->captured[loop->bound->slot])))
+            s->per_type.for_.counted = NULL;
+    }
+
+    counted_loops = outer_counted_loops;
+    curr_scope = outer_scope;
+    try_depth = outer_try_depth;
+    *layout_ptr = layout;
+}
+
+// true if the name is a local of an enclosing function, shared with this closure.
+static bool captures_name(scope *s, const char *name) {
+    if (s->enclosing == NULL || s->enclosing->layout == NULL)
+        return false;
+
+    if (*s->captures != NULL) {
+        for_list(*s->captures, it, cstr, captured)
+            if (captured == name) return true;
+    }
+
+    // methods register 'this' in their frame, even if only their closures use it
+    int slot = frame_layout_find(s->enclosing->layout, name);
+    if (slot < 0 && strcmp(name, "this") == 0 && s->enclosing->captures == NULL)
+        slot = frame_layout_add(s->enclosing->layout, name);
+
+    if (slot >= 0)
+        frame_layout_capture(s->enclosing->layout, slot);
+    else if (!captures_name(s->enclosing, name))
+        return false;
+
+    if (*s->captures == NULL)
+        *s->captures = new_list(cstr_item_info);
+    list_add(*s->captures, (void *)name);
+    return true;
+}
+
+// assigned symbols are locals, unless a closure assigns the symbol of its enclosing function
+static void add_local(frame_layout *layout, const char *name) {
+    if (frame_layout_find(layout, name) < 0 && captures_name(curr_scope, name))
+        return;
+    frame_layout_add(layout, name);
+}
+
+// ------------------------------------------------------------------------
+
+static void collect_statements(list *statements, frame_layout *layout) {
+    if (statements == NULL)
+        return;
+
+    for_list(statements, it, statement, s) {
+        switch (s->type) {
+            case ST_EXPRESSION:
+                collect_expression(s->per_type.expr.expr, layout);
+                break;
+            case ST_IF:
+                collect_expression(s->per_type.if_.condition, layout);
+                collect_statements(s->per_type.if_.body_statements, layout);
+                if (s->per_type.if_.has_else)
+                    collect_statements(s->per_type.if_.else_body_statements, layout);
+                break;
+            case ST_WHILE:
+                collect_expression(s->per_type.while_.condition, layout);
+                collect_statements(s->per_type.while_.body_statements, layout);
+                break;
+            case ST_FOR_LOOP:
+                collect_expression(s->per_type.for_.init, layout);
+                collect_expression(s->per_type.for_.condition, layout);
+                collect_expression(s->per_type.for_.next, layout);
+                collect_statements(s->per_type.for_.body_statements, layout);
+                break;
+            case ST_RETURN:
+                collect_expression(s->per_type.return_.value, layout);
+                break;
+            case ST_FUNCTION:
+                // named functions are registered in the frame they are declared in
+                frame_layout_add(layout, s->per_type.function.name);
+                break;
+            case ST_TRY_CATCH:
+                collect_statements(s->per_type.try_catch.try_statements, layout);
+                if (s->per_type.try_catch.exception_identifier != NULL)
+                    frame_layout_add(layout, s->per_type.try_catch.exception_identifier);
+                collect_statements(s->per_type.try_catch.catch_statements, layout);
+                collect_statements(s->per_type.try_catch.finally_statements, layout);
+                break;
+            case ST_THROW:
+                collect_expression(s->per_type.throw.exception, layout);
+                break;
+        }
+    }
+}
+
+static void collect_expression(expression *e, frame_layout *layout) {
+    if (e == NULL)
+        return;
+
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            // 'this' is registered in the frame of methods
+            if (strcmp(e->per_type.terminal_data, "this") == 0)
+                add_local(layout, e->per_type.terminal_data);
+            break;
+
+        case ET_UNARY_OP:
+            if ((e->op == OP_PRE_INC || e->op == OP_PRE_DEC || e->op == OP_POST_INC || e->op == OP_POST_DEC)
+                && e->per_type.operation.operand1->type == ET_IDENTIFIER)
+                add_local(layout, e->per_type.operation.operand1->per_type.terminal_data);
+            collect_expression(e->per_type.operation.operand1, layout);
+            break;
+
+        case ET_BINARY_OP:
+            if (e->op >= OP_ASSIGNMENT && e->op <= OP_XOR_ASSIGN
+                && e->per_type.operation.operand1->type == ET_IDENTIFIER)
+                add_local(layout, e->per_type.operation.operand1->per_type.terminal_data);
+            collect_expression(e->per_type.operation.operand1, layout);
+            if (e->op != OP_MEMBER)
+                collect_expression(e->per_type.operation.operand2, layout);
+            break;
+
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                collect_expression(item, layout);
+            break;
+
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                collect_expression(dict_get(e->per_type.dict_, key), layout);
+            break;
+
+        // function declarations have their own frame
+    }
+}
+
+// ------------------------------------------------------------------------
+
+static void bind_statements(list *statements, frame_layout *layout) {
+    if (statements == NULL)
+        return;
+
+    for_list(statements, it, statement, s) {
+        switch (s->type) {
+            case ST_EXPRESSION:
+                bind_expression(s->per_type.expr.expr, layout);
+                break;
+            case ST_IF:
+                bind_expression(s->per_type.if_.condition, layout);
+                bind_statements(s->per_type.if_.body_statements, layout);
+                if (s->per_type.if_.has_else)
+                    bind_statements(s->per_type.if_.else_body_statements, layout);
+                break;
+            case ST_WHILE:
+                bind_expression(s->per_type.while_.condition, layout);
+                bind_statements(s->per_type.while_.body_statements, layout);
+                break;
+            case ST_FOR_LOOP:
+                bind_expression(s->per_type.for_.init, layout);
+                bind_expression(s->per_type.for_.condition, layout);
+                bind_expression(s->per_type.for_.next, layout);
+                bind_statements(s->per_type.for_.body_statements, layout);
+                s->per_type.for_.counted = layout == NULL ? NULL : find_counted_loop(s);
+                if (s->per_type.for_.counted != NULL)
+                    list_add(counted_loops, s);
+                break;
+            case ST_RETURN:
+                bind_expression(s->per_type.return_.value, layout);
+                s->per_type.return_.tail_call = layout != NULL && try_depth == 0 && is_tail_call(s->per_type.return_.value);
+                break;
+            case ST_FUNCTION:
+                resolve_function(s->per_type.function.arg_names, s->per_type.function.statements, &s->per_type.function.layout, NULL);
+                break;
+            case ST_TRY_CATCH:
+                try_depth++;
+                bind_statements(s->per_type.try_catch.try_statements, layout);
+                bind_statements(s->per_type.try_catch.catch_statements, layout);
+                bind_statements(s->per_type.try_catch.finally_statements, layout);
+                try_depth--;
+                break;
+            case ST_THROW:
+                bind_expression(s->per_type.throw.exception, layout);
+                break;
+            case ST_CLASS:
+                // attribute initializers run in the frame of the constructor's caller
+                scope *outer_scope = curr_scope;
+                curr_scope = NULL;
+                for_list(s->per_type.class.attributes, ait, class_attribute, attr)
+                    bind_expression(attr->init_value, NULL);
+                curr_scope = outer_scope;
+                for_list(s->per_type.class.methods, mit, class_method, method)
+                    resolve_function(method->function->per_type.function.arg_names,
+                        method->function->per_type.function.statements,
+                        &method->function->per_type.function.layout, NULL);
+                break;
+        }
+    }
+}
+
+static void bind_expression(expression *e, frame_layout *layout) {
+    if (e == NULL)
+        return;
+
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            e->slot = frame_layout_find(layout, e->per_type.terminal_data);
+            if (e->slot < 0 && curr_scope != NULL && !captures_name(curr_scope, e->per_type.terminal_data))
+                e->slot = GLOBAL_SLOT;
+            break;
+
+        case ET_UNARY_OP:
+            bind_expression(e->per_type.operation.operand1, layout);
+            break;
+
+        case ET_BINARY_OP:
+            bind_expression(e->per_type.operation.operand1, layout);
+            // member names are not symbols
+            if (e->op != OP_MEMBER)
+                bind_expression(e->per_type.operation.operand2, layout);
+            break;
+
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                bind_expression(item, layout);
+            break;
+
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                bind_expression(dict_get(e->per_type.dict_, key), layout);
+            break;
+
+        case ET_FUNC_DECL:
+            resolve_function(e->per_type.func.arg_names, e->per_type.func.statements, &e->per_type.func.layout, &e->per_type.func.captures);
+            break;
+    }
+}
+
+static bool is_tail_call(expression *value) {
+    // calls of members are dispatched by their object, they stay normal calls
+    return value != NULL
+        && value->type == ET_BINARY_OP
+        && value->op == OP_FUNC_CALL
+        && value->per_type.operation.operand1->op != OP_MEMBER
+        && value->per_type.operation.operand2->type == ET_LIST_DATA;
+}
+
+// finds whether statements read or change a symbol, conservatively, i.e. nested functions included
+static void scan_statements(list *statements, const char *name, bool *read, bool *written);
+
+static void scan_expression(expression *e, const char *name, bool *read, bool *written) {
+    if (e == NULL)
+        return;
+
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            if (strcmp(e->per_type.terminal_data, name) == 0)
+                *read = true;
+            break;
+
+        case ET_UNARY_OP:
+            if ((e->op == OP_PRE_INC || e->op == OP_PRE_DEC || e->op == OP_POST_INC || e->op == OP_POST_DEC)
+                && e->per_type.operation.operand1->type == ET_IDENTIFIER
+                && strcmp(e->per_type.operation.operand1->per_type.terminal_data, name) == 0)
+                *written = true;
+            scan_expression(e->per_type.operation.operand1, name, read, written);
+            break;
+
+        case ET_BINARY_OP:
+            if (e->op >= OP_ASSIGNMENT && e->op <= OP_XOR_ASSIGN
+                && e->per_type.operation.operand1->type == ET_IDENTIFIER
+                && strcmp(e->per_type.operation.operand1->per_type.terminal_data, name) == 0)
+                *written = true;
+            scan_expression(e->per_type.operation.operand1, name, read, written);
+            if (e->op != OP_MEMBER)
+                scan_expression(e->per_type.operation.operand2, name, read, written);
+            break;
+
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                scan_expression(item, name, read, written);
+            break;
+
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                scan_expression(dict_get(e->per_type.dict_, key), name, read, written);
+            break;
+
+        case ET_FUNC_DECL:
+            scan_statements(e->per_type.func.statements, name, read, written);
+            break;
+    }
+}
+
+static void scan_statements(list *statements, const char *name, bool *read, bool *written) {
+    if (statements == NULL)
+        return;
+
+    for_list(statements, it, statement, s) {
+        switch (s->type) {
+            case ST_EXPRESSION:
+                scan_expression(s->per_type.expr.expr, name, read, written);
+                break;
+            case ST_IF:
+                scan_expression(s->per_type.if_.condition, name, read, written);
+                scan_statements(s->per_type.if_.body_statements, name, read, written);
+                if (s->per_type.if_.has_else)
+                    scan_statements(s->per_type.if_.else_body_statements, name, read, written);
+                break;
+            case ST_WHILE:
+                scan_expression(s->per_type.while_.condition, name, read, written);
+                scan_statements(s->per_type.while_.body_statements, name, read, written);
+                break;
+            case ST_FOR_LOOP:
+                scan_expression(s->per_type.for_.init, name, read, written);
+                scan_expression(s->per_type.for_.condition, name, read, written);
+                scan_expression(s->per_type.for_.next, name, read, written);
+                scan_statements(s->per_type.for_.body_statements, name, read, written);
+                break;
+            case ST_RETURN:
+                scan_expression(s->per_type.return_.value, name, read, written);
+                break;
+            case ST_FUNCTION:
+                if (strcmp(s->per_type.function.name, name) == 0)
+                    *written = true;
+                scan_statements(s->per_type.function.statements, name, read, written);
+                break;
+            case ST_TRY_CATCH:
+                if (s->per_type.try_catch.exception_identifier != NULL
+                    && strcmp(s->per_type.try_catch.exception_identifier, name) == 0)
+                    *written = true;
+                scan_statements(s->per_type.try_catch.try_statements, name, read, written);
+                scan_statements(s->per_type.try_catch.catch_statements, name, read, written);
+                scan_statements(s->per_type.try_catch.finally_statements, name, read, written);
+                break;
+            case ST_THROW:
+                scan_expression(s->per_type.throw.exception, name, read, written);
+                break;
+            case ST_CLASS:
+                for_list(s->per_type.class.attributes, ait, class_attribute, attr)
+                    scan_expression(attr->init_value, name, read, written);
+                for_list(s->per_type.class.methods, mit, class_method, method)
+                    scan_statements(method->function->per_type.function.statements, name, read, written);
+                break;
+        }
+    }
+}
+
+bool symbol_is_assigned(list *statements, const char *name) {
+    bool read = false, written = false;
+    scan_statements(statements, name, &read, &written);
+    return written;
+}
+
+static bool is_identifier_named(expression *e, const char *name) {
+    return e->type == ET_IDENTIFIER && strcmp(e->per_type.terminal_data, name) == 0;
+}
+
+static bool find_loop_step(expression *next, const char *counter, int *step) {
+    if (next->type == ET_UNARY_OP && is_identifier_named(next->per_type.operation.operand1, counter)) {
+        if (next->op == OP_POST_INC || next->op == OP_PRE_INC) { *step = 1; return true; }
+        if (next->op == OP_POST_DEC || next->op == OP_PRE_DEC) { *step = -1; return true; }
+        return false;
+    }
+
+    if (next->type == ET_BINARY_OP && (next->op == OP_ADD_ASSIGN || next->op == OP_SUB_ASSIGN)
+        && is_identifier_named(next->per_type.operation.operand1, counter)
+        && next->per_type.operation.operand2->type == ET_NUMERIC_LITERAL) {
+        int amount = atoi(next->per_type.operation.operand2->per_type.terminal_data);
+        *step = next->op == OP_ADD_ASSIGN ? amount : -amount;
+        return true;
+    }
+
+    return false;
+}
+
+static counted_loop *find_counted_loop(statement *s) {
+    // i.e. "for (...; i < n; i++)", where i and n are locals not changed in the body.
+    // callees can still change them if the slot falls back to a global or holds a closure cell,
+    // so the executors check at the start of the loop that the frame owns both slots.
+    expression *condition = s->per_type.for_.condition;
+    expression *next = s->per_type.for_.next;
+    if (condition == NULL || next == NULL || condition->type != ET_BINARY_OP)
+        return NULL;
+    if (condition->op != OP_LESS_THAN && condition->op != OP_LESS_EQUAL
+        && condition->op != OP_GREATER_THAN && condition->op != OP_GREATER_EQUAL
+        && condition->op != OP_NOT_EQUAL)
+        return NULL;
+
+    expression *counter = condition->per_type.operation.operand1;
+    expression *bound = condition->per_type.operation.operand2;
+    if (counter->type != ET_IDENTIFIER || counter->slot < 0)
+        return NULL;
+    const char *name = counter->per_type.terminal_data;
+    if (bound->type == ET_IDENTIFIER) {
+        if (bound->slot < 0 || strcmp(bound->per_type.terminal_data, name) == 0)
+            return NULL;
+    } else if (bound->type != ET_NUMERIC_LITERAL) {
+        return NULL;
+    }
+
+    int step;
+    if (!find_loop_step(next, name, &step))
+        return NULL;
+
+    bool counter_read = false, counter_written = false;
+    scan_statements(s->per_type.for_.body_statements, name, &counter_read, &counter_written);
+    if (counter_written)
+        return NULL;
+    if (bound->type == ET_IDENTIFIER) {
+        bool bound_read = false, bound_written = false;
+        scan_statements(s->per_type.for_.body_statements, bound->per_type.terminal_data, &bound_read, &bound_written);
+        if (bound_written)
+            return NULL;
+    }
+
+    counted_loop *loop = malloc(sizeof(counted_loop));
+    loop->counter = counter;
+    loop->bound = bound;
+    loop->comparison = condition->op;
+    loop->step = step;
+    loop->counter_read = counter_read;
+    return loop;
+}
@@ -0,0 +1,30 @@
+#ifndef _SYMBOL_RESOLVER_H
+#define _SYMBOL_RESOLVER_H
+
+#include "../containers/_containers.h"
+#include "../entities/_entities.h"
+
+/*
+    Runs once after parsing. For each function (statement, expression or method)
+    it assigns a slot to every argument and local symbol, and it annotates
+    each identifier with the slot it refers to in the frame of its function.
+    Identifiers outside functions, or not local to their function
+    (globals, built-ins, captured values) keep slot -1 and are resolved by name.
+
+    Closures (function expressions) capture the locals of the functions
+    they are nested in, that they use. These are listed in the closure,
+    and their slots are marked as captured, to hold cells shared with it.
+
+    It also marks the returns of calls that can reuse the frame of their function,
+    i.e. the ones outside try blocks.
+    And the "for" loops counting an int local towards a bound not changed in their body,
+    that can run with a native counter.
+*/
+
+void resolve_symbol_slots(list *statements);
+
+// true if the symbol is assigned or declared anywhere in the statements, nested functions included
+bool symbol_is_assigned(list *statements, const char *name);
+
+
+#endif
@@ -18,12 +18,12 @@
 #define at_most(value, threshold)    ((value) <= (threshold) ? (value) : (threshold))
 #define between(value, low, high)    at_most(at_least(value, low), high)
 
-static list *built_in_funcs_list = NULL;
 static dict *built_in_funcs_dict = NULL;
 
 
 #define HANDLER_ARGUMENTS \
-    list *arg_values, \
+    int argc, \
+    variant **argv, \
     void *ast_node, \
     variant *this_obj, \
     dict *captured_values, \
@@ -33,25 +33,55 @@ static dict *built_in_funcs_dict = NULL;
 
 #define BUILT_IN(name)  \
         static execution_outcome built_in_ ## name ## _handler(HANDLER_ARGUMENTS); \
-        static inline callable *make_callable_for_ ## name () \
-            { return new_callable(#name, built_in_ ## name ## _handler, NULL, NULL, NULL); } \
+        static built_in_func built_in_ ## name = { #name, built_in_ ## name ## _handler, NULL, 0, NULL, NULL }; \
         static execution_outcome built_in_ ## name ## _handler(HANDLER_ARGUMENTS)
 
+// typed built-ins get their arguments unboxed, and return a plain C value
+#define TYPED_BUILT_IN(name, arg_types, return_type)  \
+        static typed_value built_in_ ## name ## _entry(typed_value *args); \
+        static built_in_func built_in_ ## name = { #name, typed_built_in_handler, arg_types, return_type, built_in_ ## name ## _entry, NULL }; \
+        static typed_value built_in_ ## name ## _entry(typed_value *args)
 
-#define STR_ARG(num)    (num >= list_length(arg_values)) ? NULL : str_variant_as_str(list_get(arg_values, num))
-#define INT_ARG(num)    (num >= list_length(arg_values)) ? 0 : int_variant_as_int(list_get(arg_values, num))
-#define LIST_ARG(num)   (num >= list_length(arg_values)) ? NULL : list_variant_as_list(list_get(arg_values, num))
-#define DICT_ARG(num)   (num >= list_length(arg_values)) ? NULL : dict_variant_as_dict(list_get(arg_values, num))
-#define CALL_ARG(num)   (num >= list_length(arg_values)) ? NULL : callable_variant_as_callable(list_get(arg_values, num))
-#define VARNT_ARG(num)  (num >= list_length(arg_values)) ? NULL : list_get(arg_values, num)
 
-#define RET_STR(val)    ok_outcome(new_str_variant(val))
+#define STR_ARG(num)    (num >= argc) ? NULL : str_variant_as_str(argv[num])
+#define INT_ARG(num)    (num >= argc) ? 0 : int_variant_as_int(argv[num])
+#define LIST_ARG(num)   (num >= argc) ? NULL : list_variant_as_list(argv[num])
+#define DICT_ARG(num)   (num >= argc) ? NULL : dict_variant_as_dict(argv[num])
+#define CALL_ARG(num)   (num >= argc) ? NULL : callable_variant_as_callable(argv[num])
+#define VARNT_ARG(num)  (num >= argc) ? NULL : argv[num]
+
+#define RET_STR(val)    ok_outcome(new_str_variant("%s", val))
 #define RET_INT(val)    ok_outcome(new_int_variant(val))
 #define RET_BOOL(val)   ok_outcome(new_bool_variant(val))
 #define RET_VARNT(var)  ok_outcome(var)
 #define RET_VOID()      ok_outcome(void_singleton)
 
 
+static execution_outcome call_typed_entry(built_in_func *f, int argc, variant **argv) {
+    // missing or mistyped arguments get a zero value, as in the untyped ones
+    typed_value args[MAX_TYPED_ARGS];
+    for (int i = 0; f->arg_types[i] != 0; i++) {
+        switch (f->arg_types[i]) {
+            case 'i': args[i].i = INT_ARG(i); break;
+            case 's': args[i].s = STR_ARG(i); break;
+            case 'b': args[i].b = (i >= argc) ? false : bool_variant_as_bool(argv[i]); break;
+        }
+    }
+
+    typed_value result = f->entry(args);
+    switch (f->return_type) {
+        case 'i': return RET_INT(result.i);
+        case 's': return RET_STR(result.s);
+        case 'b': return RET_BOOL(result.b);
+    }
+    return RET_VOID();
+}
+
+static execution_outcome typed_built_in_handler(HANDLER_ARGUMENTS) {
+    return call_typed_entry((built_in_func *)ast_node, argc, argv);
+}
+
+
 
 BUILT_IN(new) {
     // first argument is type, rest are initialization args
@@ -60,31 +90,12 @@ BUILT_IN(new) {
     //      - call the type initializer with the 'hello' as first argument
 
     variant *v = VARNT_ARG(0);
-    if (v == NULL || v->_type != type_of_types)
+    if (v == NULL || variant_type_of(v) != type_of_types)
         return exception_outcome(new_exception_variant("new() requires a type as first argument"));
     variant_type *type = (variant_type *)v;
     
-    // we need to create a new slice of the args list, excluding the first argument.
-    list *args_slice = new_list(variant_item_info);
-    for (int i = 1; i < list_length(arg_values); i++)
-        list_add(args_slice, list_get(arg_values, i));
-    variant *initializer_arg_values = new_list_variant_owning(args_slice);
-
-    variant *instance = malloc(type->instance_size);
-    instance->_type = type;
-    instance->_references_count = 1;
-
-    if (type->initializer != NULL) {
-        execution_outcome ex;
-        ex = type->initializer(instance, initializer_arg_values, ctx);
-        if (ex.failed || ex.excepted) return ex;
-    }
-
-    // we should improve the "clone()", to allow us to copy on write.
-    // shouldn't drop object I did not create.
-    // variant_drop_ref(initializer_arg_values);
-
-    return ok_outcome(instance);
+    // the initializer gets the arguments after the type
+    return variant_create(type, argc - 1, argv + 1, ctx);
 }
 
 BUILT_IN(type) {
@@ -93,21 +104,23 @@ BUILT_IN(type) {
     if (a == NULL)
         return RET_VARNT(void_singleton);
     
-    return RET_VARNT((variant *)a->_type);
+    return RET_VARNT((variant *)variant_type_of(a));
 }
 
 
 
 
-BUILT_IN(strlen) {
-    const char *s = STR_ARG(0);
-    return RET_INT(strlen(s));
+TYPED_BUILT_IN(strlen, "s", 'i') {
+    const char *s = args[0].s;
+    return (typed_value){ .i = strlen(s) };
 }
 
-BUILT_IN(substr) {
-    const char *s = STR_ARG(0);
-    int index = INT_ARG(1);
-    int len = INT_ARG(2);
+str *substr_builder = NULL;
+
+TYPED_BUILT_IN(substr, "sii", 's') {
+    const char *s = args[0].s;
+    int index = args[1].i;
+    int len = args[2].i;
 
     int actual_index = index >= 0 ? index : strlen(s) - (-index);
     actual_index = between(actual_index, 0, strlen(s));
@@ -115,37 +128,38 @@ BUILT_IN(substr) {
     int actual_len = len >= 0 ? len : strlen(s + actual_index) - (-len);
     actual_len = between(actual_len, 0, strlen(s + actual_index));
 
-    char *p = malloc(actual_len + 1);
-    memcpy(p, s + actual_index, actual_len);
-    p[actual_len] = 0;
+    // the result is copied into the returned value
+    if (substr_builder == NULL)
+        substr_builder = new_str();
+    str_clear(substr_builder);
+    for (int i = 0; i < actual_len; i++)
+        str_addc(substr_builder, s[actual_index + i]);
 
-    return RET_STR(p);
+    return (typed_value){ .s = str_cstr(substr_builder) };
 }
 
-BUILT_IN(strpos) {
-    const char *heystack = STR_ARG(0);
-    const char *needle = STR_ARG(1);
+TYPED_BUILT_IN(strpos, "ss", 'i') {
+    const char *heystack = args[0].s;
+    const char *needle = args[1].s;
 
     char *ptr = strstr(heystack, needle);
     int pos = (ptr == NULL) ? -1 : ptr - heystack;
 
-    return RET_INT(pos);
+    return (typed_value){ .i = pos };
 }
 
 str *log_line_builder = NULL;
 
 BUILT_IN(log) {
-    int args_count = list_length(arg_values);
-
     if (log_line_builder == NULL)
         log_line_builder = new_str();
 
     str_clear(log_line_builder);
-    for (int i = 0; i < args_count; i++) {
-        variant *s = variant_to_string(list_get(arg_values, i));
+    for (int i = 0; i < argc; i++) {
+        variant *s = variant_to_string(argv[i]);
         str_adds(log_line_builder, str_variant_as_str(s));
         variant_drop_ref(s);
-        if (i < args_count - 1)
+        if (i < argc - 1)
             str_addc(log_line_builder, ' ');
     }
 
@@ -172,13 +186,12 @@ BUILT_IN(input) {
     return RET_STR(p);
 }
 BUILT_IN(output) {
-    int args_count = list_length(arg_values);
     str *str = new_str();
-    for (int i = 0; i < args_count; i++) {
-        variant *s = variant_to_string(list_get(arg_values, i));
+    for (int i = 0; i < argc; i++) {
+        variant *s = variant_to_string(argv[i]);
         str_adds(str, str_variant_as_str(s));
         variant_drop_ref(s);
-        if (i < args_count - 1)
+        if (i < argc - 1)
             str_addc(str, ' ');
     }
     str_addc(str, '\n');
@@ -187,22 +200,29 @@ BUILT_IN(output) {
     return RET_VOID();
 }
 
-BUILT_IN(srand) {
-    int seed = INT_ARG(0);
-    srand(seed == 0 ? time(NULL) : seed);
+BUILT_IN(gc) {
+    // collection runs after the current top level statement, 
+    // as only then no values are held outside of variables.
+    variant_gc_request_full_collection();
     return RET_VOID();
 }
 
-BUILT_IN(rand) {
-    return RET_INT(rand());
+TYPED_BUILT_IN(srand, "i", 'v') {
+    int seed = args[0].i;
+    srand(seed == 0 ? time(NULL) : seed);
+    return (typed_value){ .i = 0 };
+}
+
+TYPED_BUILT_IN(rand, "", 'i') {
+    return (typed_value){ .i = rand() };
 }
 
 BUILT_IN(str) {
-    variant *v = list_get(arg_values, 0);
+    variant *v = VARNT_ARG(0);
     return RET_VARNT(variant_to_string(v));
 }
 BUILT_IN(int) {
-    variant *v = list_get(arg_values, 0);
+    variant *v = VARNT_ARG(0);
     if (variant_instance_of(v, bool_type)) {
         return RET_INT(bool_variant_as_bool(v) ? 1 : 0);
     } else {
@@ -211,7 +231,7 @@ BUILT_IN(int) {
     }
 }
 BUILT_IN(bool) {
-    variant *v = list_get(arg_values, 0);
+    variant *v = VARNT_ARG(0);
     if (variant_instance_of(v, void_type)) {
         return RET_VARNT(false_instance);
     } else if (variant_instance_of(v, int_type)) {
@@ -227,30 +247,42 @@ BUILT_IN(bool) {
 
 
 
-static inline void add_callable(callable *c) {
-    list_add(built_in_funcs_list, c);
-    dict_set(built_in_funcs_dict, callable_name(c), c);
+static inline void add_built_in(built_in_func *f) {
+    // created once, shared by all the runs
+    f->value = new_callable_variant(new_callable(f->name, f->handler, f, NULL, NULL));
+    f->value->_references_count = VARIANT_STATICALLY_ALLOCATED;
+    dict_set(built_in_funcs_dict, f->name, f);
 }
 
 void initialize_built_in_funcs_table() {
-    built_in_funcs_list = new_list(callable_item_info);
-    built_in_funcs_dict = new_dict(callable_item_info);
-
-    add_callable(make_callable_for_new());
-    add_callable(make_callable_for_type());
-    add_callable(make_callable_for_substr());
-    add_callable(make_callable_for_strpos());
-    add_callable(make_callable_for_strlen());
-    add_callable(make_callable_for_log());
-    add_callable(make_callable_for_input());
-    add_callable(make_callable_for_output());
-    add_callable(make_callable_for_rand());
-    add_callable(make_callable_for_srand());
-    add_callable(make_callable_for_str());
-    add_callable(make_callable_for_int());
-    add_callable(make_callable_for_bool());
+    built_in_funcs_dict = new_dict(NULL);
+
+    add_built_in(&built_in_new);
+    add_built_in(&built_in_type);
+    add_built_in(&built_in_substr);
+    add_built_in(&built_in_strpos);
+    add_built_in(&built_in_strlen);
+    add_built_in(&built_in_log);
+    add_built_in(&built_in_input);
+    add_built_in(&built_in_output);
+    add_built_in(&built_in_rand);
+    add_built_in(&built_in_srand);
+    add_built_in(&built_in_str);
+    add_built_in(&built_in_int);
+    add_built_in(&built_in_bool);
+    add_built_in(&built_in_gc);
 }
 
 dict *get_built_in_funcs_table() {
     return built_in_funcs_dict;
 }
+
+built_in_func *find_built_in_func(const char *name) {
+    return dict_get(built_in_funcs_dict, name);
+}
+
+execution_outcome call_built_in_func(built_in_func *f, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
+    if (f->entry != NULL)
+        return call_typed_entry(f, argc, argv);
+    return f->handler(argc, argv, f, NULL, NULL, call_origin, ctx);
+}
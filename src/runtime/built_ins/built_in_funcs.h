@@ -2,9 +2,35 @@
 #define _BUILT_IN_FUNCS_H
 
 #include "../../containers/_containers.h"
+#include "../../utils/data_types/callable.h"
+
+// the unboxed values of typed built-ins
+typedef union typed_value {
+    int i;
+    bool b;
+    const char *s; // results are copied, they must only stay valid until the entry is called again
+} typed_value;
+
+typedef typed_value typed_entry(typed_value *args);
+
+#define MAX_TYPED_ARGS  4
+
+typedef struct built_in_func {
+    const char *name;
+    callable_handler *handler; // the generic entry point, with variant arguments
+    const char *arg_types;     // for typed ones, 'i'nt, 's'tr or 'b'ool per argument, NULL otherwise
+    char return_type;          // for typed ones, 'i'nt, 's'tr, 'b'ool or 'v'oid
+    typed_entry *entry;        // for typed ones, the direct entry point, with unboxed arguments
+    variant *value;            // the immortal callable of the function
+} built_in_func;
 
 void initialize_built_in_funcs_table();
-dict *get_built_in_funcs_table();
+dict *get_built_in_funcs_table(); // name -> built_in_func
+
+built_in_func *find_built_in_func(const char *name);
+
+// calls the built-in directly, without resolving its name or creating a callable
+execution_outcome call_built_in_func(built_in_func *f, int argc, variant **argv, origin *call_origin, exec_context *ctx);
 
 
 #endif
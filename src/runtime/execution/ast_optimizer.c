@@ -0,0 +1,1561 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "../../utils/cstr.h"
+#include "../../utils/intern.h"
+#include "../built_ins/built_in_funcs.h"
+#include "ast_optimizer.h"
+
+// the code of a function, or the top level code. passes run on one at a time
+typedef struct function_body {
+    list *statements;
+    list *arg_names;      // NULL for the top level code
+    frame_layout *layout; // NULL for the top level code
+    list *captures;       // for closures, the names shared with the enclosing functions
+    statement *class_stmt; // for methods, the class they belong to
+} function_body;
+
+// what the O2 passes know of the locals of a function
+typedef struct locals_info {
+    function_body *function;
+    int count;      // slots when analyzed, later ones are temporaries of the passes
+    bool *is_int;   // the local only ever holds ints
+    bool changed;
+} locals_info;
+
+typedef int (*optimization_pass_func)(function_body *f); // returns the rewrites made
+
+static int inline_functions(function_body *f);
+static int fold_constants(function_body *f);
+static int prune_branches(function_body *f);
+static int reduce_strength(function_body *f);
+static int eliminate_dead_stores(function_body *f);
+static int hoist_loop_invariants(function_body *f);
+
+static struct optimization_pass {
+    const char *name;
+    int level; // the lowest one it runs at
+    optimization_pass_func run;
+} passes[] = {
+    { "inlining",           2, inline_functions },
+    { "constant folding",   1, fold_constants },
+    { "branch pruning",     1, prune_branches },
+    { "strength reduction", 2, reduce_strength },
+    { "dead stores",        2, eliminate_dead_stores },
+    { "loop invariants",    2, hoist_loop_invariants },
+};
+
+static int optimization_level = DEFAULT_OPTIMIZATION_LEVEL;
+
+// names that can resolve to globals: assigned by the top level code, built-ins, given values.
+// a local reads the global of its name, until it is first assigned.
+static dict *global_names = NULL;
+
+// names read by class attribute initializers, they run in the frame of any constructor's caller
+static dict *dynamically_read_names = NULL;
+
+// the top level functions, by name, that are declared once
+static dict *declared_functions = NULL;
+
+typedef void (*expression_visitor)(expression **e, void *data);
+typedef void (*statements_visitor)(list *statements, void *data);
+
+static void visit_expressions(list *statements, expression_visitor visit, void *data);
+static void visit_statement_lists(list *statements, statements_visitor visit, void *data);
+static void collect_functions(list *statements, list *functions);
+static void collect_declared_names(list *statements, void *globals);
+static void collect_assigned_names(expression **e, void *globals);
+static void collect_attribute_reads(list *statements, void *names);
+static void collect_function_declarations(list *statements, void *functions);
+
+
+void optimize_statements(list *statements, dict *given_values, bool verbose) {
+    if (optimization_level <= 0)
+        return;
+
+    global_names = new_dict(NULL);
+    dynamically_read_names = new_dict(NULL);
+    declared_functions = new_dict(NULL);
+    dict *built_ins = get_built_in_funcs_table();
+    for_dict(built_ins, bit, cstr, bltin_name)
+        dict_set(global_names, bltin_name, (void *)bltin_name);
+    if (given_values != NULL) {
+        for_dict(given_values, git, cstr, given_name)
+            dict_set(global_names, given_name, (void *)given_name);
+    }
+
+    function_body top_level = { statements, NULL, NULL, NULL, NULL };
+    list *functions = new_list(NULL);
+    list_add(functions, &top_level);
+    collect_functions(statements, functions);
+
+    // only the top level code assigns globals, functions assign locals
+    visit_statement_lists(statements, collect_declared_names, global_names);
+    visit_expressions(statements, collect_assigned_names, global_names);
+    visit_statement_lists(statements, collect_function_declarations, declared_functions);
+    for_list(functions, cit, function_body, f)
+        visit_statement_lists(f->statements, collect_attribute_reads, dynamically_read_names);
+
+    for (int i = 0; i < sizeof(passes) / sizeof(passes[0]); i++) {
+        if (passes[i].level > optimization_level)
+            continue;
+        int rewrites = 0;
+        for_list(functions, fit, function_body, function)
+            rewrites += passes[i].run(function);
+        if (verbose)
+            printf("%s: %d rewrites\n", passes[i].name, rewrites);
+    }
+}
+
+int ast_optimizer_get_level() {
+    return optimization_level;
+}
+
+void ast_optimizer_set_level(int level) {
+    optimization_level = level;
+}
+
+// ------------------------------------------------------------------------
+
+static void visit_expression(expression **e, expression_visitor visit, void *data) {
+    if (*e != NULL)
+        visit(e, data);
+}
+
+// visits the operands of an expression, the visitor may replace them
+static void visit_operands(expression *e, expression_visitor visit, void *data) {
+    switch (e->type) {
+        case ET_UNARY_OP:
+            visit(&e->per_type.operation.operand1, data);
+            break;
+
+        case ET_BINARY_OP:
+            visit(&e->per_type.operation.operand1, data);
+            // member names are not symbols
+            if (e->op != OP_MEMBER)
+                visit(&e->per_type.operation.operand2, data);
+            // the body of an inlined function is code of the caller
+            if (e->inlined != NULL)
+                visit(&e->inlined->body, data);
+            break;
+
+        case ET_LIST_DATA:
+            for (int i = 0; i < list_length(e->per_type.list_); i++) {
+                expression *item = list_get(e->per_type.list_, i);
+                visit(&item, data);
+                list_set(e->per_type.list_, i, item);
+            }
+            break;
+
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, dit, cstr, key) {
+                expression *value = dict_get(e->per_type.dict_, key);
+                visit(&value, data);
+                dict_set(e->per_type.dict_, key, value);
+            }
+            break;
+
+        // function declarations have a body of their own
+    }
+}
+
+// visits the expressions of the statements, nested statements included, nested functions excluded
+static void visit_expressions(list *statements, expression_visitor visit, void *data) {
+    if (statements == NULL)
+        return;
+
+    for_list(statements, it, statement, s) {
+        switch (s->type) {
+            case ST_EXPRESSION:
+                visit_expression(&s->per_type.expr.expr, visit, data);
+                break;
+            case ST_IF:
+                visit_expression(&s->per_type.if_.condition, visit, data);
+                visit_expressions(s->per_type.if_.body_statements, visit, data);
+                if (s->per_type.if_.has_else)
+                    visit_expressions(s->per_type.if_.else_body_statements, visit, data);
+                break;
+            case ST_WHILE:
+                visit_expression(&s->per_type.while_.condition, visit, data);
+                visit_expressions(s->per_type.while_.body_statements, visit, data);
+                break;
+            case ST_FOR_LOOP:
+                visit_expression(&s->per_type.for_.init, visit, data);
+                visit_expression(&s->per_type.for_.condition, visit, data);
+                visit_expression(&s->per_type.for_.next, visit, data);
+                visit_expressions(s->per_type.for_.body_statements, visit, data);
+                break;
+            case ST_RETURN:
+                visit_expression(&s->per_type.return_.value, visit, data);
+                break;
+            case ST_TRY_CATCH:
+                visit_expressions(s->per_type.try_catch.try_statements, visit, data);
+                visit_expressions(s->per_type.try_catch.catch_statements, visit, data);
+                visit_expressions(s->per_type.try_catch.finally_statements, visit, data);
+                break;
+            case ST_THROW:
+                visit_expression(&s->per_type.throw.exception, visit, data);
+                break;
+            case ST_CLASS:
+                for_list(s->per_type.class.attributes, ait, class_attribute, attr)
+                    visit_expression(&attr->init_value, visit, data);
+                break;
+        }
+    }
+}
+
+// visits the statement lists, first the given one, then the nested ones. nested functions excluded
+static void visit_statement_lists(list *statements, statements_visitor visit, void *data) {
+    if (statements == NULL)
+        return;
+
+    visit(statements, data);
+    for_list(statements, it, statement, s) {
+        switch (s->type) {
+            case ST_IF:
+                visit_statement_lists(s->per_type.if_.body_statements, visit, data);
+                if (s->per_type.if_.has_else)
+                    visit_statement_lists(s->per_type.if_.else_body_statements, visit, data);
+                break;
+            case ST_WHILE:
+                visit_statement_lists(s->per_type.while_.body_statements, visit, data);
+                break;
+            case ST_FOR_LOOP:
+                visit_statement_lists(s->per_type.for_.body_statements, visit, data);
+                break;
+            case ST_TRY_CATCH:
+                visit_statement_lists(s->per_type.try_catch.try_statements, visit, data);
+                visit_statement_lists(s->per_type.try_catch.catch_statements, visit, data);
+                visit_statement_lists(s->per_type.try_catch.finally_statements, visit, data);
+                break;
+        }
+    }
+}
+
+static void add_function(list *functions, list *statements, list *arg_names, frame_layout *layout, list *captures, statement *class_stmt) {
+    function_body *f = malloc(sizeof(function_body));
+    f->statements = statements;
+    f->arg_names = arg_names;
+    f->layout = layout;
+    f->captures = captures;
+    f->class_stmt = class_stmt;
+    list_add(functions, f);
+    collect_functions(statements, functions);
+}
+
+static void collect_function_expressions(expression **e, void *functions) {
+    if ((*e)->type == ET_FUNC_DECL)
+        add_function(functions, (*e)->per_type.func.statements, (*e)->per_type.func.arg_names, (*e)->per_type.func.layout,
+            (*e)->per_type.func.captures, NULL);
+    else
+        visit_operands(*e, collect_function_expressions, functions);
+}
+
+static void collect_function_statements(list *statements, void *functions) {
+    for_list(statements, it, statement, s) {
+        if (s->type == ST_FUNCTION) {
+            add_function(functions, s->per_type.function.statements, s->per_type.function.arg_names, s->per_type.function.layout, NULL, NULL);
+        } else if (s->type == ST_CLASS) {
+            for_list(s->per_type.class.methods, mit, class_method, method)
+                add_function(functions, method->function->per_type.function.statements,
+                    method->function->per_type.function.arg_names, method->function->per_type.function.layout, NULL, s);
+        }
+    }
+}
+
+static void collect_functions(list *statements, list *functions) {
+    visit_statement_lists(statements, collect_function_statements, functions);
+    visit_expressions(statements, collect_function_expressions, functions);
+}
+
+static void add_name(dict *names, const char *name) {
+    dict_set(names, name, (void *)name);
+}
+
+static void collect_assigned_names(expression **e, void *globals) {
+    expression *target = (*e)->per_type.operation.operand1;
+    if ((((*e)->type == ET_BINARY_OP && (*e)->op >= OP_ASSIGNMENT && (*e)->op <= OP_XOR_ASSIGN)
+        || ((*e)->type == ET_UNARY_OP && ((*e)->op == OP_PRE_INC || (*e)->op == OP_PRE_DEC
+            || (*e)->op == OP_POST_INC || (*e)->op == OP_POST_DEC)))
+        && target->type == ET_IDENTIFIER)
+        add_name(globals, target->per_type.terminal_data);
+    visit_operands(*e, collect_assigned_names, globals);
+}
+
+static void collect_read_names(expression **e, void *names) {
+    if ((*e)->type == ET_IDENTIFIER)
+        add_name(names, (*e)->per_type.terminal_data);
+    else
+        visit_operands(*e, collect_read_names, names);
+}
+
+static void collect_declared_names(list *statements, void *globals) {
+    for_list(statements, it, statement, s) {
+        if (s->type == ST_FUNCTION)
+            add_name(globals, s->per_type.function.name);
+        else if (s->type == ST_CLASS)
+            add_name(globals, s->per_type.class.name);
+        else if (s->type == ST_TRY_CATCH && s->per_type.try_catch.exception_identifier != NULL)
+            add_name(globals, s->per_type.try_catch.exception_identifier);
+    }
+}
+
+static void collect_attribute_reads(list *statements, void *names) {
+    for_list(statements, it, statement, s) {
+        if (s->type == ST_CLASS) {
+            for_list(s->per_type.class.attributes, ait, class_attribute, attr)
+                visit_expression(&attr->init_value, collect_read_names, names);
+        }
+    }
+}
+
+// functions declared more than once are kept with no statement
+static void collect_function_declarations(list *statements, void *functions) {
+    for_list(statements, it, statement, s) {
+        if (s->type == ST_FUNCTION)
+            dict_set(functions, s->per_type.function.name, dict_has(functions, s->per_type.function.name) ? NULL : s);
+    }
+}
+
+// ------------------------------------------------------------------------
+
+static int int_value(expression *e) {
+    return atoi(e->per_type.terminal_data);
+}
+
+static bool bool_value(expression *e) {
+    return strcmp(e->per_type.terminal_data, "true") == 0;
+}
+
+static bool is_int_literal(expression *e, int value) {
+    return e->type == ET_NUMERIC_LITERAL && int_value(e) == value;
+}
+
+static expression *int_literal(int value, token *token) {
+    char *data = malloc(16);
+    snprintf(data, 16, "%d", value);
+    return new_numeric_literal_expression(data, token);
+}
+
+static expression *bool_literal(bool value, token *token) {
+    return new_boolean_literal_expression(value ? "true" : "false", token);
+}
+
+static expression *compared(operator_type op, int c, token *token) {
+    switch (op) {
+        case OP_LESS_THAN:     return bool_literal(c <  0, token);
+        case OP_LESS_EQUAL:    return bool_literal(c <= 0, token);
+        case OP_GREATER_THAN:  return bool_literal(c >  0, token);
+        case OP_GREATER_EQUAL: return bool_literal(c >= 0, token);
+        case OP_EQUAL:         return bool_literal(c == 0, token);
+        case OP_NOT_EQUAL:     return bool_literal(c != 0, token);
+    }
+    return NULL;
+}
+
+// the operations that raise exceptions are left to run, and raise them
+static expression *fold_ints(expression *e, int a, int b) {
+    // overflows wrap, as they do when calculated
+    unsigned ua = (unsigned)a, ub = (unsigned)b;
+    int bits = sizeof(int) * 8;
+
+    switch (e->op) {
+        case OP_ADD:         return int_literal((int)(ua + ub), e->token);
+        case OP_SUBTRACT:    return int_literal((int)(ua - ub), e->token);
+        case OP_MULTIPLY:    return int_literal((int)(ua * ub), e->token);
+        case OP_BITWISE_AND: return int_literal(a & b, e->token);
+        case OP_BITWISE_OR:  return int_literal(a | b, e->token);
+        case OP_BITWISE_XOR: return int_literal(a ^ b, e->token);
+        case OP_DIVIDE:
+            if (b == 0 || (a == INT_MIN && b == -1)) return NULL;
+            return int_literal(a / b, e->token);
+        case OP_MODULO:
+            if (b == 0 || (a == INT_MIN && b == -1)) return NULL;
+            return int_literal(a % b, e->token);
+        case OP_LSHIFT:
+            if (b < 0 || b >= bits) return NULL;
+            return int_literal((int)(ua << b), e->token);
+        case OP_RSHIFT:
+            if (b < 0 || b >= bits) return NULL;
+            return int_literal(a >> b, e->token);
+    }
+    return compared(e->op, a < b ? -1 : (a > b ? 1 : 0), e->token);
+}
+
+static expression *fold_strings(expression *e, const char *a, const char *b) {
+    int la = strlen(a), lb = strlen(b);
+    if (e->op == OP_ADD) {
+        char *data = malloc(la + lb + 1);
+        memcpy(data, a, la);
+        memcpy(data + la, b, lb + 1);
+        return new_string_literal_expression(data, e->token);
+    }
+    // strings compare by length first
+    return compared(e->op, la != lb ? la - lb : strcmp(a, b), e->token);
+}
+
+static expression *fold_unary(expression *e) {
+    expression *operand = e->per_type.operation.operand1;
+
+    if (operand->type == ET_NUMERIC_LITERAL) {
+        int i = int_value(operand);
+        switch (e->op) {
+            case OP_POSITIVE_NUM: return operand;
+            case OP_NEGATIVE_NUM: return int_literal((int)(0u - (unsigned)i), e->token);
+            case OP_BITWISE_NOT:  return int_literal(~i, e->token);
+        }
+    } else if (operand->type == ET_BOOLEAN_LITERAL && e->op == OP_LOGICAL_NOT) {
+        return bool_literal(!bool_value(operand), e->token);
+    }
+    return e;
+}
+
+static expression *fold_binary(expression *e) {
+    expression *left = e->per_type.operation.operand1;
+    expression *right = e->per_type.operation.operand2;
+    expression *folded = NULL;
+
+    switch (e->op) {
+        case OP_LOGICAL_AND:
+        case OP_LOGICAL_OR:
+            if (left->type != ET_BOOLEAN_LITERAL)
+                return e;
+            // false decides an AND, true decides an OR, the second operand is not evaluated
+            if (bool_value(left) == (e->op == OP_LOGICAL_OR))
+                return left;
+            return right->type == ET_BOOLEAN_LITERAL ? right : e;
+
+        case OP_SHORT_IF:
+            if (left->type != ET_BOOLEAN_LITERAL)
+                return e;
+            // the parser gives the two branches as a list
+            return list_get(right->per_type.list_, bool_value(left) ? 0 : 1);
+    }
+
+    if (left->type == ET_NUMERIC_LITERAL && right->type == ET_NUMERIC_LITERAL) {
+        folded = fold_ints(e, int_value(left), int_value(right));
+    } else if (left->type == ET_STRING_LITERAL && right->type == ET_STRING_LITERAL) {
+        folded = fold_strings(e, left->per_type.terminal_data, right->per_type.terminal_data);
+    } else if (left->type == ET_BOOLEAN_LITERAL && right->type == ET_BOOLEAN_LITERAL) {
+        if (e->op == OP_EQUAL || e->op == OP_NOT_EQUAL)
+            folded = compared(e->op, bool_value(left) != bool_value(right), e->token);
+    }
+    return folded == NULL ? e : folded;
+}
+
+static void fold_expression(expression **e, void *rewrites) {
+    visit_operands(*e, fold_expression, rewrites);
+
+    expression *folded = *e;
+    if ((*e)->type == ET_UNARY_OP)
+        folded = fold_unary(*e);
+    else if ((*e)->type == ET_BINARY_OP)
+        folded = fold_binary(*e);
+
+    if (folded != *e) {
+        *e = folded;
+        (*(int *)rewrites)++;
+    }
+}
+
+static int fold_constants(function_body *f) {
+    int rewrites = 0;
+    visit_expressions(f->statements, fold_expression, &rewrites);
+    return rewrites;
+}
+
+// ------------------------------------------------------------------------
+
+static bool ends_flow(statement *s) {
+    return s->type == ST_RETURN || s->type == ST_BREAK || s->type == ST_CONTINUE || s->type == ST_THROW;
+}
+
+static bool is_false_literal(expression *e) {
+    return e != NULL && e->type == ET_BOOLEAN_LITERAL && !bool_value(e);
+}
+
+// replaces the statement at the index with the given ones
+static void splice_statements(list *statements, int index, list *replacement) {
+    list_remove(statements, index);
+    for (int i = 0; i < list_length(replacement); i++)
+        list_insert(statements, index + i, list_get(replacement, i));
+}
+
+// the value of the last statement is the value of the list, e.g. the result of a function without return,
+// so there the last statement is replaced only by statements yielding the same value. loops yield no value.
+static int prune_statements(list *statements, bool yields_value) {
+    if (statements == NULL)
+        return 0;
+
+    int rewrites = 0;
+    for (int i = 0; i < list_length(statements); i++) {
+        statement *s = list_get(statements, i);
+        bool last = i == list_length(statements) - 1;
+        bool value_kept = last && yields_value;
+
+        switch (s->type) {
+            case ST_IF:
+                rewrites += prune_statements(s->per_type.if_.body_statements, yields_value);
+                if (s->per_type.if_.has_else)
+                    rewrites += prune_statements(s->per_type.if_.else_body_statements, yields_value);
+
+                expression *condition = s->per_type.if_.condition;
+                if (condition->type != ET_BOOLEAN_LITERAL)
+                    break;
+                list *taken = bool_value(condition) ? s->per_type.if_.body_statements :
+                    (s->per_type.if_.has_else ? s->per_type.if_.else_body_statements : NULL);
+
+                if (taken != NULL && !list_empty(taken)) {
+                    splice_statements(statements, i, taken);
+                    i--; // the spliced statements are examined in turn
+                    rewrites++;
+                    continue;
+                } else if (!value_kept) {
+                    list_remove(statements, i--);
+                    rewrites++;
+                    continue;
+                } else if (taken == NULL) {
+                    // an "if" with a false condition and no "else" yields the condition
+                    list_set(statements, i, new_expression_statement(condition));
+                    rewrites++;
+                    continue;
+                }
+                break;
+
+            case ST_WHILE:
+                rewrites += prune_statements(s->per_type.while_.body_statements, false);
+                if (!value_kept && is_false_literal(s->per_type.while_.condition)) {
+                    list_remove(statements, i--);
+                    rewrites++;
+                    continue;
+                }
+                break;
+
+            case ST_FOR_LOOP:
+                rewrites += prune_statements(s->per_type.for_.body_statements, false);
+                if (!value_kept && is_false_literal(s->per_type.for_.condition)) {
+                    // the init still runs
+                    if (s->per_type.for_.init != NULL)
+                        list_set(statements, i, new_expression_statement(s->per_type.for_.init));
+                    else
+                        list_remove(statements, i--);
+                    rewrites++;
+                    continue;
+                }
+                break;
+
+            case ST_TRY_CATCH:
+                rewrites += prune_statements(s->per_type.try_catch.try_statements, yields_value);
+                rewrites += prune_statements(s->per_type.try_catch.catch_statements, yields_value);
+                rewrites += prune_statements(s->per_type.try_catch.finally_statements, yields_value);
+                break;
+        }
+
+        if (ends_flow(s) && !last) {
+            while (list_length(statements) > i + 1)
+                list_remove(statements, i + 1);
+            rewrites++;
+        }
+    }
+    return rewrites;
+}
+
+static int prune_branches(function_body *f) {
+    return prune_statements(f->statements, true);
+}
+
+// ------------------------------------------------------------------------
+
+static bool is_int_local(locals_info *locals, expression *e) {
+    return e->type == ET_IDENTIFIER && e->slot >= 0 && e->slot < locals->count && locals->is_int[e->slot];
+}
+
+// true if the expression yields an int, whenever it yields a value
+static bool is_int_expression(expression *e, locals_info *locals) {
+    switch (e->type) {
+        case ET_NUMERIC_LITERAL:
+            return true;
+
+        case ET_IDENTIFIER:
+            return is_int_local(locals, e);
+
+        case ET_UNARY_OP:
+            switch (e->op) {
+                case OP_POSITIVE_NUM:
+                case OP_NEGATIVE_NUM:
+                case OP_BITWISE_NOT:
+                    return is_int_expression(e->per_type.operation.operand1, locals);
+                case OP_PRE_INC:
+                case OP_PRE_DEC:
+                case OP_POST_INC:
+                case OP_POST_DEC:
+                    // modifications work on ints only
+                    return true;
+            }
+            return false;
+
+        case ET_BINARY_OP:
+            switch (e->op) {
+                case OP_ADD: case OP_SUBTRACT: case OP_MULTIPLY: case OP_DIVIDE: case OP_MODULO:
+                case OP_LSHIFT: case OP_RSHIFT: case OP_BITWISE_AND: case OP_BITWISE_OR: case OP_BITWISE_XOR:
+                    return is_int_expression(e->per_type.operation.operand1, locals)
+                        && is_int_expression(e->per_type.operation.operand2, locals);
+                case OP_ASSIGNMENT:
+                    return is_int_expression(e->per_type.operation.operand2, locals);
+                case OP_SHORT_IF:
+                    list *branches = e->per_type.operation.operand2->per_type.list_;
+                    return is_int_expression(list_get(branches, 0), locals)
+                        && is_int_expression(list_get(branches, 1), locals);
+            }
+            // modifications work on ints only
+            return e->op > OP_ASSIGNMENT && e->op <= OP_XOR_ASSIGN;
+    }
+    return false;
+}
+
+static void drop_int_local(locals_info *locals, const char *name) {
+    int slot = frame_layout_find(locals->function->layout, name);
+    if (slot >= 0 && slot < locals->count && locals->is_int[slot]) {
+        locals->is_int[slot] = false;
+        locals->changed = true;
+    }
+}
+
+static void drop_non_int_assignments(expression **e, void *data) {
+    locals_info *locals = data;
+    visit_operands(*e, drop_non_int_assignments, data);
+
+    expression *target = (*e)->per_type.operation.operand1;
+    if ((*e)->type == ET_BINARY_OP && (*e)->op == OP_ASSIGNMENT && is_int_local(locals, target)
+        && !is_int_expression((*e)->per_type.operation.operand2, locals))
+        drop_int_local(locals, target->per_type.terminal_data);
+}
+
+static void drop_non_int_declarations(list *statements, void *data) {
+    for_list(statements, it, statement, s) {
+        if (s->type == ST_FUNCTION)
+            drop_int_local(data, s->per_type.function.name);
+        else if (s->type == ST_TRY_CATCH && s->per_type.try_catch.exception_identifier != NULL)
+            drop_int_local(data, s->per_type.try_catch.exception_identifier);
+    }
+}
+
+// finds the locals that only ever hold ints. arguments can be given anything,
+// and closures can change the locals they share. a local is int if all the values
+// assigned to it are, starting from all of them and dropping the ones that are not.
+static locals_info *analyze_locals(function_body *f) {
+    if (f->layout == NULL)
+        return NULL;
+
+    locals_info *locals = malloc(sizeof(locals_info));
+    locals->function = f;
+    locals->count = f->layout->slots_count;
+    locals->is_int = calloc(locals->count + 1, sizeof(bool));
+    int args_count = f->arg_names == NULL ? 0 : list_length(f->arg_names);
+    for (int i = args_count; i < locals->count; i++) {
+        const char *name = f->layout->names[i];
+        locals->is_int[i] = (f->layout->captured == NULL || !f->layout->captured[i])
+            && !dict_has(global_names, name) && strcmp(name, "this") != 0;
+    }
+
+    do {
+        locals->changed = false;
+        visit_statement_lists(f->statements, drop_non_int_declarations, locals);
+        visit_expressions(f->statements, drop_non_int_assignments, locals);
+    } while (locals->changed);
+
+    return locals;
+}
+
+// ------------------------------------------------------------------------
+
+typedef struct reduction {
+    locals_info *locals;
+    int rewrites;
+} reduction;
+
+static operator_type compound_operator(operator_type op) {
+    switch (op) {
+        case OP_ADD:         return OP_ADD_ASSIGN;
+        case OP_SUBTRACT:    return OP_SUB_ASSIGN;
+        case OP_MULTIPLY:    return OP_MUL_ASSIGN;
+        case OP_LSHIFT:      return OP_LSH_ASSIGN;
+        case OP_RSHIFT:      return OP_RSH_ASSIGN;
+        case OP_BITWISE_AND: return OP_AND_ASSIGN;
+        case OP_BITWISE_OR:  return OP_OR_ASSIGN;
+        case OP_BITWISE_XOR: return OP_XOR_ASSIGN;
+    }
+    return OP_UNKNOWN;
+}
+
+// the k for literals 2^k, k > 0, or zero
+static int power_of_two(expression *e) {
+    if (e->type != ET_NUMERIC_LITERAL)
+        return 0;
+    int value = int_value(e);
+    if (value < 2 || (value & (value - 1)) != 0)
+        return 0;
+    int k = 0;
+    while ((1 << k) != value)
+        k++;
+    return k;
+}
+
+static expression *reduce(expression *e, locals_info *locals) {
+    if (e->type != ET_BINARY_OP)
+        return e;
+    expression *left = e->per_type.operation.operand1;
+    expression *right = e->per_type.operation.operand2;
+    int k;
+
+    // "x = x + n" becomes "x += n", the local is resolved once
+    if (e->op == OP_ASSIGNMENT && is_int_local(locals, left)
+        && right->type == ET_BINARY_OP && compound_operator(right->op) != OP_UNKNOWN
+        && right->per_type.operation.operand1->type == ET_IDENTIFIER
+        && right->per_type.operation.operand1->slot == left->slot
+        && is_int_expression(right->per_type.operation.operand2, locals))
+        return new_binary_expression(compound_operator(right->op), e->token, left, right->per_type.operation.operand2);
+
+    bool left_int = is_int_expression(left, locals);
+    bool right_int = is_int_expression(right, locals);
+    switch (e->op) {
+        case OP_ADD:
+        case OP_BITWISE_OR:
+        case OP_BITWISE_XOR:
+            if (left_int && is_int_literal(right, 0)) return left;
+            if (right_int && is_int_literal(left, 0)) return right;
+            break;
+        case OP_SUBTRACT:
+        case OP_LSHIFT:
+        case OP_RSHIFT:
+            if (left_int && is_int_literal(right, 0)) return left;
+            break;
+        case OP_DIVIDE:
+            if (left_int && is_int_literal(right, 1)) return left;
+            break;
+        case OP_MULTIPLY:
+            if (left_int && is_int_literal(right, 1)) return left;
+            if (right_int && is_int_literal(left, 1)) return right;
+            if (left_int && (k = power_of_two(right)) > 0)
+                return new_binary_expression(OP_LSHIFT, e->token, left, int_literal(k, right->token));
+            if (right_int && (k = power_of_two(left)) > 0)
+                return new_binary_expression(OP_LSHIFT, e->token, right, int_literal(k, left->token));
+            break;
+    }
+    return e;
+}
+
+static void reduce_expression(expression **e, void *data) {
+    reduction *r = data;
+    visit_operands(*e, reduce_expression, data);
+
+    expression *reduced = reduce(*e, r->locals);
+    if (reduced != *e) {
+        *e = reduced;
+        r->rewrites++;
+    }
+}
+
+static int reduce_strength(function_body *f) {
+    // the top level code works on globals, their types are not known
+    reduction r = { analyze_locals(f), 0 };
+    if (r.locals == NULL)
+        return 0;
+
+    visit_expressions(f->statements, reduce_expression, &r);
+    return r.rewrites;
+}
+
+// ------------------------------------------------------------------------
+
+typedef struct dead_stores {
+    function_body *function;
+    bool *read;
+    int rewrites;
+} dead_stores;
+
+static void find_reads(expression **e, void *data) {
+    dead_stores *d = data;
+    expression *x = *e;
+
+    if (x->type == ET_IDENTIFIER) {
+        if (x->slot >= 0)
+            d->read[x->slot] = true;
+    } else if (x->type == ET_BINARY_OP && x->op == OP_ASSIGNMENT && x->per_type.operation.operand1->type == ET_IDENTIFIER) {
+        visit_expression(&x->per_type.operation.operand2, find_reads, data);
+    } else {
+        visit_operands(x, find_reads, data);
+    }
+}
+
+// true if evaluating the expression has no effect, and cannot raise an exception
+static bool has_no_effect(expression *e) {
+    switch (e->type) {
+        case ET_NUMERIC_LITERAL:
+        case ET_STRING_LITERAL:
+        case ET_BOOLEAN_LITERAL:
+        case ET_FUNC_DECL:
+            return true;
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                if (!has_no_effect(item)) return false;
+            return true;
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                if (!has_no_effect(dict_get(e->per_type.dict_, key))) return false;
+            return true;
+    }
+    return false;
+}
+
+static void remove_dead_stores(list *statements, void *data) {
+    dead_stores *d = data;
+    frame_layout *layout = d->function->layout;
+
+    for (int i = 0; i < list_length(statements); i++) {
+        statement *s = list_get(statements, i);
+        if (s->type != ST_EXPRESSION)
+            continue;
+        expression *e = s->per_type.expr.expr;
+        if (e->type != ET_BINARY_OP || e->op != OP_ASSIGNMENT)
+            continue;
+        expression *target = e->per_type.operation.operand1;
+        if (target->type != ET_IDENTIFIER || target->slot < 0 || d->read[target->slot]
+            || (layout->captured != NULL && layout->captured[target->slot]))
+            continue;
+        // assigning an existing global updates it
+        if (dict_has(global_names, target->per_type.terminal_data))
+            continue;
+
+        // the value is still evaluated, and it is the value of the statement
+        expression *value = e->per_type.operation.operand2;
+        if (i < list_length(statements) - 1 && has_no_effect(value))
+            list_remove(statements, i--);
+        else
+            s->per_type.expr.expr = value;
+        d->rewrites++;
+    }
+}
+
+static int eliminate_dead_stores(function_body *f) {
+    // globals are read by any function
+    if (f->layout == NULL)
+        return 0;
+
+    dead_stores d = { f, calloc(f->layout->slots_count + 1, sizeof(bool)), 0 };
+    visit_expressions(f->statements, find_reads, &d);
+    for_dict(dynamically_read_names, nit, cstr, name) {
+        int slot = frame_layout_find(f->layout, name);
+        if (slot >= 0)
+            d.read[slot] = true;
+    }
+
+    visit_statement_lists(f->statements, remove_dead_stores, &d);
+    free(d.read);
+    return d.rewrites;
+}
+
+// ------------------------------------------------------------------------
+
+typedef struct hoisting {
+    locals_info *locals;
+    bool *assigned;     // locals certainly set before the loop
+    bool *written;      // locals written in the loop
+    list *hoisted;      // the expressions computed before the loop,
+    list *temporaries;  // and the locals holding them
+    int rewrites;
+} hoisting;
+
+static int temporaries_count = 0;
+
+static bool is_modification_of_identifier(expression *e) {
+    if (e->type == ET_UNARY_OP)
+        return (e->op == OP_PRE_INC || e->op == OP_PRE_DEC || e->op == OP_POST_INC || e->op == OP_POST_DEC)
+            && e->per_type.operation.operand1->type == ET_IDENTIFIER;
+    return e->type == ET_BINARY_OP && e->op >= OP_ASSIGNMENT && e->op <= OP_XOR_ASSIGN
+        && e->per_type.operation.operand1->type == ET_IDENTIFIER;
+}
+
+static void find_writes(expression **e, void *data) {
+    hoisting *h = data;
+    if (is_modification_of_identifier(*e)) {
+        int slot = (*e)->per_type.operation.operand1->slot;
+        if (slot >= 0 && slot < h->locals->count)
+            h->written[slot] = true;
+    }
+    visit_operands(*e, find_writes, data);
+}
+
+static void find_declared_writes(list *statements, void *data) {
+    hoisting *h = data;
+    for_list(statements, it, statement, s) {
+        const char *name = NULL;
+        if (s->type == ST_FUNCTION)
+            name = s->per_type.function.name;
+        else if (s->type == ST_TRY_CATCH)
+            name = s->per_type.try_catch.exception_identifier;
+        int slot = name == NULL ? -1 : frame_layout_find(h->locals->function->layout, name);
+        if (slot >= 0 && slot < h->locals->count)
+            h->written[slot] = true;
+    }
+}
+
+// true for int operations, or comparisons of them, that cannot raise exceptions,
+// on literals and int locals set before the loop and not changed in it.
+static bool is_invariant_int(expression *e, hoisting *h) {
+    switch (e->type) {
+        case ET_NUMERIC_LITERAL:
+            return true;
+
+        case ET_IDENTIFIER:
+            return is_int_local(h->locals, e) && h->assigned[e->slot] && !h->written[e->slot];
+
+        case ET_UNARY_OP:
+            return (e->op == OP_POSITIVE_NUM || e->op == OP_NEGATIVE_NUM || e->op == OP_BITWISE_NOT)
+                && is_invariant_int(e->per_type.operation.operand1, h);
+
+        case ET_BINARY_OP:
+            expression *left = e->per_type.operation.operand1;
+            expression *right = e->per_type.operation.operand2;
+            switch (e->op) {
+                case OP_ADD: case OP_SUBTRACT: case OP_MULTIPLY: case OP_LSHIFT: case OP_RSHIFT:
+                case OP_BITWISE_AND: case OP_BITWISE_OR: case OP_BITWISE_XOR:
+                    return is_invariant_int(left, h) && is_invariant_int(right, h);
+                case OP_DIVIDE: case OP_MODULO:
+                    return is_invariant_int(left, h) && right->type == ET_NUMERIC_LITERAL
+                        && int_value(right) != 0 && int_value(right) != -1;
+            }
+            return false;
+    }
+    return false;
+}
+
+static bool is_invariant_operation(expression *e, hoisting *h) {
+    if (e->type != ET_UNARY_OP && e->type != ET_BINARY_OP)
+        return false;
+    if (is_invariant_int(e, h))
+        return true;
+    return e->type == ET_BINARY_OP && e->op >= OP_LESS_THAN && e->op <= OP_NOT_EQUAL
+        && is_invariant_int(e->per_type.operation.operand1, h)
+        && is_invariant_int(e->per_type.operation.operand2, h);
+}
+
+static expression *temporary_identifier(expression *temporary, token *token) {
+    expression *e = new_identifier_expression(temporary->per_type.terminal_data, token);
+    e->slot = temporary->slot;
+    return e;
+}
+
+static void hoist_expression(expression **e, void *data) {
+    hoisting *h = data;
+    if (!is_invariant_operation(*e, h)) {
+        visit_operands(*e, hoist_expression, data);
+        return;
+    }
+
+    // equal expressions share the local
+    expression *temporary = NULL;
+    for (int i = 0; i < list_length(h->hoisted) && temporary == NULL; i++)
+        if (expressions_are_equal(list_get(h->hoisted, i), *e))
+            temporary = list_get(h->temporaries, i);
+
+    if (temporary == NULL) {
+        char name[32];
+        snprintf(name, sizeof(name), "$inv%d", ++temporaries_count);
+        temporary = new_identifier_expression(intern(name), (*e)->token);
+        temporary->slot = frame_layout_add(h->locals->function->layout, temporary->per_type.terminal_data);
+        list_add(h->hoisted, *e);
+        list_add(h->temporaries, temporary);
+    }
+    *e = temporary_identifier(temporary, (*e)->token);
+    h->rewrites++;
+}
+
+// computes the invariants of the loop at the index into locals, before it. returns the statements added
+static int hoist_from_loop(list *statements, int index, hoisting *h) {
+    statement *loop = list_get(statements, index);
+    h->written = calloc(h->locals->count + 1, sizeof(bool));
+    h->hoisted = new_list(expression_item_info);
+    h->temporaries = new_list(expression_item_info);
+
+    // the init of a "for" runs after the invariants are computed, it counts as a write
+    list *loop_statements = loop->type == ST_WHILE ? loop->per_type.while_.body_statements : loop->per_type.for_.body_statements;
+    expression **condition = loop->type == ST_WHILE ? &loop->per_type.while_.condition : &loop->per_type.for_.condition;
+    if (loop->type == ST_FOR_LOOP) {
+        visit_expression(&loop->per_type.for_.init, find_writes, h);
+        visit_expression(&loop->per_type.for_.next, find_writes, h);
+    }
+    visit_expression(condition, find_writes, h);
+    visit_expressions(loop_statements, find_writes, h);
+    visit_statement_lists(loop_statements, find_declared_writes, h);
+
+    visit_expression(condition, hoist_expression, h);
+    if (loop->type == ST_FOR_LOOP)
+        visit_expression(&loop->per_type.for_.next, hoist_expression, h);
+    visit_expressions(loop_statements, hoist_expression, h);
+
+    int added = list_length(h->hoisted);
+    for (int i = 0; i < added; i++) {
+        expression *value = list_get(h->hoisted, i);
+        expression *temporary = list_get(h->temporaries, i);
+        list_insert(statements, index + i, new_expression_statement(
+            new_binary_expression(OP_ASSIGNMENT, value->token, temporary, value)));
+    }
+    free(h->written);
+    return added;
+}
+
+static void hoist_from_statements(list *statements, hoisting *h);
+
+static void hoist_from_nested(list *statements, hoisting *h, int assigned_slot) {
+    if (statements == NULL)
+        return;
+    bool *outer_assigned = h->assigned;
+    h->assigned = malloc((h->locals->count + 1) * sizeof(bool));
+    memcpy(h->assigned, outer_assigned, (h->locals->count + 1) * sizeof(bool));
+    if (assigned_slot >= 0 && assigned_slot < h->locals->count)
+        h->assigned[assigned_slot] = true;
+    hoist_from_statements(statements, h);
+    free(h->assigned);
+    h->assigned = outer_assigned;
+}
+
+static int assigned_slot(expression *e) {
+    if (e == NULL || !is_modification_of_identifier(e))
+        return -1;
+    return e->per_type.operation.operand1->slot;
+}
+
+// loops are visited outer first, what does not change in an outer loop is computed before it
+static void hoist_from_statements(list *statements, hoisting *h) {
+    for (int i = 0; i < list_length(statements); i++) {
+        statement *s = list_get(statements, i);
+
+        switch (s->type) {
+            case ST_WHILE:
+                i += hoist_from_loop(statements, i, h);
+                hoist_from_nested(s->per_type.while_.body_statements, h, -1);
+                break;
+            case ST_FOR_LOOP:
+                i += hoist_from_loop(statements, i, h);
+                hoist_from_nested(s->per_type.for_.body_statements, h, assigned_slot(s->per_type.for_.init));
+                break;
+            case ST_IF:
+                hoist_from_nested(s->per_type.if_.body_statements, h, -1);
+                if (s->per_type.if_.has_else)
+                    hoist_from_nested(s->per_type.if_.else_body_statements, h, -1);
+                break;
+            case ST_TRY_CATCH:
+                hoist_from_nested(s->per_type.try_catch.try_statements, h, -1);
+                hoist_from_nested(s->per_type.try_catch.catch_statements, h, -1);
+                hoist_from_nested(s->per_type.try_catch.finally_statements, h, -1);
+                break;
+        }
+
+        int slot = -1;
+        if (s->type == ST_EXPRESSION)
+            slot = assigned_slot(s->per_type.expr.expr);
+        else if (s->type == ST_FOR_LOOP)
+            slot = assigned_slot(s->per_type.for_.init);
+        if (slot >= 0 && slot < h->locals->count)
+            h->assigned[slot] = true;
+    }
+}
+
+static int hoist_loop_invariants(function_body *f) {
+    // globals can be changed by any call made in the loop
+    locals_info *locals = analyze_locals(f);
+    if (locals == NULL)
+        return 0;
+
+    hoisting h = { locals, calloc(locals->count + 1, sizeof(bool)), NULL, NULL, NULL, 0 };
+    hoist_from_statements(f->statements, &h);
+    free(h.assigned);
+    return h.rewrites;
+}
+
+// ------------------------------------------------------------------------
+
+// functions of a single "return <expression>", with no calls nor assignments,
+// and up to this many nodes, are expanded at their call sites
+#define INLINED_MAX_NODES   16
+
+typedef struct inlining {
+    function_body *function; // the caller
+    dict *assigned;          // the locals, or globals in the top level code, certainly set before the statement
+    int rewrites;
+} inlining;
+
+static bool is_inlinable_expression(expression *e, bool is_method, int *nodes) {
+    if (++(*nodes) > INLINED_MAX_NODES)
+        return false;
+
+    switch (e->type) {
+        case ET_NUMERIC_LITERAL:
+        case ET_STRING_LITERAL:
+        case ET_BOOLEAN_LITERAL:
+            return true;
+
+        case ET_IDENTIFIER:
+            return is_method || strcmp(e->per_type.terminal_data, "this") != 0;
+
+        case ET_UNARY_OP:
+            if (e->op == OP_PRE_INC || e->op == OP_PRE_DEC || e->op == OP_POST_INC || e->op == OP_POST_DEC)
+                return false;
+            return is_inlinable_expression(e->per_type.operation.operand1, is_method, nodes);
+
+        case ET_BINARY_OP:
+            if (e->op == OP_FUNC_CALL || (e->op >= OP_ASSIGNMENT && e->op <= OP_XOR_ASSIGN))
+                return false;
+            if (!is_inlinable_expression(e->per_type.operation.operand1, is_method, nodes))
+                return false;
+            return e->op == OP_MEMBER || is_inlinable_expression(e->per_type.operation.operand2, is_method, nodes);
+
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                if (!is_inlinable_expression(item, is_method, nodes)) return false;
+            return true;
+
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                if (!is_inlinable_expression(dict_get(e->per_type.dict_, key), is_method, nodes)) return false;
+            return true;
+    }
+    return false;
+}
+
+// the returned expression of a function that can be inlined, or NULL
+static expression *inlinable_body(statement *function, bool is_method) {
+    list *statements = function->per_type.function.statements;
+    if (list_length(statements) != 1)
+        return NULL;
+    statement *s = list_get(statements, 0);
+    if (s->type != ST_RETURN || s->per_type.return_.value == NULL)
+        return NULL;
+
+    // arguments are found by name
+    list *arg_names = function->per_type.function.arg_names;
+    for (int i = 0; i < list_length(arg_names); i++)
+        for (int j = 0; j < i; j++)
+            if (list_get(arg_names, i) == list_get(arg_names, j)) return NULL;
+
+    int nodes = 0;
+    if (!is_inlinable_expression(s->per_type.return_.value, is_method, &nodes))
+        return NULL;
+    return s->per_type.return_.value;
+}
+
+static bool is_literal(expression *e) {
+    return e->type == ET_NUMERIC_LITERAL || e->type == ET_STRING_LITERAL || e->type == ET_BOOLEAN_LITERAL;
+}
+
+static bool is_caller_argument(expression *e, function_body *caller) {
+    return e->type == ET_IDENTIFIER && caller->layout != NULL
+        && e->slot >= 0 && e->slot < list_length(caller->arg_names);
+}
+
+// arguments are read where the body uses them: reading them must have no effect, nor fail.
+// literals, and the arguments, 'this' or the locals of the caller certainly set before the call
+static bool is_stable_argument(expression *e, inlining *in) {
+    if (is_literal(e))
+        return true;
+    if (e->type != ET_IDENTIFIER)
+        return false;
+
+    function_body *f = in->function;
+    const char *name = e->per_type.terminal_data;
+    if (f->layout == NULL)
+        return dict_has(in->assigned, name);
+    if (e->slot < 0)
+        return false;
+    return is_caller_argument(e, f)
+        || (f->class_stmt != NULL && strcmp(name, "this") == 0)
+        || dict_has(in->assigned, name);
+}
+
+static bool reads_name(expression *e, const char *name) {
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            return e->per_type.terminal_data == name;
+        case ET_UNARY_OP:
+            return reads_name(e->per_type.operation.operand1, name);
+        case ET_BINARY_OP:
+            // the second operand of these is not always evaluated
+            if (e->op == OP_MEMBER || e->op == OP_LOGICAL_AND || e->op == OP_LOGICAL_OR || e->op == OP_SHORT_IF)
+                return reads_name(e->per_type.operation.operand1, name);
+            return reads_name(e->per_type.operation.operand1, name)
+                || reads_name(e->per_type.operation.operand2, name);
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                if (reads_name(item, name)) return true;
+            return false;
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                if (reads_name(dict_get(e->per_type.dict_, key), name)) return true;
+            return false;
+    }
+    return false;
+}
+
+// how the arguments of a call take the place of the parameters, in the inlined body
+typedef struct arguments {
+    list *names;              // the parameters,
+    list *values;             // and the argument expressions
+    expression *object;       // for methods, in place of 'this'
+    bool *in_place;           // per parameter, the argument is evaluated where the body first reads it,
+    int *reads;               // the reads of the parameter so far,
+    expression **temporaries; // and the local keeping the argument for the next reads, if any
+    bool has_locals;          // the caller can have temporaries, it is a function
+    int next;                 // the next in place parameter to be read
+    bool operated;            // an operation, that may fail, was evaluated
+} arguments;
+
+static int parameter_index(arguments *a, const char *name) {
+    for (int i = 0; i < list_length(a->names); i++)
+        if (list_get(a->names, i) == name) return i;
+    return -1;
+}
+
+static int next_in_place(arguments *a, int after) {
+    int i = after + 1;
+    while (i < list_length(a->names) && !a->in_place[i])
+        i++;
+    return i;
+}
+
+// walks the body in evaluation order: the arguments evaluated in place must be first read
+// in the order given, before anything of the body that may fail. later reads need a local
+static bool keeps_argument_order(expression *e, arguments *a) {
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            const char *name = e->per_type.terminal_data;
+            int i = parameter_index(a, name);
+            if (i < 0) {
+                // globals may be missing, the object is set
+                if (strcmp(name, "this") != 0)
+                    a->operated = true;
+                return true;
+            }
+            if (!a->in_place[i])
+                return true;
+            if (a->reads[i]++ > 0)
+                return a->has_locals;
+            if (a->operated || i != a->next)
+                return false;
+            a->next = next_in_place(a, i);
+            return true;
+
+        case ET_UNARY_OP:
+            if (!keeps_argument_order(e->per_type.operation.operand1, a))
+                return false;
+            a->operated = true;
+            return true;
+
+        case ET_BINARY_OP:
+            if (!keeps_argument_order(e->per_type.operation.operand1, a))
+                return false;
+            // the second operand of these is not always evaluated
+            if (e->op == OP_LOGICAL_AND || e->op == OP_LOGICAL_OR || e->op == OP_SHORT_IF)
+                a->operated = true;
+            if (e->op != OP_MEMBER && !keeps_argument_order(e->per_type.operation.operand2, a))
+                return false;
+            a->operated = true;
+            return true;
+
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                if (!keeps_argument_order(item, a)) return false;
+            return true;
+
+        case ET_DICT_DATA:
+            // the values are not evaluated in the order written
+            a->operated = true;
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                if (!keeps_argument_order(dict_get(e->per_type.dict_, key), a)) return false;
+            return true;
+    }
+    return true;
+}
+
+// the other names of the body are globals, they must be globals in the caller too
+static bool resolves_to_global(const char *name, function_body *caller) {
+    if (caller->layout == NULL)
+        return true;
+    if (frame_layout_find(caller->layout, name) >= 0)
+        return false;
+    if (caller->captures != NULL) {
+        for_list(caller->captures, it, cstr, captured)
+            if (captured == name) return false;
+    }
+    return true;
+}
+
+static bool free_names_resolve_alike(expression *e, list *arg_names, function_body *caller) {
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            const char *name = e->per_type.terminal_data;
+            for_list(arg_names, it, cstr, arg_name)
+                if (arg_name == name) return true;
+            return strcmp(name, "this") == 0 || resolves_to_global(name, caller);
+
+        case ET_UNARY_OP:
+            return free_names_resolve_alike(e->per_type.operation.operand1, arg_names, caller);
+
+        case ET_BINARY_OP:
+            return free_names_resolve_alike(e->per_type.operation.operand1, arg_names, caller)
+                && (e->op == OP_MEMBER || free_names_resolve_alike(e->per_type.operation.operand2, arg_names, caller));
+
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                if (!free_names_resolve_alike(item, arg_names, caller)) return false;
+            return true;
+
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                if (!free_names_resolve_alike(dict_get(e->per_type.dict_, key), arg_names, caller)) return false;
+            return true;
+    }
+    return true;
+}
+
+// a copy of the node, without the caches of its site
+static expression *copy_node(expression *e) {
+    expression *copy = malloc(sizeof(expression));
+    memcpy(copy, e, sizeof(expression));
+    memset(&copy->cache, 0, sizeof(copy->cache));
+    memset(&copy->feedback, 0, sizeof(copy->feedback));
+    copy->member_cache = NULL;
+    copy->inlined = NULL;
+    return copy;
+}
+
+// a copy of the body, with the arguments in place of the parameters, and the object in place of 'this'.
+// arguments evaluated in place are shared with the call, the first read keeps them in their local
+static expression *substitute(expression *e, arguments *a) {
+    expression *copy = copy_node(e);
+
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            const char *name = e->per_type.terminal_data;
+            int i = parameter_index(a, name);
+            if (i >= 0) {
+                expression *value = list_get(a->values, i);
+                expression *temporary = a->temporaries[i];
+                if (!a->in_place[i])
+                    return copy_node(value);
+                if (temporary == NULL)
+                    return value;
+                if (a->reads[i]++ > 0)
+                    return temporary_identifier(temporary, e->token);
+                return new_binary_expression(OP_ASSIGNMENT, e->token, temporary_identifier(temporary, e->token), value);
+            }
+            if (a->object != NULL && strcmp(name, "this") == 0)
+                return copy_node(a->object);
+            copy->slot = -1;
+            break;
+
+        case ET_UNARY_OP:
+            copy->per_type.operation.operand1 = substitute(e->per_type.operation.operand1, a);
+            break;
+
+        case ET_BINARY_OP:
+            copy->per_type.operation.operand1 = substitute(e->per_type.operation.operand1, a);
+            copy->per_type.operation.operand2 = e->op == OP_MEMBER ? copy_node(e->per_type.operation.operand2)
+                : substitute(e->per_type.operation.operand2, a);
+            break;
+
+        case ET_LIST_DATA:
+            copy->per_type.list_ = new_list(expression_item_info);
+            for_list(e->per_type.list_, lit, expression, item)
+                list_add(copy->per_type.list_, substitute(item, a));
+            break;
+
+        case ET_DICT_DATA:
+            copy->per_type.dict_ = new_dict(expression_item_info);
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                dict_set(copy->per_type.dict_, key, substitute(dict_get(e->per_type.dict_, key), a));
+            break;
+    }
+    return copy;
+}
+
+// the function a call may be bound to: a top level function called by name,
+// or in methods, a method of the same class called on an object
+static statement *inlining_candidate(expression *target, function_body *caller) {
+    if (target->type == ET_IDENTIFIER) {
+        const char *name = target->per_type.terminal_data;
+        if (dict_has(get_built_in_funcs_table(), name))
+            return NULL;
+        return dict_get(declared_functions, name);
+    }
+
+    if (target->type == ET_BINARY_OP && target->op == OP_MEMBER && caller->class_stmt != NULL) {
+        const char *name = target->per_type.operation.operand2->per_type.terminal_data;
+        for_list(caller->class_stmt->per_type.class.methods, it, class_method, method)
+            if (strcmp(method->name, name) == 0) return method->function;
+    }
+    return NULL;
+}
+
+static void inline_call(expression **e, void *data) {
+    inlining *in = data;
+    visit_operands(*e, inline_call, data);
+
+    expression *call = *e;
+    if (call->type != ET_BINARY_OP || call->op != OP_FUNC_CALL || call->inlined != NULL)
+        return;
+    expression *target = call->per_type.operation.operand1;
+    expression *args_expr = call->per_type.operation.operand2;
+    if (args_expr->type != ET_LIST_DATA)
+        return;
+
+    statement *function = inlining_candidate(target, in->function);
+    if (function == NULL)
+        return;
+    expression *object = target->type == ET_IDENTIFIER ? NULL : target->per_type.operation.operand1;
+    expression *body = inlinable_body(function, object != NULL);
+    if (body == NULL)
+        return;
+
+    // missing arguments would resolve by name, extra ones are not used
+    list *arg_names = function->per_type.function.arg_names;
+    list *args = args_expr->per_type.list_;
+    if (list_length(args) != list_length(arg_names))
+        return;
+    if (object != NULL && !is_stable_argument(object, in))
+        return;
+    if (!free_names_resolve_alike(body, arg_names, in->function))
+        return;
+
+    // stable arguments are read where the body uses them. if any is not, the evaluation of it
+    // could change the others, then all but the literals are evaluated in place
+    bool all_stable = true;
+    for_list(args, it, expression, arg)
+        all_stable = all_stable && is_stable_argument(arg, in);
+
+    int count = list_length(args);
+    arguments a = { arg_names, args, object, calloc(count + 1, sizeof(bool)), calloc(count + 1, sizeof(int)),
+        calloc(count + 1, sizeof(expression *)), in->function->layout != NULL, 0, false };
+    bool inlinable = true;
+    for (int i = 0; i < count; i++) {
+        expression *arg = list_get(args, i);
+        if (!all_stable && !is_literal(arg))
+            a.in_place[i] = true;
+        // the caller may have been given fewer arguments, reading a missing one must still fail
+        else if (is_caller_argument(arg, in->function) && !reads_name(body, list_get(arg_names, i)))
+            inlinable = false;
+    }
+    if (inlinable) {
+        a.next = next_in_place(&a, -1);
+        inlinable = keeps_argument_order(body, &a) && a.next == count;
+    }
+
+    if (inlinable) {
+        for (int i = 0; i < count; i++) {
+            if (!a.in_place[i] || a.reads[i] < 2)
+                continue;
+            char name[32];
+            snprintf(name, sizeof(name), "$arg%d", ++temporaries_count);
+            a.temporaries[i] = new_identifier_expression(intern(name), call->token);
+            a.temporaries[i]->slot = frame_layout_add(in->function->layout, a.temporaries[i]->per_type.terminal_data);
+        }
+        memset(a.reads, 0, (count + 1) * sizeof(int));
+
+        call->inlined = malloc(sizeof(inlined_call));
+        call->inlined->function = function;
+        call->inlined->body = substitute(body, &a);
+        in->rewrites++;
+    }
+    free(a.in_place);
+    free(a.reads);
+    free(a.temporaries);
+}
+
+static void inline_in_statements(list *statements, inlining *in);
+
+static dict *copy_names(dict *names, const char *added_name) {
+    dict *copy = new_dict(NULL);
+    for_dict(names, dit, cstr, name)
+        add_name(copy, name);
+    if (added_name != NULL)
+        add_name(copy, added_name);
+    return copy;
+}
+
+static void inline_in_nested(list *statements, inlining *in, const char *assigned_name) {
+    if (statements == NULL)
+        return;
+    dict *outer_assigned = in->assigned;
+    in->assigned = copy_names(outer_assigned, assigned_name);
+    inline_in_statements(statements, in);
+    dict_free(in->assigned);
+    in->assigned = outer_assigned;
+}
+
+static const char *assigned_name(expression *e) {
+    if (e == NULL || !is_modification_of_identifier(e))
+        return NULL;
+    return e->per_type.operation.operand1->per_type.terminal_data;
+}
+
+// statements are visited in order, to know the symbols set before each call
+static void inline_in_statements(list *statements, inlining *in) {
+    for_list(statements, it, statement, s) {
+        const char *name = NULL;
+
+        switch (s->type) {
+            case ST_EXPRESSION:
+                visit_expression(&s->per_type.expr.expr, inline_call, in);
+                name = assigned_name(s->per_type.expr.expr);
+                break;
+            case ST_IF:
+                visit_expression(&s->per_type.if_.condition, inline_call, in);
+                inline_in_nested(s->per_type.if_.body_statements, in, NULL);
+                if (s->per_type.if_.has_else)
+                    inline_in_nested(s->per_type.if_.else_body_statements, in, NULL);
+                break;
+            case ST_WHILE:
+                visit_expression(&s->per_type.while_.condition, inline_call, in);
+                inline_in_nested(s->per_type.while_.body_statements, in, NULL);
+                break;
+            case ST_FOR_LOOP:
+                visit_expression(&s->per_type.for_.init, inline_call, in);
+                name = assigned_name(s->per_type.for_.init);
+                // the condition, the next step and the body run after the init
+                dict *outer_assigned = in->assigned;
+                in->assigned = copy_names(outer_assigned, name);
+                visit_expression(&s->per_type.for_.condition, inline_call, in);
+                visit_expression(&s->per_type.for_.next, inline_call, in);
+                inline_in_statements(s->per_type.for_.body_statements, in);
+                dict_free(in->assigned);
+                in->assigned = outer_assigned;
+                break;
+            case ST_RETURN:
+                visit_expression(&s->per_type.return_.value, inline_call, in);
+                // the body of an inlined function needs no frame
+                if (s->per_type.return_.value != NULL && s->per_type.return_.value->inlined != NULL)
+                    s->per_type.return_.tail_call = false;
+                break;
+            case ST_THROW:
+                visit_expression(&s->per_type.throw.exception, inline_call, in);
+                break;
+            case ST_TRY_CATCH:
+                inline_in_nested(s->per_type.try_catch.try_statements, in, NULL);
+                inline_in_nested(s->per_type.try_catch.catch_statements, in, NULL);
+                inline_in_nested(s->per_type.try_catch.finally_statements, in, NULL);
+                break;
+            // class attribute initializers run in the frame of the constructor's caller
+        }
+
+        if (name != NULL)
+            add_name(in->assigned, name);
+    }
+}
+
+static int inline_functions(function_body *f) {
+    inlining in = { f, new_dict(NULL), 0 };
+    inline_in_statements(f->statements, &in);
+    dict_free(in.assigned);
+    return in.rewrites;
+}
@@ -0,0 +1,38 @@
+#ifndef _AST_OPTIMIZER_H
+#define _AST_OPTIMIZER_H
+
+#include "../../containers/_containers.h"
+#include "../../entities/_entities.h"
+
+/*
+    Runs once after the symbol resolver, before the constant pool.
+    It rewrites the statements in place, by a sequence of passes,
+    each one run from an optimization level up:
+
+    -O1  constant folding: operations on literals become their result,
+         branch pruning: "if", "while" and "for" on constant conditions,
+         and statements after return, break, continue or throw, are removed.
+    -O2  inlining: calls of small functions, a single "return" of an expression
+         with no calls nor assignments, are expanded in place, guarded at run time
+         by the call target still being that function, else called as usual,
+         strength reduction: on int locals, e.g. "x = x + 1" becomes "x += 1",
+         "x * 8" becomes "x << 3", "x + 0" becomes "x",
+         dead stores: assignments to locals never read keep their value only,
+         loop invariants: int operations on locals not changed in a loop
+         are computed once, into a new local, before it.
+
+    The passes keep the values, the evaluation order and the exceptions
+    of the code. They act on what they can prove: literals, and the locals
+    of functions that only ever hold ints (globals can be changed by any call).
+    -O0 leaves the code as written, the default when debugging.
+*/
+
+#define DEFAULT_OPTIMIZATION_LEVEL   1
+
+void optimize_statements(list *statements, dict *given_values, bool verbose);
+
+int ast_optimizer_get_level();
+void ast_optimizer_set_level(int level);
+
+
+#endif
@@ -0,0 +1,685 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "../../utils/str.h"
+#include "../../utils/cstr.h"
+#include "expression_execution.h"
+#include "code_cache.h"
+#include "constant_pool.h"
+#include "bytecode.h"
+
+
+typedef struct loop_labels {
+    int break_chain;    // address of last break jump, each one points to the previous
+    int continue_chain; // same for continue jumps
+    struct loop_labels *outer;
+} loop_labels;
+
+typedef struct compiler {
+    bytecode *code;
+    int depth;
+    bool debugger_hooks;
+    loop_labels *loop;
+} compiler;
+
+#define NO_ADDRESS          (-1)
+
+static code_cache *cache = NULL;
+
+static bytecode *compile_block(list *statements, bool debugger_hooks);
+static void compile_statements(compiler *c, list *statements);
+static void compile_statement(compiler *c, statement *stmt);
+static void compile_loop(compiler *c, expression *condition, list *body, expression *next, statement *counted_for);
+static void compile_jump_out(compiler *c, block_flow flow);
+static void compile_expression(compiler *c, expression *e);
+static void compile_assignment(compiler *c, expression *lvalue, expression *rvalue);
+static void compile_modification(compiler *c, expression *lvalue, enum modify_and_store op, expression *rvalue, bool return_original);
+static void compile_call(compiler *c, expression *call_expr, bool tail_call);
+static void compile_logical(compiler *c, expression *op_expr);
+static void compile_short_if(compiler *c, expression *op_expr);
+static void compile_lvalue_error(compiler *c, expression *lvalue);
+
+
+static const char *opcode_names[] = {
+    "NOP", "PUSH_CONST", "PUSH_COPY", "LOAD_SYMBOL", "STORE_SYMBOL", "POP", "DUP", "DUP2", "SWAP",
+    "ROT3", "BURY", "SET_RESULT", "CLEAR_RESULT", "UNARY_OP", "BINARY_OP", "MODIFY",
+    "GET_ELEMENT", "SET_ELEMENT", "GET_MEMBER", "SET_MEMBER", "CALL", "CALL_MEMBER",
+    "TAIL_CALL", "CALL_BUILT_IN", "INLINED_GUARD", "BUILD_LIST", "BUILD_DICT", "MAKE_CLOSURE", "MAKE_FUNCTION", "MAKE_CLASS",
+    "JUMP", "JUMP_IF_FALSE", "SHORT_CIRCUIT", "CHECK_LOGICAL",
+    "COUNTED_TEST", "COUNTED_STEP", "RETURN", "EXIT_BLOCK", "THROW", "TRY", "RAISE",
+    "DEBUG_STMT", "DEBUG_EXPR",
+};
+
+const char *opcode_name(opcode op) {
+    if (op < 0 || op >= sizeof(opcode_names) / sizeof(opcode_names[0]))
+        return "(unknown)";
+    return opcode_names[op];
+}
+
+bytecode *bytecode_for_statements(list *statements, exec_context *ctx) {
+    if (cache == NULL)
+        cache = new_code_cache();
+
+    bytecode *code = code_cache_get(cache, statements);
+    if (code != NULL && code->debugger_hooks == ctx->debugger.enabled)
+        return code;
+
+    code = compile_block(statements, ctx->debugger.enabled);
+    if (ctx->verbose) {
+        str *s = new_str();
+        bytecode_describe(code, s);
+        printf("------------- bytecode -------------\n%s", str_cstr(s));
+        str_free(s);
+    }
+
+    code_cache_put(cache, statements, code);
+    return code;
+}
+
+static bytecode *new_bytecode(bool debugger_hooks) {
+    bytecode *code = malloc(sizeof(bytecode));
+    code->capacity = 16;
+    code->instructions = malloc(sizeof(instruction) * code->capacity);
+    code->length = 0;
+    code->max_stack = 0;
+    code->debugger_hooks = debugger_hooks;
+    return code;
+}
+
+static int stack_effect(opcode op, int arg) {
+    switch (op) {
+        case OPC_PUSH_CONST:
+        case OPC_PUSH_COPY:
+        case OPC_LOAD_SYMBOL:
+        case OPC_DUP:
+        case OPC_MAKE_CLOSURE:
+            return 1;
+        case OPC_DUP2:
+            return 2;
+        case OPC_POP:
+        case OPC_SET_RESULT:
+        case OPC_BINARY_OP:
+        case OPC_MODIFY:
+        case OPC_GET_ELEMENT:
+        case OPC_SET_MEMBER:
+        case OPC_JUMP_IF_FALSE:
+        case OPC_SHORT_CIRCUIT:
+        case OPC_INLINED_GUARD:
+        case OPC_RETURN:
+        case OPC_THROW:
+            return -1;
+        case OPC_SET_ELEMENT:
+            return -2;
+        case OPC_CALL:
+        case OPC_CALL_MEMBER:
+        case OPC_TAIL_CALL:
+            return -arg;
+        case OPC_CALL_BUILT_IN:
+        case OPC_BUILD_LIST:
+        case OPC_BUILD_DICT:
+            return 1 - arg;
+        default:
+            return 0;
+    }
+}
+
+static int emit(compiler *c, opcode op, int arg, void *ptr) {
+    bytecode *code = c->code;
+    if (code->length == code->capacity) {
+        code->capacity *= 2;
+        code->instructions = realloc(code->instructions, sizeof(instruction) * code->capacity);
+    }
+    code->instructions[code->length] = (instruction){ .op = op, .arg = arg, .ptr = ptr };
+
+    c->depth += stack_effect(op, arg);
+    if (c->depth > code->max_stack)
+        code->max_stack = c->depth;
+
+    return code->length++;
+}
+
+static int here(compiler *c) {
+    return c->code->length;
+}
+
+static void patch_jump(compiler *c, int address, int target) {
+    c->code->instructions[address].arg = target;
+}
+
+static void patch_chain(compiler *c, int address, int target) {
+    while (address != NO_ADDRESS) {
+        int previous = c->code->instructions[address].arg;
+        c->code->instructions[address].arg = target;
+        address = previous;
+    }
+}
+
+static variant *immortal(variant *v) {
+    if (!variant_is_immediate(v))
+        v->_references_count = VARIANT_STATICALLY_ALLOCATED;
+    return v;
+}
+
+static void emit_raise(compiler *c, origin *origin, const char *message) {
+    raise_info *info = malloc(sizeof(raise_info));
+    info->origin = origin;
+    info->message = message;
+    emit(c, OPC_RAISE, 0, info);
+}
+
+static bytecode *compile_block(list *statements, bool debugger_hooks) {
+    compiler c = {
+        .code = new_bytecode(debugger_hooks),
+        .depth = 0,
+        .debugger_hooks = debugger_hooks,
+        .loop = NULL
+    };
+    compile_statements(&c, statements);
+    return c.code;
+}
+
+static void compile_statements(compiler *c, list *statements) {
+    // an empty list of statements yields void
+    emit(c, OPC_CLEAR_RESULT, 0, NULL);
+
+    for_list(statements, it, statement, stmt)
+        compile_statement(c, stmt);
+}
+
+static void compile_statement(compiler *c, statement *stmt) {
+    statement_type s_type = stmt->type;
+
+    // same as the tree walker, expression and function statements stop only at breakpoints
+    if (c->debugger_hooks)
+        emit(c, OPC_DEBUG_STMT, 0, stmt);
+
+    switch (s_type) {
+        case ST_IF:
+            compile_expression(c, stmt->per_type.if_.condition);
+            int jump_to_else = emit(c, OPC_JUMP_IF_FALSE, NO_ADDRESS, stmt->per_type.if_.condition);
+            compile_statements(c, stmt->per_type.if_.body_statements);
+            int jump_to_end = emit(c, OPC_JUMP, NO_ADDRESS, NULL);
+            patch_jump(c, jump_to_else, here(c));
+            if (stmt->per_type.if_.has_else) {
+                compile_statements(c, stmt->per_type.if_.else_body_statements);
+            } else {
+                // a failed if without else yields the condition value
+                emit(c, OPC_PUSH_CONST, 0, false_instance);
+                emit(c, OPC_SET_RESULT, 0, NULL);
+            }
+            patch_jump(c, jump_to_end, here(c));
+            break;
+
+        case ST_WHILE:
+            compile_loop(c, stmt->per_type.while_.condition, stmt->per_type.while_.body_statements, NULL, NULL);
+            break;
+
+        case ST_FOR_LOOP:
+            compile_expression(c, stmt->per_type.for_.init);
+            emit(c, OPC_POP, 0, NULL);
+            compile_loop(c, stmt->per_type.for_.condition, stmt->per_type.for_.body_statements, stmt->per_type.for_.next,
+                stmt->per_type.for_.counted != NULL && !c->debugger_hooks ? stmt : NULL);
+            break;
+
+        case ST_EXPRESSION:
+            compile_expression(c, stmt->per_type.expr.expr);
+            emit(c, OPC_SET_RESULT, 0, NULL);
+            break;
+
+        case ST_BREAK:
+            compile_jump_out(c, BF_BREAK);
+            break;
+
+        case ST_CONTINUE:
+            compile_jump_out(c, BF_CONTINUE);
+            break;
+
+        case ST_RETURN:
+            if (stmt->per_type.return_.tail_call) {
+                if (c->debugger_hooks)
+                    emit(c, OPC_DEBUG_EXPR, 0, stmt->per_type.return_.value);
+                compile_call(c, stmt->per_type.return_.value, true);
+            } else if (stmt->per_type.return_.value != NULL)
+                compile_expression(c, stmt->per_type.return_.value);
+            else
+                emit(c, OPC_PUSH_CONST, 0, void_singleton);
+            emit(c, OPC_RETURN, 0, NULL);
+            break;
+
+        case ST_FUNCTION:
+            emit(c, OPC_MAKE_FUNCTION, 0, stmt);
+            emit(c, OPC_CLEAR_RESULT, 0, NULL);
+            break;
+
+        case ST_TRY_CATCH:
+            try_block *block = malloc(sizeof(try_block));
+            block->try_code = compile_block(stmt->per_type.try_catch.try_statements, c->debugger_hooks);
+            block->catch_code = stmt->per_type.try_catch.catch_statements == NULL ? NULL :
+                compile_block(stmt->per_type.try_catch.catch_statements, c->debugger_hooks);
+            block->finally_code = stmt->per_type.try_catch.finally_statements == NULL ? NULL :
+                compile_block(stmt->per_type.try_catch.finally_statements, c->debugger_hooks);
+            block->exception_identifier = stmt->per_type.try_catch.exception_identifier;
+
+            // the two instructions after TRY handle a break or continue from inside the blocks
+            emit(c, OPC_TRY, 0, block);
+            compile_jump_out(c, BF_BREAK);
+            compile_jump_out(c, BF_CONTINUE);
+            break;
+
+        case ST_THROW:
+            if (stmt->per_type.throw.exception != NULL)
+                compile_expression(c, stmt->per_type.throw.exception);
+            else
+                emit(c, OPC_PUSH_CONST, 0, immortal(new_str_variant("")));
+            emit(c, OPC_THROW, 0, stmt);
+            break;
+
+        case ST_BREAKPOINT:
+            // debugger entry is checked before executing the statement.
+            emit(c, OPC_CLEAR_RESULT, 0, NULL);
+            break;
+
+        case ST_CLASS:
+            emit(c, OPC_MAKE_CLASS, 0, stmt);
+            emit(c, OPC_CLEAR_RESULT, 0, NULL);
+            break;
+
+        default:
+            str *s = new_str();
+            statement_describe(stmt, s);
+            str *message = new_str();
+            str_addf(message, "was expecting [ if, while, for, break, continue, expression, try, return, breakpoint ] but got %s", str_cstr(s));
+            emit_raise(c, stmt->token->origin, str_cstr(message));
+            str_free(s);
+            break;
+    }
+}
+
+// counted loops test and step their counter in place, without pushing values
+static void compile_loop(compiler *c, expression *condition, list *body, expression *next, statement *counted_for) {
+    loop_labels labels = {
+        .break_chain = NO_ADDRESS,
+        .continue_chain = NO_ADDRESS,
+        .outer = c->loop
+    };
+
+    int top = here(c);
+    int jump_to_end;
+    if (counted_for != NULL) {
+        jump_to_end = emit(c, OPC_COUNTED_TEST, NO_ADDRESS, counted_for);
+    } else {
+        compile_expression(c, condition);
+        jump_to_end = emit(c, OPC_JUMP_IF_FALSE, NO_ADDRESS, condition);
+    }
+
+    c->loop = &labels;
+    compile_statements(c, body);
+    c->loop = labels.outer;
+
+    // "continue" in "for" statements allows the "next" operation to run
+    patch_chain(c, labels.continue_chain, here(c));
+    if (counted_for != NULL) {
+        emit(c, OPC_COUNTED_STEP, 0, counted_for);
+    } else if (next != NULL) {
+        compile_expression(c, next);
+        emit(c, OPC_POP, 0, NULL);
+    }
+    emit(c, OPC_JUMP, top, NULL);
+
+    patch_jump(c, jump_to_end, here(c));
+    patch_chain(c, labels.break_chain, here(c));
+
+    // loops yield void
+    emit(c, OPC_CLEAR_RESULT, 0, NULL);
+}
+
+static void compile_jump_out(compiler *c, block_flow flow) {
+    if (c->loop == NULL) {
+        // not in a local loop, the caller of this block will handle it.
+        emit(c, OPC_EXIT_BLOCK, flow, NULL);
+    } else if (flow == BF_BREAK) {
+        c->loop->break_chain = emit(c, OPC_JUMP, c->loop->break_chain, NULL);
+    } else {
+        c->loop->continue_chain = emit(c, OPC_JUMP, c->loop->continue_chain, NULL);
+    }
+}
+
+static void compile_expression(compiler *c, expression *e) {
+    operator_type op = e->op;
+    expression *operand1 = e->per_type.operation.operand1;
+    expression *operand2 = e->per_type.operation.operand2;
+
+    if (c->debugger_hooks)
+        emit(c, OPC_DEBUG_EXPR, 0, e);
+
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            if (bound_built_in(e) != NULL)
+                emit(c, OPC_PUSH_CONST, 0, bound_built_in(e)->value);
+            else
+                emit(c, OPC_LOAD_SYMBOL, 0, e);
+            return;
+        case ET_NUMERIC_LITERAL:
+        case ET_STRING_LITERAL:
+        case ET_BOOLEAN_LITERAL:
+            emit(c, OPC_PUSH_CONST, 0, literal_constant(e));
+            return;
+
+        case ET_LIST_DATA:
+            if (literal_constant(e) != NULL) {
+                emit(c, OPC_PUSH_COPY, 0, e->constant);
+                return;
+            }
+            for_list(e->per_type.list_, list_iter, expression, item)
+                compile_expression(c, item);
+            emit(c, OPC_BUILD_LIST, list_length(e->per_type.list_), NULL);
+            return;
+
+        case ET_DICT_DATA:
+            if (literal_constant(e) != NULL) {
+                emit(c, OPC_PUSH_COPY, 0, e->constant);
+                return;
+            }
+            int count = dict_count(e->per_type.dict_);
+            const char **keys = malloc(sizeof(char *) * (count + 1));
+            int index = 0;
+            iterator *keys_it = dict_keys_iterator(e->per_type.dict_);
+            for_iterator(keys_it, cstr, key) {
+                compile_expression(c, dict_get(e->per_type.dict_, key));
+                keys[index++] = key;
+            }
+            keys[index] = NULL;
+            emit(c, OPC_BUILD_DICT, index, keys);
+            return;
+
+        case ET_UNARY_OP:
+            switch (op) {
+                case OP_PRE_INC:  compile_modification(c, operand1, MAS_ADD, NULL, false); return;
+                case OP_PRE_DEC:  compile_modification(c, operand1, MAS_SUB, NULL, false); return;
+                case OP_POST_INC: compile_modification(c, operand1, MAS_ADD, NULL, true);  return;
+                case OP_POST_DEC: compile_modification(c, operand1, MAS_SUB, NULL, true);  return;
+            }
+            compile_expression(c, operand1);
+            emit(c, OPC_UNARY_OP, 0, e);
+            return;
+
+        case ET_BINARY_OP:
+            switch (op) {
+                case OP_ASSIGNMENT: compile_assignment(c, operand1, operand2); return;
+                case OP_ADD_ASSIGN: compile_modification(c, operand1, MAS_ADD, operand2, false); return;
+                case OP_SUB_ASSIGN: compile_modification(c, operand1, MAS_SUB, operand2, false); return;
+                case OP_MUL_ASSIGN: compile_modification(c, operand1, MAS_MUL, operand2, false); return;
+                case OP_DIV_ASSIGN: compile_modification(c, operand1, MAS_DIV, operand2, false); return;
+                case OP_MOD_ASSIGN: compile_modification(c, operand1, MAS_MOD, operand2, false); return;
+                case OP_RSH_ASSIGN: compile_modification(c, operand1, MAS_RSH, operand2, false); return;
+                case OP_LSH_ASSIGN: compile_modification(c, operand1, MAS_LSH, operand2, false); return;
+                case OP_AND_ASSIGN: compile_modification(c, operand1, MAS_AND, operand2, false); return;
+                case OP_OR_ASSIGN:  compile_modification(c, operand1, MAS_OR,  operand2, false); return;
+                case OP_XOR_ASSIGN: compile_modification(c, operand1, MAS_XOR, operand2, false); return;
+
+                case OP_ARRAY_SUBSCRIPT:
+                    compile_expression(c, operand1);
+                    compile_expression(c, operand2);
+                    emit(c, OPC_GET_ELEMENT, 0, NULL);
+                    return;
+                case OP_MEMBER:
+                    compile_expression(c, operand1);
+                    emit(c, OPC_GET_MEMBER, 0, operand2);
+                    return;
+                case OP_FUNC_CALL:
+                    compile_call(c, e, false);
+                    return;
+                case OP_LOGICAL_AND:
+                case OP_LOGICAL_OR:
+                    compile_logical(c, e);
+                    return;
+                case OP_SHORT_IF:
+                    compile_short_if(c, e);
+                    return;
+            }
+            compile_expression(c, operand1);
+            compile_expression(c, operand2);
+            emit(c, OPC_BINARY_OP, 0, e);
+            return;
+
+        case ET_FUNC_DECL:
+            emit(c, OPC_MAKE_CLOSURE, 0, e);
+            return;
+    }
+
+    emit_raise(c, e->token->origin, "Cannot retrieve value, unknown expression / operator type");
+    emit(c, OPC_PUSH_CONST, 0, void_singleton);
+}
+
+static void compile_assignment(compiler *c, expression *lvalue, expression *rvalue) {
+    // as in the tree walker, the value is evaluated before the target
+    compile_expression(c, rvalue);
+
+    if (lvalue->type == ET_IDENTIFIER) {
+        emit(c, OPC_STORE_SYMBOL, 0, lvalue);
+
+    } else if (lvalue->type == ET_BINARY_OP && lvalue->op == OP_ARRAY_SUBSCRIPT) {
+        compile_expression(c, lvalue->per_type.operation.operand1);
+        compile_expression(c, lvalue->per_type.operation.operand2);
+        emit(c, OPC_ROT3, 0, NULL);
+        emit(c, OPC_SET_ELEMENT, 0, NULL);
+
+    } else if (lvalue->type == ET_BINARY_OP && lvalue->op == OP_MEMBER) {
+        compile_expression(c, lvalue->per_type.operation.operand1);
+        emit(c, OPC_SWAP, 0, NULL);
+        emit(c, OPC_SET_MEMBER, 0, lvalue->per_type.operation.operand2);
+
+    } else {
+        compile_lvalue_error(c, lvalue);
+    }
+}
+
+static void compile_modification(compiler *c, expression *lvalue, enum modify_and_store op, expression *rvalue, bool return_original) {
+    // the operand of inc/dec operations is the constant one
+    #define compile_operand()   (rvalue == NULL ? (void)emit(c, OPC_PUSH_CONST, 0, one_instance) : compile_expression(c, rvalue))
+
+    if (lvalue->type == ET_IDENTIFIER) {
+        emit(c, OPC_LOAD_SYMBOL, 0, lvalue);
+        if (return_original)
+            emit(c, OPC_DUP, 0, NULL);
+        compile_operand();
+        emit(c, OPC_MODIFY, op, rvalue);
+        emit(c, OPC_STORE_SYMBOL, 0, lvalue);
+
+    } else if (lvalue->type == ET_BINARY_OP && lvalue->op == OP_ARRAY_SUBSCRIPT) {
+        compile_expression(c, lvalue->per_type.operation.operand1);
+        compile_expression(c, lvalue->per_type.operation.operand2);
+        emit(c, OPC_DUP2, 0, NULL);
+        emit(c, OPC_GET_ELEMENT, 0, NULL);
+        if (return_original) {
+            emit(c, OPC_DUP, 0, NULL);
+            emit(c, OPC_BURY, 3, NULL);
+        }
+        compile_operand();
+        emit(c, OPC_MODIFY, op, rvalue);
+        emit(c, OPC_SET_ELEMENT, 0, NULL);
+
+    } else if (lvalue->type == ET_BINARY_OP && lvalue->op == OP_MEMBER) {
+        compile_expression(c, lvalue->per_type.operation.operand1);
+        emit(c, OPC_DUP, 0, NULL);
+        emit(c, OPC_GET_MEMBER, 0, lvalue->per_type.operation.operand2);
+        if (return_original) {
+            emit(c, OPC_DUP, 0, NULL);
+            emit(c, OPC_BURY, 2, NULL);
+        }
+        compile_operand();
+        emit(c, OPC_MODIFY, op, rvalue);
+        emit(c, OPC_SET_MEMBER, 0, lvalue->per_type.operation.operand2);
+
+    } else {
+        compile_lvalue_error(c, lvalue);
+        emit(c, OPC_PUSH_CONST, 0, void_singleton);
+        return;
+    }
+
+    // leave the original value as the outcome
+    if (return_original)
+        emit(c, OPC_POP, 0, NULL);
+
+    #undef compile_operand
+}
+
+// the body of a function expanded at the call site runs when the guard passes,
+// otherwise the guard leaves the target (or object) on the stack and jumps to the call
+static int compile_inlined_body(compiler *c, expression *call_expr) {
+    int jump_to_call = emit(c, OPC_INLINED_GUARD, NO_ADDRESS, call_expr);
+    compile_expression(c, call_expr->inlined->body);
+    int jump_to_end = emit(c, OPC_JUMP, NO_ADDRESS, NULL);
+    c->depth--; // only one of the paths pushes the value
+    patch_jump(c, jump_to_call, here(c));
+    c->depth++; // the target stays on the call path
+    return jump_to_end;
+}
+
+static void compile_call(compiler *c, expression *call_expr, bool tail_call) {
+    expression *target = call_expr->per_type.operation.operand1;
+    expression *args = call_expr->per_type.operation.operand2;
+    int jump_to_end = NO_ADDRESS;
+
+    if (args->type != ET_LIST_DATA) {
+        emit_raise(c, call_expr->token->origin, "call requires a list of expressions");
+        emit(c, OPC_PUSH_CONST, 0, void_singleton);
+        return;
+    }
+    int args_count = list_length(args->per_type.list_);
+
+    if (target->op == OP_MEMBER) {
+        // call on the object directly, avoid promoting the method to an instance
+        compile_expression(c, target->per_type.operation.operand1);
+        if (call_expr->inlined != NULL)
+            jump_to_end = compile_inlined_body(c, call_expr);
+        for_list(args->per_type.list_, it, expression, arg)
+            compile_expression(c, arg);
+        emit(c, OPC_CALL_MEMBER, args_count, target);
+
+    } else if (bound_built_in(target) != NULL) {
+        // built-ins bound at parse time are called directly, even in tail position
+        for_list(args->per_type.list_, it, expression, arg)
+            compile_expression(c, arg);
+        emit(c, OPC_CALL_BUILT_IN, args_count, target);
+
+    } else {
+        compile_expression(c, target);
+        if (call_expr->inlined != NULL)
+            jump_to_end = compile_inlined_body(c, call_expr);
+        for_list(args->per_type.list_, it, expression, arg)
+            compile_expression(c, arg);
+        emit(c, tail_call ? OPC_TAIL_CALL : OPC_CALL, args_count, target);
+    }
+
+    if (jump_to_end != NO_ADDRESS)
+        patch_jump(c, jump_to_end, here(c));
+}
+
+static void compile_logical(compiler *c, expression *op_expr) {
+    // a deciding first operand stays on the stack as the result
+    compile_expression(c, op_expr->per_type.operation.operand1);
+    int jump_to_end = emit(c, OPC_SHORT_CIRCUIT, NO_ADDRESS, op_expr);
+    compile_expression(c, op_expr->per_type.operation.operand2);
+    emit(c, OPC_CHECK_LOGICAL, 0, op_expr);
+    patch_jump(c, jump_to_end, here(c));
+}
+
+static void compile_short_if(compiler *c, expression *op_expr) {
+    expression *condition = op_expr->per_type.operation.operand1;
+    list *branches = op_expr->per_type.operation.operand2->per_type.list_;
+
+    compile_expression(c, condition);
+    int jump_to_else = emit(c, OPC_JUMP_IF_FALSE, NO_ADDRESS, condition);
+    compile_expression(c, list_get(branches, 0));
+    int jump_to_end = emit(c, OPC_JUMP, NO_ADDRESS, NULL);
+    c->depth--; // only one of the branches pushes its value
+
+    patch_jump(c, jump_to_else, here(c));
+    compile_expression(c, list_get(branches, 1));
+    patch_jump(c, jump_to_end, here(c));
+}
+
+static void compile_lvalue_error(compiler *c, expression *lvalue) {
+    str *message = new_str();
+    if (lvalue->type == ET_BINARY_OP) {
+        str_addf(message, "operator type cannot be used as lvalue: %s", operator_type_name(lvalue->op));
+    } else {
+        str *s = new_str();
+        expression_describe(lvalue, s);
+        str_addf(message, "expression cannot be used as lvalue: %s", str_cstr(s));
+        str_free(s);
+    }
+    emit_raise(c, lvalue->token->origin, str_cstr(message));
+}
+
+void bytecode_describe(bytecode *code, str *str) {
+    for (int i = 0; i < code->length; i++) {
+        instruction *ins = &code->instructions[i];
+        str_addf(str, "%4d  %-14s", i, opcode_name(ins->op));
+
+        switch (ins->op) {
+            case OPC_PUSH_CONST:
+            case OPC_PUSH_COPY:
+                variant *s = variant_to_string(ins->ptr);
+                str_addf(str, " %s", str_variant_as_str(s));
+                variant_drop_ref(s);
+                break;
+            case OPC_LOAD_SYMBOL:
+            case OPC_STORE_SYMBOL:
+            case OPC_GET_MEMBER:
+            case OPC_SET_MEMBER:
+                str_addf(str, " %s", ((expression *)ins->ptr)->per_type.terminal_data);
+                break;
+            case OPC_UNARY_OP:
+            case OPC_BINARY_OP:
+                str_addc(str, ' ');
+                operator_type_describe(((expression *)ins->ptr)->op, str);
+                break;
+            case OPC_CALL_MEMBER:
+                str_addf(str, " %d, %s", ins->arg, ((expression *)ins->ptr)->per_type.operation.operand2->per_type.terminal_data);
+                break;
+            case OPC_CALL_BUILT_IN:
+                str_addf(str, " %d, %s", ins->arg, ((expression *)ins->ptr)->per_type.terminal_data);
+                break;
+            case OPC_BURY:
+            case OPC_MODIFY:
+            case OPC_CALL:
+            case OPC_TAIL_CALL:
+            case OPC_BUILD_LIST:
+            case OPC_BUILD_DICT:
+            case OPC_JUMP:
+            case OPC_JUMP_IF_FALSE:
+            case OPC_SHORT_CIRCUIT:
+            case OPC_INLINED_GUARD:
+            case OPC_EXIT_BLOCK:
+                str_addf(str, " %d", ins->arg);
+                break;
+            case OPC_RAISE:
+                str_addf(str, " \"%s\"", ((raise_info *)ins->ptr)->message);
+                break;
+            case OPC_COUNTED_TEST:
+                str_addf(str, " %d, %s", ins->arg, ((statement *)ins->ptr)->per_type.for_.counted->counter->per_type.terminal_data);
+                break;
+            case OPC_COUNTED_STEP:
+                str_addf(str, " %s, %d", ((statement *)ins->ptr)->per_type.for_.counted->counter->per_type.terminal_data,
+                    ((statement *)ins->ptr)->per_type.for_.counted->step);
+                break;
+        }
+        str_addc(str, '\n');
+
+        if (ins->op == OPC_TRY) {
+            try_block *block = ins->ptr;
+            str_adds(str, "      try:\n");
+            bytecode_describe(block->try_code, str);
+            if (block->catch_code != NULL) {
+                str_adds(str, "      catch:\n");
+                bytecode_describe(block->catch_code, str);
+            }
+            if (block->finally_code != NULL) {
+                str_adds(str, "      finally:\n");
+                bytecode_describe(block->finally_code, str);
+            }
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef _BYTECODE_H
+#define _BYTECODE_H
+
+#include "../variants/_variants.h"
+#include "../../containers/_containers.h"
+#include "../../entities/_entities.h"
+#include "../../utils/str.h"
+#include "exec_context.h"
+#include "statement_execution.h"
+
+/*
+    Each list of statements (a script body, a function or method body)
+    is compiled into a flat array of instructions, for a simple stack machine.
+    Nested blocks of ifs and loops are compiled inline, with jumps.
+    Only try/catch/finally blocks are compiled into nested bytecode,
+    as they need to intercept exceptions and control flow.
+
+    Instructions keep pointers to the AST nodes they were compiled from,
+    so the VM can reuse the same value operations as the tree walker,
+    and report the same origins in exceptions.
+*/
+
+typedef enum opcode {
+    OPC_NOP,
+    OPC_PUSH_CONST,       // ptr: immortal variant
+    OPC_PUSH_COPY,        // ptr: immortal list or dict template, pushes a new instance sharing its items
+    OPC_LOAD_SYMBOL,      // ptr: identifier expression
+    OPC_STORE_SYMBOL,     // ptr: identifier expression, value stays on stack
+    OPC_POP,
+    OPC_DUP,
+    OPC_DUP2,
+    OPC_SWAP,
+    OPC_ROT3,             // [a b c] -> [b c a]
+    OPC_BURY,             // arg: depth, moves the top item under the next 'depth' items
+    OPC_SET_RESULT,       // pops the value of the statement into the result register
+    OPC_CLEAR_RESULT,     // sets the result register to void
+    OPC_UNARY_OP,         // ptr: operation expression
+    OPC_BINARY_OP,        // ptr: operation expression
+    OPC_MODIFY,           // arg: modify_and_store operation, ptr: rvalue expression
+    OPC_GET_ELEMENT,      // [container element] -> [value]
+    OPC_SET_ELEMENT,      // [container element value] -> [value]
+    OPC_GET_MEMBER,       // ptr: member identifier expression
+    OPC_SET_MEMBER,       // [container value] -> [value], ptr: member identifier expression
+    OPC_CALL,             // arg: args count, ptr: call target expression
+    OPC_CALL_MEMBER,      // arg: args count, ptr: member operation expression
+    OPC_TAIL_CALL,        // arg: args count, ptr: call target expression, followed by RETURN
+    OPC_CALL_BUILT_IN,    // arg: args count, ptr: call target identifier, bound to a built-in
+    OPC_INLINED_GUARD,    // arg: address of the call, ptr: inlined call expression, pops the target or object if the callee is the inlined one
+    OPC_BUILD_LIST,       // arg: items count
+    OPC_BUILD_DICT,       // arg: items count, ptr: array of keys
+    OPC_MAKE_CLOSURE,     // ptr: function declaration expression
+    OPC_MAKE_FUNCTION,    // ptr: function statement
+    OPC_MAKE_CLASS,       // ptr: class statement
+    OPC_JUMP,             // arg: target address
+    OPC_JUMP_IF_FALSE,    // arg: target address, ptr: condition expression
+    OPC_SHORT_CIRCUIT,    // arg: target address, ptr: && or || expression, pops the operand unless it decides
+    OPC_CHECK_LOGICAL,    // ptr: && or || expression, the second operand must be boolean
+    OPC_COUNTED_TEST,     // arg: target address, ptr: for statement of a counted loop, jumps when done
+    OPC_COUNTED_STEP,     // ptr: for statement of a counted loop
+    OPC_RETURN,
+    OPC_EXIT_BLOCK,       // arg: block_flow, break or continue outside of a local loop
+    OPC_THROW,            // ptr: throw statement
+    OPC_TRY,              // ptr: try_block, followed by the break and continue handlers
+    OPC_RAISE,            // ptr: raise_info, for errors detected at compile time
+    OPC_DEBUG_STMT,       // ptr: statement, debugger hook
+    OPC_DEBUG_EXPR,       // ptr: expression, debugger hook
+} opcode;
+
+typedef struct instruction {
+    opcode op;
+    int arg;
+    void *ptr;
+} instruction;
+
+typedef struct bytecode {
+    instruction *instructions;
+    int length;
+    int capacity;
+    int max_stack;
+    bool debugger_hooks;
+} bytecode;
+
+typedef struct try_block {
+    bytecode *try_code;
+    bytecode *catch_code;   // NULL if no catch clause
+    bytecode *finally_code; // NULL if no finally clause
+    const char *exception_identifier;
+} try_block;
+
+typedef struct raise_info {
+    origin *origin;
+    const char *message;
+} raise_info;
+
+
+// returns the cached bytecode of the list, compiling it if needed
+bytecode *bytecode_for_statements(list *statements, exec_context *ctx);
+
+const char *opcode_name(opcode op);
+void bytecode_describe(bytecode *code, str *str);
+
+
+#endif
@@ -37,7 +37,7 @@ typedef struct class_instance {
         (*(ATTRIBUTE_ADDRESS((instance), (attribute_num)))) = (value)
 
 
-static execution_outcome instance_initializer(class_instance *instance, variant *args_list, exec_context *ctx) {
+static execution_outcome instance_initializer(class_instance *instance, int argc, variant **argv, exec_context *ctx) {
     if (instance == NULL)
         return failed_outcome("no instance given");
     
@@ -45,6 +45,7 @@ static execution_outcome instance_initializer(class_instance *instance, variant
     execution_outcome ex;
 
     // first set all variables to eiter result of expression, or to void variant.
+    // collections may run in the expressions, and move the instance to an older generation.
     int index = 0;
     for_list(ci->attributes, it, class_attribute, ca) {
         variant *value = void_singleton;
@@ -55,6 +56,7 @@ static execution_outcome instance_initializer(class_instance *instance, variant
             value = ex.result;
         }
 
+        variant_gc_write_barrier((variant *)instance);
         SET_ATTRIBUTE(instance, index, value);
         index++;
     }
@@ -62,13 +64,19 @@ static execution_outcome instance_initializer(class_instance *instance, variant
     // then, if there is an explicit constructor, use it
     // actually, if constructor was not public, maybe we could forbid instantiation
     if (variant_has_method((variant *)instance, CONSTRUCTOR_METHOD_NAME, VIS_SAME_CLASS_CODE)) {
-        list *al = args_list == NULL ? NULL : list_variant_as_list(args_list);
-        variant_call_method((variant *)instance, CONSTRUCTOR_METHOD_NAME, VIS_SAME_CLASS_CODE, al, internal_origin(), ctx);
+        variant_call_method((variant *)instance, CONSTRUCTOR_METHOD_NAME, VIS_SAME_CLASS_CODE, argc, argv, internal_origin(), ctx);
     }
 
     return ok_outcome(NULL);
 }
 
+static void instance_traverse(class_instance *instance, visit_func visit, void *data) {
+    struct statement_class_info *ci = &((statement *)instance->_type->ast_node)->per_type.class;
+    int count = list_length(ci->attributes);
+    for (int i = 0; i < count; i++)
+        visit(GET_ATTRIBUTE(instance, i), data);
+}
+
 static execution_outcome instance_to_string(class_instance *instance) {
     if (instance == NULL)
         return failed_outcome("no instance given");
@@ -102,7 +110,7 @@ static execution_outcome instance_to_string(class_instance *instance) {
     return ok_outcome(s);
 }
 
-static execution_outcome class_method_call_handler(variant *this, variant_method_definition *method, list *arg_values, origin *call_origin, exec_context *ctx) {
+static execution_outcome class_method_call_handler(variant *this, variant_method_definition *method, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
     // this handler is called when a method of this class is called.
     statement *stmt = (statement *)method->ast_node;
 
@@ -110,8 +118,11 @@ static execution_outcome class_method_call_handler(variant *this, variant_method
         method->name,
         stmt->per_type.function.statements,
         stmt->per_type.function.arg_names,
-        arg_values,
+        stmt->per_type.function.layout,
+        argc,
+        argv,
         this,
+        NULL,
         call_origin,
         ctx);
 }
@@ -162,6 +173,7 @@ variant_type *class_statement_create_variant_type(statement *stmt) {
     struct statement_class_info *ci = &stmt->per_type.class;
 
     variant_type *t = malloc(sizeof(variant_type));
+    memset(t, 0, sizeof(variant_type));
     t->_type = type_of_types;
     t->_references_count = 1;
     
@@ -172,8 +184,10 @@ variant_type *class_statement_create_variant_type(statement *stmt) {
     t->instance_size = INSTANCE_SIZE(list_length(ci->attributes));
     t->attributes = prepare_attrib_definitions(stmt);
     t->methods = prepare_method_definitions(stmt);
+    variant_type_build_members_index(t);
     t->initializer = (initialize_func)instance_initializer;
     t->stringifier = (stringifier_func)instance_to_string;
+    t->traverser = (traverse_func)instance_traverse;
     
     return t;
 }
@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include <string.h>
+#include "code_cache.h"
+
+#define CODE_CACHE_BUCKETS   1024
+
+typedef struct code_cache_entry {
+    void *ast_node;
+    void *compiled;
+    int generation;
+    struct code_cache_entry *next;
+} code_cache_entry;
+
+struct code_cache {
+    code_cache_entry *buckets[CODE_CACHE_BUCKETS];
+};
+
+static int current_generation = 0;
+
+static inline unsigned bucket_of(void *ast_node) {
+    // allocations are aligned, lower bits carry no information
+    return (unsigned)(((unsigned long)ast_node >> 4) % CODE_CACHE_BUCKETS);
+}
+
+code_cache *new_code_cache() {
+    code_cache *cache = malloc(sizeof(code_cache));
+    memset(cache, 0, sizeof(code_cache));
+    return cache;
+}
+
+void *code_cache_get(code_cache *cache, void *ast_node) {
+    code_cache_entry *entry = cache->buckets[bucket_of(ast_node)];
+    while (entry != NULL) {
+        if (entry->ast_node == ast_node)
+            return entry->generation == current_generation ? entry->compiled : NULL;
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+void code_cache_put(code_cache *cache, void *ast_node, void *compiled) {
+    unsigned bucket = bucket_of(ast_node);
+    code_cache_entry *entry = cache->buckets[bucket];
+    while (entry != NULL && entry->ast_node != ast_node)
+        entry = entry->next;
+
+    if (entry == NULL) {
+        entry = malloc(sizeof(code_cache_entry));
+        entry->ast_node = ast_node;
+        entry->next = cache->buckets[bucket];
+        cache->buckets[bucket] = entry;
+    }
+    entry->compiled = compiled;
+    entry->generation = current_generation;
+}
+
+void code_cache_invalidate_all() {
+    current_generation++;
+}
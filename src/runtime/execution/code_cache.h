@@ -0,0 +1,19 @@
+#ifndef _CODE_CACHE_H
+#define _CODE_CACHE_H
+
+#include <stdbool.h>
+
+// maps AST nodes (usually a list of statements) to their compiled form,
+// for the execution engines that compile before running.
+typedef struct code_cache code_cache;
+
+code_cache *new_code_cache();
+void *code_cache_get(code_cache *cache, void *ast_node); // NULL if missing or invalidated
+void code_cache_put(code_cache *cache, void *ast_node, void *compiled);
+
+// invalidates all caches, e.g. after the debugger modified the AST.
+// code may still be running in older frames, so nothing is freed.
+void code_cache_invalidate_all();
+
+
+#endif
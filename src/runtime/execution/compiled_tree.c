@@ -0,0 +1,990 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../../debugger/debugger.h"
+#include "../../utils/data_types/callable.h"
+#include "../../utils/str.h"
+#include "../../utils/cstr.h"
+#include "expression_execution.h"
+#include "statement_execution.h"
+#include "class_execution.h"
+#include "function_execution.h"
+#include "code_cache.h"
+#include "constant_pool.h"
+#include "compiled_tree.h"
+
+
+typedef struct expr_node expr_node;
+typedef struct stmt_node stmt_node;
+typedef struct block_node block_node;
+
+typedef execution_outcome (*expr_node_func)(expr_node *n, exec_context *ctx);
+typedef execution_outcome (*stmt_node_func)(stmt_node *n, exec_context *ctx, block_flow *flow);
+
+struct expr_node {
+    expr_node_func run;
+    expression *expr;         // for origins and member names
+    expr_node *operand1;      // value, container or call target
+    expr_node *operand2;      // second value, or element of a container
+    expr_node *rvalue;        // for assignments and modifications, NULL means 'one'
+    inlined_call *inlined;    // for calls of inlined functions, the function expanded at the call,
+    expr_node *inlined_body;  // and its body, run in place of the call while the callee is that function
+    union {
+        variant *constant;
+        expression *identifier;
+        expression *member;
+        unary_operation_func unary_op;
+        struct {
+            enum modify_and_store op;
+            bool return_original;
+            expression *rvalue_expr;
+        } modify;
+        struct {
+            expr_node **items;
+            int count;
+            const char **keys;
+        } items;
+        struct {
+            origin *origin;
+            const char *message;
+        } raise;
+        expr_node *debugged;
+        expr_node *else_value;   // of shorthand ifs, operand2 is the value when true
+    } per_type;
+};
+
+struct stmt_node {
+    stmt_node_func run;
+    statement *stmt;
+    expr_node *condition;     // or value, for expression, return & throw statements
+    expr_node *init;
+    expr_node *next;
+    block_node *body;         // or try
+    block_node *else_body;    // or catch
+    block_node *finally_body;
+    stmt_node *debugged;
+    const char *message;      // for statements that cannot be executed
+};
+
+struct block_node {
+    stmt_node **statements;
+    int count;
+    bool debugger_hooks;
+};
+
+static code_cache *cache = NULL;
+
+static block_node *compile_block(list *statements, bool debugger_hooks);
+static stmt_node *compile_statement(statement *stmt, bool debugger_hooks);
+static expr_node *compile_expression(expression *e, bool debugger_hooks);
+
+
+execution_outcome compiled_tree_execute_statements(list *statements, exec_context *ctx) {
+    if (cache == NULL)
+        cache = new_code_cache();
+
+    block_node *block = code_cache_get(cache, statements);
+    if (block == NULL || block->debugger_hooks != ctx->debugger.enabled) {
+        block = compile_block(statements, ctx->debugger.enabled);
+        code_cache_put(cache, statements, block);
+    }
+
+    // break or continue outside of a loop merely stop the block, as in the tree walker
+    block_flow flow = BF_NONE;
+    execution_outcome ex;
+    variant *result = void_singleton;
+    for (int i = 0; i < block->count; i++) {
+        ex = block->statements[i]->run(block->statements[i], ctx, &flow);
+        if (ex.excepted || ex.failed) return ex;
+        result = ex.result;
+        if (flow != BF_NONE) break;
+        exec_context_safe_point(ctx, result);
+    }
+    return ok_outcome(result);
+}
+
+// ------------------------------------------------------------------------
+
+static inline execution_outcome run_block(block_node *block, exec_context *ctx, block_flow *flow) {
+    execution_outcome ex;
+    variant *result = void_singleton;
+
+    for (int i = 0; i < block->count; i++) {
+        ex = block->statements[i]->run(block->statements[i], ctx, flow);
+        if (ex.excepted || ex.failed) return ex;
+        result = ex.result;
+        if (*flow != BF_NONE) break;
+        exec_context_safe_point(ctx, result);
+    }
+
+    return ok_outcome(result);
+}
+
+static execution_outcome check_condition(expr_node *condition, exec_context *ctx) {
+    execution_outcome ex = condition->run(condition, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    if (!variant_instance_of(ex.result, bool_type))
+        return exception_outcome(new_exception_variant_at(condition->expr->token->origin, NULL,
+            "condition expressions must yield boolean result"));
+    return ex;
+}
+
+static execution_outcome run_expression_stmt(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    return n->condition->run(n->condition, ctx);
+}
+
+static execution_outcome run_if(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    execution_outcome ex = check_condition(n->condition, ctx);
+    if (ex.excepted || ex.failed) return ex;
+
+    if (bool_variant_as_bool(ex.result))
+        return run_block(n->body, ctx, flow);
+    else if (n->else_body != NULL)
+        return run_block(n->else_body, ctx, flow);
+
+    // a failed if without else yields the condition value
+    return ex;
+}
+
+static execution_outcome run_iterations(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    execution_outcome ex;
+
+    while (true) {
+        ex = check_condition(n->condition, ctx);
+        if (ex.excepted || ex.failed) return ex;
+        if (!bool_variant_as_bool(ex.result))
+            break;
+
+        block_flow body_flow = BF_NONE;
+        ex = run_block(n->body, ctx, &body_flow);
+        if (ex.excepted || ex.failed) return ex;
+
+        // "continue" in "for" statements allows the "next" operation to run
+        if (body_flow == BF_BREAK) break;
+        if (body_flow == BF_RETURN) {
+            *flow = BF_RETURN;
+            return ex;
+        }
+
+        if (n->next != NULL) {
+            ex = n->next->run(n->next, ctx);
+            if (ex.excepted || ex.failed) return ex;
+        }
+    }
+
+    // loops yield void
+    return ok_outcome(void_singleton);
+}
+
+static execution_outcome run_loop(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    if (n->init != NULL) {
+        execution_outcome ex = n->init->run(n->init, ctx);
+        if (ex.excepted || ex.failed) return ex;
+    }
+    return run_iterations(n, ctx, flow);
+}
+
+static execution_outcome run_counted_loop(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    counted_loop *loop = n->stmt->per_type.for_.counted;
+    execution_outcome ex = n->init->run(n->init, ctx);
+    if (ex.excepted || ex.failed) return ex;
+
+    int counter, bound;
+    if (!counted_loop_start(loop, ctx, &counter, &bound))
+        return run_iterations(n, ctx, flow);
+
+    while (counted_loop_continues(loop, counter, bound)) {
+        if (loop->counter_read)
+            counted_loop_store(loop, counter, ctx);
+
+        block_flow body_flow = BF_NONE;
+        ex = run_block(n->body, ctx, &body_flow);
+        if (ex.excepted || ex.failed || body_flow == BF_RETURN) {
+            counted_loop_store(loop, counter, ctx);
+            if (body_flow == BF_RETURN) *flow = BF_RETURN;
+            return ex;
+        }
+        if (body_flow == BF_BREAK) break;
+        counter += loop->step;
+    }
+
+    counted_loop_store(loop, counter, ctx);
+    return ok_outcome(void_singleton);
+}
+
+static execution_outcome run_break(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    *flow = BF_BREAK;
+    return ok_outcome(void_singleton);
+}
+
+static execution_outcome run_continue(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    *flow = BF_CONTINUE;
+    return ok_outcome(void_singleton);
+}
+
+static execution_outcome run_return(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    execution_outcome ex = ok_outcome(void_singleton);
+    if (n->condition != NULL) {
+        ex = n->condition->run(n->condition, ctx);
+        if (ex.excepted || ex.failed) return ex;
+    }
+    *flow = BF_RETURN;
+    return ex;
+}
+
+static execution_outcome run_function_stmt(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    // this is a statement function, hence a named one. Register to symbols
+    exec_context_register_symbol(ctx, n->stmt->per_type.function.name,
+        new_callable_variant(new_callable(
+            n->stmt->per_type.function.name,
+            statement_function_callable_executor,
+            n->stmt, NULL, NULL)));
+    return ok_outcome(void_singleton);
+}
+
+static execution_outcome run_class_stmt(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    variant_type *type = class_statement_create_variant_type(n->stmt);
+    exec_context_register_constructable_type(ctx, type);
+    return ok_outcome(void_singleton);
+}
+
+static execution_outcome run_breakpoint(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    // debugger entry is checked before executing the statement.
+    return ok_outcome(void_singleton);
+}
+
+static execution_outcome run_try(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    const char *exception_identifier = n->stmt->per_type.try_catch.exception_identifier;
+
+    execution_outcome ex = run_block(n->body, ctx, flow);
+    if (ex.failed) return ex;
+
+    // save this for later, we may run a "finally" block
+    execution_outcome try_catch_outcome = ex;
+    if (ex.excepted && n->else_body != NULL) {
+        if (exception_identifier != NULL)
+            exec_context_register_symbol(ctx, exception_identifier, ex.exception_thrown);
+        *flow = BF_NONE;
+        ex = run_block(n->else_body, ctx, flow);
+        if (ex.failed) return ex;
+        if (exception_identifier != NULL)
+            exec_context_unregister_symbol(ctx, exception_identifier);
+
+        // if new exception was raised inside catch, save for post-finally
+        try_catch_outcome = ex;
+    }
+
+    // finally will run in any case, but will not influence the result,
+    // unless it breaks out of the normal flow itself.
+    if (n->finally_body != NULL) {
+        block_flow finally_flow = BF_NONE;
+        ctx->outcomes_held++;
+        ex = run_block(n->finally_body, ctx, &finally_flow);
+        ctx->outcomes_held--;
+        if (ex.excepted || ex.failed) return ex;
+        if (finally_flow != BF_NONE) {
+            *flow = finally_flow;
+            return ex;
+        }
+    }
+
+    return try_catch_outcome;
+}
+
+static execution_outcome run_throw(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    variant *thrown_value = NULL;
+    if (n->condition != NULL) {
+        execution_outcome ex = n->condition->run(n->condition, ctx);
+        if (ex.excepted || ex.failed) return ex;
+        thrown_value = ex.result;
+    }
+    return exception_outcome(new_thrown_exception_variant(n->stmt->token->origin, thrown_value));
+}
+
+static execution_outcome run_unknown_stmt(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    return exception_outcome(new_exception_variant_at(n->stmt->token->origin, NULL, "%s", n->message));
+}
+
+static execution_outcome run_debug_stmt(stmt_node *n, exec_context *ctx, block_flow *flow) {
+    if ((ctx->debugger.instrumented || n->stmt->type == ST_BREAKPOINT) && should_start_debugger(n->stmt, NULL, ctx)) {
+        failable session = run_debugger(n->stmt, NULL, ctx);
+        if (session.failed) return failed_outcome("%s", session.err_msg);
+    }
+    return n->debugged->run(n->debugged, ctx, flow);
+}
+
+// ------------------------------------------------------------------------
+
+static execution_outcome run_constant(expr_node *n, exec_context *ctx) {
+    return ok_outcome(n->per_type.constant);
+}
+
+static execution_outcome run_copy(expr_node *n, exec_context *ctx) {
+    return ok_outcome(instantiate_constant(n->per_type.constant));
+}
+
+static execution_outcome run_load_symbol(expr_node *n, exec_context *ctx) {
+    return resolve_identifier_value(n->expr, ctx);
+}
+
+static execution_outcome run_list(expr_node *n, exec_context *ctx) {
+    list *values_list = new_list(variant_item_info);
+    for (int i = 0; i < n->per_type.items.count; i++) {
+        expr_node *item = n->per_type.items.items[i];
+        execution_outcome ex = item->run(item, ctx);
+        if (ex.excepted || ex.failed) return ex;
+        list_add(values_list, ex.result);
+    }
+    return ok_outcome(new_list_variant_owning(values_list));
+}
+
+static execution_outcome run_dict(expr_node *n, exec_context *ctx) {
+    dict *values_dict = new_dict(variant_item_info);
+    for (int i = 0; i < n->per_type.items.count; i++) {
+        expr_node *item = n->per_type.items.items[i];
+        execution_outcome ex = item->run(item, ctx);
+        if (ex.excepted || ex.failed) return ex;
+        dict_set(values_dict, n->per_type.items.keys[i], ex.result);
+    }
+    return ok_outcome(new_dict_variant_owning(values_dict));
+}
+
+static execution_outcome run_unary(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return n->per_type.unary_op(n->expr, ex.result);
+}
+
+static execution_outcome run_binary(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *v1 = ex.result;
+    ex = n->operand2->run(n->operand2, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return calculate_binary_expression(n->expr, v1, ex.result, ctx);
+}
+
+static execution_outcome run_logical(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    ex = check_logical_operand(n->expr, ex.result);
+    if (ex.excepted || logical_operand_decides(n->expr, ex.result)) return ex;
+
+    ex = n->operand2->run(n->operand2, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return check_logical_operand(n->expr, ex.result);
+}
+
+static execution_outcome run_short_if(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = check_condition(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    expr_node *chosen = bool_variant_as_bool(ex.result) ? n->operand2 : n->per_type.else_value;
+    return chosen->run(chosen, ctx);
+}
+
+static execution_outcome run_get_element(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *container = ex.result;
+    ex = n->operand2->run(n->operand2, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return get_element_value(container, ex.result);
+}
+
+static execution_outcome run_get_member(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return get_member_value(ex.result, n->per_type.member, ctx);
+}
+
+// evaluates the arguments onto the arguments stack, the caller pops them after the call
+static execution_outcome push_args(expr_node *n, exec_context *ctx, variant ***argv) {
+    int count = n->per_type.items.count;
+    variant **values = exec_context_push_arguments(ctx, count);
+    for (int i = 0; i < count; i++) {
+        expr_node *arg = n->per_type.items.items[i];
+        execution_outcome ex = arg->run(arg, ctx);
+        if (ex.excepted || ex.failed) {
+            exec_context_pop_arguments(ctx, count);
+            return ex;
+        }
+        values[i] = ex.result;
+    }
+    *argv = values;
+    return ok_outcome(NULL);
+}
+
+static execution_outcome call_target_value(expr_node *n, variant *call_target, exec_context *ctx) {
+    variant **argv;
+    int argc = n->per_type.items.count;
+    execution_outcome ex = push_args(n, ctx, &argv);
+    if (ex.excepted || ex.failed) return ex;
+
+    ex = variant_call(call_target, argc, argv, NULL, n->expr->token->origin, ctx);
+    exec_context_pop_arguments(ctx, argc);
+    return ex;
+}
+
+static execution_outcome run_call(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return call_target_value(n, ex.result, ctx);
+}
+
+static execution_outcome run_inlined_call(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+
+    if (inlined_call_applies(n->inlined, ex.result, NULL, ctx))
+        return n->inlined_body->run(n->inlined_body, ctx);
+    return call_target_value(n, ex.result, ctx);
+}
+
+static execution_outcome run_tail_call(expr_node *n, exec_context *ctx) {
+    variant **argv;
+    int argc = n->per_type.items.count;
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *call_target = ex.result;
+
+    ex = push_args(n, ctx, &argv);
+    if (ex.excepted || ex.failed) return ex;
+
+    ex = defer_tail_call(call_target, argc, argv, n->expr->token->origin, ctx);
+    exec_context_pop_arguments(ctx, argc);
+    return ex;
+}
+
+static execution_outcome run_call_built_in(expr_node *n, exec_context *ctx) {
+    variant **argv;
+    int argc = n->per_type.items.count;
+    execution_outcome ex = push_args(n, ctx, &argv);
+    if (ex.excepted || ex.failed) return ex;
+
+    ex = call_built_in_func(bound_built_in(n->expr), argc, argv, n->expr->token->origin, ctx);
+    exec_context_pop_arguments(ctx, argc);
+    return ex;
+}
+
+static execution_outcome call_member_of(expr_node *n, variant *container, exec_context *ctx) {
+    variant **argv;
+    int argc = n->per_type.items.count;
+    execution_outcome ex = push_args(n, ctx, &argv);
+    if (ex.excepted || ex.failed) return ex;
+
+    ex = call_member_value(container, n->expr->per_type.operation.operand2, argc, argv, n->expr->token->origin, ctx);
+    exec_context_pop_arguments(ctx, argc);
+    return ex;
+}
+
+static execution_outcome run_call_member(expr_node *n, exec_context *ctx) {
+    // n->expr is the member expression, operand1 its container
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return call_member_of(n, ex.result, ctx);
+}
+
+static execution_outcome run_inlined_call_member(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+
+    if (inlined_call_applies(n->inlined, ex.result, n->expr->per_type.operation.operand2, ctx))
+        return n->inlined_body->run(n->inlined_body, ctx);
+    return call_member_of(n, ex.result, ctx);
+}
+
+static execution_outcome run_assign_symbol(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->rvalue->run(n->rvalue, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    execution_outcome storage = store_identifier_value(n->per_type.identifier, ex.result, ctx);
+    if (storage.excepted || storage.failed) return storage;
+    return ex; // assignment returns the assigned value
+}
+
+static execution_outcome run_assign_element(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->rvalue->run(n->rvalue, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *value = ex.result;
+    ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *container = ex.result;
+    ex = n->operand2->run(n->operand2, ctx);
+    if (ex.excepted || ex.failed) return ex;
+
+    ex = variant_set_element(container, ex.result, value);
+    if (ex.excepted || ex.failed) return ex;
+    return ok_outcome(value);
+}
+
+static execution_outcome run_assign_member(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->rvalue->run(n->rvalue, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *value = ex.result;
+    ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+
+    ex = set_member_value(ex.result, n->per_type.member, value, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return ok_outcome(value);
+}
+
+static execution_outcome calculate_modified(expr_node *n, variant *original, exec_context *ctx) {
+    variant *operand = one_instance;
+    if (n->rvalue != NULL) {
+        execution_outcome ex = n->rvalue->run(n->rvalue, ctx);
+        if (ex.excepted || ex.failed) return ex;
+        operand = ex.result;
+    }
+    return calculate_modification(n->per_type.modify.op, original, operand, n->per_type.modify.rvalue_expr);
+}
+
+static execution_outcome run_modify_symbol(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *original = ex.result;
+
+    ex = calculate_modified(n, original, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *result = ex.result;
+
+    ex = store_identifier_value(n->operand1->expr, result, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return ok_outcome(n->per_type.modify.return_original ? original : result);
+}
+
+static execution_outcome run_modify_element(expr_node *n, exec_context *ctx) {
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *container = ex.result;
+    ex = n->operand2->run(n->operand2, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *element = ex.result;
+
+    ex = get_element_value(container, element);
+    if (ex.excepted || ex.failed) return ex;
+    variant *original = ex.result;
+
+    ex = calculate_modified(n, original, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *result = ex.result;
+
+    ex = variant_set_element(container, element, result);
+    if (ex.excepted || ex.failed) return ex;
+    return ok_outcome(n->per_type.modify.return_original ? original : result);
+}
+
+static execution_outcome run_modify_member(expr_node *n, exec_context *ctx) {
+    expression *member = n->expr->per_type.operation.operand2;
+    execution_outcome ex = n->operand1->run(n->operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *container = ex.result;
+
+    ex = get_member_value(container, member, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *original = ex.result;
+
+    ex = calculate_modified(n, original, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *result = ex.result;
+
+    ex = set_member_value(container, member, result, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return ok_outcome(n->per_type.modify.return_original ? original : result);
+}
+
+static execution_outcome run_closure(expr_node *n, exec_context *ctx) {
+    return ok_outcome(create_closure_variant(n->expr, ctx));
+}
+
+static execution_outcome run_raise(expr_node *n, exec_context *ctx) {
+    // evaluate what the tree walker would have evaluated before failing
+    if (n->rvalue != NULL) {
+        execution_outcome ex = n->rvalue->run(n->rvalue, ctx);
+        if (ex.excepted || ex.failed) return ex;
+    }
+    return exception_outcome(new_exception_variant_at(n->per_type.raise.origin, NULL, "%s", n->per_type.raise.message));
+}
+
+static execution_outcome run_debug_expr(expr_node *n, exec_context *ctx) {
+    if (ctx->debugger.instrumented && should_start_debugger(NULL, n->expr, ctx)) {
+        failable session = run_debugger(NULL, n->expr, ctx);
+        if (session.failed) return failed_outcome("%s", session.err_msg);
+    }
+    return n->per_type.debugged->run(n->per_type.debugged, ctx);
+}
+
+// ------------------------------------------------------------------------
+
+static stmt_node *new_stmt_node(stmt_node_func run, statement *stmt) {
+    stmt_node *n = malloc(sizeof(stmt_node));
+    memset(n, 0, sizeof(stmt_node));
+    n->run = run;
+    n->stmt = stmt;
+    return n;
+}
+
+static expr_node *new_expr_node(expr_node_func run, expression *expr) {
+    expr_node *n = malloc(sizeof(expr_node));
+    memset(n, 0, sizeof(expr_node));
+    n->run = run;
+    n->expr = expr;
+    return n;
+}
+
+static block_node *compile_block(list *statements, bool debugger_hooks) {
+    block_node *block = malloc(sizeof(block_node));
+    block->count = list_length(statements);
+    block->statements = malloc(sizeof(stmt_node *) * (block->count + 1));
+    block->debugger_hooks = debugger_hooks;
+
+    int i = 0;
+    for_list(statements, it, statement, stmt)
+        block->statements[i++] = compile_statement(stmt, debugger_hooks);
+
+    return block;
+}
+
+static stmt_node *compile_statement(statement *stmt, bool debugger_hooks) {
+    stmt_node *n;
+
+    switch (stmt->type) {
+        case ST_IF:
+            n = new_stmt_node(run_if, stmt);
+            n->condition = compile_expression(stmt->per_type.if_.condition, debugger_hooks);
+            n->body = compile_block(stmt->per_type.if_.body_statements, debugger_hooks);
+            if (stmt->per_type.if_.has_else)
+                n->else_body = compile_block(stmt->per_type.if_.else_body_statements, debugger_hooks);
+            break;
+
+        case ST_WHILE:
+            n = new_stmt_node(run_loop, stmt);
+            n->condition = compile_expression(stmt->per_type.while_.condition, debugger_hooks);
+            n->body = compile_block(stmt->per_type.while_.body_statements, debugger_hooks);
+            break;
+
+        case ST_FOR_LOOP:
+            n = new_stmt_node(stmt->per_type.for_.counted != NULL && !debugger_hooks ? run_counted_loop : run_loop, stmt);
+            n->init = compile_expression(stmt->per_type.for_.init, debugger_hooks);
+            n->condition = compile_expression(stmt->per_type.for_.condition, debugger_hooks);
+            n->next = compile_expression(stmt->per_type.for_.next, debugger_hooks);
+            n->body = compile_block(stmt->per_type.for_.body_statements, debugger_hooks);
+            break;
+
+        case ST_EXPRESSION:
+            n = new_stmt_node(run_expression_stmt, stmt);
+            n->condition = compile_expression(stmt->per_type.expr.expr, debugger_hooks);
+            break;
+
+        case ST_BREAK:
+            n = new_stmt_node(run_break, stmt);
+            break;
+
+        case ST_CONTINUE:
+            n = new_stmt_node(run_continue, stmt);
+            break;
+
+        case ST_RETURN:
+            n = new_stmt_node(run_return, stmt);
+            if (stmt->per_type.return_.value != NULL)
+                n->condition = compile_expression(stmt->per_type.return_.value, debugger_hooks);
+            if (stmt->per_type.return_.tail_call) {
+                // the resolver marks plain calls only, the call node lies under any debugger hook
+                expr_node *call = debugger_hooks ? n->condition->per_type.debugged : n->condition;
+                if (call->run == run_call)
+                    call->run = run_tail_call;
+            }
+            break;
+
+        case ST_FUNCTION:
+            n = new_stmt_node(run_function_stmt, stmt);
+            break;
+
+        case ST_TRY_CATCH:
+            n = new_stmt_node(run_try, stmt);
+            n->body = compile_block(stmt->per_type.try_catch.try_statements, debugger_hooks);
+            if (stmt->per_type.try_catch.catch_statements != NULL)
+                n->else_body = compile_block(stmt->per_type.try_catch.catch_statements, debugger_hooks);
+            if (stmt->per_type.try_catch.finally_statements != NULL)
+                n->finally_body = compile_block(stmt->per_type.try_catch.finally_statements, debugger_hooks);
+            break;
+
+        case ST_THROW:
+            n = new_stmt_node(run_throw, stmt);
+            if (stmt->per_type.throw.exception != NULL)
+                n->condition = compile_expression(stmt->per_type.throw.exception, debugger_hooks);
+            break;
+
+        case ST_BREAKPOINT:
+            n = new_stmt_node(run_breakpoint, stmt);
+            break;
+
+        case ST_CLASS:
+            n = new_stmt_node(run_class_stmt, stmt);
+            break;
+
+        default:
+            n = new_stmt_node(run_unknown_stmt, stmt);
+            str *s = new_str();
+            statement_describe(stmt, s);
+            str *message = new_str();
+            str_addf(message, "was expecting [ if, while, for, break, continue, expression, try, return, breakpoint ] but got %s", str_cstr(s));
+            n->message = str_cstr(message);
+            str_free(s);
+            break;
+    }
+
+    // same as the tree walker, expression and function statements stop only at breakpoints
+    if (debugger_hooks) {
+        stmt_node *hook = new_stmt_node(run_debug_stmt, stmt);
+        hook->debugged = n;
+        n = hook;
+    }
+
+    return n;
+}
+
+static void compile_items(expr_node *n, list *expressions, bool debugger_hooks) {
+    n->per_type.items.count = list_length(expressions);
+    n->per_type.items.items = malloc(sizeof(expr_node *) * (n->per_type.items.count + 1));
+    int i = 0;
+    for_list(expressions, it, expression, item)
+        n->per_type.items.items[i++] = compile_expression(item, debugger_hooks);
+}
+
+static expr_node *compile_raise(expression *e, origin *origin, const char *message) {
+    expr_node *n = new_expr_node(run_raise, e);
+    n->per_type.raise.origin = origin;
+    n->per_type.raise.message = message;
+    return n;
+}
+
+static expr_node *compile_lvalue_error(expression *lvalue) {
+    str *message = new_str();
+    if (lvalue->type == ET_BINARY_OP) {
+        str_addf(message, "operator type cannot be used as lvalue: %s", operator_type_name(lvalue->op));
+    } else {
+        str *s = new_str();
+        expression_describe(lvalue, s);
+        str_addf(message, "expression cannot be used as lvalue: %s", str_cstr(s));
+        str_free(s);
+    }
+    return compile_raise(lvalue, lvalue->token->origin, str_cstr(message));
+}
+
+static expr_node *compile_assignment(expression *e, expression *lvalue, expression *rvalue, bool debugger_hooks) {
+    expr_node *n;
+
+    if (lvalue->type == ET_IDENTIFIER) {
+        n = new_expr_node(run_assign_symbol, e);
+        n->per_type.identifier = lvalue;
+
+    } else if (lvalue->type == ET_BINARY_OP && lvalue->op == OP_ARRAY_SUBSCRIPT) {
+        n = new_expr_node(run_assign_element, e);
+        n->operand1 = compile_expression(lvalue->per_type.operation.operand1, debugger_hooks);
+        n->operand2 = compile_expression(lvalue->per_type.operation.operand2, debugger_hooks);
+
+    } else if (lvalue->type == ET_BINARY_OP && lvalue->op == OP_MEMBER) {
+        n = new_expr_node(run_assign_member, e);
+        n->operand1 = compile_expression(lvalue->per_type.operation.operand1, debugger_hooks);
+        n->per_type.member = lvalue->per_type.operation.operand2;
+
+    } else {
+        n = compile_lvalue_error(lvalue);
+    }
+
+    n->rvalue = compile_expression(rvalue, debugger_hooks);
+    return n;
+}
+
+static expr_node *compile_modification(expression *lvalue, enum modify_and_store op, expression *rvalue, bool return_original, bool debugger_hooks) {
+    expr_node *n;
+
+    if (lvalue->type == ET_IDENTIFIER) {
+        n = new_expr_node(run_modify_symbol, lvalue);
+        n->operand1 = compile_expression(lvalue, debugger_hooks);
+        n->operand1->expr = lvalue;
+
+    } else if (lvalue->type == ET_BINARY_OP && lvalue->op == OP_ARRAY_SUBSCRIPT) {
+        n = new_expr_node(run_modify_element, lvalue);
+        n->operand1 = compile_expression(lvalue->per_type.operation.operand1, debugger_hooks);
+        n->operand2 = compile_expression(lvalue->per_type.operation.operand2, debugger_hooks);
+
+    } else if (lvalue->type == ET_BINARY_OP && lvalue->op == OP_MEMBER) {
+        n = new_expr_node(run_modify_member, lvalue);
+        n->operand1 = compile_expression(lvalue->per_type.operation.operand1, debugger_hooks);
+
+    } else {
+        return compile_lvalue_error(lvalue);
+    }
+
+    n->per_type.modify.op = op;
+    n->per_type.modify.return_original = return_original;
+    n->per_type.modify.rvalue_expr = rvalue;
+    n->rvalue = rvalue == NULL ? NULL : compile_expression(rvalue, debugger_hooks);
+    return n;
+}
+
+static expr_node *compile_call(expression *e, bool debugger_hooks) {
+    expression *target = e->per_type.operation.operand1;
+    expression *args = e->per_type.operation.operand2;
+    expr_node *n;
+
+    if (args->type != ET_LIST_DATA)
+        return compile_raise(e, e->token->origin, "call requires a list of expressions");
+
+    if (target->op == OP_MEMBER) {
+        // call on the object directly, avoid promoting the method to an instance
+        n = new_expr_node(e->inlined != NULL ? run_inlined_call_member : run_call_member, target);
+        n->operand1 = compile_expression(target->per_type.operation.operand1, debugger_hooks);
+    } else if (bound_built_in(target) != NULL) {
+        // built-ins bound at parse time are called directly, even in tail position
+        n = new_expr_node(run_call_built_in, target);
+    } else {
+        n = new_expr_node(e->inlined != NULL ? run_inlined_call : run_call, target);
+        n->operand1 = compile_expression(target, debugger_hooks);
+    }
+    compile_items(n, args->per_type.list_, debugger_hooks);
+    if (e->inlined != NULL && n->run != run_call_built_in) {
+        n->inlined = e->inlined;
+        n->inlined_body = compile_expression(e->inlined->body, debugger_hooks);
+    }
+    return n;
+}
+
+static expr_node *compile_operation(expression *e, bool debugger_hooks) {
+    expression *operand1 = e->per_type.operation.operand1;
+    expression *operand2 = e->per_type.operation.operand2;
+    expr_node *n;
+
+    if (e->type == ET_UNARY_OP) {
+        switch (e->op) {
+            case OP_PRE_INC:  return compile_modification(operand1, MAS_ADD, NULL, false, debugger_hooks);
+            case OP_PRE_DEC:  return compile_modification(operand1, MAS_SUB, NULL, false, debugger_hooks);
+            case OP_POST_INC: return compile_modification(operand1, MAS_ADD, NULL, true, debugger_hooks);
+            case OP_POST_DEC: return compile_modification(operand1, MAS_SUB, NULL, true, debugger_hooks);
+        }
+        n = new_expr_node(run_unary, e);
+        n->operand1 = compile_expression(operand1, debugger_hooks);
+        n->per_type.unary_op = unary_operation_for(e->op);
+        return n;
+    }
+
+    switch (e->op) {
+        case OP_ASSIGNMENT: return compile_assignment(e, operand1, operand2, debugger_hooks);
+        case OP_ADD_ASSIGN: return compile_modification(operand1, MAS_ADD, operand2, false, debugger_hooks);
+        case OP_SUB_ASSIGN: return compile_modification(operand1, MAS_SUB, operand2, false, debugger_hooks);
+        case OP_MUL_ASSIGN: return compile_modification(operand1, MAS_MUL, operand2, false, debugger_hooks);
+        case OP_DIV_ASSIGN: return compile_modification(operand1, MAS_DIV, operand2, false, debugger_hooks);
+        case OP_MOD_ASSIGN: return compile_modification(operand1, MAS_MOD, operand2, false, debugger_hooks);
+        case OP_RSH_ASSIGN: return compile_modification(operand1, MAS_RSH, operand2, false, debugger_hooks);
+        case OP_LSH_ASSIGN: return compile_modification(operand1, MAS_LSH, operand2, false, debugger_hooks);
+        case OP_AND_ASSIGN: return compile_modification(operand1, MAS_AND, operand2, false, debugger_hooks);
+        case OP_OR_ASSIGN:  return compile_modification(operand1, MAS_OR,  operand2, false, debugger_hooks);
+        case OP_XOR_ASSIGN: return compile_modification(operand1, MAS_XOR, operand2, false, debugger_hooks);
+
+        case OP_ARRAY_SUBSCRIPT:
+            n = new_expr_node(run_get_element, e);
+            n->operand1 = compile_expression(operand1, debugger_hooks);
+            n->operand2 = compile_expression(operand2, debugger_hooks);
+            return n;
+
+        case OP_MEMBER:
+            n = new_expr_node(run_get_member, e);
+            n->operand1 = compile_expression(operand1, debugger_hooks);
+            n->per_type.member = operand2;
+            return n;
+
+        case OP_FUNC_CALL:
+            return compile_call(e, debugger_hooks);
+
+        case OP_LOGICAL_AND:
+        case OP_LOGICAL_OR:
+            n = new_expr_node(run_logical, e);
+            n->operand1 = compile_expression(operand1, debugger_hooks);
+            n->operand2 = compile_expression(operand2, debugger_hooks);
+            return n;
+
+        case OP_SHORT_IF:
+            n = new_expr_node(run_short_if, e);
+            n->operand1 = compile_expression(operand1, debugger_hooks);
+            n->operand2 = compile_expression(list_get(operand2->per_type.list_, 0), debugger_hooks);
+            n->per_type.else_value = compile_expression(list_get(operand2->per_type.list_, 1), debugger_hooks);
+            return n;
+    }
+
+    n = new_expr_node(run_binary, e);
+    n->operand1 = compile_expression(operand1, debugger_hooks);
+    n->operand2 = compile_expression(operand2, debugger_hooks);
+    return n;
+}
+
+static expr_node *compile_expression(expression *e, bool debugger_hooks) {
+    expr_node *n;
+
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            if (bound_built_in(e) != NULL) {
+                n = new_expr_node(run_constant, e);
+                n->per_type.constant = bound_built_in(e)->value;
+                break;
+            }
+            n = new_expr_node(run_load_symbol, e);
+            break;
+
+        case ET_NUMERIC_LITERAL:
+        case ET_STRING_LITERAL:
+        case ET_BOOLEAN_LITERAL:
+            n = new_expr_node(run_constant, e);
+            n->per_type.constant = literal_constant(e);
+            break;
+
+        case ET_LIST_DATA:
+            if (literal_constant(e) != NULL) {
+                n = new_expr_node(run_copy, e);
+                n->per_type.constant = e->constant;
+                break;
+            }
+            n = new_expr_node(run_list, e);
+            compile_items(n, e->per_type.list_, debugger_hooks);
+            break;
+
+        case ET_DICT_DATA:
+            if (literal_constant(e) != NULL) {
+                n = new_expr_node(run_copy, e);
+                n->per_type.constant = e->constant;
+                break;
+            }
+            n = new_expr_node(run_dict, e);
+            int count = dict_count(e->per_type.dict_);
+            n->per_type.items.items = malloc(sizeof(expr_node *) * (count + 1));
+            n->per_type.items.keys = malloc(sizeof(char *) * (count + 1));
+            n->per_type.items.count = 0;
+            iterator *keys_it = dict_keys_iterator(e->per_type.dict_);
+            for_iterator(keys_it, cstr, key) {
+                n->per_type.items.keys[n->per_type.items.count] = key;
+                n->per_type.items.items[n->per_type.items.count] = compile_expression(dict_get(e->per_type.dict_, key), debugger_hooks);
+                n->per_type.items.count++;
+            }
+            break;
+
+        case ET_UNARY_OP:
+        case ET_BINARY_OP:
+            n = compile_operation(e, debugger_hooks);
+            break;
+
+        case ET_FUNC_DECL:
+            n = new_expr_node(run_closure, e);
+            break;
+
+        default:
+            n = compile_raise(e, e->token->origin, "Cannot retrieve value, unknown expression / operator type");
+            break;
+    }
+
+    if (debugger_hooks) {
+        expr_node *hook = new_expr_node(run_debug_expr, e);
+        hook->per_type.debugged = n;
+        n = hook;
+    }
+
+    return n;
+}
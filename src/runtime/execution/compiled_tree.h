@@ -0,0 +1,20 @@
+#ifndef _COMPILED_TREE_H
+#define _COMPILED_TREE_H
+
+#include "../variants/_variants.h"
+#include "../../containers/_containers.h"
+#include "../../entities/_entities.h"
+
+/*
+    Each list of statements is lowered once into a tree of executor nodes.
+    Every node holds a direct pointer to the C function that executes it,
+    and its operands already decoded (constants created, operator functions
+    resolved, lvalue kinds decided), so executing a node is a single
+    indirect call, without any switch on expression or operator types.
+*/
+
+// compiles (or reuses the compiled) tree of the statements and runs it
+execution_outcome compiled_tree_execute_statements(list *statements, exec_context *ctx);
+
+
+#endif
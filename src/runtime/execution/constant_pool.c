@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../../utils/cstr.h"
+#include "../../parser/symbol_resolver.h"
+#include "constant_pool.h"
+
+static void pool_statements(list *statements);
+static void pool_expression(expression *e);
+static void pool_function(list *statements, list *captures);
+
+// equal string literals of the script share one value
+static dict *strings = NULL;
+
+// the built-ins whose names the script does not assign, name -> built_in_func
+static dict *bindable_built_ins = NULL;
+
+// of the closure being pooled, the names shared with its enclosing functions
+static list *curr_captures = NULL;
+
+
+void build_constant_pool(list *statements, dict *given_values) {
+    bindable_built_ins = new_dict(NULL);
+    dict *built_ins = get_built_in_funcs_table();
+    for_dict(built_ins, it, cstr, name) {
+        if (given_values != NULL && dict_has(given_values, name))
+            continue;
+        if (!symbol_is_assigned(statements, name))
+            dict_set(bindable_built_ins, name, dict_get(built_ins, name));
+    }
+
+    curr_captures = NULL;
+    pool_statements(statements);
+}
+
+static variant *immortal(variant *v) {
+    if (!variant_is_immediate(v))
+        v->_references_count = VARIANT_STATICALLY_ALLOCATED;
+    return v;
+}
+
+static bool is_scalar_literal(expression *e) {
+    return e->type == ET_NUMERIC_LITERAL ||
+           e->type == ET_STRING_LITERAL ||
+           e->type == ET_BOOLEAN_LITERAL;
+}
+
+static variant *string_constant(const char *data) {
+    if (strings == NULL)
+        strings = new_dict(variant_item_info);
+
+    variant *v = dict_get(strings, data);
+    if (v == NULL) {
+        v = immortal(new_str_variant("%s", data));
+        dict_set(strings, data, v);
+    }
+    return v;
+}
+
+static variant *create_constant(expression *e) {
+    const char *data = e->per_type.terminal_data;
+
+    switch (e->type) {
+        case ET_NUMERIC_LITERAL:
+            return immortal(new_int_variant(atoi(data)));
+        case ET_STRING_LITERAL:
+            return string_constant(data);
+        case ET_BOOLEAN_LITERAL:
+            return strcmp(data, "true") == 0 ? true_instance : false_instance;
+
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                if (!is_scalar_literal(item)) return NULL;
+            list *items = new_list(variant_item_info);
+            for_list(e->per_type.list_, vit, expression, item)
+                list_add(items, literal_constant(item));
+            return immortal(new_list_variant_owning(items));
+
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, kit, cstr, key)
+                if (!is_scalar_literal(dict_get(e->per_type.dict_, key))) return NULL;
+            dict *entries = new_dict(variant_item_info);
+            for_dict(e->per_type.dict_, eit, cstr, key)
+                dict_set(entries, key, literal_constant(dict_get(e->per_type.dict_, key)));
+            return immortal(new_dict_variant_owning(entries));
+    }
+    return NULL;
+}
+
+variant *literal_constant(expression *e) {
+    if (e->constant == NULL)
+        e->constant = create_constant(e);
+    return e->constant;
+}
+
+built_in_func *bound_built_in(expression *e) {
+    return e->type == ET_IDENTIFIER ? e->constant : NULL;
+}
+
+static void bind_identifier(expression *e) {
+    // locals, and arguments of enclosing functions, may have any name
+    const char *name = e->per_type.terminal_data;
+    if (e->slot >= 0)
+        return;
+    if (curr_captures != NULL) {
+        for_list(curr_captures, it, cstr, captured)
+            if (captured == name) return;
+    }
+    e->constant = dict_get(bindable_built_ins, name);
+}
+
+variant *instantiate_constant(variant *constant) {
+    if (variant_instance_of(constant, list_type))
+        return new_list_variant_sharing(constant);
+    if (variant_instance_of(constant, dict_type))
+        return new_dict_variant_sharing(constant);
+    return constant;
+}
+
+// ------------------------------------------------------------------------
+
+static void pool_statements(list *statements) {
+    if (statements == NULL)
+        return;
+
+    for_list(statements, it, statement, s) {
+        switch (s->type) {
+            case ST_EXPRESSION:
+                pool_expression(s->per_type.expr.expr);
+                break;
+            case ST_IF:
+                pool_expression(s->per_type.if_.condition);
+                pool_statements(s->per_type.if_.body_statements);
+                if (s->per_type.if_.has_else)
+                    pool_statements(s->per_type.if_.else_body_statements);
+                break;
+            case ST_WHILE:
+                pool_expression(s->per_type.while_.condition);
+                pool_statements(s->per_type.while_.body_statements);
+                break;
+            case ST_FOR_LOOP:
+                pool_expression(s->per_type.for_.init);
+                pool_expression(s->per_type.for_.condition);
+                pool_expression(s->per_type.for_.next);
+                pool_statements(s->per_type.for_.body_statements);
+                break;
+            case ST_RETURN:
+                pool_expression(s->per_type.return_.value);
+                break;
+            case ST_FUNCTION:
+                pool_function(s->per_type.function.statements, NULL);
+                break;
+            case ST_TRY_CATCH:
+                pool_statements(s->per_type.try_catch.try_statements);
+                pool_statements(s->per_type.try_catch.catch_statements);
+                pool_statements(s->per_type.try_catch.finally_statements);
+                break;
+            case ST_THROW:
+                pool_expression(s->per_type.throw.exception);
+                break;
+            case ST_CLASS:
+                for_list(s->per_type.class.attributes, ait, class_attribute, attr)
+                    pool_expression(attr->init_value);
+                for_list(s->per_type.class.methods, mit, class_method, method)
+                    pool_function(method->function->per_type.function.statements, NULL);
+                break;
+        }
+    }
+}
+
+static void pool_expression(expression *e) {
+    if (e == NULL)
+        return;
+
+    switch (e->type) {
+        case ET_IDENTIFIER:
+            bind_identifier(e);
+            break;
+
+        case ET_NUMERIC_LITERAL:
+        case ET_STRING_LITERAL:
+        case ET_BOOLEAN_LITERAL:
+            literal_constant(e);
+            break;
+
+        case ET_UNARY_OP:
+            pool_expression(e->per_type.operation.operand1);
+            break;
+
+        case ET_BINARY_OP:
+            pool_expression(e->per_type.operation.operand1);
+            // member names are not symbols
+            if (e->op != OP_MEMBER)
+                pool_expression(e->per_type.operation.operand2);
+            break;
+
+        case ET_LIST_DATA:
+            for_list(e->per_type.list_, lit, expression, item)
+                pool_expression(item);
+            literal_constant(e);
+            break;
+
+        case ET_DICT_DATA:
+            for_dict(e->per_type.dict_, dit, cstr, key)
+                pool_expression(dict_get(e->per_type.dict_, key));
+            literal_constant(e);
+            break;
+
+        case ET_FUNC_DECL:
+            pool_function(e->per_type.func.statements, e->per_type.func.captures);
+            break;
+    }
+}
+
+static void pool_function(list *statements, list *captures) {
+    list *outer_captures = curr_captures;
+    curr_captures = captures;
+    pool_statements(statements);
+    curr_captures = outer_captures;
+}
@@ -0,0 +1,34 @@
+#ifndef _CONSTANT_POOL_H
+#define _CONSTANT_POOL_H
+
+#include "../variants/_variants.h"
+#include "../../containers/_containers.h"
+#include "../../entities/_entities.h"
+#include "../built_ins/built_in_funcs.h"
+
+/*
+    Runs once after parsing. Every literal gets its value created once,
+    as an immortal variant stored on its expression, so no engine converts
+    or allocates literals while running. Equal string literals share one value.
+    Lists and dicts whose items are all scalar literals (including empty ones)
+    become immortal templates; each evaluation gets a new list or dict
+    sharing the items of the template, copied only when first changed.
+
+    Identifiers of built-in functions are bound to them, if the script
+    never assigns their name and it is not one of the values given to it.
+    Such identifiers always resolve to the built-in, calls to them are direct.
+*/
+
+void build_constant_pool(list *statements, dict *given_values);
+
+// the immortal constant or template of a literal, or NULL if it is not one
+variant *literal_constant(expression *e);
+
+// the value of an evaluation of a constant: itself, or a new sharing instance of a template
+variant *instantiate_constant(variant *constant);
+
+// the built-in function an identifier is bound to, or NULL
+built_in_func *bound_built_in(expression *e);
+
+
+#endif
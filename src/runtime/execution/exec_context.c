@@ -1,7 +1,11 @@
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include "../../utils/str.h"
 #include "../../utils/listing.h"
+#include "../../utils/cstr.h"
+#include "../../utils/intern.h"
+#include "../../entities/expression.h"
 #include "exec_context.h"
 #include "stack_frame.h"
 #include "../../debugger/breakpoint.h"
@@ -10,135 +14,445 @@
 
 // apparently we need more than one flag for debugging,
 // we need: execute single, execute whole line, execute whole function etc.
-// also we need a list of breakpoints (file+line)
+// breakpoints are kept in a table hashed on file+line
 
 
 
+// bumped whenever a global symbol is registered or unregistered, in any context.
+// identifier sites compare it to their cached version, before trusting their cached cell.
+static unsigned int symbols_version = 1;
+
+static symbol_cell *get_symbol_cell(exec_context *c, const char *name, bool create) {
+    symbol_cell *cell = dict_get(c->symbol_cells, name);
+    if (cell == NULL && create) {
+        cell = malloc(sizeof(symbol_cell));
+        memset(cell, 0, sizeof(symbol_cell));
+        dict_set(c->symbol_cells, intern(name), cell);
+    }
+    return cell;
+}
+
+// the size of most value chunks, larger requests get a chunk of their own
+#define VALUE_CHUNK_CAPACITY   256
+
+struct value_chunk {
+    value_chunk *previous;
+    value_chunk *next; // kept after popped, to be reused
+    int capacity;
+    int length;
+    variant *values[];
+};
+
+static value_chunk *new_value_chunk(value_chunk *previous, int capacity) {
+    value_chunk *chunk = malloc(sizeof(value_chunk) + capacity * sizeof(variant *));
+    chunk->previous = previous;
+    chunk->next = NULL;
+    chunk->capacity = capacity;
+    chunk->length = 0;
+    return chunk;
+}
+
+// values are taken and given back in reverse order, a bump allocation in the current chunk
+static variant **push_values(exec_context *c, int count) {
+    if (count <= 0)
+        return NULL;
+
+    value_chunk *chunk = c->values;
+    if (chunk->length + count > chunk->capacity) {
+        // values in use stay where they are
+        while (chunk->next != NULL && chunk->next->capacity < count) {
+            value_chunk *spare = chunk->next;
+            chunk->next = spare->next;
+            free(spare);
+        }
+        if (chunk->next == NULL) {
+            int capacity = count > VALUE_CHUNK_CAPACITY ? count : VALUE_CHUNK_CAPACITY;
+            chunk->next = new_value_chunk(chunk, capacity);
+        }
+        chunk->next->previous = chunk;
+        chunk = chunk->next;
+        c->values = chunk;
+    }
+
+    variant **values = chunk->values + chunk->length;
+    chunk->length += count;
+    return values;
+}
+
+static void pop_values(exec_context *c, int count) {
+    if (count <= 0)
+        return;
+
+    value_chunk *chunk = c->values;
+    chunk->length -= count;
+    if (chunk->length == 0 && chunk->previous != NULL)
+        c->values = chunk->previous;
+}
+
+static inline variant *symbol_cell_value(symbol_cell *cell) {
+    if (cell->global != NULL)   return cell->global;
+    if (cell->built_in != NULL) return cell->built_in;
+    return (variant *)cell->type;
+}
+
 exec_context *new_exec_context(const char *script_name, listing *code_listing, list *ast_root_statements, dict *global_values, bool verbose, bool enable_debugger, bool start_with_debugger) {
     exec_context *c = malloc(sizeof(exec_context));
     c->script_name = script_name;
     c->code_listing = code_listing;
     c->ast_root_statements = ast_root_statements;
     c->verbose = verbose;
+    c->engine = exec_context_get_default_engine();
     c->debugger.enabled = enable_debugger;
     c->debugger.enter_at_next_instruction = start_with_debugger; // debug first line
-    c->debugger.breakpoints = new_list(breakpoint_item_info);
-    c->stack_frames = new_stack(stack_frame_item_info);
+    c->debugger.instrumented = enable_debugger && start_with_debugger;
+    c->debugger.breakpoints = new_breakpoint_table();
+    c->call_stack.frames = NULL;
+    c->call_stack.depth = 0;
+    c->call_stack.capacity = 0;
+    c->max_call_depth = exec_context_get_max_call_depth();
+    c->native_stack_limit = NULL;
+    c->values = new_value_chunk(NULL, VALUE_CHUNK_CAPACITY);
+    c->outcomes_held = 0;
+    c->tail_call.target = NULL;
+    c->tail_call.argc = 0;
+    c->tail_call.argv = NULL;
+    c->tail_call.argv_capacity = 0;
     c->built_in_symbols = new_dict(variant_item_info);
     c->global_values = global_values;
     c->constructable_variant_types = new_dict(NULL);
+    c->symbol_cells = new_dict(NULL);
+
+    // identifiers may have cached cells of a previous context
+    symbols_version++;
+    if (global_values != NULL) {
+        for_dict(global_values, it, cstr, name)
+            get_symbol_cell(c, name, true)->global = dict_get(global_values, name);
+    }
     return c;
 }
 
+void exec_context_export_globals(exec_context *c) {
+    if (c->global_values == NULL)
+        return;
+
+    for_dict(c->symbol_cells, it, cstr, name) {
+        symbol_cell *cell = dict_get(c->symbol_cells, name);
+        if (cell->global != NULL)
+            dict_set(c->global_values, name, cell->global);
+        else if (dict_has(c->global_values, name))
+            dict_del(c->global_values, name);
+    }
+}
+
+static inline stack_frame *curr_frame(exec_context *c) {
+    return c->call_stack.depth == 0 ? NULL : c->call_stack.frames[c->call_stack.depth - 1];
+}
+
 stack_frame *exec_context_get_curr_stack_frame(exec_context *c) {
-    return stack_empty(c->stack_frames) ? 
-        NULL : stack_peek(c->stack_frames);
+    return curr_frame(c);
 }
 
-failable exec_context_push_stack_frame(exec_context *c, stack_frame *f) {
-    stack_push(c->stack_frames, f);
-    return ok();
+stack_frame *exec_context_get_stack_frame(exec_context *c, int level) {
+    return (level < 0 || level >= c->call_stack.depth) ? NULL : c->call_stack.frames[level];
+}
+
+int exec_context_get_call_depth(exec_context *c) {
+    return c->call_stack.depth;
+}
+
+// the slots of the frame, cleared, on top of the values
+static variant **push_frame_slots(exec_context *c, frame_layout *layout) {
+    int count = layout == NULL ? 0 : layout->slots_count;
+    variant **slots = push_values(c, count);
+    if (count > 0)
+        memset(slots, 0, count * sizeof(variant *));
+    return slots;
+}
+
+static void pop_frame_slots(exec_context *c, stack_frame *f) {
+    pop_values(c, f->layout == NULL ? 0 : f->layout->slots_count);
+}
+
+stack_frame *exec_context_push_stack_frame(exec_context *c, const char *func_name, origin *call_origin, frame_layout *layout) {
+    struct call_stack *s = &c->call_stack;
+    if (s->depth == s->capacity) {
+        int capacity = s->capacity == 0 ? 32 : s->capacity * 2;
+        s->frames = realloc(s->frames, capacity * sizeof(stack_frame *));
+        memset(s->frames + s->capacity, 0, (capacity - s->capacity) * sizeof(stack_frame *));
+        s->capacity = capacity;
+    }
+
+    stack_frame *f = s->frames[s->depth];
+    if (f == NULL) {
+        f = new_stack_frame();
+        s->frames[s->depth] = f;
+    }
+    s->depth++;
+
+    stack_frame_prepare(f, func_name, call_origin, layout, push_frame_slots(c, layout));
+    f->young_since = variant_gc_stamp();
+    return f;
+}
+
+stack_frame *exec_context_reuse_stack_frame(exec_context *c, const char *func_name, origin *call_origin, frame_layout *layout) {
+    stack_frame *f = curr_frame(c);
+    if (f == NULL)
+        return NULL;
+
+    // nothing was pushed after the slots of the frame, while its function returned
+    pop_frame_slots(c, f);
+    stack_frame_prepare(f, func_name, call_origin, layout, push_frame_slots(c, layout));
+    f->young_since = variant_gc_stamp();
+    return f;
+}
+
+bool exec_context_call_too_deep(exec_context *c) {
+    if (c->call_stack.depth >= c->max_call_depth)
+        return true;
+
+    // native stacks grow downwards on the platforms we run on
+    char here;
+    return c->native_stack_limit != NULL && &here < c->native_stack_limit;
+}
+
+variant **exec_context_push_arguments(exec_context *c, int count) {
+    // the values are roots, even while the arguments are being evaluated
+    variant **values = push_values(c, count);
+    if (count > 0)
+        memset(values, 0, count * sizeof(variant *));
+    return values;
+}
+
+void exec_context_pop_arguments(exec_context *c, int count) {
+    pop_values(c, count);
 }
 
 failable exec_context_pop_stack_frame(exec_context *c) {
-    if (stack_empty(c->stack_frames))
+    if (c->call_stack.depth == 0)
         return failed(NULL, "Cannot pop stack frame, stack already empty");
-    stack_pop(c->stack_frames);
+
+    // the frame stays allocated, for the next call at this depth
+    pop_frame_slots(c, curr_frame(c));
+    c->call_stack.depth--;
     return ok();
 }
 
+struct roots {
+    exec_context *ctx;
+    variant *last_result;
+};
+
+struct visitor {
+    visit_func visit;
+    void *data;
+};
+
+static void visit_dict_values(dict *d, visit_func visit, void *data) {
+    if (d != NULL)
+        dict_visit_items(d, (visit_item_func)visit, data);
+}
+
+static void visit_symbol_cell(symbol_cell *cell, struct visitor *v) {
+    v->visit(cell->global, v->data);
+    v->visit(cell->built_in, v->data);
+}
+
+static void visit_roots(struct roots *roots, visit_func visit, void *data) {
+    exec_context *c = roots->ctx;
+    visit(roots->last_result, data);
+
+    struct visitor v = { visit, data };
+    dict_visit_items(c->symbol_cells, (visit_item_func)visit_symbol_cell, &v);
+    visit_dict_values(c->built_in_symbols, visit, data);
+    visit_dict_values(c->global_values, visit, data);
+
+    for (int level = 0; level < c->call_stack.depth; level++) {
+        stack_frame *f = c->call_stack.frames[level];
+        visit_dict_values(f->symbols, visit, data);
+        visit_dict_values(f->captured_values, visit, data);
+    }
+
+    // the slots of the frames and the arguments of the calls in progress
+    for (value_chunk *chunk = c->values; chunk != NULL; chunk = chunk->previous) {
+        for (int i = 0; i < chunk->length; i++)
+            visit(chunk->values[i], data);
+    }
+
+    if (c->tail_call.target != NULL) {
+        visit(c->tail_call.target, data);
+        for (int i = 0; i < c->tail_call.argc; i++)
+            visit(c->tail_call.argv[i], data);
+    }
+}
+
+void exec_context_safe_point(exec_context *c, variant *last_result) {
+    if (c->outcomes_held > 0)
+        return;
+    
+    int generation = variant_gc_due_generation();
+    if (generation < 0)
+        return;
+
+    // values in flight are only known to the C code (or the VM stacks) of the callers,
+    // they were all there before the running function was called
+    stack_frame *f = curr_frame(c);
+    unsigned long long young_since = f == NULL ? 0 : f->young_since;
+
+    struct roots roots = { .ctx = c, .last_result = last_result };
+    variant_gc_collect(generation, young_since, (roots_func)visit_roots, &roots);
+}
+
 failable exec_context_register_built_in(exec_context *c, const char *name, variant *value) {
     if (dict_has(c->built_in_symbols, name))
         return failed("Symbol %s already exists", name);
-    dict_set(c->built_in_symbols, name, value);
+    dict_set(c->built_in_symbols, intern(name), value);
+    get_symbol_cell(c, name, true)->built_in = value;
+    symbols_version++;
     return ok();
 }
 
 variant *exec_context_resolve_symbol(exec_context *c, const char *name) {
-    stack_frame *f = stack_peek(c->stack_frames);
+    stack_frame *f = curr_frame(c);
     if (f != NULL) {
         variant *v = stack_frame_resolve_symbol(f, name);
         if (v != NULL)
             return v;
     }
 
-    if (dict_has(c->global_values, name))
-        return dict_get(c->global_values, name);
-
-    if (dict_has(c->built_in_symbols, name))
-        return dict_get(c->built_in_symbols, name);
-    
-    if (dict_has(c->constructable_variant_types, name))
-        return dict_get(c->constructable_variant_types, name);
-    
-    return NULL;
+    symbol_cell *cell = get_symbol_cell(c, name, false);
+    return cell == NULL ? NULL : symbol_cell_value(cell);
 }
 
 bool exec_context_symbol_exists(exec_context *c, const char *name) {
-    stack_frame *f = stack_peek(c->stack_frames);
+    stack_frame *f = curr_frame(c);
     if (f != NULL) {
         if (stack_frame_symbol_exists(f, name))
             return true;
     }
 
-    if (dict_has(c->global_values, name))
-        return true;
-    
-    if (dict_has(c->built_in_symbols, name))
-        return true;
-
-    if (dict_has(c->constructable_variant_types, name))
-        return true;
-    
-    return false;
+    symbol_cell *cell = get_symbol_cell(c, name, false);
+    return cell != NULL && symbol_cell_value(cell) != NULL;
 }
 
 failable exec_context_register_symbol(exec_context *c, const char *name, variant *v) {
-    stack_frame *f = stack_peek(c->stack_frames);
+    stack_frame *f = curr_frame(c);
     if (f != NULL) {
         failable registration = stack_frame_register_symbol(f, name, v);
         if (registration.failed) return failed(&registration, NULL);
         return ok();
     }
     
-    if (dict_has(c->global_values, name))
+    symbol_cell *cell = get_symbol_cell(c, name, true);
+    if (cell->global != NULL)
         return failed("symbol %s already exists", name);
-    dict_set(c->global_values, name, v);
+    cell->global = v;
+    symbols_version++;
     return ok();
 }
 
 failable exec_context_update_symbol(exec_context *c, const char *name, variant *v) {
-    stack_frame *f = stack_peek(c->stack_frames);
+    stack_frame *f = curr_frame(c);
     if (f != NULL) {
         if (stack_frame_symbol_exists(f, name))
             return stack_frame_update_symbol(f, name, v);
     }
     
-    if (!dict_has(c->global_values, name))
+    symbol_cell *cell = get_symbol_cell(c, name, false);
+    if (cell == NULL || cell->global == NULL)
         return failed("Symbol %s does not exist", name);
-    dict_set(c->global_values, name, v);
+    cell->global = v;
     return ok();
 }
 
 failable exec_context_unregister_symbol(exec_context *c, const char *name) {
-    stack_frame *f = stack_peek(c->stack_frames);
+    stack_frame *f = curr_frame(c);
     if (f != NULL) {
         failable registration = stack_frame_unregister_symbol(f, name);
         if (registration.failed) return failed(&registration, NULL);
         return ok();
     }
     
-    if (!dict_has(c->global_values, name))
+    symbol_cell *cell = get_symbol_cell(c, name, false);
+    if (cell == NULL || cell->global == NULL)
         return failed("symbol %s not found", name);
-    dict_del(c->global_values, name);
+    cell->global = NULL;
+    symbols_version++;
     return ok();
 }
 
-bool exec_context_is_curr_method_owned_by(exec_context *c, variant_type *class_type) {
-    if (stack_empty(c->stack_frames))
+// finds the global cell of the name, using the cache of the identifier site
+static symbol_cell *cached_symbol_cell(exec_context *c, const char *name, symbol_cache *cache) {
+    if (cache->version == symbols_version)
+        return cache->cell;
+
+    cache->cell = get_symbol_cell(c, name, false);
+    cache->version = symbols_version;
+    return cache->cell;
+}
+
+// pooled frames keep their emptied names dict, for the next call at their depth
+static inline bool frame_has_names(stack_frame *f) {
+    return (f->symbols != NULL && !dict_is_empty(f->symbols)) || f->captured_values != NULL;
+}
+
+// slots are resolved at parse time, in the layout of the current function.
+// slots captured by closures hold cells, looked through here.
+// unset slots fall back to frame names (captured values etc), then global cells.
+// globals of frames without names of their own go straight to their cells
+variant *exec_context_resolve_identifier(exec_context *c, const char *name, int slot, symbol_cache *cache) {
+    stack_frame *f = curr_frame(c);
+    if (f != NULL && !(slot == GLOBAL_SLOT && !frame_has_names(f))) {
+        if (slot >= 0 && f->layout != NULL && slot < f->layout->slots_count && f->slots[slot] != NULL) {
+            if (f->layout->captured == NULL || !f->layout->captured[slot])
+                return f->slots[slot];
+            if (cell_variant_get(f->slots[slot]) != NULL)
+                return cell_variant_get(f->slots[slot]);
+        }
+        variant *v = stack_frame_resolve_symbol(f, name);
+        if (v != NULL)
+            return v;
+    }
+
+    symbol_cell *cell = cached_symbol_cell(c, name, cache);
+    return cell == NULL ? NULL : symbol_cell_value(cell);
+}
+
+// updates an existing local or global, returns false if the symbol is not set.
+bool exec_context_update_identifier(exec_context *c, const char *name, int slot, symbol_cache *cache, variant *v) {
+    stack_frame *f = curr_frame(c);
+    if (f != NULL && !(slot == GLOBAL_SLOT && !frame_has_names(f))) {
+        if (slot >= 0 && f->layout != NULL && slot < f->layout->slots_count && f->slots[slot] != NULL) {
+            if (f->layout->captured == NULL || !f->layout->captured[slot]) {
+                f->slots[slot] = v;
+                return true;
+            }
+            if (cell_variant_get(f->slots[slot]) != NULL) {
+                cell_variant_set(f->slots[slot], v);
+                return true;
+            }
+        }
+        if (stack_frame_symbol_exists(f, name))
+            return false;
+    }
+
+    symbol_cell *cell = cached_symbol_cell(c, name, cache);
+    if (cell == NULL || cell->global == NULL)
+        return false;
+    cell->global = v;
+    return true;
+}
+
+// true if the slot is held by the current frame itself, not by a closure cell or a global.
+// only such values cannot be changed by the callees of the frame.
+bool exec_context_slot_is_owned(exec_context *c, int slot) {
+    stack_frame *f = curr_frame(c);
+    if (f == NULL || slot < 0 || f->layout == NULL || slot >= f->layout->slots_count || f->slots[slot] == NULL)
         return false;
+    return f->layout->captured == NULL || !f->layout->captured[slot];
+}
 
-    stack_frame *f = stack_peek(c->stack_frames);
+bool exec_context_is_curr_method_owned_by(exec_context *c, variant_type *class_type) {
+    stack_frame *f = curr_frame(c);
     if (f == NULL)
         return false;
 
@@ -150,6 +464,9 @@ failable exec_context_register_constructable_type(exec_context *c, variant_type
     if (dict_has(c->constructable_variant_types, type->name))
         return failed(NULL, "type '%s' already registered", type->name);
     dict_set(c->constructable_variant_types, type->name, type);
+    get_symbol_cell(c, type->name, true)->type = type;
+    symbols_version++;
+    return ok();
 }
 
 variant_type *exec_context_get_constructable_type(exec_context *c, const char *name) {
@@ -207,3 +524,23 @@ void exec_context_set_log_echo(FILE *handle, char *filename) {
 }
 
 
+
+static execution_engine default_engine = EE_AST_WALKER;
+
+execution_engine exec_context_get_default_engine() {
+    return default_engine;
+}
+
+void exec_context_set_default_engine(execution_engine engine) {
+    default_engine = engine;
+}
+
+static int max_call_depth = 10000;
+
+int exec_context_get_max_call_depth() {
+    return max_call_depth;
+}
+
+void exec_context_set_max_call_depth(int depth) {
+    max_call_depth = depth;
+}
@@ -7,9 +7,26 @@
 #include "stack_frame.h"
 #include "../../utils/listing.h"
 
+typedef enum execution_engine {
+    EE_AST_WALKER,    // walks the statements and expressions tree directly
+    EE_BYTECODE_VM,   // compiles statement lists into bytecode, runs on a stack machine
+    EE_COMPILED_TREE, // lowers statement lists into nodes of direct function pointers
+} execution_engine;
+
+typedef struct symbol_cache symbol_cache;
+typedef struct value_chunk value_chunk;
+
+// stable storage of a global name, the first non-NULL of these is its value
+typedef struct symbol_cell {
+    variant *global;
+    variant *built_in;
+    variant_type *type;
+} symbol_cell;
+
 typedef struct exec_context exec_context;
 struct exec_context {
     bool verbose;
+    execution_engine engine;
 
     const char *script_name;
     listing *code_listing;
@@ -17,17 +34,43 @@ struct exec_context {
     dict *built_in_symbols;
     dict *global_values;
     dict *constructable_variant_types;
-    stack *stack_frames;
+    dict *symbol_cells; // name -> symbol_cell, for globals, built-ins and types
+
+    // frames of the running functions, kept after they return, for the next calls
+    struct call_stack {
+        stack_frame **frames;   // outermost first
+        int depth;
+        int capacity;
+    } call_stack;
+    int max_call_depth;         // script calls nesting, beyond that an exception is raised
+    char *native_stack_limit;   // lowest native stack address script calls may reach, or NULL
+
+    // arguments of the calls in progress and slots of the running functions,
+    // taken and given back in reverse order, in chunks that never move
+    value_chunk *values;
+
+    // outcomes held by C code while statements run, e.g. during finally blocks
+    int outcomes_held;
+
+    // a call in tail position, made by the function after it returns
+    struct tail_call {
+        variant *target;
+        int argc;
+        variant **argv;     // copied, the arguments of the returning call are gone
+        int argv_capacity;
+        origin *call_origin;
+    } tail_call;
 
     struct debugger_info {
         bool enabled;
+        bool instrumented; // stepping, or breakpoints armed, only then the tree walker checks for debugger entry
         bool enter_at_next_instruction;
         bool enter_when_at_different_line;
         const char *original_filename;
         int original_line_no;
         bool enter_at_next_return;
         int return_stack_size;
-        list *breakpoints;
+        struct breakpoint_table *breakpoints;
     } debugger;
 
     // stdin, stdout, logger
@@ -35,9 +78,19 @@ struct exec_context {
 
 exec_context *new_exec_context(const char *script_name, listing *code_listing, list *ast_root_statments, dict *global_values, bool verbose, bool debugger, bool start_with_debugger);
 
+void exec_context_export_globals(exec_context *c);
+
 stack_frame *exec_context_get_curr_stack_frame(exec_context *c);
-failable exec_context_push_stack_frame(exec_context *c, stack_frame *f);
+stack_frame *exec_context_get_stack_frame(exec_context *c, int level); // level 0 is the outermost call
+int exec_context_get_call_depth(exec_context *c);
+stack_frame *exec_context_push_stack_frame(exec_context *c, const char *func_name, origin *call_origin, frame_layout *layout);
+stack_frame *exec_context_reuse_stack_frame(exec_context *c, const char *func_name, origin *call_origin, frame_layout *layout); // for tail calls
 failable exec_context_pop_stack_frame(exec_context *c);
+bool exec_context_call_too_deep(exec_context *c);
+
+// space for the arguments of a call, valid until popped, pops go in reverse order of pushes
+variant **exec_context_push_arguments(exec_context *c, int count);
+void exec_context_pop_arguments(exec_context *c, int count);
 
 failable exec_context_register_built_in(exec_context *c, const char *name, variant *value);
 
@@ -46,8 +99,14 @@ bool exec_context_symbol_exists(exec_context *c, const char *name);
 failable exec_context_register_symbol(exec_context *c, const char *name, variant *v);
 failable exec_context_update_symbol(exec_context *c, const char *name, variant *v);
 failable exec_context_unregister_symbol(exec_context *c, const char *name);
+variant *exec_context_resolve_identifier(exec_context *c, const char *name, int slot, symbol_cache *cache);
+bool exec_context_update_identifier(exec_context *c, const char *name, int slot, symbol_cache *cache, variant *v);
+bool exec_context_slot_is_owned(exec_context *c, int slot);
 bool exec_context_is_curr_method_owned_by(exec_context *c, variant_type *class_type);
 
+// called between statements of the running function or the top level code, runs cycle collection if due
+void exec_context_safe_point(exec_context *c, variant *last_result);
+
 failable exec_context_register_constructable_type(exec_context *c, variant_type *type);
 variant_type *exec_context_get_constructable_type(exec_context *c, const char *name);
 
@@ -62,5 +121,13 @@ const char *exec_context_get_log();
 FILE *exec_context_get_log_echo();
 void exec_context_set_log_echo(FILE *handle, char *filename);
 
+// engine used by all new execution contexts
+execution_engine exec_context_get_default_engine();
+void exec_context_set_default_engine(execution_engine engine);
+
+// call depth allowed in all new execution contexts
+int exec_context_get_max_call_depth();
+void exec_context_set_max_call_depth(int depth);
+
 
 #endif
@@ -8,15 +8,18 @@
 #include "expression_execution.h"
 #include "statement_execution.h"
 #include "function_execution.h"
+#include "type_feedback.h"
+#include "constant_pool.h"
 #include "../built_ins/built_in_funcs.h"
 
 // used for pre/post increment/decrement
 static expression *one = NULL;
 
-enum modify_and_store {
-    MAS_ADD, MAS_SUB, MAS_MUL, MAS_DIV, MAS_MOD,
-    MAS_RSH, MAS_LSH, MAS_AND, MAS_OR, MAS_XOR,
-};
+// discrete functions per operator, instead of switch statements
+static unary_operation_func unary_operations[OP_MAX_VALUE];
+static binary_operation_func binary_operations[OP_MAX_VALUE];
+static void initialize_operation_tables();
+
 enum comparison { 
     COMP_GT, COMP_GE, 
     COMP_LT, COMP_LE, 
@@ -32,20 +35,28 @@ static execution_outcome store_element(expression *container_expr, expression *e
 
 static execution_outcome retrieve_member(expression *object, expression *member, exec_context *ctx);
 static execution_outcome store_member(expression *container_expr, expression *member_expr, variant *value, exec_context *ctx);
-static execution_outcome call_member(expression *container_expr, expression *member_expr, expression *args_expr, origin *call_origin, exec_context *ctx);
+static execution_outcome call_member(expression *container_expr, expression *member_expr, expression *args_expr, inlined_call *inlined, origin *call_origin, exec_context *ctx);
+
+static execution_outcome make_function_call(expression *call_target_expr, expression *args_expr, inlined_call *inlined, origin *call_origin, exec_context *ctx);
+static execution_outcome retrieve_logical(expression *op_expr, exec_context *ctx);
+static execution_outcome retrieve_short_if(expression *op_expr, exec_context *ctx);
+
+execution_outcome resolve_identifier_value(expression *identifier, exec_context *ctx) {
+    const char *name = identifier->per_type.terminal_data;
+    variant *v = exec_context_resolve_identifier(ctx, name, identifier->slot, &identifier->cache);
+    if (v == NULL)
+        return exception_outcome(new_exception_variant_at(identifier->token->origin, NULL,
+            "identifier '%s' not found", name));
+    return ok_outcome(v);
+}
+
+execution_outcome store_identifier_value(expression *identifier, variant *value, exec_context *ctx) {
+    if (exec_context_update_identifier(ctx, identifier->per_type.terminal_data, identifier->slot, &identifier->cache, value))
+        return ok_outcome(NULL);
+    return store_symbol_value(identifier->per_type.terminal_data, value, ctx);
+}
 
-static execution_outcome make_function_call(expression *call_target_expr, expression *args_expr, origin *call_origin, exec_context *ctx);
-static execution_outcome calculate_unary_expression(expression *op_expr, variant *value, exec_context *ctx);
-static execution_outcome calculate_binary_expression(expression *op_expr, variant *v1, variant *v2, exec_context *ctx);
 static execution_outcome calculate_comparison(expression *op_expr, enum comparison cmp, variant *v1, variant *v2);
-static execution_outcome expression_function_callable_executor(
-    list *arg_values, 
-    void *ast_node, 
-    variant *this_obj,
-    dict *captured_values, // optional for closures
-    origin *call_origin, // source of call
-    exec_context *ctx);
-dict *capture_variables_for_closure(expression *expr, exec_context *ctx);
 
 
 
@@ -54,6 +65,9 @@ dict *capture_variables_for_closure(expression *expr, exec_context *ctx);
 void initialize_expression_execution() {
     // used for inc/dec operations
     one = new_numeric_literal_expression("1", NULL);
+
+    initialize_operation_tables();
+    initialize_type_feedback();
 }
 
 execution_outcome execute_expression(expression *e, exec_context *ctx) {
@@ -63,7 +77,7 @@ execution_outcome execute_expression(expression *e, exec_context *ctx) {
     expression *lval_expr;
     expression *rval_expr;
 
-    if (should_start_debugger(NULL, e, ctx)) {
+    if (ctx->debugger.instrumented && should_start_debugger(NULL, e, ctx)) {
         failable session = run_debugger(NULL, e, ctx);
         if (session.failed) return failed_outcome("%s", session.err_msg);
     }
@@ -82,10 +96,10 @@ execution_outcome execute_expression(expression *e, exec_context *ctx) {
         rval_expr = e->per_type.operation.operand2;
         switch (op) {
             case OP_ASSIGNMENT:
-                execution_outcome retrieval = retrieve_value(rval_expr, ctx);
-                if (retrieval.exception_thrown || retrieval.failed) return retrieval;
+                execution_outcome retrieval = execute_expression(rval_expr, ctx);
+                if (retrieval.excepted || retrieval.failed) return retrieval;
                 execution_outcome storage = store_value(lval_expr, ctx, retrieval.result);
-                if (storage.exception_thrown || storage.failed) return storage;
+                if (storage.excepted || storage.failed) return storage;
                 return retrieval; // assignment returns the assigned value
             
             case OP_ADD_ASSIGN: return modify_and_store(lval_expr, MAS_ADD, rval_expr, false, ctx);
@@ -108,25 +122,21 @@ execution_outcome execute_expression(expression *e, exec_context *ctx) {
 static execution_outcome retrieve_value(expression *e, exec_context *ctx) {
     execution_outcome ex;
     operator_type op = e->op;
-    const char *data = e->per_type.terminal_data;
     expression *operand1, *operand2;
 
     switch (e->type) {
         case ET_IDENTIFIER:
-            variant *v = exec_context_resolve_symbol(ctx, data);
-            if (v == NULL) {
-                return exception_outcome(new_exception_variant_at(e->token->origin, NULL,
-                    "identifier '%s' not found", data));
-            }
-            return ok_outcome(v);
+            if (bound_built_in(e) != NULL)
+                return ok_outcome(bound_built_in(e)->value);
+            return resolve_identifier_value(e, ctx);
         case ET_NUMERIC_LITERAL:
-            return ok_outcome(new_int_variant(atoi(data)));
         case ET_STRING_LITERAL:
-            return ok_outcome(new_str_variant(data));
         case ET_BOOLEAN_LITERAL:
-            return ok_outcome(new_bool_variant(strcmp(data, "true") == 0));
+            return ok_outcome(literal_constant(e));
 
         case ET_LIST_DATA:
+            if (e->constant != NULL)
+                return ok_outcome(instantiate_constant(e->constant));
             list *expressions_list = e->per_type.list_;
             list *values_list = new_list(variant_item_info);
             for_list(expressions_list, list_iter, expression, list_exp) {
@@ -137,6 +147,8 @@ static execution_outcome retrieve_value(expression *e, exec_context *ctx) {
             return ok_outcome(new_list_variant_owning(values_list));
 
         case ET_DICT_DATA:
+            if (e->constant != NULL)
+                return ok_outcome(instantiate_constant(e->constant));
             dict *expressions_dict = e->per_type.dict_;
             dict *values_dict = new_dict(variant_item_info);
             iterator *keys_it = dict_keys_iterator(expressions_dict);
@@ -163,7 +175,11 @@ static execution_outcome retrieve_value(expression *e, exec_context *ctx) {
             } else if (op == OP_MEMBER) {
                 return retrieve_member(operand1, operand2, ctx);
             } else if (op == OP_FUNC_CALL) {
-                return make_function_call(operand1, operand2, e->token->origin, ctx);
+                return make_function_call(operand1, operand2, e->inlined, e->token->origin, ctx);
+            } else if (op == OP_LOGICAL_AND || op == OP_LOGICAL_OR) {
+                return retrieve_logical(e, ctx);
+            } else if (op == OP_SHORT_IF) {
+                return retrieve_short_if(e, ctx);
             } else {
                 ex = execute_expression(operand1, ctx);
                 if (ex.excepted || ex.failed) return ex;
@@ -177,14 +193,8 @@ static execution_outcome retrieve_value(expression *e, exec_context *ctx) {
         
         case ET_FUNC_DECL:
             // "retrieving" a `function () { ...}` expression merely creates and returns a callable variant
-            // we need to find any variables to capture.
-            return ok_outcome(new_callable_variant(new_callable(
-                e->per_type.func.name == NULL ? "(anonymous)" : e->per_type.func.name,
-                expression_function_callable_executor, 
-                e,
-                NULL,
-                capture_variables_for_closure(e, ctx)
-            )));
+            // sharing the cells of the variables it captures.
+            return ok_outcome(create_closure_variant(e, ctx));
     }
 
     return exception_outcome(new_exception_variant_at(e->token->origin, NULL,
@@ -193,21 +203,35 @@ static execution_outcome retrieve_value(expression *e, exec_context *ctx) {
 
 static execution_outcome modify_and_store(expression *lvalue, enum modify_and_store op, expression *rvalue, bool return_original, exec_context *ctx) {
     execution_outcome retrieval;
-    int original_int = 0;
-    int operand_int;
-    int result_int;
 
     // for now we allow variable creation via simple assignment
     retrieval = retrieve_value(lvalue, ctx);
-    if (retrieval.exception_thrown || retrieval.failed) return retrieval;
+    if (retrieval.excepted || retrieval.failed) return retrieval;
     variant *original = retrieval.result;
+
+    retrieval = execute_expression(rvalue, ctx);
+    if (retrieval.excepted || retrieval.failed) return retrieval;
+    variant *operand = retrieval.result;
+
+    execution_outcome calculation = calculate_modification(op, original, operand, rvalue);
+    if (calculation.excepted || calculation.failed) return calculation;
+    variant *result = calculation.result;
+
+    execution_outcome storing = store_value(lvalue, ctx, result);
+    if (storing.excepted || storing.failed) return storing;
+
+    return ok_outcome(return_original ? original : result);
+}
+
+execution_outcome calculate_modification(enum modify_and_store op, variant *original, variant *operand, expression *rvalue) {
+    int original_int;
+    int operand_int;
+    int result_int;
+
     if (!variant_instance_of(original, int_type))
         return failed_outcome("modify_and_store() should be called for integers only");
     original_int = int_variant_as_int(original);
 
-    retrieval = retrieve_value(rvalue, ctx);
-    if (retrieval.exception_thrown || retrieval.failed) return retrieval;
-    variant *operand = retrieval.result;
     if (!variant_instance_of(operand, int_type))
         return failed_outcome("modify_and_store() should be called for integers only");
     operand_int = int_variant_as_int(operand);
@@ -230,23 +254,14 @@ static execution_outcome modify_and_store(expression *lvalue, enum modify_and_st
         case MAS_XOR: result_int = original_int  ^ operand_int; break;
     }
     
-    variant *result = new_int_variant(result_int);
-    execution_outcome storing = store_value(lvalue, ctx, result);
-    if (storing.exception_thrown || storing.failed) return storing;
-
-    return ok_outcome(return_original ? original : result);
+    return ok_outcome(new_int_variant(result_int));
 }
 
 static execution_outcome store_value(expression *lvalue, exec_context *ctx, variant *rvalue) {
 
     expression_type et = lvalue->type;
     if (et == ET_IDENTIFIER) {
-        const char *name = lvalue->per_type.terminal_data;
-        if (exec_context_symbol_exists(ctx, name))
-            exec_context_update_symbol(ctx, name, rvalue);
-        else
-            exec_context_register_symbol(ctx, name, rvalue);
-        return ok_outcome(NULL);
+        return store_identifier_value(lvalue, rvalue, ctx);
 
     } else if (et == ET_BINARY_OP) {
         operator_type op = lvalue->op;
@@ -270,6 +285,14 @@ static execution_outcome store_value(expression *lvalue, exec_context *ctx, vari
     }
 }
 
+execution_outcome store_symbol_value(const char *name, variant *value, exec_context *ctx) {
+    if (exec_context_symbol_exists(ctx, name))
+        exec_context_update_symbol(ctx, name, value);
+    else
+        exec_context_register_symbol(ctx, name, value);
+    return ok_outcome(NULL);
+}
+
 static execution_outcome calculate_comparison(expression *op_expr, enum comparison cmp, variant *v1, variant *v2) {
 
     if (variant_instance_of(v1, int_type) && variant_instance_of(v2, int_type)) {
@@ -341,9 +364,13 @@ static execution_outcome retrieve_element(expression *container_expr, expression
     if (ex.excepted || ex.failed) return ex;
     variant *element = ex.result;
 
-    ex = variant_get_element(container, element);
+    return get_element_value(container, element);
+}
+
+execution_outcome get_element_value(variant *container, variant *element) {
+    execution_outcome ex = variant_get_element(container, element);
 
-    if (ex.result != NULL)
+    if (!ex.excepted && !ex.failed && ex.result != NULL)
         variant_inc_ref(ex.result);
     
     return ex;
@@ -368,29 +395,83 @@ static execution_outcome retrieve_member(expression *container_expr, expression
 
     execution_outcome ex = execute_expression(container_expr, ctx);
     if (ex.excepted || ex.failed) return ex;
-    variant *container = ex.result;
 
-    visibility vis = exec_context_is_curr_method_owned_by(ctx, container->_type) ?
+    return get_member_value(ex.result, member_expr, ctx);
+}
+
+// inline cache of a member access site, remembers the definitions
+// resolved for the last few (type, visibility) pairs seen at this site
+#define MEMBER_CACHE_ENTRIES  4
+
+typedef struct member_cache_entry {
+    variant_type *type;
+    visibility vis;
+    variant_attrib_definition *attr;
+    variant_method_definition *method;
+} member_cache_entry;
+
+typedef struct member_cache {
+    int count;
+    int next_replaced;
+    member_cache_entry entries[MEMBER_CACHE_ENTRIES];
+} member_cache;
+
+static member_cache_entry *lookup_member(expression *member_expr, variant_type *type, visibility vis) {
+    member_cache *cache = member_expr->member_cache;
+    if (cache == NULL) {
+        cache = malloc(sizeof(member_cache));
+        memset(cache, 0, sizeof(member_cache));
+        member_expr->member_cache = cache;
+    }
+
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->entries[i].type == type && cache->entries[i].vis == vis)
+            return &cache->entries[i];
+    }
+
+    // megamorphic sites keep working, replacing entries in turn
+    member_cache_entry *entry;
+    if (cache->count < MEMBER_CACHE_ENTRIES) {
+        entry = &cache->entries[cache->count++];
+    } else {
+        entry = &cache->entries[cache->next_replaced];
+        cache->next_replaced = (cache->next_replaced + 1) % MEMBER_CACHE_ENTRIES;
+    }
+
+    const char *member = member_expr->per_type.terminal_data;
+    entry->type = type;
+    entry->vis = vis;
+    entry->attr = variant_find_attr(type, member, vis);
+    entry->method = variant_find_method(type, member, vis);
+    return entry;
+}
+
+execution_outcome get_member_value(variant *container, expression *member_expr, exec_context *ctx) {
+    execution_outcome ex;
+
+    variant_type *type = variant_type_of(container);
+    visibility vis = exec_context_is_curr_method_owned_by(ctx, type) ?
         VIS_SAME_CLASS_CODE : VIS_PUBLIC_CODE;
 
     if (member_expr->type != ET_IDENTIFIER)
         return exception_outcome(new_exception_variant("MEMBER_OF requires identifier as right operand"));
     const char *member = member_expr->per_type.terminal_data;
+    member_cache_entry *resolved = lookup_member(member_expr, type, vis);
 
-    if (variant_has_attr(container, member, vis)) {
-        ex = variant_get_attr_value(container, member, vis);
+    if (resolved->attr != NULL) {
+        ex = variant_get_attr_value_of(container, resolved->attr);
         if (ex.excepted || ex.failed) return ex;
         variant *value = ex.result;
         variant_inc_ref(value);
         return ok_outcome(value);
 
-    } else if (variant_has_method(container, member, vis)) {
+    } else if (resolved->method != NULL) {
         // promote a function to an instance, capturing the container as 'this'
         return variant_get_bound_method(container, member, vis);
 
     } else {
         return exception_outcome(new_exception_variant("member '%s' not found in object type '%s'",
-            member, container->_type->name));
+            member, type->name));
     }
 }
 
@@ -398,66 +479,142 @@ static execution_outcome store_member(expression *container_expr, expression *me
 
     execution_outcome ex = execute_expression(container_expr, ctx);
     if (ex.excepted || ex.failed) return ex;
-    variant *container = ex.result;
 
-    visibility vis = exec_context_is_curr_method_owned_by(ctx, container->_type) ?
+    return set_member_value(ex.result, member_expr, value, ctx);
+}
+
+execution_outcome set_member_value(variant *container, expression *member_expr, variant *value, exec_context *ctx) {
+
+    variant_type *type = variant_type_of(container);
+    visibility vis = exec_context_is_curr_method_owned_by(ctx, type) ?
         VIS_SAME_CLASS_CODE : VIS_PUBLIC_CODE;
 
     if (member_expr->type != ET_IDENTIFIER)
         return exception_outcome(new_exception_variant("MEMBER_OF requires identifier as right operand"));
     const char *member = member_expr->per_type.terminal_data;
 
-    if (!variant_has_attr(container, member, vis))
+    member_cache_entry *resolved = lookup_member(member_expr, type, vis);
+
+    if (resolved->attr == NULL)
         return exception_outcome(new_exception_variant("attribute '%s' not found in object type '%s'",
-            member, container->_type->name));
+            member, type->name));
 
-    return variant_set_attr_value(container, member, vis, value);
+    return variant_set_attr_value_of(container, resolved->attr, value);
 }
 
-static execution_outcome call_member(expression *container_expr, expression *member_expr, expression *args_expr, origin *call_origin, exec_context *ctx) {
+// evaluates the argument expressions onto the arguments stack, the caller pops them after the call
+static execution_outcome push_arguments(expression *args_expr, int *argc, variant ***argv, exec_context *ctx) {
+    int count = list_length(args_expr->per_type.list_);
+    variant **values = exec_context_push_arguments(ctx, count);
+
+    int i = 0;
+    for_list(args_expr->per_type.list_, it, expression, arg_expr) {
+        execution_outcome ex = execute_expression(arg_expr, ctx);
+        if (ex.excepted || ex.failed) {
+            exec_context_pop_arguments(ctx, count);
+            return ex;
+        }
+        values[i++] = ex.result;
+    }
+
+    *argc = count;
+    *argv = values;
+    return ok_outcome(NULL);
+}
+
+static execution_outcome call_member(expression *container_expr, expression *member_expr, expression *args_expr, inlined_call *inlined, origin *call_origin, exec_context *ctx) {
 
     execution_outcome ex = execute_expression(container_expr, ctx);
     if (ex.excepted || ex.failed) return ex;
     variant *container = ex.result;
 
-    visibility vis = exec_context_is_curr_method_owned_by(ctx, container->_type) ?
-        VIS_SAME_CLASS_CODE : VIS_PUBLIC_CODE;
-
     if (member_expr->type != ET_IDENTIFIER)
         return exception_outcome(new_exception_variant("MEMBER_OF requires identifier as right operand"));
-    const char *member = member_expr->per_type.terminal_data;
+
+    if (inlined != NULL && inlined_call_applies(inlined, container, member_expr, ctx))
+        return execute_expression(inlined->body, ctx);
 
     // arguments is a list of expressions, evaluating to a list of values
     if (args_expr->type != ET_LIST_DATA)
         return exception_outcome(new_exception_variant("function call requires a list of args"));
     
-    ex = retrieve_value(args_expr, ctx);
+    int argc;
+    variant **argv;
+    ex = push_arguments(args_expr, &argc, &argv, ctx);
     if (ex.excepted || ex.failed) return ex;
-    list *args = list_variant_as_list(ex.result);
 
-    if (variant_has_method(container, member, vis)) {
-        return variant_call_method(container, member, vis, args, call_origin, ctx);
+    ex = call_member_value(container, member_expr, argc, argv, call_origin, ctx);
+    exec_context_pop_arguments(ctx, argc);
+    return ex;
+}
+
+execution_outcome call_member_value(variant *container, expression *member_expr, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
+    execution_outcome ex;
+
+    variant_type *type = variant_type_of(container);
+    visibility vis = exec_context_is_curr_method_owned_by(ctx, type) ?
+        VIS_SAME_CLASS_CODE : VIS_PUBLIC_CODE;
+
+    if (member_expr->type != ET_IDENTIFIER)
+        return exception_outcome(new_exception_variant("MEMBER_OF requires identifier as right operand"));
+    const char *member = member_expr->per_type.terminal_data;
 
-    } else if (variant_has_attr(container, member, vis)) {
-        ex = variant_get_attr_value(container, member, vis);
+    member_cache_entry *resolved = lookup_member(member_expr, type, vis);
+
+    if (resolved->method != NULL) {
+        return resolved->method->handler(container, resolved->method, argc, argv, call_origin, ctx);
+
+    } else if (resolved->attr != NULL) {
+        ex = variant_get_attr_value_of(container, resolved->attr);
         if (ex.excepted || ex.failed) return ex;
 
         // attribute could be an expression function or callable.
-        return variant_call(ex.result, args, NULL, call_origin, ctx);
+        return variant_call(ex.result, argc, argv, NULL, call_origin, ctx);
 
     } else {
         return exception_outcome(new_exception_variant("no callable member '%s' found in object type '%s'",
-            member, container->_type->name));
+            member, type->name));
+    }
+}
+
+// true if the callee of an inlined call site is still the function expanded there.
+// for method calls, the target is the object and the method is resolved as a call would.
+bool inlined_call_applies(inlined_call *inlined, variant *target, expression *member_expr, exec_context *ctx) {
+    if (member_expr == NULL) {
+        if (!variant_instance_of(target, callable_type))
+            return false;
+        callable *c = callable_variant_as_callable(target);
+        return callable_get_handler(c) == statement_function_callable_executor
+            && callable_ast_node(c) == inlined->function;
     }
+
+    variant_type *type = variant_type_of(target);
+    visibility vis = exec_context_is_curr_method_owned_by(ctx, type) ?
+        VIS_SAME_CLASS_CODE : VIS_PUBLIC_CODE;
+    member_cache_entry *resolved = lookup_member(member_expr, type, vis);
+    return resolved->method != NULL && resolved->method->ast_node == inlined->function;
 }
 
-static execution_outcome make_function_call(expression *call_target_expr, expression *args_expr, origin *call_origin, exec_context *ctx) {
+static execution_outcome make_function_call(expression *call_target_expr, expression *args_expr, inlined_call *inlined, origin *call_origin, exec_context *ctx) {
 
     if (call_target_expr->op == OP_MEMBER) {
         // if calling a member of something, avoid promoting the method 
         // to an instance, call on the object directly.
         // remember, object instances don't have func pointers, the class instance does.
-        return call_member(call_target_expr->per_type.operation.operand1, call_target_expr->per_type.operation.operand2, args_expr, call_target_expr->token->origin, ctx);
+        return call_member(call_target_expr->per_type.operation.operand1, call_target_expr->per_type.operation.operand2, args_expr, inlined, call_target_expr->token->origin, ctx);
+
+    } else if (bound_built_in(call_target_expr) != NULL) {
+        // built-ins bound at parse time are called directly
+        if (args_expr->type != ET_LIST_DATA)
+            return exception_outcome(new_exception_variant("call requires a list of expressions"));
+        int argc;
+        variant **argv;
+        execution_outcome ex = push_arguments(args_expr, &argc, &argv, ctx);
+        if (ex.excepted || ex.failed) return ex;
+
+        ex = call_built_in_func(bound_built_in(call_target_expr), argc, argv, call_target_expr->token->origin, ctx);
+        exec_context_pop_arguments(ctx, argc);
+        return ex;
 
     } else {
         // otherwise, derive the callable and call it.
@@ -465,207 +622,301 @@ static execution_outcome make_function_call(expression *call_target_expr, expres
         if (ex.excepted || ex.failed) return ex;
         variant *call_target = ex.result;
 
+        // a small function expanded here runs in place, without a frame
+        if (inlined != NULL && inlined_call_applies(inlined, call_target, NULL, ctx))
+            return execute_expression(inlined->body, ctx);
+
         if (args_expr->type != ET_LIST_DATA)
             return exception_outcome(new_exception_variant("call requires a list of expressions"));
-        ex = retrieve_value(args_expr, ctx);
+        int argc;
+        variant **argv;
+        ex = push_arguments(args_expr, &argc, &argv, ctx);
         if (ex.excepted || ex.failed) return ex;
-        list *args = list_variant_as_list(ex.result);
 
-        ex = variant_call(call_target, args, NULL, call_target_expr->token->origin, ctx);
+        ex = variant_call(call_target, argc, argv, NULL, call_target_expr->token->origin, ctx);
+        exec_context_pop_arguments(ctx, argc);
         return ex;
     }
 }
 
-static execution_outcome calculate_unary_expression(expression *op_expr, variant *value, exec_context *ctx) {
-    switch (op_expr->op) {
-        case OP_POSITIVE_NUM:
-            if (variant_instance_of(value, int_type) || variant_instance_of(value, float_type))
-                return ok_outcome(value);
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "positive num only works for int / float values"
-            ));
+execution_outcome execute_tail_call(expression *call_expr, exec_context *ctx) {
+    // the resolver marks only calls of non members, with a list of arguments
+    expression *call_target_expr = call_expr->per_type.operation.operand1;
+    if (bound_built_in(call_target_expr) != NULL)
+        return make_function_call(call_target_expr, call_expr->per_type.operation.operand2, NULL, call_expr->token->origin, ctx);
 
-        case OP_NEGATIVE_NUM:
-            if (variant_instance_of(value, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(value) * -1));
-            if (variant_instance_of(value, float_type))
-                return ok_outcome(new_float_variant(float_variant_as_float(value) * -1));
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "negative num only works for int / float values"
-            ));
+    execution_outcome ex = retrieve_value(call_target_expr, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    variant *call_target = ex.result;
 
-        case OP_LOGICAL_NOT:
-            // let's avoid implicit conversion to bool for now.
-            if (variant_instance_of(value, bool_type))
-                return ok_outcome(new_bool_variant(!bool_variant_as_bool(value)));
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "logical-not only works for bool values"
-            ));
+    int argc;
+    variant **argv;
+    ex = push_arguments(call_expr->per_type.operation.operand2, &argc, &argv, ctx);
+    if (ex.excepted || ex.failed) return ex;
 
-        case OP_BITWISE_NOT:
-            if (variant_instance_of(value, int_type))
-                return ok_outcome(new_int_variant(~int_variant_as_int(value)));
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "bitwise-not only works for int values"
-            ));
-    }
+    ex = defer_tail_call(call_target, argc, argv, call_target_expr->token->origin, ctx);
+    exec_context_pop_arguments(ctx, argc);
+    return ex;
+}
+
+execution_outcome calculate_unary_expression(expression *op_expr, variant *value, exec_context *ctx) {
+    return unary_operations[op_expr->op](op_expr, value);
+}
+
+execution_outcome calculate_binary_expression(expression *op_expr, variant *v1, variant *v2, exec_context *ctx) {
+    binary_operation_func handler = op_expr->feedback.handler;
+    if (handler == NULL)
+        handler = observe_binary_operands(op_expr, v1, v2);
+    return handler(op_expr, v1, v2);
+}
+
+unary_operation_func unary_operation_for(operator_type op) {
+    return unary_operations[op];
+}
 
+binary_operation_func binary_operation_for(operator_type op) {
+    return binary_operations[op];
+}
+
+static execution_outcome unknown_unary_operation(expression *op_expr, variant *value) {
     return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
         "Unknown unary operator type %s", operator_type_name(op_expr->type)));
 }
 
-static execution_outcome calculate_binary_expression(expression *op_expr, variant *v1, variant *v2, exec_context *ctx) {
-    switch (op_expr->op) {
-        case OP_MULTIPLY:
-            if (variant_instance_of(v1, int_type) && variant_instance_of(v2, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) * int_variant_as_int(v2)));
-            if (variant_instance_of(v1, float_type) && variant_instance_of(v2, float_type))
-                return ok_outcome(new_float_variant(float_variant_as_float(v1) * float_variant_as_float(v2)));
-            if (variant_instance_of(v1, str_type) && variant_instance_of(v2, int_type)) {
-                str *tmp = new_str();
-                for (int i = 0; i < int_variant_as_int(v2); i++)
-                    str_adds(tmp, str_variant_as_str(v1));
-                return ok_outcome(new_str_variant(str_cstr(tmp)));
-            }
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "multiplication is only supported in int/float types"
-            ));
+static execution_outcome positive_num(expression *op_expr, variant *value) {
+    if (variant_instance_of(value, int_type) || variant_instance_of(value, float_type))
+        return ok_outcome(value);
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "positive num only works for int / float values"
+    ));
+}
 
-        case OP_DIVIDE:
-            if (variant_instance_of(v1, int_type)) {
-                int denominator = int_variant_as_int(v2);
-                if (denominator == 0)
-                    return exception_outcome(new_exception_variant_at(
-                        op_expr->token->origin, NULL,
-                        "division by zero not possible in integers"
-                    ));
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) / denominator));
-            }
-            if (variant_instance_of(v1, float_type)) {
-                // in floats, the result is "infinity"
-                return ok_outcome(new_float_variant(float_variant_as_float(v1) / float_variant_as_float(v2)));
-            }
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "division is only supported in int/float types"
-            ));
+static execution_outcome negative_num(expression *op_expr, variant *value) {
+    if (variant_instance_of(value, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(value) * -1));
+    if (variant_instance_of(value, float_type))
+        return ok_outcome(new_float_variant(float_variant_as_float(value) * -1));
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "negative num only works for int / float values"
+    ));
+}
 
-        case OP_MODULO:
-            if (variant_instance_of(v1, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) % int_variant_as_int(v2)));
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "modulo is only supported in int types"
-            ));
+static execution_outcome logical_not(expression *op_expr, variant *value) {
+    // let's avoid implicit conversion to bool for now.
+    if (variant_instance_of(value, bool_type))
+        return ok_outcome(new_bool_variant(!bool_variant_as_bool(value)));
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "logical-not only works for bool values"
+    ));
+}
 
-        case OP_ADD:
-            if (variant_instance_of(v1, int_type) && variant_instance_of(v2, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) + int_variant_as_int(v2)));
-            if (variant_instance_of(v1, float_type) && variant_instance_of(v2, float_type))
-                return ok_outcome(new_float_variant(float_variant_as_float(v1) + float_variant_as_float(v2)));
-            if (variant_instance_of(v1, str_type) && variant_instance_of(v2, str_type)) {
-                str *str = new_str();
-                str_adds(str, str_variant_as_str(v1));
-                str_adds(str, str_variant_as_str(v2));
-                variant *v = new_str_variant(strdup(str_cstr(str)));
-                str_free(str);
-                return ok_outcome(v);
-            }
-            // how about adding items to a list???
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "addition is only supported in int, float, string types"
-            ));
+static execution_outcome bitwise_not(expression *op_expr, variant *value) {
+    if (variant_instance_of(value, int_type))
+        return ok_outcome(new_int_variant(~int_variant_as_int(value)));
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "bitwise-not only works for int values"
+    ));
+}
 
-        case OP_SUBTRACT:
-            if (variant_instance_of(v1, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) - int_variant_as_int(v2)));
-            if (variant_instance_of(v1, float_type))
-                return ok_outcome(new_float_variant(float_variant_as_float(v1) - float_variant_as_float(v2)));
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "subtraction is only supported in int/float types"
-            ));
+static execution_outcome unknown_binary_operation(expression *op_expr, variant *v1, variant *v2) {
+    return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
+        "Unknown binary operator type %s", operator_type_name(op_expr->type)));
+}
 
-        case OP_LSHIFT:
-            if (variant_instance_of(v1, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) << int_variant_as_int(v2)));
-            return exception_outcome(new_exception_variant_at(
-                op_expr->token->origin, NULL,
-                "left shift is only supported in int types"
-            ));
+static execution_outcome multiply(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type) && variant_instance_of(v2, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) * int_variant_as_int(v2)));
+    if (variant_instance_of(v1, float_type) && variant_instance_of(v2, float_type))
+        return ok_outcome(new_float_variant(float_variant_as_float(v1) * float_variant_as_float(v2)));
+    if (variant_instance_of(v1, str_type) && variant_instance_of(v2, int_type)) {
+        str *tmp = new_str();
+        for (int i = 0; i < int_variant_as_int(v2); i++)
+            str_adds(tmp, str_variant_as_str(v1));
+        return ok_outcome(new_str_variant(str_cstr(tmp)));
+    }
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "multiplication is only supported in int/float types"
+    ));
+}
 
-        case OP_RSHIFT:
-            if (variant_instance_of(v1, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) >> int_variant_as_int(v2)));
+static execution_outcome divide(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type)) {
+        int denominator = int_variant_as_int(v2);
+        if (denominator == 0)
             return exception_outcome(new_exception_variant_at(
                 op_expr->token->origin, NULL,
-                "right shift is only supported in int types"
+                "division by zero not possible in integers"
             ));
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) / denominator));
+    }
+    if (variant_instance_of(v1, float_type)) {
+        // in floats, the result is "infinity"
+        return ok_outcome(new_float_variant(float_variant_as_float(v1) / float_variant_as_float(v2)));
+    }
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "division is only supported in int/float types"
+    ));
+}
 
-        case OP_LESS_THAN:      return calculate_comparison(op_expr, COMP_LT, v1, v2);
-        case OP_LESS_EQUAL:     return calculate_comparison(op_expr, COMP_LE, v1, v2);
-        case OP_GREATER_THAN:   return calculate_comparison(op_expr, COMP_GT, v1, v2);
-        case OP_GREATER_EQUAL:  return calculate_comparison(op_expr, COMP_GE, v1, v2);
-        case OP_EQUAL:          return calculate_comparison(op_expr, COMP_EQ, v1, v2);
-        case OP_NOT_EQUAL:      return calculate_comparison(op_expr, COMP_NE, v1, v2);
-
-        case OP_BITWISE_AND:
-            if (variant_instance_of(v1, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) & int_variant_as_int(v2)));
-            return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
-                "bitwise operations only supported in int types"));
-
-        case OP_BITWISE_XOR:
-            if (variant_instance_of(v1, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) ^ int_variant_as_int(v2)));
-            return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
-                "bitwise operations only supported in int types"));
-
-        case OP_BITWISE_OR:
-            if (variant_instance_of(v1, int_type))
-                return ok_outcome(new_int_variant(int_variant_as_int(v1) | int_variant_as_int(v2)));
-            return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
-                "bitwise operations only supported in int types"));
-
-        case OP_LOGICAL_AND:
-            // we could do shorthand here...
-            if (variant_instance_of(v1, bool_type) && variant_instance_of(v2, bool_type))
-                return ok_outcome(new_bool_variant(bool_variant_as_bool(v1) && bool_variant_as_bool(v2)));
-            return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
-                "logical operations only supported in bool types"));
-            
-        case OP_LOGICAL_OR:
-            // we could do shorthand here...
-            if (variant_instance_of(v1, bool_type) && variant_instance_of(v2, bool_type))
-                return ok_outcome(new_bool_variant(bool_variant_as_bool(v1) || bool_variant_as_bool(v2)));
-            return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
-                "logical operations only supported in bool types"));
-
-        case OP_SHORT_IF:
-            if (!variant_instance_of(v1, bool_type))
-                return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
-                    "shorthand-if operator_type requires boolean condition"));
-            bool passed = bool_variant_as_bool(v1);
-            if (!variant_instance_of(v2, list_type))
-                return failed_outcome("shorthand-if operator_type was expecting a list of 2 arguments, maybe parsing has a bug?");
-            list *values_pair = list_variant_as_list(v2);
-            if (list_length(values_pair) != 2)
-                return failed_outcome("shorthand-if operator_type was expecting exactly two arguments in the list, maybe parsing has a bug?");
-            return ok_outcome(list_get(values_pair, passed ? 0 : 1));
+static execution_outcome modulo(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) % int_variant_as_int(v2)));
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "modulo is only supported in int types"
+    ));
+}
+
+static execution_outcome add(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type) && variant_instance_of(v2, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) + int_variant_as_int(v2)));
+    if (variant_instance_of(v1, float_type) && variant_instance_of(v2, float_type))
+        return ok_outcome(new_float_variant(float_variant_as_float(v1) + float_variant_as_float(v2)));
+    if (variant_instance_of(v1, str_type) && variant_instance_of(v2, str_type)) {
+        variant *v = new_str_variant(NULL);
+        str_variant_append(v, v1);
+        str_variant_append(v, v2);
+        return ok_outcome(v);
     }
+    // how about adding items to a list???
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "addition is only supported in int, float, string types"
+    ));
+}
+
+static execution_outcome subtract(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) - int_variant_as_int(v2)));
+    if (variant_instance_of(v1, float_type))
+        return ok_outcome(new_float_variant(float_variant_as_float(v1) - float_variant_as_float(v2)));
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "subtraction is only supported in int/float types"
+    ));
+}
 
+static execution_outcome left_shift(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) << int_variant_as_int(v2)));
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "left shift is only supported in int types"
+    ));
+}
+
+static execution_outcome right_shift(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) >> int_variant_as_int(v2)));
+    return exception_outcome(new_exception_variant_at(
+        op_expr->token->origin, NULL,
+        "right shift is only supported in int types"
+    ));
+}
+
+static execution_outcome less_than(expression *op_expr, variant *v1, variant *v2)     { return calculate_comparison(op_expr, COMP_LT, v1, v2); }
+static execution_outcome less_equal(expression *op_expr, variant *v1, variant *v2)    { return calculate_comparison(op_expr, COMP_LE, v1, v2); }
+static execution_outcome greater_than(expression *op_expr, variant *v1, variant *v2)  { return calculate_comparison(op_expr, COMP_GT, v1, v2); }
+static execution_outcome greater_equal(expression *op_expr, variant *v1, variant *v2) { return calculate_comparison(op_expr, COMP_GE, v1, v2); }
+static execution_outcome equal(expression *op_expr, variant *v1, variant *v2)         { return calculate_comparison(op_expr, COMP_EQ, v1, v2); }
+static execution_outcome not_equal(expression *op_expr, variant *v1, variant *v2)     { return calculate_comparison(op_expr, COMP_NE, v1, v2); }
+
+static execution_outcome bitwise_and(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) & int_variant_as_int(v2)));
     return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
-        "Unknown binary operator type %s", operator_type_name(op_expr->type)));
+        "bitwise operations only supported in int types"));
+}
+
+static execution_outcome bitwise_xor(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) ^ int_variant_as_int(v2)));
+    return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
+        "bitwise operations only supported in int types"));
+}
+
+static execution_outcome bitwise_or(expression *op_expr, variant *v1, variant *v2) {
+    if (variant_instance_of(v1, int_type))
+        return ok_outcome(new_int_variant(int_variant_as_int(v1) | int_variant_as_int(v2)));
+    return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
+        "bitwise operations only supported in int types"));
+}
+
+execution_outcome check_logical_operand(expression *op_expr, variant *value) {
+    if (variant_instance_of(value, bool_type))
+        return ok_outcome(value);
+    return exception_outcome(new_exception_variant_at(op_expr->token->origin, NULL,
+        "logical operations only supported in bool types"));
+}
+
+bool logical_operand_decides(expression *op_expr, variant *value) {
+    // false decides an AND, true decides an OR, the second operand is not evaluated
+    return bool_variant_as_bool(value) == (op_expr->op == OP_LOGICAL_OR);
 }
 
-static execution_outcome expression_function_callable_executor(
-    list *arg_values, 
+static execution_outcome retrieve_logical(expression *op_expr, exec_context *ctx) {
+    execution_outcome ex = execute_expression(op_expr->per_type.operation.operand1, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    ex = check_logical_operand(op_expr, ex.result);
+    if (ex.excepted || logical_operand_decides(op_expr, ex.result)) return ex;
+
+    ex = execute_expression(op_expr->per_type.operation.operand2, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    return check_logical_operand(op_expr, ex.result);
+}
+
+static execution_outcome retrieve_short_if(expression *op_expr, exec_context *ctx) {
+    // the parser gives the two branches as a list, only the chosen one is evaluated
+    expression *condition = op_expr->per_type.operation.operand1;
+    list *branches = op_expr->per_type.operation.operand2->per_type.list_;
+
+    execution_outcome ex = execute_expression(condition, ctx);
+    if (ex.excepted || ex.failed) return ex;
+    if (!variant_instance_of(ex.result, bool_type))
+        return exception_outcome(new_exception_variant_at(condition->token->origin, NULL,
+            "condition expressions must yield boolean result"));
+
+    return execute_expression(list_get(branches, bool_variant_as_bool(ex.result) ? 0 : 1), ctx);
+}
+
+static void initialize_operation_tables() {
+    for (int op = 0; op < OP_MAX_VALUE; op++) {
+        unary_operations[op] = unknown_unary_operation;
+        binary_operations[op] = unknown_binary_operation;
+    }
+
+    unary_operations[OP_POSITIVE_NUM] = positive_num;
+    unary_operations[OP_NEGATIVE_NUM] = negative_num;
+    unary_operations[OP_LOGICAL_NOT]  = logical_not;
+    unary_operations[OP_BITWISE_NOT]  = bitwise_not;
+
+    binary_operations[OP_MULTIPLY]      = multiply;
+    binary_operations[OP_DIVIDE]        = divide;
+    binary_operations[OP_MODULO]        = modulo;
+    binary_operations[OP_ADD]           = add;
+    binary_operations[OP_SUBTRACT]      = subtract;
+    binary_operations[OP_LSHIFT]        = left_shift;
+    binary_operations[OP_RSHIFT]        = right_shift;
+    binary_operations[OP_LESS_THAN]     = less_than;
+    binary_operations[OP_LESS_EQUAL]    = less_equal;
+    binary_operations[OP_GREATER_THAN]  = greater_than;
+    binary_operations[OP_GREATER_EQUAL] = greater_equal;
+    binary_operations[OP_EQUAL]         = equal;
+    binary_operations[OP_NOT_EQUAL]     = not_equal;
+    binary_operations[OP_BITWISE_AND]   = bitwise_and;
+    binary_operations[OP_BITWISE_XOR]   = bitwise_xor;
+    binary_operations[OP_BITWISE_OR]    = bitwise_or;
+}
+
+execution_outcome expression_function_callable_executor(
+    int argc,
+    variant **argv,
     void *ast_node, 
     variant *this_obj,
     dict *captured_values, // optional for closures
@@ -674,39 +925,51 @@ static execution_outcome expression_function_callable_executor(
 ) {
     expression *expr = (expression *)ast_node;
 
-    list *arg_names = expr->per_type.func.arg_names;
-    if (list_length(arg_values) < list_length(arg_names)) {
-        return exception_outcome(new_exception_variant_at(
-            expr->token->origin, NULL,
-            "%s() expected %d arguments, got %d", expr->per_type.func.name, list_length(arg_names), list_length(arg_values)
-        ));
-    }
-
-    stack_frame *frame = new_stack_frame(expr->per_type.func.name, expr->token->origin);
-    stack_frame_initialization(frame, arg_names, arg_values, this_obj, captured_values);
-    exec_context_push_stack_frame(ctx, frame);
-
-    execution_outcome result = execute_statements(expr->per_type.func.statements, ctx);
-    
-    // even if an exception was raised, we still must pop the stack frame
-    exec_context_pop_stack_frame(ctx);
-
-    return result;
+    return execute_user_function(
+        expr->per_type.func.name,
+        expr->per_type.func.statements,
+        expr->per_type.func.arg_names,
+        expr->per_type.func.layout,
+        argc,
+        argv,
+        this_obj,
+        captured_values,
+        call_origin == NULL ? expr->token->origin : call_origin,
+        ctx);
 }
 
+// the cells of the enclosing frame, for the names the closure uses
 dict *capture_variables_for_closure(expression *expr, exec_context *ctx) {
-    if (stack_empty(ctx->stack_frames))
-        return NULL;
-
-    stack_frame *f = stack_peek(ctx->stack_frames);
-    if (f->symbols == NULL || dict_is_empty(f->symbols))
+    stack_frame *f = exec_context_get_curr_stack_frame(ctx);
+    if (f == NULL || expr->per_type.func.captures == NULL)
         return NULL;
 
-    dict *captured_variables = new_dict(variant_item_info);
-    for_dict(f->symbols, it, cstr, key) {
-        variant *v = variant_clone(dict_get(f->symbols, key));
-        dict_set(captured_variables, key, v);
+    dict *captured_cells = new_dict(variant_item_info);
+    for_list(expr->per_type.func.captures, it, cstr, name) {
+        variant *cell = stack_frame_capture_cell(f, name);
+        if (cell != NULL)
+            dict_set(captured_cells, name, cell);
     }
 
-    return captured_variables;
+    return captured_cells;
+}
+
+variant *create_closure_variant(expression *func_expr, exec_context *ctx) {
+    // closures capturing nothing are all the same, they are created once
+    if (func_expr->per_type.func.captures == NULL && func_expr->constant != NULL)
+        return func_expr->constant;
+
+    variant *closure = new_callable_variant(new_callable(
+        func_expr->per_type.func.name == NULL ? "(anonymous)" : func_expr->per_type.func.name,
+        expression_function_callable_executor, 
+        func_expr,
+        NULL,
+        capture_variables_for_closure(func_expr, ctx)
+    ));
+
+    if (func_expr->per_type.func.captures == NULL) {
+        closure->_references_count = VARIANT_STATICALLY_ALLOCATED;
+        func_expr->constant = closure;
+    }
+    return closure;
 }
\ No newline at end of file
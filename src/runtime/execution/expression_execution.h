@@ -1,13 +1,50 @@
 #ifndef _EXPRESSION_EXECUTION_H
 #define _EXPRESSION_EXECUTION_H
 
+#include "../variants/_variants.h"
 #include "../../containers/_containers.h"
 #include "../../entities/_entities.h"
 
+enum modify_and_store {
+    MAS_ADD, MAS_SUB, MAS_MUL, MAS_DIV, MAS_MOD,
+    MAS_RSH, MAS_LSH, MAS_AND, MAS_OR, MAS_XOR,
+};
+
+typedef execution_outcome (*unary_operation_func)(expression *op_expr, variant *value);
+typedef execution_outcome (*binary_operation_func)(expression *op_expr, variant *v1, variant *v2);
 
 void initialize_expression_execution();
 
 execution_outcome execute_expression(expression *e, exec_context *ctx);
 
+// value level operations, shared with the other execution engines
+execution_outcome calculate_unary_expression(expression *op_expr, variant *value, exec_context *ctx);
+execution_outcome calculate_binary_expression(expression *op_expr, variant *v1, variant *v2, exec_context *ctx);
+unary_operation_func unary_operation_for(operator_type op);
+binary_operation_func binary_operation_for(operator_type op);
+execution_outcome check_logical_operand(expression *op_expr, variant *value);
+bool logical_operand_decides(expression *op_expr, variant *value);
+execution_outcome calculate_modification(enum modify_and_store op, variant *original, variant *operand, expression *rvalue);
+execution_outcome store_symbol_value(const char *name, variant *value, exec_context *ctx);
+execution_outcome resolve_identifier_value(expression *identifier, exec_context *ctx);
+execution_outcome store_identifier_value(expression *identifier, variant *value, exec_context *ctx);
+execution_outcome get_element_value(variant *container, variant *element);
+execution_outcome get_member_value(variant *container, expression *member_expr, exec_context *ctx);
+execution_outcome set_member_value(variant *container, expression *member_expr, variant *value, exec_context *ctx);
+execution_outcome call_member_value(variant *container, expression *member_expr, int argc, variant **argv, origin *call_origin, exec_context *ctx);
+bool inlined_call_applies(inlined_call *inlined, variant *target, expression *member_expr, exec_context *ctx);
+variant *create_closure_variant(expression *func_expr, exec_context *ctx);
+execution_outcome execute_tail_call(expression *call_expr, exec_context *ctx);
+
+execution_outcome expression_function_callable_executor(
+    int argc,
+    variant **argv,
+    void *ast_node, 
+    variant *this_obj,
+    dict *captured_values, // optional for closures
+    origin *call_origin, // source of call
+    exec_context *ctx
+);
+
 
 #endif
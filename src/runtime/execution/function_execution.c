@@ -1,39 +1,141 @@
-
+#include <stdlib.h>
+#include <string.h>
 #include "function_execution.h"
 #include "expression_execution.h"
 #include "statement_execution.h"
 #include "exec_context.h"
 #include "stack_frame.h"
+#include "../../utils/data_types/callable.h"
+
+// what a callable runs, if it is a function of the script
+typedef struct user_function {
+    const char *name;
+    list *statements;
+    list *arg_names;
+    frame_layout *layout;
+    variant *this_obj;
+    dict *captured_values;
+} user_function;
+
+static bool get_user_function(variant *target, user_function *func);
+
 
 execution_outcome execute_user_function(
     const char *name,
     list *func_statements, 
     list *func_arg_names,
-    list *arg_values, 
+    frame_layout *func_layout,
+    int argc,
+    variant **argv,
     variant *this_obj,
+    dict *captured_values,
     origin *call_origin,
     exec_context *ctx) {
     
     // here we have opportunity for improvements
     // named arguments, or default values, variadic args etc.
 
-    if (list_length(arg_values) < list_length(func_arg_names)) {
+    if (argc < list_length(func_arg_names)) {
         return exception_outcome(new_exception_variant_at(
             call_origin, NULL, 
-            "%s() expected %d arguments, got %d", name, list_length(func_arg_names), list_length(arg_values)
+            "%s() expected %d arguments, got %d", name, list_length(func_arg_names), argc
+        ));
+    }
+    if (exec_context_call_too_deep(ctx)) {
+        return exception_outcome(new_exception_variant_at(
+            call_origin, NULL,
+            "%s(): maximum call depth exceeded, at %d nested calls", name, exec_context_get_call_depth(ctx)
         ));
     }
 
-    stack_frame *frame = new_stack_frame(name, call_origin);
-    stack_frame_initialization(frame, func_arg_names, arg_values, this_obj, NULL);
-    exec_context_push_stack_frame(ctx, frame);
+    stack_frame *frame = exec_context_push_stack_frame(ctx, name, call_origin, func_layout);
+    stack_frame_initialization(frame, func_arg_names, argc, argv, this_obj, captured_values);
 
     execution_outcome result = execute_statements(func_statements, ctx);
-    
-    // we could run local statistics or clean up local variables.
-    
+
+    // calls in tail position run here, in the same frame, instead of nesting
+    while (ctx->tail_call.target != NULL) {
+        variant *target = ctx->tail_call.target;
+        int tail_argc = ctx->tail_call.argc;
+        origin *tail_call_origin = ctx->tail_call.call_origin;
+        ctx->tail_call.target = NULL;
+        if (result.excepted || result.failed)
+            break;
+
+        user_function func;
+        if (!get_user_function(target, &func)) {
+            exec_context_pop_stack_frame(ctx);
+            // the call may defer tail calls of its own, reusing the buffer
+            variant **args = exec_context_push_arguments(ctx, tail_argc);
+            if (tail_argc > 0)
+                memcpy(args, ctx->tail_call.argv, tail_argc * sizeof(variant *));
+            result = variant_call(target, tail_argc, args, NULL, tail_call_origin, ctx);
+            exec_context_pop_arguments(ctx, tail_argc);
+            return result;
+        }
+        if (tail_argc < list_length(func.arg_names)) {
+            result = exception_outcome(new_exception_variant_at(
+                tail_call_origin, NULL, 
+                "%s() expected %d arguments, got %d", func.name, list_length(func.arg_names), tail_argc
+            ));
+            break;
+        }
+
+        frame = exec_context_reuse_stack_frame(ctx, func.name, tail_call_origin, func.layout);
+        stack_frame_initialization(frame, func.arg_names, tail_argc, ctx->tail_call.argv, func.this_obj, func.captured_values);
+        result = execute_statements(func.statements, ctx);
+    }
+
+    // even if an exception was raised, we still must pop the stack frame
+    if (result.excepted)
+        exception_variant_add_trace(result.exception_thrown, frame->func_name, frame->call_origin);
     exec_context_pop_stack_frame(ctx);
 
     return result;
 }
 
+execution_outcome defer_tail_call(variant *target, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
+    if (argc > ctx->tail_call.argv_capacity) {
+        ctx->tail_call.argv = realloc(ctx->tail_call.argv, argc * sizeof(variant *));
+        ctx->tail_call.argv_capacity = argc;
+    }
+    if (argc > 0)
+        memcpy(ctx->tail_call.argv, argv, argc * sizeof(variant *));
+    ctx->tail_call.target = target;
+    ctx->tail_call.argc = argc;
+    ctx->tail_call.call_origin = call_origin;
+
+    // the value returned is ignored, the call yields the result
+    return ok_outcome(void_singleton);
+}
+
+static bool get_user_function(variant *target, user_function *func) {
+    if (!variant_instance_of(target, callable_type))
+        return false;
+
+    callable *c = callable_variant_as_callable(target);
+    callable_handler *handler = callable_get_handler(c);
+
+    if (handler == statement_function_callable_executor) {
+        statement *stmt = callable_ast_node(c);
+        func->name = stmt->per_type.function.name;
+        func->statements = stmt->per_type.function.statements;
+        func->arg_names = stmt->per_type.function.arg_names;
+        func->layout = stmt->per_type.function.layout;
+        func->this_obj = NULL;
+        func->captured_values = NULL;
+        return true;
+
+    } else if (handler == expression_function_callable_executor) {
+        expression *expr = callable_ast_node(c);
+        func->name = expr->per_type.func.name;
+        func->statements = expr->per_type.func.statements;
+        func->arg_names = expr->per_type.func.arg_names;
+        func->layout = expr->per_type.func.layout;
+        func->this_obj = callable_this_obj(c);
+        func->captured_values = callable_captured_values(c);
+        return true;
+    }
+
+    return false;
+}
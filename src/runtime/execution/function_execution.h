@@ -3,16 +3,23 @@
 
 #include "../../containers/_containers.h"
 #include "../variants/_variants.h"
+#include "../../entities/frame_layout.h"
 
 
 execution_outcome execute_user_function(
     const char *name,
     list *func_statements, 
     list *func_arg_names,
-    list *arg_values, 
+    frame_layout *func_layout,
+    int argc,
+    variant **argv,
     variant *this_obj,
+    dict *captured_values,
     origin *call_origin,
     exec_context *ctx);
 
+// returns of calls in tail position leave the call to execute_user_function()
+execution_outcome defer_tail_call(variant *target, int argc, variant **argv, origin *call_origin, exec_context *ctx);
+
 
 #endif
@@ -2,58 +2,127 @@
 #include <string.h>
 #include "stack_frame.h"
 #include "../../utils/cstr.h"
+#include "../../utils/intern.h"
 
 
-stack_frame *new_stack_frame(const char *func_name, origin *call_origin) {
+stack_frame *new_stack_frame() {
     stack_frame *f = malloc(sizeof(stack_frame));
+    memset(f, 0, sizeof(stack_frame));
     f->item_info = stack_frame_item_info;
+    return f;
+}
+
+// slots are cleared, layout->slots_count of them
+void stack_frame_prepare(stack_frame *f, const char *func_name, origin *call_origin, frame_layout *layout, variant **slots) {
     f->func_name = func_name;
+    f->func_stmt = NULL;
+    f->func_expr = NULL;
     f->call_origin = call_origin;
-    f->symbols = new_dict(variant_item_info);
+    f->layout = layout;
+    f->slots = slots;
+    if (f->symbols != NULL)
+        dict_clear(f->symbols);
     f->method_owning_class = NULL;
-    return f;
+    f->captured_values = NULL;
+
+    // each call gets its own cells, for the closures it creates
+    if (layout != NULL && layout->captured != NULL) {
+        for (int i = 0; i < layout->slots_count; i++)
+            if (layout->captured[i]) slots[i] = new_cell_variant(NULL);
+    }
 }
 
-void stack_frame_initialization(stack_frame *f, list *arg_names, list *arg_values, variant *this_obj, dict *captured_values) {
+// the value of a slot, looking through the cell of captured slots
+static variant *slot_value(stack_frame *f, int slot) {
+    variant *v = f->slots[slot];
+    if (v != NULL && f->layout->captured != NULL && f->layout->captured[slot])
+        v = cell_variant_get(v);
+    return v;
+}
+
+static void set_slot_value(stack_frame *f, int slot, variant *v) {
+    if (f->layout->captured != NULL && f->layout->captured[slot])
+        cell_variant_set(f->slots[slot], v);
+    else
+        f->slots[slot] = v;
+}
 
-    if (arg_names != NULL && arg_values != NULL) {
-        for (int i = 0; i < list_length(arg_names); i++) {
-            stack_frame_register_symbol(f, list_get(arg_names, i), list_get(arg_values, i));
+static variant *captured_value(stack_frame *f, const char *name) {
+    if (f->captured_values == NULL)
+        return NULL;
+    variant *cell = dict_get(f->captured_values, name);
+    return cell == NULL ? NULL : cell_variant_get(cell);
+}
+
+void stack_frame_initialization(stack_frame *f, list *arg_names, int argc, variant **argv, variant *this_obj, dict *captured_values) {
+
+    if (arg_names != NULL && argv != NULL) {
+        int i = 0;
+        for_list(arg_names, it, const_char, name) {
+            if (i >= argc)
+                break;
+            // the resolver places arguments in the first slots
+            if (f->layout != NULL && i < f->layout->slots_count && f->layout->names[i] == name)
+                set_slot_value(f, i, argv[i]);
+            else
+                stack_frame_register_symbol(f, name, argv[i]);
+            i++;
         }
     }
 
     if (this_obj != NULL) {
-        stack_frame_register_symbol(f, "this", this_obj);
-        f->method_owning_class = this_obj->_type;
+        static const char *this_symbol = NULL;
+        if (this_symbol == NULL)
+            this_symbol = intern("this");
+        stack_frame_register_symbol(f, this_symbol, this_obj);
+        f->method_owning_class = variant_type_of(this_obj);
     }
 
     f->captured_values = captured_values;
 }
 
-
 variant *stack_frame_resolve_symbol(stack_frame *f, const char *name) {
-    if (dict_has(f->symbols, name))
+    int slot = frame_layout_find(f->layout, name);
+    if (slot >= 0 && slot_value(f, slot) != NULL)
+        return slot_value(f, slot);
+
+    if (f->symbols != NULL && dict_has(f->symbols, name))
         return dict_get(f->symbols, name);
 
-    if (f->captured_values != NULL && dict_has(f->captured_values, name))
-        return dict_get(f->captured_values, name);
-    
-    return NULL;
+    return captured_value(f, name);
 }
 
 bool stack_frame_symbol_exists(stack_frame *f, const char *name) {
-    if (dict_has(f->symbols, name))
+    int slot = frame_layout_find(f->layout, name);
+    if (slot >= 0 && slot_value(f, slot) != NULL)
         return true;
 
-    if (f->captured_values != NULL && dict_has(f->captured_values, name))
+    if (f->symbols != NULL && dict_has(f->symbols, name))
         return true;
-    
-    return false;
+
+    return captured_value(f, name) != NULL;
 }
 
 failable stack_frame_register_symbol(stack_frame *f, const char *name, variant *v) {
+    int slot = frame_layout_find(f->layout, name);
+    if (slot >= 0) {
+        if (slot_value(f, slot) != NULL)
+            return failed("Symbol %s already exists", name);
+        set_slot_value(f, slot, v);
+        return ok();
+    }
 
-    if (dict_has(f->symbols, name))
+    // symbols shared with the enclosing function may be assigned here first
+    if (f->captured_values != NULL && dict_has(f->captured_values, name)) {
+        if (captured_value(f, name) != NULL)
+            return failed("Symbol %s already exists", name);
+        cell_variant_set(dict_get(f->captured_values, name), v);
+        return ok();
+    }
+
+    if (f->symbols == NULL)
+        f->symbols = new_dict(variant_item_info);
+    else if (dict_has(f->symbols, name))
         return failed("Symbol %s already exists", name);
     
     dict_set(f->symbols, name, v);
@@ -61,13 +130,19 @@ failable stack_frame_register_symbol(stack_frame *f, const char *name, variant *
 }
 
 failable stack_frame_update_symbol(stack_frame *f, const char *name, variant *v) {
-    if (dict_has(f->symbols, name)) {
+    int slot = frame_layout_find(f->layout, name);
+    if (slot >= 0 && slot_value(f, slot) != NULL) {
+        set_slot_value(f, slot, v);
+        return ok();
+    }
+
+    if (f->symbols != NULL && dict_has(f->symbols, name)) {
         dict_set(f->symbols, name, v);
         return ok();
     }
 
-    if (f->captured_values != NULL && dict_has(f->captured_values, name)) {
-        dict_set(f->captured_values, name, v);
+    if (captured_value(f, name) != NULL) {
+        cell_variant_set(dict_get(f->captured_values, name), v);
         return ok();
     }
 
@@ -75,7 +150,13 @@ failable stack_frame_update_symbol(stack_frame *f, const char *name, variant *v)
 }
 
 failable stack_frame_unregister_symbol(stack_frame *f, const char *name) {
-    if (!dict_has(f->symbols, name))
+    int slot = frame_layout_find(f->layout, name);
+    if (slot >= 0 && slot_value(f, slot) != NULL) {
+        set_slot_value(f, slot, NULL);
+        return ok();
+    }
+
+    if (f->symbols == NULL || !dict_has(f->symbols, name))
         return failed("Symbol %s does not exist", name);
     dict_del(f->symbols, name);
     return ok();
@@ -90,6 +171,37 @@ bool stack_frame_is_method_owned_by(stack_frame *f, variant_type *class_type) {
         || variants_are_equal((variant *)class_type, (variant *)f->method_owning_class);
 }
 
+// returns a new dict with all the symbols of the frame, slotted or not
+dict *stack_frame_collect_symbols(stack_frame *f) {
+    dict *symbols = new_dict(variant_item_info);
+
+    if (f->layout != NULL) {
+        for (int i = 0; i < f->layout->slots_count; i++) {
+            if (slot_value(f, i) != NULL)
+                dict_set(symbols, f->layout->names[i], slot_value(f, i));
+        }
+    }
+
+    if (f->symbols != NULL) {
+        for_dict(f->symbols, it, cstr, name)
+            dict_set(symbols, name, dict_get(f->symbols, name));
+    }
+
+    return symbols;
+}
+
+// the cell holding a symbol shared with closures, NULL if it is not shared
+variant *stack_frame_capture_cell(stack_frame *f, const char *name) {
+    int slot = frame_layout_find(f->layout, name);
+    if (slot >= 0 && f->layout->captured != NULL && f->layout->captured[slot])
+        return f->slots[slot];
+
+    if (f->captured_values != NULL)
+        return dict_get(f->captured_values, name);
+
+    return NULL;
+}
+
 const void stack_frame_describe(stack_frame *f, str *str) {
     str_adds(str, "stack_frame");
 }
@@ -101,7 +213,7 @@ bool stack_frames_are_equal(stack_frame *a, stack_frame *b) {
 
     if (strcmp(a->func_name, b->func_name) != 0)
         return false;
-    if (!dicts_are_equal(a->symbols, b->symbols))
+    if (!dicts_are_equal(stack_frame_collect_symbols(a), stack_frame_collect_symbols(b)))
         return false;
 
     return true;
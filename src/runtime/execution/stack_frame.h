@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include "../../runtime/variants/_variants.h"
 #include "../../containers/_containers.h"
+#include "../../entities/frame_layout.h"
 #include "stack_frame.h"
 
 typedef struct statement statement;
@@ -19,12 +20,17 @@ struct stack_frame {
     expression *func_expr;
     origin *call_origin;
     variant_type *method_owning_class; // if curr function is a method.
-    dict *symbols;
-    dict *captured_values; // not destroyed when stack_frame is destroyed
+    frame_layout *layout;  // may be NULL, if the function was not resolved
+    variant **slots;       // values of the layout symbols, NULL if not registered, owned by the exec_context
+    dict *symbols;         // symbols without a slot, created when first needed
+    dict *captured_values; // of closures, name -> cell shared with the enclosing frame, not destroyed with the frame
+    unsigned long long young_since; // containers tracked from this gc stamp on cannot be held by the callers
 };
 
-stack_frame *new_stack_frame(const char *func_name, origin *call_origin);
-void stack_frame_initialization(stack_frame *f, list *arg_names, list *arg_values, variant *this_value, dict *captured_values);
+// frames are pooled by the exec_context, and prepared for each call
+stack_frame *new_stack_frame();
+void stack_frame_prepare(stack_frame *f, const char *func_name, origin *call_origin, frame_layout *layout, variant **slots);
+void stack_frame_initialization(stack_frame *f, list *arg_names, int argc, variant **argv, variant *this_value, dict *captured_values);
 
 variant *stack_frame_resolve_symbol(stack_frame *f, const char *name);
 bool stack_frame_symbol_exists(stack_frame *f, const char *name);
@@ -32,6 +38,8 @@ failable stack_frame_register_symbol(stack_frame *f, const char *name, variant *
 failable stack_frame_update_symbol(stack_frame *f, const char *name, variant *v);
 failable stack_frame_unregister_symbol(stack_frame *f, const char *name);
 bool stack_frame_is_method_owned_by(stack_frame *f, variant_type *class_type);
+dict *stack_frame_collect_symbols(stack_frame *f);
+variant *stack_frame_capture_cell(stack_frame *f, const char *name);
 
 const void stack_frame_describe(stack_frame *f, str *str);
 bool stack_frames_are_equal(stack_frame *a, stack_frame *b);
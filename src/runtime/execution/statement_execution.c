@@ -7,26 +7,25 @@
 #include "statement_execution.h"
 #include "function_execution.h"
 #include "class_execution.h"
+#include "vm_execution.h"
+#include "compiled_tree.h"
 
 
 static execution_outcome check_condition(expression *condition, exec_context *ctx);
 static execution_outcome execute_single_statement(statement *stmt, exec_context *ctx, bool *should_break, bool *should_continue, bool *should_return);
 static execution_outcome execute_statements_with_flow(list *statements, exec_context *ctx, bool *should_break, bool *should_continue, bool *should_return);
 static execution_outcome execute_statements_in_loop(expression *condition, list *statements, expression *next, exec_context *ctx, bool *should_return);
+static execution_outcome execute_counted_loop(statement *stmt, exec_context *ctx, bool *should_return);
 static void register_class_in_exec_context(statement *statement, exec_context *ctx);
 
-execution_outcome statement_function_callable_executor(
-    list *arg_values, 
-    void *ast_node, 
-    variant *this_obj, 
-    dict *captured_values, // optional for closures
-    origin *call_origin, // source of call
-    exec_context *ctx
-);
-
 
 // public entry point
 execution_outcome execute_statements(list *statements, exec_context *ctx) {
+    if (ctx->engine == EE_BYTECODE_VM)
+        return vm_execute_statements(statements, ctx);
+    if (ctx->engine == EE_COMPILED_TREE)
+        return compiled_tree_execute_statements(statements, ctx);
+
     bool should_break = false;
     bool should_continue = false;
     bool should_return = false;
@@ -48,8 +47,9 @@ static execution_outcome execute_single_statement(statement *stmt, exec_context
     execution_outcome ex;
     variant *return_value = void_singleton;
 
-    // not all statement types should be checked for debugger
-    if (s_type != ST_EXPRESSION && s_type != ST_FUNCTION) {
+    // the debugger is checked only while stepping or with breakpoints armed,
+    // breakpoint statements enter it whenever it is enabled
+    if (ctx->debugger.instrumented || s_type == ST_BREAKPOINT) {
         if (should_start_debugger(stmt, NULL, ctx)) {
             failable session = run_debugger(stmt, NULL, ctx);
             if (session.failed) return failed_outcome(session.err_msg);
@@ -92,13 +92,16 @@ static execution_outcome execute_single_statement(statement *stmt, exec_context
             ex = execute_expression(stmt->per_type.for_.init, ctx);
             if (ex.excepted || ex.failed)
                 return ex;
-            ex = execute_statements_in_loop(
-                stmt->per_type.for_.condition,
-                stmt->per_type.for_.body_statements,
-                stmt->per_type.for_.next,
-                ctx,
-                should_return
-            );
+            if (stmt->per_type.for_.counted != NULL && !ctx->debugger.enabled)
+                ex = execute_counted_loop(stmt, ctx, should_return);
+            else
+                ex = execute_statements_in_loop(
+                    stmt->per_type.for_.condition,
+                    stmt->per_type.for_.body_statements,
+                    stmt->per_type.for_.next,
+                    ctx,
+                    should_return
+                );
             if (ex.excepted || ex.failed)
                 return ex;
             return_value = ex.result;
@@ -122,7 +125,12 @@ static execution_outcome execute_single_statement(statement *stmt, exec_context
             break;
 
         case ST_RETURN:
-            if (stmt->per_type.return_.value != NULL) {
+            if (stmt->per_type.return_.tail_call) {
+                ex = execute_tail_call(stmt->per_type.return_.value, ctx);
+                if (ex.excepted || ex.failed)
+                    return ex;
+                return_value = ex.result;
+            } else if (stmt->per_type.return_.value != NULL) {
                 ex = execute_expression(stmt->per_type.return_.value, ctx);
                 if (ex.excepted || ex.failed)
                     return ex;
@@ -165,32 +173,28 @@ static execution_outcome execute_single_statement(statement *stmt, exec_context
             }
 
             // finally will run in any case, but will not influence the result.
+            // meanwhile the outcome is held here, collections must wait
             if (stmt->per_type.try_catch.finally_statements != NULL) {
+                ctx->outcomes_held++;
                 ex = execute_statements_with_flow(stmt->per_type.try_catch.finally_statements, ctx, should_break, should_continue, should_return);    
+                ctx->outcomes_held--;
                 if (ex.excepted || ex.failed) return ex;
             }
             return try_catch_outcome;
             break; // useless here.
 
         case ST_THROW:
-            variant *str_result;
-            if (stmt->per_type.throw.exception == NULL) {
-                str_result = new_str_variant("");
-            } else {
+            variant *thrown_value = NULL;
+            if (stmt->per_type.throw.exception != NULL) {
                 ex = execute_expression(stmt->per_type.throw.exception, ctx);
                 if (ex.excepted || ex.failed) return ex;
-                str_result = variant_to_string(ex.result);
+                thrown_value = ex.result;
             }
-            variant *exception = new_exception_variant_at(
-                stmt->token->origin, 
-                NULL, 
-                str_variant_as_str(str_result));
-            variant_drop_ref(str_result);
-            return exception_outcome(exception);
+            return exception_outcome(new_thrown_exception_variant(stmt->token->origin, thrown_value));
             break; // useless
             
         case ST_BREAKPOINT:
-            // ignored in execution, bebugger entry is checked before executing a row.
+            // ignored in execution, debugger entry is checked before executing the statement.
             break;
 
         case ST_CLASS:
@@ -218,6 +222,7 @@ static execution_outcome execute_statements_with_flow(list *statements, exec_con
         return_value = ex.result;
         if (*should_break || *should_continue || *should_return)
             break;
+        exec_context_safe_point(ctx, return_value);
     }
 
     return ok_outcome(return_value);
@@ -241,7 +246,7 @@ static execution_outcome execute_statements_in_loop(expression *pre_condition, l
 
         // "continue" in "for" statements allows the "next" operation to run
         if (should_break) break;
-        if (*should_return) return ok_outcome(return_value);
+        if (*should_return) return ok_outcome(ex.result);
 
         if (next != NULL) {
             ex = execute_expression(next, ctx);
@@ -252,13 +257,98 @@ static execution_outcome execute_statements_in_loop(expression *pre_condition, l
     return ok_outcome(return_value);
 }
 
+static execution_outcome execute_counted_loop(statement *stmt, exec_context *ctx, bool *should_return) {
+    counted_loop *loop = stmt->per_type.for_.counted;
+    list *statements = stmt->per_type.for_.body_statements;
+    execution_outcome ex;
+    int counter, bound;
+
+    if (!counted_loop_start(loop, ctx, &counter, &bound))
+        return execute_statements_in_loop(stmt->per_type.for_.condition, statements, stmt->per_type.for_.next, ctx, should_return);
+
+    while (counted_loop_continues(loop, counter, bound)) {
+        bool should_break = false;
+        bool should_continue = false;
+
+        if (loop->counter_read)
+            counted_loop_store(loop, counter, ctx);
+        ex = execute_statements_with_flow(statements, ctx, &should_break, &should_continue, should_return);
+        if (ex.excepted || ex.failed || *should_return) {
+            counted_loop_store(loop, counter, ctx);
+            return ex;
+        }
+        if (should_break) break;
+        counter += loop->step;
+    }
+
+    counted_loop_store(loop, counter, ctx);
+    return ok_outcome(void_singleton);
+}
+
+bool counted_loop_start(counted_loop *loop, exec_context *ctx, int *counter, int *bound) {
+    // a counter or bound kept in a global or a closure cell can be changed by callees
+    if (!exec_context_slot_is_owned(ctx, loop->counter->slot))
+        return false;
+    if (loop->bound->type == ET_IDENTIFIER && !exec_context_slot_is_owned(ctx, loop->bound->slot))
+        return false;
+
+    variant *v = exec_context_resolve_identifier(ctx, loop->counter->per_type.terminal_data, loop->counter->slot, &loop->counter->cache);
+    if (v == NULL || variant_immediate_tag(v) != VARIANT_TAG_INT)
+        return false;
+    *counter = int_variant_as_int(v);
+
+    if (loop->bound->type == ET_NUMERIC_LITERAL) {
+        *bound = atoi(loop->bound->per_type.terminal_data);
+        return true;
+    }
+    v = exec_context_resolve_identifier(ctx, loop->bound->per_type.terminal_data, loop->bound->slot, &loop->bound->cache);
+    if (v == NULL || variant_immediate_tag(v) != VARIANT_TAG_INT)
+        return false;
+    *bound = int_variant_as_int(v);
+    return true;
+}
+
+bool counted_loop_continues(counted_loop *loop, int counter, int bound) {
+    switch (loop->comparison) {
+        case OP_LESS_THAN:     return counter <  bound;
+        case OP_LESS_EQUAL:    return counter <= bound;
+        case OP_GREATER_THAN:  return counter >  bound;
+        case OP_GREATER_EQUAL: return counter >= bound;
+        case OP_NOT_EQUAL:     return counter != bound;
+    }
+    return false;
+}
+
+void counted_loop_store(counted_loop *loop, int counter, exec_context *ctx) {
+    exec_context_update_identifier(ctx, loop->counter->per_type.terminal_data, loop->counter->slot,
+        &loop->counter->cache, new_int_variant(counter));
+}
+
+execution_outcome counted_loop_test(statement *for_stmt, exec_context *ctx) {
+    counted_loop *loop = for_stmt->per_type.for_.counted;
+    int counter, bound;
+    if (counted_loop_start(loop, ctx, &counter, &bound))
+        return ok_outcome(new_bool_variant(counted_loop_continues(loop, counter, bound)));
+    return check_condition(for_stmt->per_type.for_.condition, ctx);
+}
+
+execution_outcome counted_loop_step(statement *for_stmt, exec_context *ctx) {
+    counted_loop *loop = for_stmt->per_type.for_.counted;
+    variant *v = exec_context_resolve_identifier(ctx, loop->counter->per_type.terminal_data, loop->counter->slot, &loop->counter->cache);
+    if (v == NULL || variant_immediate_tag(v) != VARIANT_TAG_INT)
+        return execute_expression(for_stmt->per_type.for_.next, ctx);
+    counted_loop_store(loop, int_variant_as_int(v) + loop->step, ctx);
+    return ok_outcome(void_singleton);
+}
+
 static void register_class_in_exec_context(statement *statement, exec_context *ctx) {
     variant_type *type = class_statement_create_variant_type(statement);
     exec_context_register_constructable_type(ctx, type);
 }
 
 execution_outcome statement_function_callable_executor(
-    list *arg_values, 
+    int argc,
+    variant **argv,
     void *ast_node, 
     variant *this_obj, 
     dict *captured_values, // optional for closures
@@ -267,24 +357,19 @@ execution_outcome statement_function_callable_executor(
 ) {
 
     statement *stmt = (statement *)ast_node;
-    list *arg_names = stmt->per_type.function.arg_names;
-    if (list_length(arg_values) < list_length(arg_names)) {
-        // we should report where the call was made, not where the function is
-        return exception_outcome(new_exception_variant_at(
-            stmt->token->origin, NULL,
-            "%s() expected %d arguments, got %d", stmt->per_type.function.name, list_length(arg_names), list_length(arg_values)
-        ));
-    }
-
-    stack_frame *frame = new_stack_frame(stmt->per_type.function.name, stmt->token->origin);
-    stack_frame_initialization(frame, arg_names, arg_values, NULL, NULL);
-    exec_context_push_stack_frame(ctx, frame);
-    
-    execution_outcome result = execute_statements(stmt->per_type.function.statements, ctx);
 
-    // even if an exception was raised, we still must pop the stack frame.
-    exec_context_pop_stack_frame(ctx);
-    return result;
+    // we should report where the call was made, not where the function is
+    return execute_user_function(
+        stmt->per_type.function.name,
+        stmt->per_type.function.statements,
+        stmt->per_type.function.arg_names,
+        stmt->per_type.function.layout,
+        argc,
+        argv,
+        NULL,
+        NULL,
+        call_origin == NULL ? stmt->token->origin : call_origin,
+        ctx);
 }
 
 
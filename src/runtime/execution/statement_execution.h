@@ -5,7 +5,35 @@
 #include "../../containers/_containers.h"
 #include "../../entities/_entities.h"
 
+// how a block of statements finished, for the engines that run blocks separately
+typedef enum block_flow {
+    BF_NONE,
+    BF_BREAK,
+    BF_CONTINUE,
+    BF_RETURN,
+} block_flow;
+
 execution_outcome execute_statements(list *statements, exec_context *ctx);
 
+// counted loops run with a native counter, if their counter and bound are ints as they start.
+// the engine stores the counter back to its local when the body reads it, and after the loop.
+bool counted_loop_start(counted_loop *loop, exec_context *ctx, int *counter, int *bound);
+bool counted_loop_continues(counted_loop *loop, int counter, int bound);
+void counted_loop_store(counted_loop *loop, int counter, exec_context *ctx);
+
+// for engines keeping the counter in its local, they fall back to the generic condition and step
+execution_outcome counted_loop_test(statement *for_stmt, exec_context *ctx);
+execution_outcome counted_loop_step(statement *for_stmt, exec_context *ctx);
+
+execution_outcome statement_function_callable_executor(
+    int argc,
+    variant **argv,
+    void *ast_node, 
+    variant *this_obj, 
+    dict *captured_values, // optional for closures
+    origin *call_origin, // source of call
+    exec_context *ctx
+);
+
 
 #endif
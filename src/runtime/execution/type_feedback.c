@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../variants/_variants.h"
+#include "type_feedback.h"
+
+// evaluations with the same operand types, before specializing
+#define WARMUP_EVALUATIONS    2
+
+// guard failures, after which an operation stays generic
+#define MAX_DEOPTIMIZATIONS   4
+
+enum operand_types {
+    OT_OTHER,
+    OT_INTS,
+    OT_FLOATS,
+    OT_STRS,
+    OT_MAX_VALUE
+};
+
+static binary_operation_func specialized[OP_MAX_VALUE][OT_MAX_VALUE];
+
+#define are_ints(v1, v2)      (variant_immediate_tag(v1) == VARIANT_TAG_INT && variant_immediate_tag(v2) == VARIANT_TAG_INT)
+#define are_floats(v1, v2)    (variant_immediate_tag(v1) == VARIANT_TAG_FLOAT && variant_immediate_tag(v2) == VARIANT_TAG_FLOAT)
+#define is_str(v)             ((v) != NULL && !variant_is_immediate(v) && (v)->_type == str_type)
+#define are_strs(v1, v2)      (is_str(v1) && is_str(v2))
+#define int_of(v)             ((int)variant_immediate_payload(v))
+
+static inline float float_of(variant *v) {
+    uint32_t bits = variant_immediate_payload(v);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline enum operand_types operand_types_of(variant *v1, variant *v2) {
+    if (are_ints(v1, v2)) return OT_INTS;
+    if (are_floats(v1, v2)) return OT_FLOATS;
+    if (are_strs(v1, v2)) return OT_STRS;
+    return OT_OTHER;
+}
+
+binary_operation_func observe_binary_operands(expression *op_expr, variant *v1, variant *v2) {
+    struct type_feedback *feedback = &op_expr->feedback;
+    binary_operation_func generic = binary_operation_for(op_expr->op);
+
+    if (feedback->deopts >= MAX_DEOPTIMIZATIONS) {
+        feedback->handler = generic;
+        return generic;
+    }
+
+    enum operand_types types = operand_types_of(v1, v2);
+    if (types != feedback->operand_types) {
+        feedback->operand_types = types;
+        feedback->hits = 0;
+    }
+    if (++feedback->hits >= WARMUP_EVALUATIONS && specialized[op_expr->op][types] != NULL)
+        feedback->handler = specialized[op_expr->op][types];
+
+    return generic;
+}
+
+static execution_outcome deoptimize(expression *op_expr, variant *v1, variant *v2) {
+    op_expr->feedback.handler = NULL;
+    op_expr->feedback.hits = 0;
+    op_expr->feedback.deopts++;
+    return binary_operation_for(op_expr->op)(op_expr, v1, v2);
+}
+
+// the generic operation raises the exceptions, e.g. for divisions by zero
+static execution_outcome calculate_generic(expression *op_expr, variant *v1, variant *v2) {
+    return binary_operation_for(op_expr->op)(op_expr, v1, v2);
+}
+
+#define INT_OPERATION(name, result) \
+    static execution_outcome name(expression *op_expr, variant *v1, variant *v2) { \
+        if (!are_ints(v1, v2)) return deoptimize(op_expr, v1, v2); \
+        int a = int_of(v1), b = int_of(v2); \
+        return ok_outcome(result); \
+    }
+
+#define FLOAT_OPERATION(name, result) \
+    static execution_outcome name(expression *op_expr, variant *v1, variant *v2) { \
+        if (!are_floats(v1, v2)) return deoptimize(op_expr, v1, v2); \
+        float a = float_of(v1), b = float_of(v2); \
+        return ok_outcome(result); \
+    }
+
+#define STR_COMPARISON(name, condition) \
+    static execution_outcome name(expression *op_expr, variant *v1, variant *v2) { \
+        if (!are_strs(v1, v2)) return deoptimize(op_expr, v1, v2); \
+        int c = variant_compare(v1, v2); \
+        return ok_outcome(new_bool_variant(condition)); \
+    }
+
+INT_OPERATION(ints_add,           new_int_variant(a + b))
+INT_OPERATION(ints_subtract,      new_int_variant(a - b))
+INT_OPERATION(ints_multiply,      new_int_variant(a * b))
+INT_OPERATION(ints_less_than,     new_bool_variant(a <  b))
+INT_OPERATION(ints_less_equal,    new_bool_variant(a <= b))
+INT_OPERATION(ints_greater_than,  new_bool_variant(a >  b))
+INT_OPERATION(ints_greater_equal, new_bool_variant(a >= b))
+INT_OPERATION(ints_equal,         new_bool_variant(a == b))
+INT_OPERATION(ints_not_equal,     new_bool_variant(a != b))
+
+static execution_outcome ints_divide(expression *op_expr, variant *v1, variant *v2) {
+    if (!are_ints(v1, v2)) return deoptimize(op_expr, v1, v2);
+    if (int_of(v2) == 0) return calculate_generic(op_expr, v1, v2);
+    return ok_outcome(new_int_variant(int_of(v1) / int_of(v2)));
+}
+
+static execution_outcome ints_modulo(expression *op_expr, variant *v1, variant *v2) {
+    if (!are_ints(v1, v2)) return deoptimize(op_expr, v1, v2);
+    if (int_of(v2) == 0) return calculate_generic(op_expr, v1, v2);
+    return ok_outcome(new_int_variant(int_of(v1) % int_of(v2)));
+}
+
+FLOAT_OPERATION(floats_add,           new_float_variant(a + b))
+FLOAT_OPERATION(floats_subtract,      new_float_variant(a - b))
+FLOAT_OPERATION(floats_multiply,      new_float_variant(a * b))
+FLOAT_OPERATION(floats_divide,        new_float_variant(a / b))
+FLOAT_OPERATION(floats_less_than,     new_bool_variant(a <  b))
+FLOAT_OPERATION(floats_less_equal,    new_bool_variant(a <= b))
+FLOAT_OPERATION(floats_greater_than,  new_bool_variant(a >  b))
+FLOAT_OPERATION(floats_greater_equal, new_bool_variant(a >= b))
+FLOAT_OPERATION(floats_equal,         new_bool_variant(a == b))
+FLOAT_OPERATION(floats_not_equal,     new_bool_variant(a != b))
+
+static execution_outcome strs_add(expression *op_expr, variant *v1, variant *v2) {
+    if (!are_strs(v1, v2)) return deoptimize(op_expr, v1, v2);
+    variant *v = new_str_variant(NULL);
+    str_variant_append(v, v1);
+    str_variant_append(v, v2);
+    return ok_outcome(v);
+}
+
+STR_COMPARISON(strs_less_than,     c <  0)
+STR_COMPARISON(strs_less_equal,    c <= 0)
+STR_COMPARISON(strs_greater_than,  c >  0)
+STR_COMPARISON(strs_greater_equal, c >= 0)
+STR_COMPARISON(strs_equal,         c == 0)
+STR_COMPARISON(strs_not_equal,     c != 0)
+
+void initialize_type_feedback() {
+    memset(specialized, 0, sizeof(specialized));
+
+    specialized[OP_ADD][OT_INTS]           = ints_add;
+    specialized[OP_SUBTRACT][OT_INTS]      = ints_subtract;
+    specialized[OP_MULTIPLY][OT_INTS]      = ints_multiply;
+    specialized[OP_DIVIDE][OT_INTS]        = ints_divide;
+    specialized[OP_MODULO][OT_INTS]        = ints_modulo;
+    specialized[OP_LESS_THAN][OT_INTS]     = ints_less_than;
+    specialized[OP_LESS_EQUAL][OT_INTS]    = ints_less_equal;
+    specialized[OP_GREATER_THAN][OT_INTS]  = ints_greater_than;
+    specialized[OP_GREATER_EQUAL][OT_INTS] = ints_greater_equal;
+    specialized[OP_EQUAL][OT_INTS]         = ints_equal;
+    specialized[OP_NOT_EQUAL][OT_INTS]     = ints_not_equal;
+
+    specialized[OP_ADD][OT_FLOATS]           = floats_add;
+    specialized[OP_SUBTRACT][OT_FLOATS]      = floats_subtract;
+    specialized[OP_MULTIPLY][OT_FLOATS]      = floats_multiply;
+    specialized[OP_DIVIDE][OT_FLOATS]        = floats_divide;
+    specialized[OP_LESS_THAN][OT_FLOATS]     = floats_less_than;
+    specialized[OP_LESS_EQUAL][OT_FLOATS]    = floats_less_equal;
+    specialized[OP_GREATER_THAN][OT_FLOATS]  = floats_greater_than;
+    specialized[OP_GREATER_EQUAL][OT_FLOATS] = floats_greater_equal;
+    specialized[OP_EQUAL][OT_FLOATS]         = floats_equal;
+    specialized[OP_NOT_EQUAL][OT_FLOATS]     = floats_not_equal;
+
+    specialized[OP_ADD][OT_STRS]           = strs_add;
+    specialized[OP_LESS_THAN][OT_STRS]     = strs_less_than;
+    specialized[OP_LESS_EQUAL][OT_STRS]    = strs_less_equal;
+    specialized[OP_GREATER_THAN][OT_STRS]  = strs_greater_than;
+    specialized[OP_GREATER_EQUAL][OT_STRS] = strs_greater_equal;
+    specialized[OP_EQUAL][OT_STRS]         = strs_equal;
+    specialized[OP_NOT_EQUAL][OT_STRS]     = strs_not_equal;
+}
@@ -0,0 +1,19 @@
+#ifndef _TYPE_FEEDBACK_H
+#define _TYPE_FEEDBACK_H
+
+#include "expression_execution.h"
+
+// quickening of arithmetic and comparison operations.
+// operation nodes record the types of the operands they see, and after
+// a few evaluations with the same types they switch to a handler specialized
+// to them, skipping the type checks of the generic operation.
+// specialized handlers guard their operands, if the types differ, the node
+// goes back to the generic operation. nodes that keep changing stay generic.
+
+void initialize_type_feedback();
+
+// records the operand types, returns the handler to calculate the operation with
+binary_operation_func observe_binary_operands(expression *op_expr, variant *v1, variant *v2);
+
+
+#endif
@@ -0,0 +1,374 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../../debugger/debugger.h"
+#include "../../utils/data_types/callable.h"
+#include "../../utils/str.h"
+#include "expression_execution.h"
+#include "statement_execution.h"
+#include "class_execution.h"
+#include "function_execution.h"
+#include "constant_pool.h"
+#include "bytecode.h"
+#include "vm_execution.h"
+
+
+static execution_outcome run_bytecode(bytecode *code, exec_context *ctx, block_flow *flow);
+static execution_outcome run_try_block(try_block *block, exec_context *ctx, block_flow *flow);
+static list *pop_values_list(variant **stack, int *sp, int count);
+
+
+execution_outcome vm_execute_statements(list *statements, exec_context *ctx) {
+    bytecode *code = bytecode_for_statements(statements, ctx);
+    block_flow flow = BF_NONE;
+
+    // break or continue outside of a loop merely stop the block, as in the tree walker
+    return run_bytecode(code, ctx, &flow);
+}
+
+#define push(v)     (stack[sp++] = (v))
+#define pop()       (stack[--sp])
+#define peek(n)     (stack[sp - 1 - (n)])
+
+static execution_outcome run_bytecode(bytecode *code, exec_context *ctx, block_flow *flow) {
+    variant *stack[code->max_stack + 1];
+    int sp = 0;
+    int pc = 0;
+    variant *result = void_singleton;
+    execution_outcome ex;
+    variant *v1, *v2, *v3;
+    expression *e;
+
+    while (pc < code->length) {
+        instruction *ins = &code->instructions[pc++];
+
+        switch (ins->op) {
+            case OPC_NOP:
+                break;
+
+            case OPC_PUSH_CONST:
+                push((variant *)ins->ptr);
+                break;
+
+            case OPC_PUSH_COPY:
+                push(instantiate_constant((variant *)ins->ptr));
+                break;
+
+            case OPC_LOAD_SYMBOL:
+                ex = resolve_identifier_value((expression *)ins->ptr, ctx);
+                if (ex.excepted || ex.failed) return ex;
+                push(ex.result);
+                break;
+
+            case OPC_STORE_SYMBOL:
+                ex = store_identifier_value((expression *)ins->ptr, peek(0), ctx);
+                if (ex.excepted || ex.failed) return ex;
+                break;
+
+            case OPC_POP:
+                sp--;
+                break;
+
+            case OPC_DUP:
+                v1 = peek(0);
+                push(v1);
+                break;
+
+            case OPC_DUP2:
+                v1 = peek(1);
+                v2 = peek(0);
+                push(v1);
+                push(v2);
+                break;
+
+            case OPC_SWAP:
+                v1 = peek(0);
+                peek(0) = peek(1);
+                peek(1) = v1;
+                break;
+
+            case OPC_ROT3:
+                v1 = peek(2);
+                peek(2) = peek(1);
+                peek(1) = peek(0);
+                peek(0) = v1;
+                break;
+
+            case OPC_BURY:
+                v1 = peek(0);
+                memmove(&stack[sp - ins->arg], &stack[sp - 1 - ins->arg], sizeof(variant *) * ins->arg);
+                stack[sp - 1 - ins->arg] = v1;
+                break;
+
+            case OPC_SET_RESULT:
+                result = pop();
+                if (sp == 0)
+                    exec_context_safe_point(ctx, result);
+                break;
+
+            case OPC_CLEAR_RESULT:
+                result = void_singleton;
+                break;
+
+            case OPC_UNARY_OP:
+                ex = calculate_unary_expression((expression *)ins->ptr, pop(), ctx);
+                if (ex.excepted || ex.failed) return ex;
+                push(ex.result);
+                break;
+
+            case OPC_BINARY_OP:
+                v2 = pop();
+                v1 = pop();
+                ex = calculate_binary_expression((expression *)ins->ptr, v1, v2, ctx);
+                if (ex.excepted || ex.failed) return ex;
+                push(ex.result);
+                break;
+
+            case OPC_MODIFY:
+                v2 = pop();
+                v1 = pop();
+                ex = calculate_modification(ins->arg, v1, v2, (expression *)ins->ptr);
+                if (ex.excepted || ex.failed) return ex;
+                push(ex.result);
+                break;
+
+            case OPC_GET_ELEMENT:
+                v2 = pop();
+                v1 = pop();
+                ex = get_element_value(v1, v2);
+                if (ex.excepted || ex.failed) return ex;
+                push(ex.result);
+                break;
+
+            case OPC_SET_ELEMENT:
+                v3 = pop();
+                v2 = pop();
+                v1 = pop();
+                ex = variant_set_element(v1, v2, v3);
+                if (ex.excepted || ex.failed) return ex;
+                push(v3);
+                break;
+
+            case OPC_GET_MEMBER:
+                ex = get_member_value(pop(), (expression *)ins->ptr, ctx);
+                if (ex.excepted || ex.failed) return ex;
+                push(ex.result);
+                break;
+
+            case OPC_SET_MEMBER:
+                v2 = pop();
+                v1 = pop();
+                ex = set_member_value(v1, (expression *)ins->ptr, v2, ctx);
+                if (ex.excepted || ex.failed) return ex;
+                push(v2);
+                break;
+
+            case OPC_CALL:
+                // arguments are passed in place, above the stack pointer after the pops
+                sp -= ins->arg;
+                v1 = pop();
+                ex = variant_call(v1, ins->arg, &stack[sp + 1], NULL, ((expression *)ins->ptr)->token->origin, ctx);
+                if (ex.excepted || ex.failed) return ex;
+                push(ex.result);
+                break;
+
+            case OPC_TAIL_CALL:
+                sp -= ins->arg;
+                v1 = pop();
+                ex = defer_tail_call(v1, ins->arg, &stack[sp + 1], ((expression *)ins->ptr)->token->origin, ctx);
+                push(ex.result);
+                break;
+
+            case OPC_CALL_BUILT_IN:
+                e = (expression *)ins->ptr;
+                sp -= ins->arg;
+                ex = call_built_in_func(bound_built_in(e), ins->arg, &stack[sp], e->token->origin, ctx);
+                if (ex.excepted || ex.failed) return ex;
+                push(ex.result);
+                break;
+
+            case OPC_INLINED_GUARD:
+                // the callee is still the inlined function, its body follows
+                e = (expression *)ins->ptr;
+                expression *callee = e->per_type.operation.operand1;
+                if (inlined_call_applies(e->inlined, peek(0),
+                        callee->op == OP_MEMBER ? callee->per_type.operation.operand2 : NULL, ctx))
+                    sp--;
+                else
+                    pc = ins->arg;
+                break;
+
+            case OPC_CALL_MEMBER:
+                e = (expression *)ins->ptr;
+                sp -= ins->arg;
+                v1 = pop();
+                ex = call_member_value(v1, e->per_type.operation.operand2, ins->arg, &stack[sp + 1], e->token->origin, ctx);
+                if (ex.excepted || ex.failed) return ex;
+                push(ex.result);
+                break;
+
+            case OPC_BUILD_LIST:
+                push(new_list_variant_owning(pop_values_list(stack, &sp, ins->arg)));
+                break;
+
+            case OPC_BUILD_DICT:
+                const char **keys = (const char **)ins->ptr;
+                dict *values_dict = new_dict(variant_item_info);
+                for (int i = 0; i < ins->arg; i++)
+                    dict_set(values_dict, keys[i], stack[sp - ins->arg + i]);
+                sp -= ins->arg;
+                push(new_dict_variant_owning(values_dict));
+                break;
+
+            case OPC_MAKE_CLOSURE:
+                push(create_closure_variant((expression *)ins->ptr, ctx));
+                break;
+
+            case OPC_MAKE_FUNCTION:
+                statement *func_stmt = (statement *)ins->ptr;
+                exec_context_register_symbol(ctx, func_stmt->per_type.function.name,
+                    new_callable_variant(new_callable(
+                        func_stmt->per_type.function.name,
+                        statement_function_callable_executor,
+                        func_stmt, NULL, NULL)));
+                break;
+
+            case OPC_MAKE_CLASS:
+                variant_type *type = class_statement_create_variant_type((statement *)ins->ptr);
+                exec_context_register_constructable_type(ctx, type);
+                break;
+
+            case OPC_JUMP:
+                pc = ins->arg;
+                break;
+
+            case OPC_JUMP_IF_FALSE:
+                v1 = pop();
+                if (!variant_instance_of(v1, bool_type))
+                    return exception_outcome(new_exception_variant_at(((expression *)ins->ptr)->token->origin, NULL,
+                        "condition expressions must yield boolean result"));
+                if (!bool_variant_as_bool(v1))
+                    pc = ins->arg;
+                break;
+
+            case OPC_COUNTED_TEST:
+                ex = counted_loop_test((statement *)ins->ptr, ctx);
+                if (ex.excepted || ex.failed) return ex;
+                if (!bool_variant_as_bool(ex.result))
+                    pc = ins->arg;
+                break;
+
+            case OPC_COUNTED_STEP:
+                ex = counted_loop_step((statement *)ins->ptr, ctx);
+                if (ex.excepted || ex.failed) return ex;
+                break;
+
+            case OPC_SHORT_CIRCUIT:
+                ex = check_logical_operand((expression *)ins->ptr, peek(0));
+                if (ex.excepted) return ex;
+                if (logical_operand_decides((expression *)ins->ptr, ex.result))
+                    pc = ins->arg;
+                else
+                    sp--;
+                break;
+
+            case OPC_CHECK_LOGICAL:
+                ex = check_logical_operand((expression *)ins->ptr, peek(0));
+                if (ex.excepted) return ex;
+                break;
+
+            case OPC_RETURN:
+                *flow = BF_RETURN;
+                return ok_outcome(pop());
+
+            case OPC_EXIT_BLOCK:
+                *flow = (block_flow)ins->arg;
+                return ok_outcome(void_singleton);
+
+            case OPC_THROW:
+                v1 = pop();
+                return exception_outcome(new_thrown_exception_variant(((statement *)ins->ptr)->token->origin, v1));
+
+            case OPC_TRY:
+                block_flow try_flow = BF_NONE;
+                ex = run_try_block((try_block *)ins->ptr, ctx, &try_flow);
+                if (ex.excepted || ex.failed) return ex;
+                result = ex.result;
+                if (try_flow == BF_RETURN) {
+                    *flow = BF_RETURN;
+                    return ex;
+                }
+                // the two instructions following are the break and continue handlers
+                if (try_flow == BF_NONE)
+                    pc += 2;
+                else if (try_flow == BF_CONTINUE)
+                    pc += 1;
+                break;
+
+            case OPC_RAISE:
+                raise_info *info = (raise_info *)ins->ptr;
+                return exception_outcome(new_exception_variant_at(info->origin, NULL, "%s", info->message));
+
+            case OPC_DEBUG_STMT:
+            case OPC_DEBUG_EXPR:
+                statement *dbg_stmt = ins->op == OPC_DEBUG_STMT ? ins->ptr : NULL;
+                expression *dbg_expr = ins->op == OPC_DEBUG_EXPR ? ins->ptr : NULL;
+                if ((ctx->debugger.instrumented || (dbg_stmt != NULL && dbg_stmt->type == ST_BREAKPOINT))
+                    && should_start_debugger(dbg_stmt, dbg_expr, ctx)) {
+                    failable session = run_debugger(dbg_stmt, dbg_expr, ctx);
+                    if (session.failed) return failed_outcome("%s", session.err_msg);
+                }
+                break;
+
+            default:
+                return failed_outcome("unknown opcode %d at address %d", ins->op, pc - 1);
+        }
+    }
+
+    return ok_outcome(result);
+}
+
+static execution_outcome run_try_block(try_block *block, exec_context *ctx, block_flow *flow) {
+    execution_outcome ex = run_bytecode(block->try_code, ctx, flow);
+    if (ex.failed) return ex;
+
+    // save this for later, we may run a "finally" block
+    execution_outcome try_catch_outcome = ex;
+    if (ex.excepted && block->catch_code != NULL) {
+        variant *exception = ex.exception_thrown;
+
+        if (block->exception_identifier != NULL)
+            exec_context_register_symbol(ctx, block->exception_identifier, exception);
+        *flow = BF_NONE;
+        ex = run_bytecode(block->catch_code, ctx, flow);
+        if (ex.failed) return ex;
+        if (block->exception_identifier != NULL)
+            exec_context_unregister_symbol(ctx, block->exception_identifier);
+
+        // if new exception was raised inside catch, save for post-finally
+        try_catch_outcome = ex;
+    }
+
+    // finally will run in any case, but will not influence the result,
+    // unless it breaks out of the normal flow itself.
+    if (block->finally_code != NULL) {
+        block_flow finally_flow = BF_NONE;
+        ctx->outcomes_held++;
+        ex = run_bytecode(block->finally_code, ctx, &finally_flow);
+        ctx->outcomes_held--;
+        if (ex.excepted || ex.failed) return ex;
+        if (finally_flow != BF_NONE) {
+            *flow = finally_flow;
+            return ex;
+        }
+    }
+
+    return try_catch_outcome;
+}
+
+static list *pop_values_list(variant **stack, int *sp, int count) {
+    list *values = new_list(variant_item_info);
+    for (int i = *sp - count; i < *sp; i++)
+        list_add(values, stack[i]);
+    *sp -= count;
+    return values;
+}
@@ -0,0 +1,12 @@
+#ifndef _VM_EXECUTION_H
+#define _VM_EXECUTION_H
+
+#include "../variants/_variants.h"
+#include "../../containers/_containers.h"
+#include "../../entities/_entities.h"
+
+// compiles (or reuses the compiled) bytecode of the statements and runs it
+execution_outcome vm_execute_statements(list *statements, exec_context *ctx);
+
+
+#endif
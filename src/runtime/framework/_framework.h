@@ -6,6 +6,7 @@
 #include "variant_base.h" 
 #include "variant_type.h" 
 #include "variant_funcs.h"
+#include "variant_gc.h"
 #include "variant_item_info.h"
 #include "variant_tests.h"
 
@@ -1,6 +1,8 @@
 #ifndef _BASE_VARIANT_H
 #define _BASE_VARIANT_H
 
+#include <stdint.h> // for uintptr_t
+
 // forward declarations
 typedef struct variant variant;
 typedef struct variant_type variant_type;
@@ -31,4 +33,22 @@ struct variant {
 };
 
 
+// ints, floats, bools and void are not allocated, they are encoded in the 
+// variant pointer itself. heap variants are aligned, so their lowest bit is zero.
+// immediates have the lowest bit set, their kind in the next two bits
+// and their 32 bits payload in the upper half of the pointer.
+#define VARIANT_TAG_MASK     0x7
+#define VARIANT_TAG_INT      0x1
+#define VARIANT_TAG_FLOAT    0x3
+#define VARIANT_TAG_BOOL     0x5
+#define VARIANT_TAG_VOID     0x7
+
+_Static_assert(sizeof(uintptr_t) >= 8, "immediate variants need 64 bits pointers");
+
+#define variant_is_immediate(v)                 (((uintptr_t)(v)) & 1)
+#define variant_immediate_tag(v)                ((int)(((uintptr_t)(v)) & VARIANT_TAG_MASK))
+#define variant_immediate_payload(v)            ((uint32_t)(((uintptr_t)(v)) >> 32))
+#define new_immediate_variant(tag, payload)     ((variant *)((((uintptr_t)(uint32_t)(payload)) << 32) | (tag)))
+
+
 #endif
@@ -2,6 +2,7 @@
 #include "variant_funcs.h"
 #include "../variants/_variants.h"
 #include "../../utils/error.h"
+#include "../../utils/slab.h"
 
 
 variant *void_singleton;
@@ -10,20 +11,27 @@ variant *false_instance;
 variant *zero_instance;
 variant *one_instance;
 variant *iteration_finished_exception_instance;
+variant_type *immediate_types[4];
 
 void initialize_variants() {
     // the following cannot be initialized statically
     type_of_types->_type = type_of_types;
 
-    void_type->_type = type_of_types;
-    int_type->_type = type_of_types;
-    str_type->_type = type_of_types;
-    bool_type->_type = type_of_types;
-    float_type->_type = type_of_types;
-    exception_type->_type = type_of_types;
-    list_type->_type = type_of_types;
-    dict_type->_type = type_of_types;
-    callable_type->_type = type_of_types;
+    variants_register_type(void_type);
+    variants_register_type(int_type);
+    variants_register_type(str_type);
+    variants_register_type(bool_type);
+    variants_register_type(float_type);
+    variants_register_type(exception_type);
+    variants_register_type(list_type);
+    variants_register_type(dict_type);
+    variants_register_type(callable_type);
+    variants_register_type(cell_type);
+
+    immediate_types[VARIANT_TAG_INT >> 1] = int_type;
+    immediate_types[VARIANT_TAG_FLOAT >> 1] = float_type;
+    immediate_types[VARIANT_TAG_BOOL >> 1] = bool_type;
+    immediate_types[VARIANT_TAG_VOID >> 1] = void_type;
 
     void_singleton = new_void_variant();
     true_instance = new_bool_variant(true);
@@ -32,24 +40,44 @@ void initialize_variants() {
     one_instance = new_int_variant(1);
     iteration_finished_exception_instance = new_exception_variant("(iteration finished)");
 
-    void_singleton->_references_count = VARIANT_STATICALLY_ALLOCATED;
-    true_instance->_references_count = VARIANT_STATICALLY_ALLOCATED;
-    false_instance->_references_count = VARIANT_STATICALLY_ALLOCATED;
-    zero_instance->_references_count = VARIANT_STATICALLY_ALLOCATED;
-    one_instance->_references_count = VARIANT_STATICALLY_ALLOCATED;
     iteration_finished_exception_instance->_references_count = VARIANT_STATICALLY_ALLOCATED;
 }
 
-execution_outcome variant_create(variant_type *type, variant *args, exec_context *ctx) {
+// instances come from the slab pool of their size, found once per type.
+// containers are tracked for cycle collection, with a header before them.
+static variant *allocate_instance(variant_type *type) {
+    bool tracked = type->traverser != NULL;
+    if (type->pool == NULL)
+        type->pool = slab_pool_for_size(type->instance_size + (tracked ? variant_gc_header_size() : 0));
+    void *block = slab_alloc(type->pool);
+    return tracked ? variant_gc_track(block) : block;
+}
+
+static void free_instance(variant *obj) {
+    variant_type *type = obj->_type;
+    if (type->pool == NULL) {
+        // types created at runtime are not allocated from pools
+        free(obj);
+        return;
+    }
+    void *block = type->traverser != NULL ? variant_gc_untrack(obj) : obj;
+    slab_free(type->pool, block);
+}
+
+execution_outcome variant_create(variant_type *type, int argc, variant **argv, exec_context *ctx) {
     if (type == NULL || type->_type != type_of_types)
         return failed_outcome("variant_create() requires a type as first argument.");
     
-    variant *p = malloc(type->instance_size);
+    // immediates are never allocated, they start as zero, false or void
+    if (type->immediate_tag != 0)
+        return ok_outcome(new_immediate_variant(type->immediate_tag, 0));
+
+    variant *p = allocate_instance(type);
     memset(p, 0, type->instance_size);
     p->_type = type;
     p->_references_count = 1; // the one we are going to return
     if (type->initializer != NULL) {
-        execution_outcome ex = type->initializer(p, args, ctx);
+        execution_outcome ex = type->initializer(p, argc, argv, ctx);
         if (ex.failed || ex.excepted) return ex;
     }
     return ok_outcome(p);
@@ -58,11 +86,13 @@ execution_outcome variant_create(variant_type *type, variant *args, exec_context
 variant *variant_clone(variant *obj) {
     if (obj == NULL)
         return NULL;
+    if (variant_is_immediate(obj))
+        return obj;
         
     if (obj->_type->copy_initializer == NULL)
         return NULL;
     
-    variant *clone = malloc(obj->_type->instance_size);
+    variant *clone = allocate_instance(obj->_type);
     clone->_type = obj->_type;
     clone->_references_count = 1; // the one we are going to return
 
@@ -71,7 +101,7 @@ variant *variant_clone(variant *obj) {
 }
 
 void variant_inc_ref(variant *obj) {
-    if (obj == NULL || obj->_type == NULL)
+    if (obj == NULL || variant_is_immediate(obj) || obj->_type == NULL)
         return;
     if (obj->_references_count == VARIANT_STATICALLY_ALLOCATED)
         return;
@@ -81,9 +111,9 @@ void variant_inc_ref(variant *obj) {
 
 void variant_drop_ref(variant *obj) {
 //    if (obj == NULL || obj->_type == NULL)
-    if (obj == NULL)
+    if (obj == NULL || variant_is_immediate(obj))
         return;
-    if (obj->_references_count == VARIANT_STATICALLY_ALLOCATED)
+    if (obj->_references_count == VARIANT_STATICALLY_ALLOCATED || variant_gc_is_releasing())
         return;
     
     obj->_references_count--;
@@ -95,13 +125,13 @@ void variant_drop_ref(variant *obj) {
     if (obj->_type->destructor)
         obj->_type->destructor(obj);
     
-    free(obj);
+    free_instance(obj);
 }
 
 bool variant_instance_of(variant *obj, variant_type *type) {
-    if (obj == NULL || obj->_type == NULL)
+    if (obj == NULL)
         return false;
-    variant_type *t = obj->_type;
+    variant_type *t = variant_type_of(obj);
     int levels = 0; // avoid infinite loops
     while (t != NULL && levels++ < 100) {
         if (t == type)
@@ -112,147 +142,122 @@ bool variant_instance_of(variant *obj, variant_type *type) {
 }
 
 bool variant_is_exactly(variant *obj, variant_type *type) {
-    if (obj == NULL || obj->_type == NULL)
+    if (obj == NULL)
         return false;
-    return obj->_type == type;
+    return variant_type_of(obj) == type;
+}
+
+variant_attrib_definition *variant_find_attr(variant_type *type, const char *name, visibility vis) {
+    variant_member_entry *e = variant_type_find_member(type, name);
+    if (e == NULL || e->attr == NULL)
+        return NULL;
+    if (vis != VIS_SAME_CLASS_CODE && !e->public_attr)
+        return NULL;
+    return e->attr;
 }
 
 bool variant_has_attr(variant *obj, const char *name, visibility vis) {
-    variant_type *t = obj->_type;
-    if (t->attributes == NULL) return false;
-    for (int i = 0; t->attributes[i].name != NULL; i++) {
-        if (vis != VIS_SAME_CLASS_CODE && !(t->attributes[i].vaf_flags & VAF_PUBLIC))
-            continue;
-        
-        if (strcmp(t->attributes[i].name, name) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return variant_find_attr(variant_type_of(obj), name, vis) != NULL;
 }
 
 execution_outcome variant_get_attr_value(variant *obj, const char *name, visibility vis) {
-    variant_type *type = obj->_type;
+    variant_type *type = variant_type_of(obj);
     if (type->attributes == NULL)
         return exception_outcome(new_exception_variant("object '%s' has no attributes", type->name));
 
-    for (int i = 0; type->attributes[i].name != NULL; i++) {
-        if (strcmp(type->attributes[i].name, name) != 0)
-            continue;
-        
-        if (vis != VIS_SAME_CLASS_CODE && !(type->attributes[i].vaf_flags & VAF_PUBLIC))
-            return exception_outcome(new_exception_variant("attribute '%s' is not public in type '%s'", name, type->name));
+    variant_member_entry *e = variant_type_find_member(type, name);
+    if (e == NULL || e->attr == NULL)
+        return exception_outcome(new_exception_variant("attribute '%s' not found in type '%s'", name, type->name));
+    if (vis != VIS_SAME_CLASS_CODE && !e->public_attr)
+        return exception_outcome(new_exception_variant("attribute '%s' is not public in type '%s'", name, type->name));
         
-        variant_attrib_definition *attr = &type->attributes[i];
-        if (attr->getter != NULL) {
-            return attr->getter(obj, attr);
-        } else {
-            variant **var_ptr_ptr = (variant **)(((void *)obj) + attr->offset);
-            variant_inc_ref(*var_ptr_ptr); // the one returned
-            return ok_outcome(*var_ptr_ptr);
-        }
-    }
+    return variant_get_attr_value_of(obj, e->attr);
+}
 
-    return exception_outcome(new_exception_variant("attribute '%s' not found in type '%s'", name, type->name));
+execution_outcome variant_get_attr_value_of(variant *obj, variant_attrib_definition *attr) {
+    if (attr->getter != NULL)
+        return attr->getter(obj, attr);
+
+    variant **var_ptr_ptr = (variant **)(((void *)obj) + attr->offset);
+    variant_inc_ref(*var_ptr_ptr); // the one returned
+    return ok_outcome(*var_ptr_ptr);
 }
 
 execution_outcome variant_set_attr_value(variant *obj, const char *name, visibility vis, variant *value) {
-    variant_type *type = obj->_type;
-    if (type->attributes == NULL)
+    variant_type *type = variant_type_of(obj);
+    variant_member_entry *e = variant_type_find_member(type, name);
+    if (e == NULL || e->attr == NULL)
         return exception_outcome(new_exception_variant("attribute '%s' not found in type '%s'", name, type->name));
-        
-    for (int i = 0; type->attributes[i].name != NULL; i++) {
-        if (strcmp(type->attributes[i].name, name) != 0)
-            continue;
-
-        variant_attrib_definition *attr = &type->attributes[i];
-        if (vis != VIS_SAME_CLASS_CODE && !(attr->vaf_flags & VAF_PUBLIC))
-            return exception_outcome(new_exception_variant("attribute '%s' is not public in type '%s'", name, type->name));
-        if (attr->vaf_flags & VAF_READ_ONLY)
-            return exception_outcome(new_exception_variant("attribute '%s' is read only in type '%s'", name, type->name));
-
-        if (attr->setter != NULL)
-            return attr->setter(obj, attr, value);
-
-        // we could do a small type test, if we wanted.
-        variant **var_ptr_ptr = (variant **)(((void *)obj) + attr->offset);
-        variant_drop_ref(*var_ptr_ptr);
-        *var_ptr_ptr = value;
-        variant_inc_ref(*var_ptr_ptr);
-        return ok_outcome(NULL);
-    }
+    if (vis != VIS_SAME_CLASS_CODE && !e->public_attr)
+        return exception_outcome(new_exception_variant("attribute '%s' is not public in type '%s'", name, type->name));
 
-    return exception_outcome(new_exception_variant("attribute '%s' not found in type '%s'", name, type->name));
+    return variant_set_attr_value_of(obj, e->attr, value);
 }
 
-bool variant_has_method(variant *obj, const char *name, visibility vis) {
-    variant_type *type = obj->_type;
-    if (type->methods == NULL)
-        return false;
-    
-    for (int i = 0; type->methods[i].name != NULL; i++) {
-        if (vis != VIS_SAME_CLASS_CODE && !(type->methods[i].vmf_flags & VAF_PUBLIC))
-            continue;
-        
-        if (strcmp(type->methods[i].name, name) == 0) {
-            return true;
-        }
-    }
+execution_outcome variant_set_attr_value_of(variant *obj, variant_attrib_definition *attr, variant *value) {
+    if (attr->vaf_flags & VAF_READ_ONLY)
+        return exception_outcome(new_exception_variant("attribute '%s' is read only in type '%s'", attr->name, variant_type_of(obj)->name));
 
-    return false;
+    if (attr->setter != NULL)
+        return attr->setter(obj, attr, value);
+
+    // we could do a small type test, if we wanted.
+    variant **var_ptr_ptr = (variant **)(((void *)obj) + attr->offset);
+    variant_gc_write_barrier(obj);
+    variant_drop_ref(*var_ptr_ptr);
+    *var_ptr_ptr = value;
+    variant_inc_ref(*var_ptr_ptr);
+    return ok_outcome(NULL);
+}
+
+variant_method_definition *variant_find_method(variant_type *type, const char *name, visibility vis) {
+    variant_member_entry *e = variant_type_find_member(type, name);
+    if (e == NULL || e->method == NULL)
+        return NULL;
+    if (vis != VIS_SAME_CLASS_CODE && !e->public_method)
+        return NULL;
+    return e->method;
 }
 
-execution_outcome variant_call_method(variant *obj, const char *name, visibility vis, list *arg_values, origin *call_origin, exec_context *ctx) {
+bool variant_has_method(variant *obj, const char *name, visibility vis) {
+    return variant_find_method(variant_type_of(obj), name, vis) != NULL;
+}
 
-    variant_type *type = obj->_type;
-    if (type->methods == NULL)
+execution_outcome variant_call_method(variant *obj, const char *name, visibility vis, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
+    variant_type *type = variant_type_of(obj);
+    variant_member_entry *e = variant_type_find_member(type, name);
+    if (e == NULL || e->method == NULL)
         return exception_outcome(new_exception_variant("method '%s()' not found in type '%s'", name, type->name));
-
-    for (int i = 0; type->methods[i].name != NULL; i++) {
-        if (strcmp(type->methods[i].name, name) != 0)
-            continue;
-        
-        if (vis != VIS_SAME_CLASS_CODE && !(type->methods[i].vmf_flags & VAF_PUBLIC))
-            return exception_outcome(new_exception_variant("method '%s()' is not public in type '%s'", name, type->name));
+    if (vis != VIS_SAME_CLASS_CODE && !e->public_method)
+        return exception_outcome(new_exception_variant("method '%s()' is not public in type '%s'", name, type->name));
         
-        variant_method_definition *method = &type->methods[i];
-        return method->handler(obj, method, arg_values, call_origin, ctx);
-    }
-    
-    return exception_outcome(new_exception_variant("method '%s()' not found in type '%s'", name, type->name));
+    return e->method->handler(obj, e->method, argc, argv, call_origin, ctx);
 }
 
 execution_outcome variant_get_bound_method(variant *obj, const char *name, visibility vis) {
-
-    variant_type *type = obj->_type;
-    if (type->methods == NULL)
+    variant_type *type = variant_type_of(obj);
+    variant_member_entry *e = variant_type_find_member(type, name);
+    if (e == NULL || e->method == NULL)
         return exception_outcome(new_exception_variant("method '%s()' not found in type '%s'", name, type->name));
-
-    for (int i = 0; type->methods[i].name != NULL; i++) {
-        if (strcmp(type->methods[i].name, name) != 0)
-            continue;
+    if (vis != VIS_SAME_CLASS_CODE && !e->public_method)
+        return exception_outcome(new_exception_variant("method '%s()' is not public in type '%s'", name, type->name));
         
-        if (vis != VIS_SAME_CLASS_CODE && !(type->methods[i].vmf_flags & VAF_PUBLIC))
-            return exception_outcome(new_exception_variant("method '%s()' is not public in type '%s'", name, type->name));
-        
-        variant *bound_method = new_callable_variant(
-            NULL // TODO: travel the tree to find var references and capture
-        );
-        // but we need the callable, no?
-        return ok_outcome(bound_method);
-    }
-    
-    return exception_outcome(new_exception_variant("method '%s()' not found in type '%s'", name, type->name));
+    variant *bound_method = new_callable_variant(
+        NULL // TODO: travel the tree to find var references and capture
+    );
+    // but we need the callable, no?
+    return ok_outcome(bound_method);
 }
 
 variant *variant_to_string(variant *obj) {
     if (obj == NULL)
         return new_str_variant("(null)");
     
-    if (obj->_type->stringifier == NULL)
-        return new_str_variant("(%s @ 0x%p)", obj->_type->name, obj);
+    variant_type *type = variant_type_of(obj);
+    if (type->stringifier == NULL)
+        return new_str_variant("(%s @ 0x%p)", type->name, obj);
     
-    return obj->_type->stringifier(obj);
+    return type->stringifier(obj);
 }
 
 bool variants_are_equal(variant *a, variant *b) {
@@ -263,10 +268,11 @@ bool variants_are_equal(variant *a, variant *b) {
     if (a != NULL && b == NULL)
         return false;
     
-    if (a->_type != b->_type)
+    variant_type *type = variant_type_of(a);
+    if (type != variant_type_of(b))
         return false;
-    if (a->_type->equality_checker != NULL)
-        return a->_type->equality_checker(a, b);
+    if (type->equality_checker != NULL)
+        return type->equality_checker(a, b);
     return a == b;
 }
 
@@ -278,10 +284,11 @@ int variant_compare(variant *a, variant *b) {
     if (a != NULL && b == NULL)
         return 1;
     
-    if (a->_type != b->_type)
+    variant_type *type = variant_type_of(a);
+    if (type != variant_type_of(b))
         return false;
-    if (a->_type->comparer != NULL)
-        return a->_type->comparer(a, b);
+    if (type->comparer != NULL)
+        return type->comparer(a, b);
     return -1;
 }
 
@@ -289,45 +296,51 @@ unsigned variant_hash(variant *obj) {
     if (obj == NULL)
         return 0;
     
-    if (obj->_type->hasher != NULL)
-        return obj->_type->hasher(obj);
+    variant_type *type = variant_type_of(obj);
+    if (type->hasher != NULL)
+        return type->hasher(obj);
     
     return (unsigned)(long)obj;
 }
 
 variant *variant_get_iterator(variant *obj) { // create & reset iterator to before first
-    if (obj->_type->iterator_factory != NULL)
-        return obj->_type->iterator_factory(obj);
+    variant_type *type = variant_type_of(obj);
+    if (type->iterator_factory != NULL)
+        return type->iterator_factory(obj);
     return NULL;
 }
 
 execution_outcome variant_iterator_next(variant *obj) { // advance and get next, or return error
-    if (obj->_type->iterator_next_implementation == NULL)
-        return exception_outcome(new_exception_variant("Type '%s' is not iterable", obj->_type->name));
+    variant_type *type = variant_type_of(obj);
+    if (type->iterator_next_implementation == NULL)
+        return exception_outcome(new_exception_variant("Type '%s' is not iterable", type->name));
 
-    return obj->_type->iterator_next_implementation(obj);
+    return type->iterator_next_implementation(obj);
 }
 
-execution_outcome variant_call(variant *obj, list *arg_values, variant *this_obj, origin *call_origin, exec_context *ctx) {
-    if (obj == NULL || obj->_type == NULL)
+execution_outcome variant_call(variant *obj, int argc, variant **argv, variant *this_obj, origin *call_origin, exec_context *ctx) {
+    if (obj == NULL || variant_type_of(obj) == NULL)
         return failed_outcome("Expecting variant with a type, got null");
 
-    if (obj->_type->call_handler == NULL)
-        return exception_outcome(new_exception_variant("Type '%s' is not callable", obj->_type->name));
+    variant_type *type = variant_type_of(obj);
+    if (type->call_handler == NULL)
+        return exception_outcome(new_exception_variant("Type '%s' is not callable", type->name));
     
-    return obj->_type->call_handler(obj, arg_values, this_obj, call_origin, ctx);
+    return type->call_handler(obj, argc, argv, this_obj, call_origin, ctx);
 }
 
 execution_outcome variant_get_element(variant *obj, variant *index) {
-    if (obj->_type->get_element == NULL)
-        return exception_outcome(new_exception_variant("Type '%s' does not support getting element by index", obj->_type->name));
+    variant_type *type = variant_type_of(obj);
+    if (type->get_element == NULL)
+        return exception_outcome(new_exception_variant("Type '%s' does not support getting element by index", type->name));
 
-    return obj->_type->get_element(obj, index);
+    return type->get_element(obj, index);
 }
 
 execution_outcome variant_set_element(variant *obj, variant *index, variant *value) {
-    if (obj->_type->set_element == NULL)
-        return exception_outcome(new_exception_variant("Type '%s' does not support setting element by index", obj->_type->name));
+    variant_type *type = variant_type_of(obj);
+    if (type->set_element == NULL)
+        return exception_outcome(new_exception_variant("Type '%s' does not support setting element by index", type->name));
     
-    return obj->_type->set_element(obj, index, value);
+    return type->set_element(obj, index, value);
 }
@@ -25,6 +25,12 @@ extern variant *iteration_finished_exception_instance;
 
 void initialize_variants();
 
+// the type of any variant, immediate or not
+extern variant_type *immediate_types[4];
+#define variant_type_of(obj)    (variant_is_immediate(obj) ? \
+                                    immediate_types[variant_immediate_tag(obj) >> 1] : \
+                                    (obj)->_type)
+
 
 typedef enum visibility {
     VIS_SAME_CLASS_CODE,
@@ -32,7 +38,7 @@ typedef enum visibility {
 } visibility;
 
 // call this to create a new instance
-execution_outcome variant_create(variant_type *type, variant *args, exec_context *ctx);
+execution_outcome variant_create(variant_type *type, int argc, variant **argv, exec_context *ctx);
 
 // references count. if refs down to zero, variant is destroyed too.
 void variant_inc_ref(variant *obj);
@@ -47,10 +53,16 @@ bool              variant_has_attr(variant *obj, const char *name, visibility vi
 execution_outcome variant_get_attr_value(variant *obj, const char *name, visibility vis);
 execution_outcome variant_set_attr_value(variant *obj, const char *name, visibility vis, variant *value);
 
+// lookup once, then use the definitions directly, e.g. from inline caches
+variant_attrib_definition *variant_find_attr(variant_type *type, const char *name, visibility vis);
+execution_outcome variant_get_attr_value_of(variant *obj, variant_attrib_definition *attr);
+execution_outcome variant_set_attr_value_of(variant *obj, variant_attrib_definition *attr, variant *value);
+
 // call these to manipulate methods on an variant
 bool              variant_has_method(variant *obj, const char *name, visibility vis);
-execution_outcome variant_call_method(variant *obj, const char *name, visibility vis, list *args_list, origin *call_origin, exec_context *ctx);
+execution_outcome variant_call_method(variant *obj, const char *name, visibility vis, int argc, variant **argv, origin *call_origin, exec_context *ctx);
 execution_outcome variant_get_bound_method(variant *obj, const char *name, visibility vis);
+variant_method_definition *variant_find_method(variant_type *type, const char *name, visibility vis);
 
 // a few utilitiy methods without knowing the variant type
 variant *         variant_to_string(variant *obj);
@@ -61,7 +73,7 @@ variant *         variant_clone(variant *obj);
 variant *         variant_get_iterator(variant *obj); // create & reset iterator to before first
 execution_outcome variant_iterator_next(variant *obj); // advance and get next, or return error
 
-execution_outcome variant_call(variant *obj, list *args, variant *this_obj, origin *call_origin, exec_context *ctx);
+execution_outcome variant_call(variant *obj, int argc, variant **argv, variant *this_obj, origin *call_origin, exec_context *ctx);
 execution_outcome variant_get_element(variant *obj, variant *index);
 execution_outcome variant_set_element(variant *obj, variant *index, variant *value);
 
@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <string.h>
+#include "variant_gc.h"
+#include "../../utils/slab.h"
+#include "../../utils/mem.h"
+
+// we allocate the worklist, not variants
+#undef malloc
+#undef realloc
+#undef free
+
+// young containers are collected after this many allocations,
+// older generations after this many collections of the previous one.
+#define YOUNG_GENERATION_THRESHOLD   700
+#define OLDER_GENERATIONS_THRESHOLD   10
+
+typedef struct gc_header {
+    struct gc_header *prev;
+    struct gc_header *next;
+    unsigned long long stamp : 59; // the count of containers tracked before this one
+    unsigned long long generation : 2;
+    unsigned long long remembered : 1;
+    unsigned long long collecting : 1;
+    unsigned long long marked : 1;
+} gc_header;
+
+#define header_of(obj)     ((gc_header *)(((char *)(obj)) - sizeof(gc_header)))
+#define object_of(header)  ((variant *)(((char *)(header)) + sizeof(gc_header)))
+
+// each generation is a circular list, headed by a sentinel
+static gc_header generations[VARIANT_GC_GENERATIONS];
+// containers of older generations that changed after they got there, and may hold younger ones.
+// younger generations are collected from them, instead of traversing the older generations.
+static gc_header remembered[VARIANT_GC_GENERATIONS];
+static int counts[VARIANT_GC_GENERATIONS]; // allocations for the first, collections for the rest
+static bool full_collection_requested = false;
+static bool releasing_garbage = false;
+static unsigned long long tracked_count = 0;
+
+// containers reached, but not traversed yet
+static struct {
+    variant **items;
+    int capacity;
+    int length;
+} worklist;
+
+
+static void initialize_generations() {
+    for (int i = 0; i < VARIANT_GC_GENERATIONS; i++) {
+        generations[i].prev = generations[i].next = &generations[i];
+        remembered[i].prev = remembered[i].next = &remembered[i];
+    }
+}
+
+static inline void append_header(gc_header *h, gc_header *head) {
+    h->next = head;
+    h->prev = head->prev;
+    head->prev->next = h;
+    head->prev = h;
+}
+
+static inline void link_header(gc_header *h, int generation) {
+    h->generation = generation;
+    h->remembered = false;
+    append_header(h, &generations[generation]);
+}
+
+static inline void unlink_header(gc_header *h) {
+    h->prev->next = h->next;
+    h->next->prev = h->prev;
+}
+
+static void move_headers(gc_header *from, int generation) {
+    while (from->next != from) {
+        gc_header *h = from->next;
+        unlink_header(h);
+        link_header(h, generation);
+    }
+}
+
+int variant_gc_header_size() {
+    return sizeof(gc_header);
+}
+
+variant *variant_gc_track(void *block) {
+    if (generations[0].next == NULL)
+        initialize_generations();
+
+    gc_header *h = block;
+    h->stamp = tracked_count++;
+    h->remembered = false;
+    h->collecting = false;
+    h->marked = false;
+    link_header(h, 0);
+    counts[0]++;
+    return object_of(h);
+}
+
+void *variant_gc_untrack(variant *obj) {
+    gc_header *h = header_of(obj);
+    unlink_header(h);
+    if (h->generation == 0 && counts[0] > 0)
+        counts[0]--;
+    return h;
+}
+
+int variant_gc_due_generation() {
+    if (full_collection_requested)
+        return VARIANT_GC_GENERATIONS - 1;
+    if (counts[0] < YOUNG_GENERATION_THRESHOLD)
+        return -1;
+
+    int generation = 0;
+    while (generation + 1 < VARIANT_GC_GENERATIONS && counts[generation + 1] >= OLDER_GENERATIONS_THRESHOLD)
+        generation++;
+    return generation;
+}
+
+unsigned long long variant_gc_stamp() {
+    return tracked_count;
+}
+
+bool variant_gc_is_releasing() {
+    return releasing_garbage;
+}
+
+void variant_gc_request_full_collection() {
+    full_collection_requested = true;
+}
+
+static inline bool is_tracked(variant *obj) {
+    return obj != NULL && !variant_is_immediate(obj) && obj->_type != NULL && obj->_type->traverser != NULL;
+}
+
+void variant_gc_write_barrier(variant *container) {
+    if (!is_tracked(container))
+        return;
+    gc_header *h = header_of(container);
+    if (h->generation == 0 || h->remembered || h->collecting)
+        return;
+
+    unlink_header(h);
+    append_header(h, &remembered[h->generation]);
+    h->remembered = true;
+}
+
+static void mark(variant *obj, void *data) {
+    if (!is_tracked(obj))
+        return;
+    gc_header *h = header_of(obj);
+    if (!h->collecting || h->marked)
+        return;
+
+    h->marked = true;
+    if (worklist.length == worklist.capacity) {
+        worklist.capacity = worklist.capacity == 0 ? 256 : worklist.capacity * 2;
+        worklist.items = realloc(worklist.items, sizeof(variant *) * worklist.capacity);
+    }
+    worklist.items[worklist.length++] = obj;
+}
+
+static void process_worklist() {
+    while (worklist.length > 0) {
+        variant *obj = worklist.items[--worklist.length];
+        obj->_type->traverser(obj, mark, NULL);
+    }
+}
+
+int variant_gc_collect(int generation, unsigned long long young_since, roots_func roots, void *roots_data) {
+    if (generations[0].next == NULL)
+        initialize_generations();
+    if (generation < 0 || generation >= VARIANT_GC_GENERATIONS)
+        return 0;
+
+    // gather the collected generations in the oldest of them
+    gc_header *collected = &generations[generation];
+    for (int i = 0; i < generation; i++)
+        move_headers(&generations[i], generation);
+    for (int i = 0; i <= generation; i++)
+        move_headers(&remembered[i], generation);
+    for (gc_header *h = collected->next; h != collected; h = h->next) {
+        h->collecting = true;
+        h->marked = false;
+    }
+
+    // mark from the roots, the changed containers of older generations, 
+    // the immortals and those older than the current code
+    roots(roots_data, mark, NULL);
+    for (int i = generation + 1; i < VARIANT_GC_GENERATIONS; i++) {
+        gc_header *head = &remembered[i];
+        for (gc_header *h = head->next; h != head; h = h->next)
+            object_of(h)->_type->traverser(object_of(h), mark, NULL);
+    }
+    for (gc_header *h = collected->next; h != collected; h = h->next) {
+        if (object_of(h)->_references_count == VARIANT_STATICALLY_ALLOCATED || h->stamp < young_since)
+            mark(object_of(h), NULL);
+    }
+    process_worklist();
+
+    // survivors move on, the rest is garbage
+    gc_header survivors = { .prev = &survivors, .next = &survivors };
+    gc_header garbage = { .prev = &garbage, .next = &garbage };
+    while (collected->next != collected) {
+        gc_header *h = collected->next;
+        gc_header *into = h->marked ? &survivors : &garbage;
+        unlink_header(h);
+        h->collecting = false;
+        append_header(h, into);
+    }
+    int survivors_generation = generation + 1 < VARIANT_GC_GENERATIONS ? generation + 1 : generation;
+    move_headers(&survivors, survivors_generation);
+
+    // the younger generations are empty now, the changed containers 
+    // of the next one cannot hold anything younger than themselves
+    if (generation + 1 < VARIANT_GC_GENERATIONS)
+        move_headers(&remembered[generation + 1], generation + 1);
+
+    // destructors release the storage of the containers. the references they drop 
+    // are ignored, as not all holders count theirs, e.g. frames or argument lists.
+    releasing_garbage = true;
+    for (gc_header *h = garbage.next; h != &garbage; h = h->next) {
+        variant *obj = object_of(h);
+        if (obj->_type->destructor != NULL)
+            obj->_type->destructor(obj);
+    }
+    releasing_garbage = false;
+    int freed = 0;
+    while (garbage.next != &garbage) {
+        gc_header *h = garbage.next;
+        variant_type *type = object_of(h)->_type;
+        garbage.next = h->next;
+        slab_free(type->pool, h);
+        freed++;
+    }
+
+    counts[0] = 0;
+    for (int i = 1; i <= generation; i++)
+        counts[i] = 0;
+    if (generation + 1 < VARIANT_GC_GENERATIONS)
+        counts[generation + 1]++;
+    if (generation == VARIANT_GC_GENERATIONS - 1)
+        full_collection_requested = false;
+
+    mem_stats_add_collection(freed);
+    return freed;
+}
@@ -0,0 +1,53 @@
+#ifndef _VARIANT_GC_H
+#define _VARIANT_GC_H
+
+#include <stdbool.h>
+#include "variant_base.h"
+#include "variant_type.h"
+
+/*
+    Collection of container variants (those whose type has a traverser) 
+    that reference counting cannot free, e.g. lists that contain themselves.
+    Strings are tracked too, the garbage ones are freed with the containers.
+
+    Containers are tracked from their creation, in three generations.
+    A collection marks everything reachable from the roots (given by the caller)
+    and from the older containers that changed since they got to their generation,
+    and frees the unmarked containers of the collected generations. 
+    Survivors move to the next generation. Containers tell of their changes 
+    through `variant_gc_write_barrier()`, before storing a variant.
+
+    Values in flight (e.g. in C locals or the VM stack) are not roots.
+    Containers are stamped with their tracking order, and a collection keeps
+    those stamped before a given stamp, as the values in flight of running
+    functions can only be older than their frames, see `exec_context_safe_point()`.
+*/
+
+#define VARIANT_GC_GENERATIONS   3
+
+// containers are allocated with a header before them
+int variant_gc_header_size();
+variant *variant_gc_track(void *block);
+void *variant_gc_untrack(variant *obj);
+
+// to be called by containers before they store a variant in them
+void variant_gc_write_barrier(variant *container);
+
+// the roots enumerator visits every variant that is in use
+typedef void (*roots_func)(void *roots_data, visit_func visit, void *visit_data);
+
+// tells which generation is due for collection, or -1
+int variant_gc_due_generation();
+void variant_gc_request_full_collection();
+
+// while garbage is released, dropping references does nothing
+bool variant_gc_is_releasing();
+
+// containers tracked from this stamp on are younger than the current code
+unsigned long long variant_gc_stamp();
+
+// returns the number of containers freed, those stamped before young_since are kept
+int variant_gc_collect(int generation, unsigned long long young_since, roots_func roots, void *roots_data);
+
+
+#endif
@@ -5,6 +5,7 @@
 #include <stddef.h>
 #include "variant_item_info.h"
 #include "../../utils/testing.h"
+#include "../../utils/mem.h"
 #include "_framework.h"
 #include "../variants/_variants.h"
 
@@ -17,6 +18,29 @@ void variant_self_diagnostics(bool verbose) {
     v = new_int_variant(15);
     assert(strcmp(str_variant_as_str(variant_to_string(v)), "15") == 0);
 
+    // numbers, bools and void are encoded in the pointer, never allocated
+    assert(variant_is_immediate(v));
+    assert(variant_type_of(v) == int_type);
+    assert(int_variant_as_int(new_int_variant(-7)) == -7);
+    assert(variants_are_equal(new_int_variant(-7), new_int_variant(-7)));
+    assert(float_variant_as_float(new_float_variant(-2.5)) == -2.5);
+    assert(variant_compare(new_float_variant(1.5), new_float_variant(2.5)) < 0);
+    assert(new_bool_variant(true) == true_instance);
+    assert(new_void_variant() == void_singleton);
+    assert(variant_instance_of(false_instance, bool_type));
+    assert(!variant_is_immediate(new_str_variant("15")));
+    assert(int_variant_as_int(new_float_variant(1.0)) == 0);
+
+    // instances are counted in mem stats, freed ones are reused
+    long allocations = mem_stats_allocations();
+    variant *s1 = new_str_variant("a");
+    assert(mem_stats_allocations() > allocations);
+    variant_drop_ref(s1);
+    assert(mem_stats_freeings() > 0);
+    #ifndef PLAIN_MALLOC
+    assert(new_str_variant("b") == s1);
+    #endif
+
     // assert(variant_instance_of(v, str_type));
     // assert(variants_are_equal(v, new_str_variant("15")));
     // assert(!variants_are_equal(v, new_int_variant(15))); // no auto conversion
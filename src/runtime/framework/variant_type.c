@@ -1,5 +1,7 @@
 #include <stdbool.h>
 #include <string.h>
+#include "../../utils/hash.h"
+#include "../../utils/intern.h"
 #include "variant_type.h"
 #include "../variants/str_variant.h"
 
@@ -48,6 +50,7 @@ static struct {
 void variants_register_type(variant_type *type) {
     // setting this here, as we cannot set it statically.
     type->_type = type_of_types;
+    variant_type_build_members_index(type);
 
     if (registry.capacity == 0) {
         registry.capacity = 16;
@@ -72,3 +75,70 @@ variant_type *variants_get_named_type(const char *name) {
     return NULL;
 }
 
+
+static variant_member_entry *members_index_slot(variant_members_index *index, const char *name, unsigned hash) {
+    unsigned mask = index->capacity - 1;
+    unsigned i = hash & mask;
+
+    // linear probing, the index is never more than half full.
+    // index names are symbols, names from the code match by pointer
+    bool symbol = is_interned(name);
+    while (index->entries[i].name != NULL) {
+        if (index->entries[i].name == name)
+            break;
+        if (!symbol && index->entries[i].hash == hash && strcmp(index->entries[i].name, name) == 0)
+            break;
+        i = (i + 1) & mask;
+    }
+    return &index->entries[i];
+}
+
+void variant_type_build_members_index(variant_type *type) {
+    int count = 0;
+    if (type->attributes != NULL)
+        while (type->attributes[count].name != NULL) count++;
+    if (type->methods != NULL)
+        for (int i = 0; type->methods[i].name != NULL; i++) count++;
+
+    variant_members_index *index = malloc(sizeof(variant_members_index));
+    index->capacity = 8;
+    while (index->capacity < count * 2)
+        index->capacity *= 2;
+    index->entries = calloc(index->capacity, sizeof(variant_member_entry));
+
+    // on duplicate names, the first definition wins, as in a linear scan
+    for (int i = 0; type->attributes != NULL && type->attributes[i].name != NULL; i++) {
+        const char *name = intern(type->attributes[i].name);
+        unsigned hash = interned_hash(name);
+        variant_member_entry *e = members_index_slot(index, name, hash);
+        e->name = name;
+        e->hash = hash;
+        if (e->attr == NULL) {
+            e->attr = &type->attributes[i];
+            e->public_attr = (type->attributes[i].vaf_flags & VAF_PUBLIC) != 0;
+        }
+    }
+    for (int i = 0; type->methods != NULL && type->methods[i].name != NULL; i++) {
+        const char *name = intern(type->methods[i].name);
+        unsigned hash = interned_hash(name);
+        variant_member_entry *e = members_index_slot(index, name, hash);
+        e->name = name;
+        e->hash = hash;
+        if (e->method == NULL) {
+            e->method = &type->methods[i];
+            e->public_method = (type->methods[i].vmf_flags & VMF_PUBLIC) != 0;
+        }
+    }
+
+    type->members_index = index;
+}
+
+// returns NULL if the type has no member of this name
+variant_member_entry *variant_type_find_member(variant_type *type, const char *name) {
+    if (type->members_index == NULL)
+        variant_type_build_members_index(type);
+
+    unsigned hash = is_interned(name) ? interned_hash(name) : simple_hash((void *)name, strlen(name));
+    variant_member_entry *e = members_index_slot(type->members_index, name, hash);
+    return e->name == NULL ? NULL : e;
+}
@@ -13,9 +13,10 @@
 
 
 typedef struct exec_context exec_context;
+typedef struct slab_pool slab_pool;
 
 // some specific function types, used in types
-typedef execution_outcome (*initialize_func)(variant *obj, variant *arg_values, exec_context *ctx);
+typedef execution_outcome (*initialize_func)(variant *obj, int argc, variant **argv, exec_context *ctx);
 typedef void (*destruct_func)(variant *obj);
 typedef void (*copy_initializer_func)(variant *obj, variant *original);
 typedef variant *(*return_obj_func)(variant *obj);
@@ -25,15 +26,17 @@ typedef int (*compare_func)(variant *a, variant *b);
 typedef bool (*equals_func)(variant *a, variant *b);
 
 typedef execution_outcome (*iterator_next_func)(variant *obj);
-typedef execution_outcome (*call_handler_func)(variant *obj, list *arg_values, variant *this_obj, origin *call_origin, exec_context *ctx);
+typedef execution_outcome (*call_handler_func)(variant *obj, int argc, variant **argv, variant *this_obj, origin *call_origin, exec_context *ctx);
 typedef execution_outcome (*get_element_func)(variant *obj, variant *index);
 typedef execution_outcome (*set_element_func)(variant *obj, variant *index, variant *value);
+typedef void (*visit_func)(variant *obj, void *data);
+typedef void (*traverse_func)(variant *obj, visit_func visit, void *data);
 
 
 // each variant has zero or more methods. 
 // they are defined in an array of this structure
 typedef struct variant_method_definition variant_method_definition;
-typedef execution_outcome (*variant_method_handler_func)(variant *this, variant_method_definition *method, list *arg_values, origin *call_origin, exec_context *ctx);
+typedef execution_outcome (*variant_method_handler_func)(variant *this, variant_method_definition *method, int argc, variant **argv, origin *call_origin, exec_context *ctx);
 enum variant_method_flags {
     VMF_DEFAULT = 0,
     VMF_VARARGS = 1,
@@ -72,6 +75,23 @@ typedef struct variant_attrib_definition {
 } variant_attrib_definition;
 
 
+// an open addressed index of the attributes and methods of a type, by name.
+// an attribute and a method of the same name share the entry.
+typedef struct variant_member_entry {
+    const char *name; // NULL for empty entries
+    unsigned hash;
+    variant_attrib_definition *attr;
+    variant_method_definition *method;
+    bool public_attr;
+    bool public_method;
+} variant_member_entry;
+
+typedef struct variant_members_index {
+    int capacity; // power of two
+    variant_member_entry *entries;
+} variant_members_index;
+
+
 // each variant is associated with a variant_type. 
 // that type describes how instances behave, initialize, destruct, etc.
 // the variant_type also is associated with a static variant_type instance, the type-type!
@@ -85,6 +105,9 @@ struct variant_type {
     int instance_size;
     struct variant_type *parent_type;
 
+    // non zero for types whose values are encoded in the variant pointer
+    int immediate_tag;
+
     // the AST node that created this type.
     // most probably a statement, maybe an expression in the future
     void *ast_node;
@@ -104,11 +127,18 @@ struct variant_type {
     call_handler_func      call_handler;
     get_element_func       get_element;
     set_element_func       set_element;
+    traverse_func          traverser; // for containers, visits the variants they hold
 
     // array of attributes and methods of the instances
     // last element in array has a NULL name
     variant_attrib_definition *attributes;
     variant_method_definition *methods;
+
+    // built once, when the type is registered or created
+    variant_members_index *members_index;
+
+    // where instances are allocated from, set on first instance
+    slab_pool *pool;
 };
 
 
@@ -118,6 +148,8 @@ extern variant_type *type_of_types;
 // type manipulation functions
 void variants_register_type(variant_type *type);
 variant_type *variants_get_named_type(const char *name);
+void variant_type_build_members_index(variant_type *type);
+variant_member_entry *variant_type_find_member(variant_type *type, const char *name);
 
 
 #endif
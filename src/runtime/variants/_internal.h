@@ -22,6 +22,7 @@ typedef struct variant_type variant_type;
 #include "list_variant.h"
 #include "dict_variant.h"
 #include "callable_variant.h"
+#include "cell_variant.h"
 
 
 #endif
@@ -16,6 +16,7 @@ typedef struct variant variant;
 #include "list_variant.h"
 #include "dict_variant.h"
 #include "callable_variant.h"
+#include "cell_variant.h"
 
 
 
@@ -3,37 +3,24 @@
 #include <stdio.h>
 
 
-typedef struct bool_instance {
-    BASE_VARIANT_FIRST_ATTRIBUTES;
-    bool value;
-} bool_instance;
+// bools are immediates, the value lives in the variant pointer.
+#define bool_value(v)    (variant_immediate_payload(v) != 0)
 
-static execution_outcome initialize(bool_instance *obj, variant *args, exec_context *ctx) {
-    obj->value = false;
-    return ok_outcome(NULL);
-}
-
-static void destruct(bool_instance *obj) {
-}
-
-static void copy_initialize(bool_instance *obj, bool_instance *original) {
-    obj->value = original->value;
-}
 
-static variant *stringify(bool_instance *obj) {
-    return new_str_variant(obj->value ? "true" : "false");
+static variant *stringify(variant *obj) {
+    return new_str_variant(bool_value(obj) ? "true" : "false");
 }
 
-static unsigned hash(bool_instance *obj) {
-    return (unsigned)(obj->value);
+static unsigned hash(variant *obj) {
+    return (unsigned)bool_value(obj);
 }
 
-static int compare(bool_instance *a, bool_instance *b) {
-    return a->value - b->value;
+static int compare(variant *a, variant *b) {
+    return bool_value(a) - bool_value(b);
 }
 
-static bool are_equal(bool_instance *a, bool_instance *b) {
-    return a->value == b->value;
+static bool are_equal(variant *a, variant *b) {
+    return bool_value(a) == bool_value(b);
 }
 
 variant_type *bool_type = &(variant_type){
@@ -42,27 +29,21 @@ variant_type *bool_type = &(variant_type){
     
     .name = "bool",
     .parent_type = NULL,
-    .instance_size = sizeof(bool_instance),
+    .instance_size = 0,
+    .immediate_tag = VARIANT_TAG_BOOL,
 
-    .initializer = (initialize_func)initialize,
-    .destructor = (destruct_func)destruct,
-    .copy_initializer = (copy_initializer_func)copy_initialize,
-    .stringifier = (stringifier_func)stringify,
-    .hasher = (hashing_func)hash,
-    .comparer = (compare_func)compare,
-    .equality_checker = (equals_func)are_equal
+    .stringifier = stringify,
+    .hasher = hash,
+    .comparer = compare,
+    .equality_checker = are_equal
 };
 
 variant *new_bool_variant(bool value) {
-    execution_outcome ex = variant_create(bool_type, NULL, NULL);
-    if (ex.failed || ex.excepted) return NULL;
-    bool_instance *i = (bool_instance *)ex.result;
-    i->value = value;
-    return (variant *)i;
+    return new_immediate_variant(VARIANT_TAG_BOOL, value ? 1 : 0);
 }
 
 bool bool_variant_as_bool(variant *v) {
-    if (!variant_instance_of(v, bool_type))
+    if (variant_immediate_tag(v) != VARIANT_TAG_BOOL)
         return 0;
-    return ((bool_instance *)v)->value;
+    return bool_value(v);
 }
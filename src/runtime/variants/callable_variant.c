@@ -25,19 +25,27 @@ static variant *instance_stringify(callable_instance *obj) {
         return NULL;
     
     if (obj->this != NULL)
-        return new_str_variant("%s.%s()", obj->this->_type->name, obj->name);
+        return new_str_variant("%s.%s()", variant_type_of(obj->this)->name, obj->name);
     else if (obj->name != NULL)
         return new_str_variant("%s()", obj->name);
     else
         return new_str_variant("(callable @ 0x%p", obj);
 }
 
-static execution_outcome instance_call(variant *obj, list *arg_values, variant *this_obj, origin *call_origin, exec_context *ctx) {
+static void instance_traverse(callable_instance *obj, visit_func visit, void *data) {
+    visit(obj->this, data);
+    if (obj->captured_values != NULL)
+        dict_visit_items(obj->captured_values, (visit_item_func)visit, data);
+    if (obj->callable != NULL)
+        callable_traverse(obj->callable, visit, data);
+}
+
+static execution_outcome instance_call(variant *obj, int argc, variant **argv, variant *this_obj, origin *call_origin, exec_context *ctx) {
     callable_instance *c = (callable_instance *)obj;
     if (c->callable == NULL)
         return failed_outcome("Callable variant was not correctly setup");
     
-    return callable_call(c->callable, arg_values, NULL, call_origin, ctx);
+    return callable_call(c->callable, argc, argv, NULL, call_origin, ctx);
 }
 
 variant_type *callable_type = &(variant_type){
@@ -50,10 +58,11 @@ variant_type *callable_type = &(variant_type){
 
     .stringifier = (stringifier_func)instance_stringify,
     .call_handler = instance_call, // don't cast, so that we get warnings when handler arguments change.
+    .traverser = (traverse_func)instance_traverse,
 };
 
 variant *new_callable_variant(callable *c) {
-    execution_outcome ex = variant_create(callable_type, NULL, NULL);
+    execution_outcome ex = variant_create(callable_type, 0, NULL, NULL);
     if (ex.failed || ex.excepted) return NULL;
     callable_instance *obj = (callable_instance *)ex.result;
     obj->callable = c;
@@ -0,0 +1,62 @@
+#include "_internal.h"
+#include <string.h>
+#include <stdio.h>
+
+
+typedef struct cell_instance {
+    BASE_VARIANT_FIRST_ATTRIBUTES;
+    variant *value;
+} cell_instance;
+
+static execution_outcome initialize(cell_instance *obj, int argc, variant **argv, exec_context *ctx) {
+    obj->value = NULL;
+    return ok_outcome(NULL);
+}
+
+static void destruct(cell_instance *obj) {
+    if (obj->value != NULL)
+        variant_drop_ref(obj->value);
+}
+
+static void traverse(cell_instance *obj, visit_func visit, void *data) {
+    visit(obj->value, data);
+}
+
+static variant *stringify(cell_instance *obj) {
+    return obj->value == NULL ? new_str_variant("(empty cell)") : variant_to_string(obj->value);
+}
+
+variant_type *cell_type = &(variant_type){
+    ._type = NULL,
+    ._references_count = VARIANT_STATICALLY_ALLOCATED,
+    
+    .name = "cell",
+    .parent_type = NULL,
+    .instance_size = sizeof(cell_instance),
+
+    .initializer = (initialize_func)initialize,
+    .destructor = (destruct_func)destruct,
+    .stringifier = (stringifier_func)stringify,
+    .traverser = (traverse_func)traverse,
+};
+
+variant *new_cell_variant(variant *value) {
+    execution_outcome ex = variant_create(cell_type, 0, NULL, NULL);
+    if (ex.failed || ex.excepted) return NULL;
+    cell_variant_set(ex.result, value);
+    return ex.result;
+}
+
+variant *cell_variant_get(variant *cell) {
+    return ((cell_instance *)cell)->value;
+}
+
+void cell_variant_set(variant *cell, variant *value) {
+    cell_instance *obj = (cell_instance *)cell;
+    variant_gc_write_barrier(cell);
+    if (value != NULL)
+        variant_inc_ref(value);
+    if (obj->value != NULL)
+        variant_drop_ref(obj->value);
+    obj->value = value;
+}
@@ -0,0 +1,19 @@
+#ifndef _CELL_VARIANT_H
+#define _CELL_VARIANT_H
+
+#include "../framework/_framework.h"
+
+/*
+    A cell holds a local symbol that closures share with the function
+    they were created in, so changes are seen on both sides.
+    Cells live in frame slots and captured values, they are never
+    values of the script themselves; their value is NULL until assigned.
+*/
+
+extern variant_type *cell_type;
+
+variant *new_cell_variant(variant *value);
+variant *cell_variant_get(variant *cell);
+void cell_variant_set(variant *cell, variant *value);
+
+#endif
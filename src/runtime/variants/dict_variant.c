@@ -7,23 +7,48 @@
 typedef struct dict_instance {
     BASE_VARIANT_FIRST_ATTRIBUTES;
     dict *dict;
+    bool shared; // the dict of a constant template, copied before the first change
 } dict_instance;
 
-static execution_outcome initialize(dict_instance *obj, variant *args, exec_context *ctx) {
+static execution_outcome initialize(dict_instance *obj, int argc, variant **argv, exec_context *ctx) {
     // this dict shall contain variants
     obj->dict = new_dict(variant_item_info);
     return ok_outcome(NULL);
 }
 
-static void destruct(dict_instance *obj) {
-    // drop references for any contained items before we drop the dict
-    for_dict(obj->dict, it, variant, key) {
-        variant_drop_ref(key);
-        variant_drop_ref((variant *)dict_get(obj->dict, str_variant_as_str(key)));
+// gets a dict of its own, before changing it
+static void own_dict(dict_instance *obj) {
+    if (!obj->shared)
+        return;
+
+    dict *copy = new_dict(variant_item_info);
+    for_dict(obj->dict, it, const_char, key) {
+        variant *item = dict_get(obj->dict, key);
+        variant_inc_ref(item);
+        dict_set(copy, key, item);
     }
+    obj->dict = copy;
+    obj->shared = false;
+}
+
+static void drop_item(variant *item, void *data) {
+    variant_drop_ref(item);
+}
+
+static void destruct(dict_instance *obj) {
+    if (obj->shared)
+        return;
+
+    // drop references for any contained items before we drop the dict.
+    // keys are plain strings, owned by the dict.
+    dict_visit_items(obj->dict, (visit_item_func)drop_item, NULL);
     dict_free(obj->dict);
 }
 
+static void traverse(dict_instance *obj, visit_func visit, void *data) {
+    dict_visit_items(obj->dict, (visit_item_func)visit, data);
+}
+
 static variant *stringify(dict_instance *obj) {
     variant *key_separator = new_str_variant(": ");
     variant *entries_separator = new_str_variant(", ");
@@ -81,6 +106,8 @@ static execution_outcome set_element(dict_instance *obj, variant *index, variant
             "dict elements must be indexed by strings"));
         
     const char *key = str_variant_as_str(index);
+    own_dict(obj);
+    variant_gc_write_barrier((variant *)obj);
     
     if (!dict_has(obj->dict, key)) {
         dict_set(obj->dict, key, value);
@@ -114,10 +141,11 @@ variant_type *dict_type = &(variant_type){
     .equality_checker = (equals_func)are_equal,
     .get_element = (get_element_func)get_element,
     .set_element = (set_element_func)set_element,
+    .traverser = (traverse_func)traverse,
 };
 
 variant *new_dict_variant() {
-    execution_outcome ex = variant_create(dict_type, NULL, NULL);
+    execution_outcome ex = variant_create(dict_type, 0, NULL, NULL);
     if (ex.failed || ex.excepted) return NULL;
     return (variant *)ex.result;
 }
@@ -137,10 +165,19 @@ variant *new_dict_variant_of(int entries_count, ...) {
 
 variant *new_dict_variant_owning(dict *dict) {
     dict_instance *obj = (dict_instance *)new_dict_variant();
+    dict_free(obj->dict);
     obj->dict = dict;
     return (variant *)obj;
 }
 
+variant *new_dict_variant_sharing(variant *template) {
+    dict_instance *obj = (dict_instance *)new_dict_variant();
+    dict_free(obj->dict);
+    obj->dict = ((dict_instance *)template)->dict;
+    obj->shared = true;
+    return (variant *)obj;
+}
+
 dict *dict_variant_as_dict(variant *v) {
     if (!variant_instance_of(v, dict_type))
         return NULL;
@@ -155,6 +192,8 @@ void dict_variant_set(variant *v, variant *key, variant *item) {
     if (!variant_instance_of(key, str_type))
         return; // exception?
 
+    own_dict(obj);
+    variant_gc_write_barrier(v);
     dict_set(obj->dict, str_variant_as_str(key), item);
     variant_inc_ref(item);
 }
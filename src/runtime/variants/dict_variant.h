@@ -8,8 +8,9 @@ extern variant_type *dict_type;
 variant *new_dict_variant();
 variant *new_dict_variant_of(int entries_count, ...);
 variant *new_dict_variant_owning(dict *dict);
+variant *new_dict_variant_sharing(variant *template); // of an immortal dict, copied when first changed
 
-dict *dict_variant_as_dict(variant *v); // caller should not free result
+dict *dict_variant_as_dict(variant *v); // caller should not free or change result
 void dict_variant_set(variant *v, variant *key, variant *item);
 
 #endif
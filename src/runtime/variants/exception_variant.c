@@ -1,37 +1,164 @@
 #include "_internal.h"
 #include "../../utils/hash.h"
+#include "../../utils/str.h"
+#include "../../utils/intern.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 
+// messages with more arguments, or conversions not captured, are formatted on creation
+#define MAX_CAPTURED_ARGS  8
+
+typedef struct captured_arg {
+    char conversion;
+    char length;       // 0, 'l' or 'L' for long long
+    union {
+        long long i;
+        double f;
+        const char *s;
+        void *p;
+    } value;
+} captured_arg;
+
+typedef struct trace_entry {
+    const char *func_name;
+    origin *call_origin;
+    int repeats; // further calls of the same function from the same place, i.e. recursion
+} trace_entry;
+
+// long traces keep only their innermost and outermost frames
+#define TRACE_INNERMOST  10
+#define TRACE_OUTERMOST  10
 
 typedef struct exception_instance {
     BASE_VARIANT_FIRST_ATTRIBUTES;
-    char *message;
+    const char *fmt;   // a literal, formatted with the captured arguments when first stringified
+    captured_arg args[MAX_CAPTURED_ARGS];
+    int args_count;
+    char *strings;     // copies of the string arguments
+    variant *value;    // for thrown values, stringified instead of the format
+    char *message;     // formatted once needed
     origin *origin;
     variant *inner;
+    trace_entry *trace; // the functions unwound, innermost first
+    int trace_length;
+    int trace_capacity;
+    int trace_omitted;  // frames dropped between the innermost and the outermost ones
 } exception_instance;
 
-static execution_outcome initialize(exception_instance *obj, variant *args, exec_context *ctx) {
+static execution_outcome initialize(exception_instance *obj, int argc, variant **argv, exec_context *ctx) {
+    obj->fmt = NULL;
+    obj->args_count = 0;
+    obj->strings = NULL;
+    obj->value = NULL;
     obj->message = NULL;
     obj->origin = NULL;
     obj->inner = NULL;
+    obj->trace = NULL;
+    obj->trace_length = 0;
+    obj->trace_capacity = 0;
+    obj->trace_omitted = 0;
     return ok_outcome(NULL);
 }
 
 static void destruct(exception_instance *obj) {
+    if (obj->strings != NULL)
+        free(obj->strings);
     if (obj->message != NULL)
         free(obj->message);
+    if (obj->value != NULL)
+        variant_drop_ref(obj->value);
     if (obj->inner != NULL)
         variant_drop_ref(obj->inner);
+    if (obj->trace != NULL)
+        free(obj->trace);
     // we don't drop origins, they are owned by tokens/AST
 }
 
+// thrown values may be containers, caught exceptions keep them alive
+static void traverse(exception_instance *obj, visit_func visit, void *data) {
+    visit(obj->value, data);
+    visit(obj->inner, data);
+}
+
+static void format_captured(exception_instance *obj, str *s) {
+    const char *p = obj->fmt;
+    int arg_no = 0;
+    char spec[16];
+
+    while (*p != '\0') {
+        if (*p != '%') {
+            str_addc(s, *p++);
+            continue;
+        }
+        if (p[1] == '%') {
+            str_addc(s, '%');
+            p += 2;
+            continue;
+        }
+
+        // copy the specification, up to and including the conversion
+        int len = 0;
+        while (len < (int)sizeof(spec) - 1) {
+            spec[len] = p[len];
+            if (p[len] == obj->args[arg_no].conversion && len > 0) { len++; break; }
+            len++;
+        }
+        spec[len] = '\0';
+        p += len;
+
+        captured_arg *arg = &obj->args[arg_no++];
+        switch (arg->conversion) {
+            case 's':
+                if (len == 2) str_adds(s, arg->value.s == NULL ? "(null)" : arg->value.s);
+                else str_addf(s, spec, arg->value.s);
+                break;
+            case 'f': case 'g': case 'e':
+                str_addf(s, spec, arg->value.f);
+                break;
+            case 'p':
+                str_addf(s, spec, arg->value.p);
+                break;
+            default:
+                if (arg->length == 'L') str_addf(s, spec, arg->value.i);
+                else if (arg->length == 'l') str_addf(s, spec, (long)arg->value.i);
+                else str_addf(s, spec, (int)arg->value.i);
+                break;
+        }
+    }
+}
+
+// messages are freed with the allocator of this file, not the one strdup() uses
+static char *copy_of(const char *s) {
+    char *copy = malloc(strlen(s) + 1);
+    strcpy(copy, s);
+    return copy;
+}
+
+static const char *exception_message(exception_instance *obj) {
+    if (obj->message != NULL)
+        return obj->message;
+
+    str *s = new_str();
+    if (obj->value != NULL) {
+        variant *v = variant_to_string(obj->value);
+        str_adds(s, str_variant_as_str(v));
+        variant_drop_ref(v);
+    } else if (obj->fmt != NULL) {
+        format_captured(obj, s);
+    }
+    obj->message = copy_of(str_cstr(s));
+    str_free(s);
+    return obj->message;
+}
+
 static variant *stringify(exception_instance *obj) {
     // we should append the inner exceptions recursively...
+    const char *message = exception_message(obj);
     if (obj->origin == NULL)
-        return new_str_variant("%s", obj->message);
+        return new_str_variant("%s", message);
     else
-        return new_str_variant("%s, at %s:%d:%d", obj->message, obj->origin->filename, obj->origin->line_no, obj->origin->column_no);
+        return new_str_variant("%s, at %s:%d:%d", message, obj->origin->filename, obj->origin->line_no, obj->origin->column_no);
 }
 
 variant_type *exception_type = &(variant_type){
@@ -45,50 +172,180 @@ variant_type *exception_type = &(variant_type){
     .initializer = (initialize_func)initialize,
     .destructor = (destruct_func)destruct,
     .stringifier = (stringifier_func)stringify,
+    .traverser = (traverse_func)traverse,
 };
 
-static char *duplicate(const char *src) {
-    if (src == NULL)
-        return NULL;
+// reads the arguments of the conversions in the format, false if one cannot be captured
+static bool capture_args(exception_instance *obj, const char *fmt, va_list args) {
+    int strings_size = 0;
+
+    for (const char *p = fmt; *p != '\0'; p++) {
+        if (*p != '%')
+            continue;
+        if (p[1] == '%') {
+            p++;
+            continue;
+        }
+
+        p++;
+        while (strchr("-+ #0123456789.", *p) != NULL && *p != '\0')
+            p++;
+        char length = 0;
+        if (*p == 'l') { length = 'l'; p++; }
+        if (*p == 'l') { length = 'L'; p++; }
+        if (*p == 'z') { length = 'L'; p++; }
+
+        if (obj->args_count == MAX_CAPTURED_ARGS)
+            return false;
+        captured_arg *arg = &obj->args[obj->args_count++];
+        arg->conversion = *p;
+        arg->length = length;
 
-    char *p = malloc(strlen(src) + 1);
-    strcpy(p, src);
-    return p;
+        switch (*p) {
+            case 'd': case 'i':
+                arg->value.i = length == 'L' ? va_arg(args, long long) : length == 'l' ? va_arg(args, long) : va_arg(args, int);
+                break;
+            case 'u': case 'x': case 'X': case 'o': case 'c':
+                arg->value.i = length == 'L' ? (long long)va_arg(args, unsigned long long) : length == 'l' ? (long long)va_arg(args, unsigned long) : (long long)va_arg(args, unsigned int);
+                break;
+            case 'f': case 'g': case 'e':
+                arg->value.f = va_arg(args, double);
+                break;
+            case 'p':
+                arg->value.p = va_arg(args, void *);
+                break;
+            case 's':
+                arg->value.s = va_arg(args, const char *);
+                if (arg->value.s != NULL && !is_interned(arg->value.s))
+                    strings_size += strlen(arg->value.s) + 1;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    // the arguments may not outlive the call, symbols do
+    if (strings_size > 0) {
+        obj->strings = malloc(strings_size);
+        char *copy = obj->strings;
+        for (int i = 0; i < obj->args_count; i++) {
+            captured_arg *arg = &obj->args[i];
+            if (arg->conversion != 's' || arg->value.s == NULL || is_interned(arg->value.s))
+                continue;
+            strcpy(copy, arg->value.s);
+            arg->value.s = copy;
+            copy += strlen(copy) + 1;
+        }
+    }
+    return true;
 }
 
-static char *format_message(const char *fmt, va_list args) {
+static void set_message(exception_instance *obj, const char *fmt, va_list args) {
+    va_list captured;
+    va_copy(captured, args);
+    bool ok = capture_args(obj, fmt, captured);
+    va_end(captured);
+
+    if (ok) {
+        obj->fmt = fmt;
+        return;
+    }
+
     char temp[256];
     vsnprintf(temp, sizeof(temp), fmt, args);
-    char *p = malloc(strlen(temp) + 1);
-    strcpy(p, temp);
-    return p;
+    obj->message = copy_of(temp);
+    obj->args_count = 0;
 }
 
 
 // TODO: make everything have origin and call `new_exception_at()`
 variant *new_exception_variant(const char *fmt, ...) {
-    execution_outcome ex = variant_create(exception_type, NULL, NULL);
+    execution_outcome ex = variant_create(exception_type, 0, NULL, NULL);
     if (ex.failed || ex.excepted) return NULL;
     exception_instance *e = (exception_instance *)ex.result;
 
     va_list args;
     va_start(args, fmt);
-    e->message = format_message(fmt, args);
+    set_message(e, fmt, args);
     va_end(args);
 
     return (variant *)e;
 }
 
 variant *new_exception_variant_at(origin *origin, variant *inner, const char *fmt, ...) {
-    execution_outcome ex = variant_create(exception_type, NULL, NULL);
+    execution_outcome ex = variant_create(exception_type, 0, NULL, NULL);
     if (ex.failed || ex.excepted) return NULL;
     exception_instance *e = (exception_instance *)ex.result;
 
     va_list args;
     va_start(args, fmt);
-    e->message = format_message(fmt, args);
+    set_message(e, fmt, args);
     va_end(args);
     e->origin = origin;
     
     return (variant *)e;
 }
+
+variant *new_thrown_exception_variant(origin *origin, variant *value) {
+    execution_outcome ex = variant_create(exception_type, 0, NULL, NULL);
+    if (ex.failed || ex.excepted) return NULL;
+    exception_instance *e = (exception_instance *)ex.result;
+
+    if (value != NULL)
+        variant_inc_ref(value);
+    e->value = value;
+    e->origin = origin;
+
+    return (variant *)e;
+}
+
+void exception_variant_add_trace(variant *v, const char *func_name, origin *call_origin) {
+    if (!variant_instance_of(v, exception_type))
+        return;
+    exception_instance *e = (exception_instance *)v;
+
+    if (e->trace_length > 0) {
+        trace_entry *last = &e->trace[e->trace_length - 1];
+        if (last->call_origin == call_origin && strcmp(last->func_name, func_name) == 0) {
+            last->repeats++;
+            return;
+        }
+    }
+
+    if (e->trace_length == TRACE_INNERMOST + TRACE_OUTERMOST) {
+        trace_entry *dropped = &e->trace[TRACE_INNERMOST];
+        e->trace_omitted += 1 + dropped->repeats;
+        memmove(dropped, dropped + 1, (TRACE_OUTERMOST - 1) * sizeof(trace_entry));
+        e->trace_length--;
+    }
+
+    if (e->trace_length == e->trace_capacity) {
+        e->trace_capacity = e->trace_capacity == 0 ? 8 : e->trace_capacity * 2;
+        e->trace = e->trace == NULL ?
+            malloc(e->trace_capacity * sizeof(trace_entry)) :
+            realloc(e->trace, e->trace_capacity * sizeof(trace_entry));
+    }
+    e->trace[e->trace_length].func_name = func_name;
+    e->trace[e->trace_length].call_origin = call_origin;
+    e->trace[e->trace_length].repeats = 0;
+    e->trace_length++;
+}
+
+void exception_variant_describe_trace(variant *v, str *str) {
+    if (!variant_instance_of(v, exception_type))
+        return;
+    exception_instance *e = (exception_instance *)v;
+
+    for (int i = 0; i < e->trace_length; i++) {
+        trace_entry *t = &e->trace[i];
+        if (t->call_origin == NULL)
+            str_addf(str, "    in %s()\n", t->func_name);
+        else
+            str_addf(str, "    in %s(), called at %s:%d:%d\n", t->func_name,
+                t->call_origin->filename, t->call_origin->line_no, t->call_origin->column_no);
+        if (t->repeats > 0)
+            str_addf(str, "    ... %d more in %s()\n", t->repeats, t->func_name);
+        if (i == TRACE_INNERMOST - 1 && e->trace_omitted > 0)
+            str_addf(str, "    ... %d more frames\n", e->trace_omitted);
+    }
+}
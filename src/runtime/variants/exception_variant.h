@@ -2,11 +2,24 @@
 #define _EXCEPTION_VARIANT_H
 
 #include "../framework/_framework.h"
+#include "../../utils/str.h"
 
 extern variant_type *exception_type;
 
+/*
+    Exceptions keep their format (a literal) and its arguments,
+    the message is formatted only if the exception is stringified.
+    As an exception propagates out of each function, the function
+    and the origin of its call are appended to its stack trace.
+    Recursive calls are counted instead of appended, and long traces
+    keep only their innermost and outermost frames.
+*/
 variant *new_exception_variant(const char *fmt, ...);
 variant *new_exception_variant_at(origin *origin, variant *inner, const char *fmt, ...);
+variant *new_thrown_exception_variant(origin *origin, variant *value); // message is the value stringified, if any
+
+void exception_variant_add_trace(variant *v, const char *func_name, origin *call_origin);
+void exception_variant_describe_trace(variant *v, str *str); // one line per function, innermost first
 
 
 #endif
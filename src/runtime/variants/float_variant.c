@@ -4,39 +4,32 @@
 #include <float.h>
 
 
-typedef struct float_instance {
-    BASE_VARIANT_FIRST_ATTRIBUTES;
+// floats are immediates, the bits of the value live in the variant pointer.
+static inline float float_value(variant *v) {
+    uint32_t bits = variant_immediate_payload(v);
     float value;
-} float_instance;
-
-static execution_outcome initialize(float_instance *obj, variant *args, exec_context *ctx) {
-    obj->value = 0.0;
-    return ok_outcome(NULL);
-}
-
-static void destruct(float_instance *obj) {
-}
-
-static void copy_initialize(float_instance *obj, float_instance *original) {
-    obj->value = original->value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
 }
 
-static variant *stringify(float_instance *obj) {
+static variant *stringify(variant *obj) {
     char buffer[128];
-    snprintf(buffer, sizeof(buffer), "%f", obj->value);
+    snprintf(buffer, sizeof(buffer), "%f", float_value(obj));
     return new_str_variant(buffer);
 }
 
-static unsigned hash(float_instance *obj) {
-    return (unsigned)(obj->value);
+static unsigned hash(variant *obj) {
+    return (unsigned)float_value(obj);
 }
 
-static int compare(float_instance *a, float_instance *b) {
-    return (a > b) ? 1 : (a < b ? -1 : 0);
+static int compare(variant *a, variant *b) {
+    float fa = float_value(a), fb = float_value(b);
+    return (fa > fb) ? 1 : (fa < fb ? -1 : 0);
 }
 
-static bool are_equal(float_instance *a, float_instance *b) {
-    return (a > b) ? ((a - b) < FLT_EPSILON) : ((b - a) < FLT_EPSILON);
+static bool are_equal(variant *a, variant *b) {
+    float fa = float_value(a), fb = float_value(b);
+    return (fa > fb) ? ((fa - fb) < FLT_EPSILON) : ((fb - fa) < FLT_EPSILON);
 }
 
 variant_type *float_type = &(variant_type){
@@ -45,27 +38,23 @@ variant_type *float_type = &(variant_type){
     
     .name = "float",
     .parent_type = NULL,
-    .instance_size = sizeof(float_instance),
+    .instance_size = 0,
+    .immediate_tag = VARIANT_TAG_FLOAT,
 
-    .initializer = (initialize_func)initialize,
-    .destructor = (destruct_func)destruct,
-    .copy_initializer = (copy_initializer_func)copy_initialize,
-    .stringifier = (stringifier_func)stringify,
-    .hasher = (hashing_func)hash,
-    .comparer = (compare_func)compare,
-    .equality_checker = (equals_func)are_equal
+    .stringifier = stringify,
+    .hasher = hash,
+    .comparer = compare,
+    .equality_checker = are_equal
 };
 
 variant *new_float_variant(float value) {
-    execution_outcome ex = variant_create(float_type, NULL, NULL);
-    if (ex.failed || ex.excepted) return NULL;
-    float_instance *i = (float_instance *)ex.result;
-    i->value = value;
-    return (variant *)i;
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return new_immediate_variant(VARIANT_TAG_FLOAT, bits);
 }
 
 float float_variant_as_float(variant *v) {
-    if (!variant_instance_of(v, float_type))
+    if (variant_immediate_tag(v) != VARIANT_TAG_FLOAT)
         return 0;
-    return ((float_instance *)v)->value;
+    return float_value(v);
 }
@@ -3,39 +3,26 @@
 #include <stdio.h>
 
 
-typedef struct int_instance {
-    BASE_VARIANT_FIRST_ATTRIBUTES;
-    int value;
-} int_instance;
+// ints are immediates, the value lives in the variant pointer.
+#define int_value(v)    ((int)variant_immediate_payload(v))
 
-static execution_outcome initialize(int_instance *obj, variant *args, exec_context *ctx) {
-    obj->value = 0;
-    return ok_outcome(NULL);
-}
-
-static void destruct(int_instance *obj) {
-}
-
-static void copy_initialize(int_instance *obj, int_instance *original) {
-    obj->value = original->value;
-}
 
-static variant *stringify(int_instance *obj) {
+static variant *stringify(variant *obj) {
     char buffer[128];
-    snprintf(buffer, sizeof(buffer), "%d", obj->value);
+    snprintf(buffer, sizeof(buffer), "%d", int_value(obj));
     return new_str_variant(buffer);
 }
 
-static unsigned hash(int_instance *obj) {
-    return (unsigned)(obj->value);
+static unsigned hash(variant *obj) {
+    return (unsigned)int_value(obj);
 }
 
-static int compare(int_instance *a, int_instance *b) {
-    return a->value - b->value;
+static int compare(variant *a, variant *b) {
+    return int_value(a) - int_value(b);
 }
 
-static bool are_equal(int_instance *a, int_instance *b) {
-    return a->value == b->value;
+static bool are_equal(variant *a, variant *b) {
+    return int_value(a) == int_value(b);
 }
 
 variant_type *int_type = &(variant_type){
@@ -44,27 +31,21 @@ variant_type *int_type = &(variant_type){
     
     .name = "int",
     .parent_type = NULL,
-    .instance_size = sizeof(int_instance),
+    .instance_size = 0,
+    .immediate_tag = VARIANT_TAG_INT,
 
-    .initializer = (initialize_func)initialize,
-    .destructor = (destruct_func)destruct,
-    .copy_initializer = (copy_initializer_func)copy_initialize,
-    .stringifier = (stringifier_func)stringify,
-    .hasher = (hashing_func)hash,
-    .comparer = (compare_func)compare,
-    .equality_checker = (equals_func)are_equal
+    .stringifier = stringify,
+    .hasher = hash,
+    .comparer = compare,
+    .equality_checker = are_equal
 };
 
 variant *new_int_variant(int value) {
-    execution_outcome ex = variant_create(int_type, NULL, NULL);
-    if (ex.failed || ex.excepted) return NULL;
-    int_instance *i = (int_instance *)ex.result;
-    i->value = value;
-    return (variant *)i;
+    return new_immediate_variant(VARIANT_TAG_INT, value);
 }
 
 int int_variant_as_int(variant *v) {
-    if (!variant_instance_of(v, int_type))
+    if (variant_immediate_tag(v) != VARIANT_TAG_INT)
         return 0;
-    return ((int_instance *)v)->value;
+    return int_value(v);
 }
@@ -7,22 +7,46 @@
 typedef struct list_instance {
     BASE_VARIANT_FIRST_ATTRIBUTES;
     list *list;
+    bool shared; // the list of a constant template, copied before the first change
 } list_instance;
 
-static execution_outcome initialize(list_instance *obj, variant *args, exec_context *ctx) {
+static execution_outcome initialize(list_instance *obj, int argc, variant **argv, exec_context *ctx) {
     // this list shall contain variants
     obj->list = new_list(variant_item_info);
     return ok_outcome(NULL);
 }
 
-static void destruct(list_instance *obj) {
-    // drop references for any contained items before we drop the list
+// gets a list of its own, before changing it
+static void own_list(list_instance *obj) {
+    if (!obj->shared)
+        return;
+
+    list *copy = new_list(variant_item_info);
     for_list(obj->list, it, variant, item) {
-        variant_drop_ref(item);
+        variant_inc_ref(item);
+        list_add(copy, item);
     }
+    obj->list = copy;
+    obj->shared = false;
+}
+
+static void drop_item(variant *item, void *data) {
+    variant_drop_ref(item);
+}
+
+static void destruct(list_instance *obj) {
+    if (obj->shared)
+        return;
+
+    // drop references for any contained items before we drop the list
+    list_visit_items(obj->list, (visit_item_func)drop_item, NULL);
     list_free(obj->list);
 }
 
+static void traverse(list_instance *obj, visit_func visit, void *data) {
+    list_visit_items(obj->list, (visit_item_func)visit, data);
+}
+
 static variant *stringify(list_instance *obj) {
     variant *separator = new_str_variant(", ");
     variant *result = new_str_variant("");
@@ -77,6 +101,8 @@ static execution_outcome set_element(list_instance *obj, variant *index, variant
         return exception_outcome(new_exception_variant(
             "index %d outside of list bounds (%d..%d)", i, 0, list_length(obj->list)));
     
+    own_list(obj);
+    variant_gc_write_barrier((variant *)obj);
     if (i == list_length(obj->list)) {
         list_add(obj->list, value);
         variant_inc_ref(value);
@@ -93,35 +119,37 @@ static execution_outcome set_element(list_instance *obj, variant *index, variant
     return ok_outcome(NULL);
 }
 
-static execution_outcome method_empty(list_instance *this, variant_method_definition *method, list *args, origin *call_origin, exec_context *ctx) {
+static execution_outcome method_empty(list_instance *this, variant_method_definition *method, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
     return ok_outcome(new_bool_variant(list_empty(this->list)));
 }
 
-static execution_outcome method_legth(list_instance *this, variant_method_definition *method, list *args, origin *call_origin, exec_context *ctx) {
+static execution_outcome method_legth(list_instance *this, variant_method_definition *method, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
     return ok_outcome(new_int_variant(list_length(this->list)));
 }
 
-static execution_outcome method_add(list_instance *this, variant_method_definition *method, list *args, origin *call_origin, exec_context *ctx) {
-    if (list_length(args) < 1)
+static execution_outcome method_add(list_instance *this, variant_method_definition *method, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
+    if (argc < 1)
         return exception_outcome(new_exception_variant("expected the item to add as argument"));
     
-    variant *item = list_get(args, 0);
+    variant *item = argv[0];
+    own_list(this);
+    variant_gc_write_barrier((variant *)this);
     variant_inc_ref(item);
     list_add(this->list, item);
+    return ok_outcome(void_singleton);
 }
 
-static execution_outcome method_filter(list_instance *this, variant_method_definition *method, list *args, origin *call_origin, exec_context *ctx) {
-    if (list_length(args) < 1)
+static execution_outcome method_filter(list_instance *this, variant_method_definition *method, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
+    if (argc < 1)
         return exception_outcome(new_exception_variant("expected the filtering function as argument"));
     
-    variant *func = (variant *)list_get(args, 0);
+    variant *func = argv[0];
     list *filtered_list = new_list(variant_item_info);
     int index = 0;
     
     for_list(this->list, it, variant, item) {
-        list *func_args = list_of(variant_item_info, 3, item, new_int_variant(index), this);
-        execution_outcome ex = variant_call(func, func_args, NULL, call_origin, ctx);
-        list_free(func_args);
+        variant *func_args[] = { item, new_int_variant(index), (variant *)this };
+        execution_outcome ex = variant_call(func, 3, func_args, NULL, call_origin, ctx);
 
         if (ex.excepted || ex.failed) return ex;
         if (!variant_instance_of(ex.result, bool_type))
@@ -137,18 +165,17 @@ static execution_outcome method_filter(list_instance *this, variant_method_defin
     return ok_outcome(new_list_variant_owning(filtered_list));
 }
 
-static execution_outcome method_map(list_instance *this, variant_method_definition *method, list *args, origin *call_origin, exec_context *ctx) {
-    if (list_length(args) < 1)
+static execution_outcome method_map(list_instance *this, variant_method_definition *method, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
+    if (argc < 1)
         return exception_outcome(new_exception_variant("expected the mapping function as argument"));
     
-    variant *func = (variant *)list_get(args, 0);
+    variant *func = argv[0];
     list *mapped_list = new_list(variant_item_info);
     int index = 0;
     
     for_list(this->list, it, variant, item) {
-        list *func_args = list_of(variant_item_info, 3, item, new_int_variant(index), this);
-        execution_outcome ex = variant_call(func, func_args, NULL, call_origin, ctx);
-        list_free(func_args);
+        variant *func_args[] = { item, new_int_variant(index), (variant *)this };
+        execution_outcome ex = variant_call(func, 3, func_args, NULL, call_origin, ctx);
 
         if (ex.excepted || ex.failed) return ex;
         list_add(mapped_list, ex.result);
@@ -158,17 +185,16 @@ static execution_outcome method_map(list_instance *this, variant_method_definiti
     return ok_outcome(new_list_variant_owning(mapped_list));
 }
 
-static execution_outcome method_reduce(list_instance *this, variant_method_definition *method, list *args, origin *call_origin, exec_context *ctx) {
-    if (list_length(args) < 2)
+static execution_outcome method_reduce(list_instance *this, variant_method_definition *method, int argc, variant **argv, origin *call_origin, exec_context *ctx) {
+    if (argc < 2)
         return exception_outcome(new_exception_variant("expected (start value, aggregating function) as arguments"));
-    variant *value = list_get(args, 0);
-    variant *aggregator = list_get(args, 1);
+    variant *value = argv[0];
+    variant *aggregator = argv[1];
     int index = 0;
     
     for_list(this->list, it, variant, item) {
-        list *func_args = list_of(variant_item_info, 4, value, item, new_int_variant(index), this);
-        execution_outcome ex = variant_call(aggregator, func_args, NULL, call_origin, ctx);
-        list_free(func_args);
+        variant *func_args[] = { value, item, new_int_variant(index), (variant *)this };
+        execution_outcome ex = variant_call(aggregator, 4, func_args, NULL, call_origin, ctx);
 
         if (ex.excepted || ex.failed) return ex;
         value = ex.result;
@@ -215,12 +241,13 @@ variant_type *list_type = &(variant_type){
     .equality_checker = (equals_func)are_equal,
     .get_element = (get_element_func)get_element,
     .set_element = (set_element_func)set_element,
+    .traverser = (traverse_func)traverse,
 
     .methods = methods,
 };
 
 variant *new_list_variant() {
-    execution_outcome ex = variant_create(list_type, NULL, NULL);
+    execution_outcome ex = variant_create(list_type, 0, NULL, NULL);
     if (ex.failed || ex.excepted) return NULL;
     return (variant *)ex.result;
 }
@@ -239,10 +266,19 @@ variant *new_list_variant_of(int argc, ...) {
 
 variant *new_list_variant_owning(list *list) {
     list_instance *l = (list_instance *)new_list_variant();
+    list_free(l->list);
     l->list = list;
     return (variant *)l;
 }
 
+variant *new_list_variant_sharing(variant *template) {
+    list_instance *l = (list_instance *)new_list_variant();
+    list_free(l->list);
+    l->list = ((list_instance *)template)->list;
+    l->shared = true;
+    return (variant *)l;
+}
+
 list *list_variant_as_list(variant *v) {
     if (!variant_instance_of(v, list_type))
         return NULL;
@@ -8,7 +8,8 @@ extern variant_type *list_type;
 variant *new_list_variant();
 variant *new_list_variant_of(int argc, ...);
 variant *new_list_variant_owning(list *list);
+variant *new_list_variant_sharing(variant *template); // of an immortal list, copied when first changed
 
-list *list_variant_as_list(variant *v); // caller should not free result
+list *list_variant_as_list(variant *v); // caller should not free or change result
 
 #endif
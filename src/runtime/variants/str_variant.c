@@ -21,7 +21,7 @@ static void ensure_capacity(str_instance *obj, int capacity) {
     obj->buffer = realloc(obj->buffer, obj->capacity);
 }
 
-static execution_outcome initialize(str_instance *obj, variant *args, exec_context *ctx) {
+static execution_outcome initialize(str_instance *obj, int argc, variant **argv, exec_context *ctx) {
     obj->capacity = 16;
     obj->buffer = malloc(obj->capacity);
     obj->length = 0;
@@ -35,6 +35,11 @@ static void destruct(str_instance *obj) {
     }
 }
 
+// strings hold no variants, but are tracked like containers,
+// as their holders do not always count their references.
+static void traverse(str_instance *obj, visit_func visit, void *data) {
+}
+
 static void copy_initialize(str_instance *obj, str_instance *original) {
     obj->capacity = original->capacity;
     obj->buffer = malloc(obj->capacity);
@@ -77,11 +82,12 @@ variant_type *str_type = &(variant_type){
     .stringifier = (stringifier_func)stringify,
     .hasher = (hashing_func)hash,
     .comparer = (compare_func)compare,
-    .equality_checker = (equals_func)are_equal
+    .equality_checker = (equals_func)are_equal,
+    .traverser = (traverse_func)traverse
 };
 
 variant *new_str_variant(const char *fmt, ...) {
-    execution_outcome ex = variant_create(str_type, NULL, NULL);
+    execution_outcome ex = variant_create(str_type, 0, NULL, NULL);
     if (ex.failed || ex.excepted) return NULL;
     str_instance *s = (str_instance *)ex.result;
 
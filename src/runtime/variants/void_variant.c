@@ -3,33 +3,21 @@
 #include <stdio.h>
 
 
-typedef struct void_variant_instance {
-    BASE_VARIANT_FIRST_ATTRIBUTES;
-} void_variant_instance;
+// void is an immediate, there is exactly one value of it.
 
-static execution_outcome initialize(void_variant_instance *obj, variant *args, exec_context *ctx) {
-    return ok_outcome(NULL);
-}
-
-static void destruct(void_variant_instance *obj) {
-}
-
-static void copy_initialize(void_variant_instance *obj, void_variant_instance *original) {
-}
-
-static variant *stringify(void_variant_instance *obj) {
+static variant *stringify(variant *obj) {
     return new_str_variant("void");
 }
 
-static unsigned hash(void_variant_instance *obj) {
+static unsigned hash(variant *obj) {
     return 0;
 }
 
-static int compare(void_variant_instance *a, void_variant_instance *b) {
+static int compare(variant *a, variant *b) {
     return 0;
 }
 
-static bool are_equal(void_variant_instance *a, void_variant_instance *b) {
+static bool are_equal(variant *a, variant *b) {
     return true;
 }
 
@@ -39,19 +27,15 @@ variant_type *void_type = &(variant_type){
     
     .name = "void",
     .parent_type = NULL,
-    .instance_size = sizeof(void_variant_instance),
-
-    .initializer = (initialize_func)initialize,
-    .destructor = (destruct_func)destruct,
-    .copy_initializer = (copy_initializer_func)copy_initialize,
-    .stringifier = (stringifier_func)stringify,
-    .hasher = (hashing_func)hash,
-    .comparer = (compare_func)compare,
-    .equality_checker = (equals_func)are_equal
+    .instance_size = 0,
+    .immediate_tag = VARIANT_TAG_VOID,
+
+    .stringifier = stringify,
+    .hasher = hash,
+    .comparer = compare,
+    .equality_checker = are_equal
 };
 
 variant *new_void_variant() {
-    execution_outcome ex = variant_create(void_type, NULL, NULL);
-    if (ex.failed || ex.excepted) return NULL;
-    return ex.result;
+    return new_immediate_variant(VARIANT_TAG_VOID, 0);
 }
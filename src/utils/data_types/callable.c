@@ -35,9 +35,32 @@ const char *callable_name(callable *c) {
     return c->name;
 }
 
+callable_handler *callable_get_handler(callable *c) {
+    return c->handler;
+}
+
+void *callable_ast_node(callable *c) {
+    return c->callable_data;
+}
+
+variant *callable_this_obj(callable *c) {
+    return c->this_obj;
+}
+
+dict *callable_captured_values(callable *c) {
+    return c->captured_values;
+}
+
+void callable_traverse(callable *c, visit_func visit, void *data) {
+    visit(c->this_obj, data);
+    if (c->captured_values != NULL)
+        dict_visit_items(c->captured_values, (visit_item_func)visit, data);
+}
+
 execution_outcome callable_call(
     callable *c,
-    list *arg_values,
+    int argc,
+    variant **argv,
     variant *this_obj,
     origin *call_origin,
     exec_context *ctx
@@ -49,7 +72,8 @@ execution_outcome callable_call(
         this_obj = c->this_obj;
 
     return c->handler(
-        arg_values,
+        argc,
+        argv,
         c->callable_data,
         this_obj,
         c->captured_values,
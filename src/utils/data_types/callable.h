@@ -11,7 +11,8 @@ typedef struct callable callable;
 
 // the C call handler function and it's arguments
 typedef execution_outcome callable_handler(
-    list *arg_values,
+    int argc,
+    variant **argv,
     void *ast_node, // used for AST nodes
     variant *this_obj,
     dict *captured_values, // optional for closures
@@ -29,11 +30,19 @@ callable *new_callable(
 );
 
 const char *callable_name(callable *c);
+callable_handler *callable_get_handler(callable *c);
+void *callable_ast_node(callable *c);
+variant *callable_this_obj(callable *c);
+dict *callable_captured_values(callable *c);
+
+// visits the early bound 'this' and the captured values, if any
+void callable_traverse(callable *c, visit_func visit, void *data);
 
 // passed in at callable call time
 execution_outcome callable_call(
     callable *c, 
-    list *arg_values,  // each item a variant
+    int argc,
+    variant **argv,  // argc variants, valid for the duration of the call
     variant *this_obj, // late binding,
     origin *call_origin,
     exec_context *ctx
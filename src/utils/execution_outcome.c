@@ -4,26 +4,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-execution_outcome ok_outcome(variant *result) {
-    return (execution_outcome){
-        .result = result,
-        .excepted = false,
-        .exception_thrown = NULL,
-        .failed = false,
-        .failure_message = NULL
-    };
-}
-
-execution_outcome exception_outcome(variant *exception) {
-    return (execution_outcome){
-        .result = NULL,
-        .excepted = true,
-        .exception_thrown = exception,
-        .failed = false,
-        .failure_message = NULL
-    };
-}
-
 execution_outcome failed_outcome(const char *fmt, ...) {
     char buffer[256];
 
@@ -36,11 +16,9 @@ execution_outcome failed_outcome(const char *fmt, ...) {
     strcpy(msg, buffer);
 
     return (execution_outcome){
-        .result = NULL,
+        .failure_message = msg,
         .excepted = false,
-        .exception_thrown = NULL,
-        .failed = true,
-        .failure_message = msg
+        .failed = true
     };
 }
 
@@ -7,23 +7,37 @@
 typedef struct variant variant;
 
 // any function can instantiate and return an exception
-// so we need an alternative way to signal a "thrown" exception
+// so we need an alternative way to signal a "thrown" exception.
+// it is returned by value from every executor, so it is kept at two words,
+// that are returned in registers. only one of the pointers is ever set,
+// check the flags before reading any of them.
 typedef struct execution_outcome {
-    // succesful execution
-    variant *result;
+    union {
+        // succesful execution
+        variant *result;
 
-    // exception thrown because of the script (e.g. division by zero)
-    bool excepted;
-    variant *exception_thrown;
+        // exception thrown because of the script (e.g. division by zero)
+        variant *exception_thrown;
 
-    // failure due to our code (e.g. out of memory)
+        // failure due to our code (e.g. out of memory)
+        const char *failure_message;
+    };
+    bool excepted;
     bool failed;
-    const char *failure_message;
 } execution_outcome;
 
+_Static_assert(sizeof(execution_outcome) <= 2 * sizeof(void *), "execution outcomes are returned in two registers");
+
+
+// the common outcomes are built in place, at every return of every executor
+static inline execution_outcome ok_outcome(variant *result) {
+    return (execution_outcome){ .result = result, .excepted = false, .failed = false };
+}
+
+static inline execution_outcome exception_outcome(variant *exception) {
+    return (execution_outcome){ .exception_thrown = exception, .excepted = true, .failed = false };
+}
 
-execution_outcome ok_outcome(variant *result);
-execution_outcome exception_outcome(variant *exception);
 execution_outcome failed_outcome(const char *fmt, ...);
 
 
@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "hash.h"
+#include "intern.h"
+
+// symbols are carved out of chunks of this size, longer ones get a chunk of their own.
+// chunks are aligned to their size, the chunk of any pointer is found by masking it
+#define CHUNK_SIZE  (16 * 1024)
+#define chunk_of(p)  ((p) & ~(uintptr_t)(CHUNK_SIZE - 1))
+
+// symbols point to themselves, pointers into the characters of symbols are not symbols
+typedef struct symbol {
+    struct symbol *self;
+    unsigned hash;
+    char chars[];
+} symbol;
+
+static struct {
+    uintptr_t *chunks; // open addressing, never more than half full
+    unsigned chunks_capacity;
+    unsigned chunks_count;
+    char *free_space;  // in the last chunk
+    int free_size;
+
+    symbol **table;   // open addressing, never more than half full
+    unsigned capacity;
+    unsigned count;
+} symbols = { NULL, 0, 0, NULL, 0, NULL, 0, 0 };
+
+#define symbol_of(s)  ((symbol *)((s) - offsetof(symbol, chars)))
+
+static uintptr_t *chunks_slot(uintptr_t *chunks, unsigned capacity, uintptr_t chunk) {
+    unsigned mask = capacity - 1;
+    unsigned i = (unsigned)(chunk / CHUNK_SIZE) & mask;
+    while (chunks[i] != 0 && chunks[i] != chunk)
+        i = (i + 1) & mask;
+    return &chunks[i];
+}
+
+static void add_chunk(uintptr_t chunk) {
+    if ((symbols.chunks_count + 1) * 2 > symbols.chunks_capacity) {
+        unsigned capacity = symbols.chunks_capacity == 0 ? 16 : symbols.chunks_capacity * 2;
+        uintptr_t *chunks = calloc(capacity, sizeof(uintptr_t));
+        for (unsigned i = 0; i < symbols.chunks_capacity; i++) {
+            if (symbols.chunks[i] != 0)
+                *chunks_slot(chunks, capacity, symbols.chunks[i]) = symbols.chunks[i];
+        }
+        free(symbols.chunks);
+        symbols.chunks = chunks;
+        symbols.chunks_capacity = capacity;
+    }
+    *chunks_slot(symbols.chunks, symbols.chunks_capacity, chunk) = chunk;
+    symbols.chunks_count++;
+}
+
+static symbol *allocate_symbol(int length) {
+    int size = offsetof(symbol, chars) + length + 1;
+    size = (size + sizeof(symbol *) - 1) & ~(sizeof(symbol *) - 1);
+
+    if (size > symbols.free_size) {
+        // only the start of long symbols need be found, their first chunk is enough
+        int chunk_size = (size + CHUNK_SIZE - 1) & ~(CHUNK_SIZE - 1);
+        symbols.free_space = aligned_alloc(CHUNK_SIZE, chunk_size);
+        symbols.free_size = chunk_size;
+        add_chunk((uintptr_t)symbols.free_space);
+    }
+
+    symbol *sym = (symbol *)symbols.free_space;
+    symbols.free_space += size;
+    symbols.free_size -= size;
+    return sym;
+}
+
+static symbol **table_slot(symbol **table, unsigned capacity, const char *s, unsigned hash) {
+    unsigned mask = capacity - 1;
+    unsigned i = hash & mask;
+    while (table[i] != NULL) {
+        if (table[i]->hash == hash && strcmp(table[i]->chars, s) == 0)
+            break;
+        i = (i + 1) & mask;
+    }
+    return &table[i];
+}
+
+static void grow_table() {
+    unsigned capacity = symbols.capacity == 0 ? 1024 : symbols.capacity * 2;
+    symbol **table = calloc(capacity, sizeof(symbol *));
+    for (unsigned i = 0; i < symbols.capacity; i++) {
+        symbol *sym = symbols.table[i];
+        if (sym != NULL)
+            *table_slot(table, capacity, sym->chars, sym->hash) = sym;
+    }
+    free(symbols.table);
+    symbols.table = table;
+    symbols.capacity = capacity;
+}
+
+const char *intern(const char *s) {
+    if (s == NULL || is_interned(s))
+        return s;
+
+    if ((symbols.count + 1) * 2 > symbols.capacity)
+        grow_table();
+
+    int length = strlen(s);
+    unsigned hash = simple_hash((void *)s, length);
+    symbol **slot = table_slot(symbols.table, symbols.capacity, s, hash);
+    if (*slot != NULL)
+        return (*slot)->chars;
+
+    symbol *sym = allocate_symbol(length);
+    sym->self = sym;
+    sym->hash = hash;
+    memcpy(sym->chars, s, length + 1);
+    *slot = sym;
+    symbols.count++;
+    return sym->chars;
+}
+
+bool is_interned(const char *s) {
+    uintptr_t p = (uintptr_t)s - offsetof(symbol, chars);
+    if (s == NULL || symbols.chunks_count == 0 || (p & (sizeof(symbol *) - 1)) != 0)
+        return false;
+
+    // the symbol header is read only within chunks of symbols
+    uintptr_t chunk = chunk_of(p);
+    if (*chunks_slot(symbols.chunks, symbols.chunks_capacity, chunk) != chunk)
+        return false;
+    return ((symbol *)p)->self == (symbol *)p;
+}
+
+unsigned interned_hash(const char *s) {
+    return symbol_of(s)->hash;
+}
@@ -0,0 +1,24 @@
+#ifndef _INTERN_H
+#define _INTERN_H
+
+#include <stdbool.h>
+
+/*
+    Interned strings, i.e. symbols. Equal strings are interned to the same,
+    never freed, copy. Two symbols are equal if their pointers are equal,
+    and their hash is stored with them, it is not computed again.
+    The lexer interns identifiers, so names in the AST are symbols.
+    Containers that key on names use the pointers, falling back to comparing
+    characters only for strings that were not interned.
+*/
+
+const char *intern(const char *s);
+
+// true for the pointers returned by intern()
+bool is_interned(const char *s);
+
+// the simple_hash() of the symbol characters
+unsigned interned_hash(const char *s);
+
+
+#endif
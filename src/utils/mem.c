@@ -16,6 +16,9 @@ static long stats_bytes_housekeeping = 0;
 static long stats_allocations = 0;
 static long stats_freeings = 0;
 
+static long stats_collections = 0;
+static long stats_collected = 0;
+
 static long snapshot_bytes_allocated = 0;
 static long snapshot_bytes_freed = 0;
 static long snapshot_bytes_housekeeping = 0;
@@ -101,11 +104,28 @@ void *__mem_realloc(void *ptr, int new_size, const char *reason, const char *fil
     return new_ptr;
 }
 
+void mem_stats_add_allocation(int size) {
+    stats_allocations += 1;
+    stats_bytes_allocated += size;
+}
+
+void mem_stats_add_freeing(int size) {
+    stats_freeings += 1;
+    stats_bytes_freed += size;
+}
+
+void mem_stats_add_collection(long collected) {
+    stats_collections += 1;
+    stats_collected += collected;
+}
+
 long mem_stats_bytes_allocated()    { return stats_bytes_allocated; }
 long mem_stats_bytes_freed()        { return stats_bytes_freed; }
 long mem_stats_bytes_housekeeping() { return stats_bytes_housekeeping; }
 long mem_stats_allocations()        { return stats_allocations; }
 long mem_stats_freeings()           { return stats_freeings; }
+long mem_stats_collections()        { return stats_collections; }
+long mem_stats_collected()          { return stats_collected; }
 void mem_set_verbose_mode(int verbose) { stats_verbose_mode = verbose; }
 
 
@@ -133,6 +153,8 @@ void mem_stats_compare_snapshot() {
         stats_allocations, stats_freeings, (stats_allocations - stats_freeings));
     printf("Total bytes        %10ld   %10ld   %10ld\n", 
         stats_bytes_allocated, stats_bytes_freed, (stats_bytes_allocated - stats_bytes_freed));
+    printf("Cycle collections  %10ld, freeing %ld containers\n", 
+        stats_collections, stats_collected);
 }
 
 
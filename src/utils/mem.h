@@ -11,11 +11,18 @@ void *__mem_alloc(int size, const char *size_str, const char *file, int line);
 void *__mem_realloc(void *ptr, int new_size, const char *size_str, const char *file, int line);
 void __mem_free(void *ptr, const char *file, int line);
 
+// for allocators that manage their own memory, e.g. slabs
+void mem_stats_add_allocation(int size);
+void mem_stats_add_freeing(int size);
+void mem_stats_add_collection(long collected);
+
 long mem_stats_bytes_allocated();
 long mem_stats_bytes_freed();
 long mem_stats_bytes_housekeeping();
 long mem_stats_allocations();
 long mem_stats_freeings();
+long mem_stats_collections();      // cycle collections run
+long mem_stats_collected();        // containers freed by them
 void mem_set_verbose_mode(int verbose);
 
 
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <string.h>
+#include "slab.h"
+#include "mem.h"
+
+// we manage our own memory here, only reporting usage to mem stats
+#undef malloc
+#undef free
+
+#define SLAB_GRANULARITY   16
+#define SLAB_MAX_SIZE      512
+#define SLAB_CHUNK_SIZE    (64 * 1024)
+#define SLAB_CLASSES       (SLAB_MAX_SIZE / SLAB_GRANULARITY)
+
+typedef struct free_block {
+    struct free_block *next;
+} free_block;
+
+struct slab_pool {
+    int block_size;
+    int oversized; // blocks are malloc'ed one by one
+    free_block *free_list;
+    char *chunk_next; // bump allocation in the latest chunk
+    char *chunk_end;
+};
+
+static slab_pool pools[SLAB_CLASSES];
+
+
+slab_pool *slab_pool_for_size(int size) {
+    if (size < (int)sizeof(free_block))
+        size = sizeof(free_block);
+    
+    // sizes above the largest class get a pool of their own
+    if (size > SLAB_MAX_SIZE) {
+        slab_pool *pool = malloc(sizeof(slab_pool));
+        memset(pool, 0, sizeof(slab_pool));
+        pool->block_size = size;
+        pool->oversized = 1;
+        return pool;
+    }
+
+    int index = (size - 1) / SLAB_GRANULARITY;
+    pools[index].block_size = (index + 1) * SLAB_GRANULARITY;
+    return &pools[index];
+}
+
+#ifdef PLAIN_MALLOC
+
+void *slab_alloc(slab_pool *pool) {
+    mem_stats_add_allocation(pool->block_size);
+    return malloc(pool->block_size);
+}
+
+void slab_free(slab_pool *pool, void *ptr) {
+    mem_stats_add_freeing(pool->block_size);
+    free(ptr);
+}
+
+#else
+
+void *slab_alloc(slab_pool *pool) {
+    mem_stats_add_allocation(pool->block_size);
+
+    if (pool->free_list != NULL) {
+        free_block *block = pool->free_list;
+        pool->free_list = block->next;
+        return block;
+    }
+
+    if (pool->oversized)
+        return malloc(pool->block_size);
+    
+    if (pool->chunk_next == NULL || pool->chunk_next + pool->block_size > pool->chunk_end) {
+        // the tail of the previous chunk, if any, is wasted
+        pool->chunk_next = malloc(SLAB_CHUNK_SIZE);
+        if (pool->chunk_next == NULL)
+            return NULL;
+        pool->chunk_end = pool->chunk_next + SLAB_CHUNK_SIZE;
+    }
+
+    void *ptr = pool->chunk_next;
+    pool->chunk_next += pool->block_size;
+    return ptr;
+}
+
+void slab_free(slab_pool *pool, void *ptr) {
+    if (ptr == NULL)
+        return;
+    mem_stats_add_freeing(pool->block_size);
+
+    free_block *block = ptr;
+    block->next = pool->free_list;
+    pool->free_list = block;
+}
+
+#endif
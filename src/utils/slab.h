@@ -0,0 +1,22 @@
+#ifndef _SLAB_H
+#define _SLAB_H
+
+/*
+    Pools of same sized blocks, for small objects that are allocated
+    and freed all the time, e.g. variant instances.
+    Sizes are rounded up to size classes, all users of a size class share a pool.
+    Blocks are carved out of large chunks, freed blocks are kept in a freelist
+    and are reused before carving new ones. Chunks are never returned.
+
+    Build with -DPLAIN_MALLOC to use malloc() and free() for every block,
+    e.g. for address sanitizer or valgrind runs.
+*/
+
+typedef struct slab_pool slab_pool;
+
+slab_pool *slab_pool_for_size(int size);
+void *slab_alloc(slab_pool *pool);
+void slab_free(slab_pool *pool, void *ptr);
+
+
+#endif
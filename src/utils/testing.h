@@ -98,7 +98,7 @@ bool testing_outcome();
     } else { \
         __testing_failed("Variant is not of the expected type", extra, file, line);  \
         printf("    Expected: %s\n", expected_type->name);  \
-        printf("    Actual  : %s\n", actual_variant->_type->name);  \
+        printf("    Actual  : %s\n", variant_type_of(actual_variant)->name);  \
     }
 
 #define assert_variants_are_equal_fl(actual, expected, extra, file, line) \